@@ -4,6 +4,7 @@
 #include <cstring>
 #include <stdlib.h>
 #include <stdio.h>
+#include "mock-server.h"
 
 const int MAX_THREAD = 1;
 #define OPERATION_PER_SECOND_LABEL "nb operations per second"
@@ -20,6 +21,8 @@ std::string DB_DATABASE = GetEnvironmentVariableOrDefault("TEST_DB_DATABASE", "b
 std::string DB_USER = GetEnvironmentVariableOrDefault("TEST_DB_USER", "root");
 std::string DB_HOST = GetEnvironmentVariableOrDefault("TEST_DB_HOST", "127.0.0.1");
 std::string DB_PASSWORD = GetEnvironmentVariableOrDefault("TEST_DB_PASSWORD", "");
+// TEST_MOCK_SERVER=1 runs the benchmarks against an in-process mock server
+std::string MOCK_SERVER = GetEnvironmentVariableOrDefault("TEST_MOCK_SERVER", "");
 
 #define check_conn_rc(rc, mysql) \
 do {\
@@ -46,6 +49,8 @@ do {\
 
 #ifndef BENCHMARK_MYSQL
 #include <mysql.h>
+#include <mariadb_pool.h>
+#include <mariadb_uring.h>
 const std::string TYPE = "MariaDB";
 
 MYSQL* connect(std::string options) {
@@ -117,6 +122,19 @@ static void BM_DO_1(benchmark::State& state) {
 
 BENCHMARK(BM_DO_1)->Name(TYPE + " DO 1")->ThreadRange(1, MAX_THREAD)->UseRealTime();
 
+static void BM_CONNECT_DO_1(benchmark::State& state) {
+  int numOperation = 0;
+  for (auto _ : state) {
+    MYSQL *conn = connect("");
+    do_1(state, conn);
+    mysql_close(conn);
+    numOperation++;
+  }
+  state.counters[OPERATION_PER_SECOND_LABEL] = benchmark::Counter(numOperation, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_CONNECT_DO_1)->Name(TYPE + " connect + DO 1 + close")->ThreadRange(1, MAX_THREAD)->UseRealTime();
+
 
 
 
@@ -328,6 +346,21 @@ static void BM_SELECT_100_INT_COLS_WITH_PREPARE(benchmark::State& state) {
   mysql_close(conn);
 }
 
+#ifndef BENCHMARK_MYSQL
+static void BM_SELECT_100_INT_COLS_WITH_PREPARE_CACHED(benchmark::State& state) {
+  MYSQL *conn = connect("");
+  unsigned int cache_size = 16;
+  mysql_optionsv(conn, MARIADB_OPT_STMT_CACHE_SIZE, &cache_size);
+  int numOperation = 0;
+  for (auto _ : state) {
+    select_100_int_cols_with_prepare(state, conn);
+    numOperation++;
+  }
+  state.counters[OPERATION_PER_SECOND_LABEL] = benchmark::Counter(numOperation, benchmark::Counter::kIsRate);
+  mysql_close(conn);
+}
+#endif
+
 static void BM_SELECT_100_INT_COLS_PREPARED(benchmark::State& state) {
   MYSQL *conn = connect("");
   MYSQL_STMT *stmt = mysql_stmt_init(conn);
@@ -349,6 +382,109 @@ static void BM_SELECT_100_INT_COLS_PREPARED(benchmark::State& state) {
 BENCHMARK(BM_SELECT_100_INT_COLS)->Name(TYPE + " SELECT 100 int cols")->ThreadRange(1, MAX_THREAD)->UseRealTime()->Setup(setup_select_100_int_cols);
 BENCHMARK(BM_SELECT_100_INT_COLS_WITH_PREPARE)->Name(TYPE + " SELECT 100 int cols - BINARY prepare+execute+close")->ThreadRange(1, MAX_THREAD)->UseRealTime();
 BENCHMARK(BM_SELECT_100_INT_COLS_PREPARED)->Name(TYPE + " SELECT 100 int cols - BINARY execute only")->ThreadRange(1, MAX_THREAD)->UseRealTime();
+#ifndef BENCHMARK_MYSQL
+BENCHMARK(BM_SELECT_100_INT_COLS_WITH_PREPARE_CACHED)->Name(TYPE + " SELECT 100 int cols - BINARY prepare+execute+close with statement cache")->ThreadRange(1, MAX_THREAD)->UseRealTime();
+#endif
+
+
+
+void select_1000_numeric_strings(benchmark::State& state, MYSQL* conn, MYSQL_STMT* stmt) {
+  int rc;
+  long long int_data;
+  double double_data;
+
+  MYSQL_BIND my_bind[2];
+  memset(my_bind, 0, sizeof(my_bind));
+
+  my_bind[0].buffer_type= MYSQL_TYPE_LONGLONG;
+  my_bind[0].buffer= (char *) &int_data;
+  my_bind[1].buffer_type= MYSQL_TYPE_DOUBLE;
+  my_bind[1].buffer= (char *) &double_data;
+
+  rc = mysql_stmt_execute(stmt);
+  check_conn_rc(rc, conn);
+
+  rc = mysql_stmt_bind_result(stmt, my_bind);
+  check_stmt_rc(rc, stmt, conn);
+
+  rc = mysql_stmt_store_result(stmt);
+  check_stmt_rc(rc, stmt, conn);
+
+  while (!mysql_stmt_fetch(stmt)) {
+    benchmark::DoNotOptimize(int_data);
+    benchmark::DoNotOptimize(double_data);
+  }
+}
+
+static void BM_SELECT_1000_NUMERIC_STRINGS(benchmark::State& state) {
+  MYSQL *conn = connect("");
+  MYSQL_STMT *stmt = mysql_stmt_init(conn);
+  std::string query = "select CAST(seq * 1234567891 AS CHAR), CAST(seq / 7 AS CHAR) from seq_1_to_1000";
+  int rc;
+
+  rc = mysql_stmt_prepare(stmt, query.c_str(), (unsigned long)query.size());
+  check_conn_rc(rc, conn);
+  int numOperation = 0;
+  for (auto _ : state) {
+    select_1000_numeric_strings(state, conn, stmt);
+    numOperation++;
+  }
+  state.counters[OPERATION_PER_SECOND_LABEL] = benchmark::Counter(numOperation, benchmark::Counter::kIsRate);
+  mysql_stmt_close(stmt);
+  mysql_close(conn);
+}
+
+BENCHMARK(BM_SELECT_1000_NUMERIC_STRINGS)->Name(TYPE + " SELECT 1000 rows - BINARY string to bigint/double conversion")->ThreadRange(1, MAX_THREAD)->UseRealTime();
+
+
+void select_1000_double_to_string(benchmark::State& state, MYSQL* conn, MYSQL_STMT* stmt) {
+  int rc;
+  char str_data[2][64];
+  unsigned long length[2];
+
+  MYSQL_BIND my_bind[2];
+  memset(my_bind, 0, sizeof(my_bind));
+
+  for (int i = 0; i < 2; i++) {
+    my_bind[i].buffer_type= MYSQL_TYPE_STRING;
+    my_bind[i].buffer= str_data[i];
+    my_bind[i].buffer_length= sizeof(str_data[i]);
+    my_bind[i].length= &length[i];
+  }
+
+  rc = mysql_stmt_execute(stmt);
+  check_conn_rc(rc, conn);
+
+  rc = mysql_stmt_bind_result(stmt, my_bind);
+  check_stmt_rc(rc, stmt, conn);
+
+  rc = mysql_stmt_store_result(stmt);
+  check_stmt_rc(rc, stmt, conn);
+
+  while (!mysql_stmt_fetch(stmt)) {
+    benchmark::DoNotOptimize(str_data);
+  }
+}
+
+static void BM_SELECT_1000_DOUBLE_TO_STRING(benchmark::State& state) {
+  MYSQL *conn = connect("");
+  MYSQL_STMT *stmt = mysql_stmt_init(conn);
+  std::string query = "select CAST(seq / 7 AS DOUBLE), CAST(seq * 0.01 AS DOUBLE) from seq_1_to_1000";
+  int rc;
+
+  rc = mysql_stmt_prepare(stmt, query.c_str(), (unsigned long)query.size());
+  check_conn_rc(rc, conn);
+  int numOperation = 0;
+  for (auto _ : state) {
+    select_1000_double_to_string(state, conn, stmt);
+    numOperation++;
+  }
+  state.counters[OPERATION_PER_SECOND_LABEL] = benchmark::Counter(numOperation, benchmark::Counter::kIsRate);
+  mysql_stmt_close(stmt);
+  mysql_close(conn);
+}
+
+BENCHMARK(BM_SELECT_1000_DOUBLE_TO_STRING)->Name(TYPE + " SELECT 1000 rows - BINARY double to string conversion")->ThreadRange(1, MAX_THREAD)->UseRealTime();
 
 
 
@@ -550,7 +686,254 @@ BENCHMARK(BM_INSERT_BATCH_WITH_PREPARE)->Name(TYPE + " insert batch looping exec
 
   BENCHMARK(BM_SELECT_100_INT_COLS_WITH_PREPARE_PIPELINE)->Name(TYPE + " SELECT 100 int cols - BINARY pipeline prepare+execute+close")->ThreadRange(1, MAX_THREAD)->UseRealTime()->Setup(setup_insert_batch);
 
+  void do_50_pipeline(benchmark::State& state, MYSQL* conn) {
+    int rc;
+
+    rc = mariadb_pipeline_begin(conn);
+    check_conn_rc(rc, conn);
+    for (int i = 0; i < 50; i++) {
+      rc = mariadb_pipeline_query(conn, "DO 1", 4);
+      check_conn_rc(rc, conn);
+    }
+    rc = mariadb_pipeline_flush(conn);
+    check_conn_rc(rc, conn);
+    while ((rc = mariadb_pipeline_next_result(conn, NULL)) == 0) {
+      //
+    }
+    if (rc != -1)
+      check_conn_rc(rc, conn);
+  }
+
+  static void BM_DO_50_PIPELINE(benchmark::State& state) {
+    MYSQL *conn = connect("");
+    int numOperation = 0;
+    for (auto _ : state) {
+      do_50_pipeline(state, conn);
+      numOperation++;
+    }
+    state.counters[OPERATION_PER_SECOND_LABEL] = benchmark::Counter(numOperation, benchmark::Counter::kIsRate);
+    mysql_close(conn);
+  }
+
+  BENCHMARK(BM_DO_50_PIPELINE)->Name(TYPE + " DO 1 x 50 - pipeline")->ThreadRange(1, MAX_THREAD)->UseRealTime();
+
+  static MARIADB_POOL *pool = NULL;
+
+  static int pool_init_connection(MYSQL *conn, void *data) {
+    enum mysql_protocol_type prot_type= MYSQL_PROTOCOL_TCP;
+    return mysql_optionsv(conn, MYSQL_OPT_PROTOCOL, (void *)&prot_type);
+  }
+
+  static void setup_pool(const benchmark::State& state) {
+    pool = mariadb_pool_init();
+    mariadb_pool_optionsv(pool, MARIADB_POOL_MAX_SIZE, MAX_THREAD);
+    mariadb_pool_optionsv(pool, MARIADB_POOL_INIT_CALLBACK, pool_init_connection, (void *)NULL);
+    if (mariadb_pool_open(pool, DB_HOST.c_str(), DB_USER.c_str(), DB_PASSWORD.c_str(),
+                          DB_DATABASE.c_str(), atoi(DB_PORT.c_str()), NULL, 0)) {
+      fprintf(stderr, "%s\n", mariadb_pool_error(pool));
+      exit(1);
+    }
+  }
+
+  static void teardown_pool(const benchmark::State& state) {
+    mariadb_pool_close(pool);
+    pool = NULL;
+  }
+
+  static void BM_POOL_DO_1(benchmark::State& state) {
+    int numOperation = 0;
+    for (auto _ : state) {
+      MYSQL *conn = mariadb_pool_acquire(pool);
+      if (!conn) {
+        fprintf(stderr, "%s\n", mariadb_pool_error(pool));
+        exit(1);
+      }
+      do_1(state, conn);
+      mariadb_pool_release(pool, conn);
+      numOperation++;
+    }
+    state.counters[OPERATION_PER_SECOND_LABEL] = benchmark::Counter(numOperation, benchmark::Counter::kIsRate);
+  }
+
+  BENCHMARK(BM_POOL_DO_1)->Name(TYPE + " pool acquire + DO 1 + release")->ThreadRange(1, MAX_THREAD)->UseRealTime()->Setup(setup_pool)->Teardown(teardown_pool);
+
+  extern "C" {
+    int STDCALL mysql_real_query_start(int *ret, MYSQL *mysql, const char *query, unsigned long length);
+    int STDCALL mysql_real_query_cont(int *ret, MYSQL *mysql, int status);
+  }
+
+  // a NULL ring gives the connection a private ring
+  MYSQL* connect_io_uring(MARIADB_URING *ring, bool nonblock) {
+    MYSQL *con = mysql_init(NULL);
+    enum mysql_protocol_type prot_type= MYSQL_PROTOCOL_TCP;
+    mysql_optionsv(con, MYSQL_OPT_PROTOCOL, (void *)&prot_type);
+    mysql_optionsv(con, MARIADB_OPT_IO_URING, ring);
+    if (nonblock)
+      mysql_optionsv(con, MYSQL_OPT_NONBLOCK, 0);
+
+    if (mysql_real_connect(con, DB_HOST.c_str(), DB_USER.c_str(), DB_PASSWORD.c_str(),
+            DB_DATABASE.c_str(), atoi(DB_PORT.c_str()), NULL, 0) == NULL) {
+      fprintf(stderr, "%s\n", mysql_error(con));
+      mysql_close(con);
+      exit(1);
+    }
+    return con;
+  }
+
+  static void BM_DO_1_IO_URING(benchmark::State& state) {
+    MYSQL *conn = connect_io_uring(NULL, false);
+    int numOperation = 0;
+    for (auto _ : state) {
+      do_1(state, conn);
+      numOperation++;
+    }
+    state.counters[OPERATION_PER_SECOND_LABEL] = benchmark::Counter(numOperation, benchmark::Counter::kIsRate);
+    mysql_close(conn);
+  }
+
+  static void BM_SELECT_1000_ROWS_IO_URING(benchmark::State& state) {
+    MYSQL *conn = connect_io_uring(NULL, false);
+    int numOperation = 0;
+    for (auto _ : state) {
+      select_1000_rows(state, conn);
+      numOperation++;
+    }
+    state.counters[OPERATION_PER_SECOND_LABEL] = benchmark::Counter(numOperation, benchmark::Counter::kIsRate);
+    mysql_close(conn);
+  }
+
+  // DO 1 on 16 connections at once, driven by the non-blocking API on one shared ring
+  static void BM_DO_1_IO_URING_SHARED(benchmark::State& state) {
+    const int count = 16;
+    MYSQL *conns[count], *ready[count];
+    MARIADB_URING_STATS stats;
+    MARIADB_URING *ring = mariadb_uring_init(256);
+    int numOperation = 0;
+
+    if (!ring) {
+      state.SkipWithError("io_uring not available");
+      for (auto _ : state) {}
+      return;
+    }
+    for (int i = 0; i < count; i++)
+      conns[i] = connect_io_uring(ring, true);
+    mariadb_uring_get_stats(ring, &stats);
+    unsigned long long enters = stats.enters;
+
+    for (auto _ : state) {
+      int pending = 0, err;
+      for (int i = 0; i < count; i++) {
+        MYSQL *conn = conns[i];
+        if (mysql_real_query_start(&err, conn, "DO 1", 4))
+          pending++;
+        else
+          check_conn_rc(err, conn);
+      }
+      while (pending) {
+        int n = mariadb_uring_wait(ring, ready, count, 1000);
+        if (n < 0) {
+          fprintf(stderr, "mariadb_uring_wait failed\n");
+          exit(1);
+        }
+        for (int i = 0; i < n; i++) {
+          MYSQL *conn = ready[i];
+          if (!mysql_real_query_cont(&err, conn, MYSQL_WAIT_READ)) {
+            check_conn_rc(err, conn);
+            pending--;
+          }
+        }
+      }
+      numOperation += count;
+    }
+    mariadb_uring_get_stats(ring, &stats);
+    state.counters[OPERATION_PER_SECOND_LABEL] = benchmark::Counter(numOperation, benchmark::Counter::kIsRate);
+    state.counters["system calls per operation"] = numOperation ? (double)(stats.enters - enters) / numOperation : 0;
+    mariadb_uring_close(ring);
+    for (int i = 0; i < count; i++)
+      mysql_close(conns[i]);
+  }
+
+  BENCHMARK(BM_DO_1_IO_URING)->Name(TYPE + " DO 1 - io_uring")->ThreadRange(1, MAX_THREAD)->UseRealTime();
+  BENCHMARK(BM_SELECT_1000_ROWS_IO_URING)->Name(TYPE + " SELECT 1000 rows (int + char(32)) - io_uring")->ThreadRange(1, MAX_THREAD)->UseRealTime();
+  BENCHMARK(BM_DO_1_IO_URING_SHARED)->Name(TYPE + " DO 1 x 16 connections - io_uring shared ring")->ThreadRange(1, MAX_THREAD)->UseRealTime();
+
 #endif
 
 
-BENCHMARK_MAIN();
+// result sets of the queries above, as returned by a MariaDB server
+static void register_mock_results(mock::Server& server) {
+  mock::ResultSet select_1;
+  select_1.rows = 1;
+  select_1.columns.push_back(mock::Column("1", mock::TYPE_INT,
+      [](size_t row, std::string& value) { value = "1"; return true; }));
+  server.add_result("SELECT 1", select_1);
+
+  mock::ResultSet rows_1000;
+  rows_1000.rows = 1000;
+  rows_1000.columns.push_back(mock::Column("seq", mock::TYPE_BIGINT,
+      [](size_t row, std::string& value) { value = std::to_string(row + 1); return true; }, true));
+  rows_1000.columns.push_back(mock::Column("abcdefghijabcdefghijabcdefghijaa", mock::TYPE_VARCHAR,
+      [](size_t row, std::string& value) { value = "abcdefghijabcdefghijabcdefghijaa"; return true; }));
+  server.add_result("select seq, 'abcdefghijabcdefghijabcdefghijaa' from seq_1_to_1000", rows_1000);
+
+  mock::ResultSet int_cols;
+  int_cols.rows = 1;
+  for (int i = 0; i < 100; i++) {
+    int_cols.columns.push_back(mock::Column("i" + std::to_string(i + 1), mock::TYPE_INT,
+        [i](size_t row, std::string& value) { value = std::to_string(i + 1); return true; }));
+  }
+  server.add_result("select * FROM test100", int_cols);
+
+  mock::ResultSet numeric_strings;
+  numeric_strings.rows = 1000;
+  numeric_strings.columns.push_back(mock::Column("CAST(seq * 1234567891 AS CHAR)", mock::TYPE_VARCHAR,
+      [](size_t row, std::string& value) { value = std::to_string((row + 1) * 1234567891ULL); return true; }));
+  numeric_strings.columns.push_back(mock::Column("CAST(seq / 7 AS CHAR)", mock::TYPE_VARCHAR,
+      [](size_t row, std::string& value) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.4f", (row + 1) / 7.0);
+        value = buf;
+        return true;
+      }));
+  server.add_result("select CAST(seq * 1234567891 AS CHAR), CAST(seq / 7 AS CHAR) from seq_1_to_1000", numeric_strings);
+
+  mock::ResultSet doubles;
+  doubles.rows = 1000;
+  doubles.columns.push_back(mock::Column("CAST(seq / 7 AS DOUBLE)", mock::TYPE_DOUBLE,
+      [](size_t row, std::string& value) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.4f", (row + 1) / 7.0);
+        value = buf;
+        return true;
+      }));
+  doubles.columns.push_back(mock::Column("CAST(seq * 0.01 AS DOUBLE)", mock::TYPE_DOUBLE,
+      [](size_t row, std::string& value) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.2f", (row + 1) * 0.01);
+        value = buf;
+        return true;
+      }));
+  server.add_result("select CAST(seq / 7 AS DOUBLE), CAST(seq * 0.01 AS DOUBLE) from seq_1_to_1000", doubles);
+}
+
+int main(int argc, char** argv) {
+  mock::Server server;
+
+  if (MOCK_SERVER == "1") {
+    register_mock_results(server);
+    int port = server.start();
+    if (port < 0) {
+      fprintf(stderr, "unable to start mock server\n");
+      return 1;
+    }
+    DB_HOST = "127.0.0.1";
+    DB_PORT = std::to_string(port);
+  }
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,539 @@
+#include "mock-server.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace mock {
+
+enum {
+  COM_QUIT = 1,
+  COM_INIT_DB = 2,
+  COM_QUERY = 3,
+  COM_PING = 14,
+  COM_STMT_PREPARE = 22,
+  COM_STMT_EXECUTE = 23,
+  COM_STMT_SEND_LONG_DATA = 24,
+  COM_STMT_CLOSE = 25,
+  COM_STMT_RESET = 26,
+  COM_SET_OPTION = 27,
+  COM_RESET_CONNECTION = 31,
+  COM_STMT_BULK_EXECUTE = 250
+};
+
+static const unsigned int CAPABILITIES =
+  4 |          /* CLIENT_LONG_FLAG */
+  8 |          /* CLIENT_CONNECT_WITH_DB */
+  512 |        /* CLIENT_PROTOCOL_41 */
+  8192 |       /* CLIENT_TRANSACTIONS */
+  32768 |      /* CLIENT_SECURE_CONNECTION */
+  (1U << 16) | /* CLIENT_MULTI_STATEMENTS */
+  (1U << 17) | /* CLIENT_MULTI_RESULTS */
+  (1U << 18) | /* CLIENT_PS_MULTI_RESULTS */
+  (1U << 19);  /* CLIENT_PLUGIN_AUTH */
+static const unsigned int MARIADB_CAPABILITIES = 4; /* STMT_BULK_OPERATIONS */
+static const unsigned short SERVER_STATUS = 2;      /* AUTOCOMMIT */
+static const unsigned int PACKET_MAX = 0xFFFFFF;
+
+struct Server::Response {
+  ResultSet result;
+  std::vector<std::string> column_defs;   /* payloads */
+  std::string text;                       /* complete COM_QUERY response */
+  std::string binary;                     /* complete COM_STMT_EXECUTE response */
+};
+
+/* {{{ encoding */
+static void put_int2(std::string &buf, unsigned int v) {
+  buf += (char)(v & 0xFF);
+  buf += (char)((v >> 8) & 0xFF);
+}
+
+static void put_int4(std::string &buf, unsigned int v) {
+  put_int2(buf, v & 0xFFFF);
+  put_int2(buf, v >> 16);
+}
+
+static void put_int8(std::string &buf, unsigned long long v) {
+  put_int4(buf, (unsigned int)v);
+  put_int4(buf, (unsigned int)(v >> 32));
+}
+
+static void put_lenenc(std::string &buf, unsigned long long v) {
+  if (v < 251) {
+    buf += (char)v;
+  } else if (v < 65536) {
+    buf += (char)0xFC;
+    put_int2(buf, (unsigned int)v);
+  } else if (v < 16777216) {
+    buf += (char)0xFD;
+    put_int2(buf, (unsigned int)(v & 0xFFFF));
+    buf += (char)(v >> 16);
+  } else {
+    buf += (char)0xFE;
+    put_int8(buf, v);
+  }
+}
+
+static void put_lenenc_str(std::string &buf, const std::string &s) {
+  put_lenenc(buf, s.size());
+  buf += s;
+}
+
+/* appends payload as one or more packets */
+static void put_packet(std::string &buf, const std::string &payload, unsigned char &seq) {
+  size_t pos = 0;
+  for (;;) {
+    size_t len = std::min((size_t)PACKET_MAX, payload.size() - pos);
+    put_int2(buf, (unsigned int)(len & 0xFFFF));
+    buf += (char)(len >> 16);
+    buf += (char)seq++;
+    buf.append(payload, pos, len);
+    pos += len;
+    if (len < PACKET_MAX)
+      break;
+  }
+}
+
+static std::string ok_payload(unsigned long long affected_rows = 0) {
+  std::string p(1, '\0');
+  put_lenenc(p, affected_rows);
+  put_lenenc(p, 0);
+  put_int2(p, SERVER_STATUS);
+  put_int2(p, 0);
+  return p;
+}
+
+static std::string eof_payload() {
+  std::string p(1, (char)0xFE);
+  put_int2(p, 0);
+  put_int2(p, SERVER_STATUS);
+  return p;
+}
+
+static std::string err_payload(unsigned int code, const char *sqlstate, const std::string &msg) {
+  std::string p(1, (char)0xFF);
+  put_int2(p, code);
+  p += '#';
+  p += sqlstate;
+  p += msg;
+  return p;
+}
+
+static std::string column_def(const std::string &name, ColumnType type, bool is_unsigned) {
+  std::string p;
+  unsigned int length, flags = is_unsigned ? 32 : 0;
+  unsigned int charset = 63;
+  unsigned char decimals = 0;
+
+  switch (type) {
+  case TYPE_INT: length = 11; break;
+  case TYPE_BIGINT: length = 20; break;
+  case TYPE_DOUBLE: length = 22; decimals = 31; break;
+  default: length = 1020; charset = 45; break;
+  }
+  if (charset == 63)
+    flags |= 128; /* BINARY_FLAG */
+
+  put_lenenc_str(p, "def");
+  put_lenenc_str(p, "");
+  put_lenenc_str(p, "");
+  put_lenenc_str(p, "");
+  put_lenenc_str(p, name);
+  put_lenenc_str(p, name);
+  p += (char)0x0C;
+  put_int2(p, charset);
+  put_int4(p, length);
+  p += (char)type;
+  put_int2(p, flags);
+  p += (char)decimals;
+  put_int2(p, 0);
+  return p;
+}
+
+static void put_binary_value(std::string &buf, ColumnType type, const std::string &value) {
+  switch (type) {
+  case TYPE_INT:
+    put_int4(buf, (unsigned int)strtoll(value.c_str(), NULL, 10));
+    break;
+  case TYPE_BIGINT:
+    put_int8(buf, (unsigned long long)strtoull(value.c_str(), NULL, 10));
+    break;
+  case TYPE_DOUBLE: {
+    double d = strtod(value.c_str(), NULL);
+    unsigned long long bits;
+    memcpy(&bits, &d, sizeof(bits));
+    put_int8(buf, bits);
+    break;
+  }
+  default:
+    put_lenenc_str(buf, value);
+    break;
+  }
+}
+/* }}} */
+
+static std::string normalize(const std::string &query) {
+  size_t start = query.find_first_not_of(" \t\r\n");
+  size_t end = query.find_last_not_of(" \t\r\n;");
+  std::string q = start == std::string::npos ? "" : query.substr(start, end - start + 1);
+  std::transform(q.begin(), q.end(), q.begin(), ::tolower);
+  return q;
+}
+
+bool ResultSet::load(const std::string &path, ResultSet &result) {
+  std::ifstream in(path.c_str());
+  std::string line;
+  std::shared_ptr<std::vector<std::vector<std::string> > > data(
+    new std::vector<std::vector<std::string> >());
+
+  if (!in || !std::getline(in, line))
+    return false;
+
+  std::vector<std::pair<std::string, ColumnType> > specs;
+  std::stringstream header(line);
+  std::string spec;
+  while (std::getline(header, spec, '\t')) {
+    size_t colon = spec.rfind(':');
+    std::string type = colon == std::string::npos ? "varchar" : normalize(spec.substr(colon + 1));
+    ColumnType t = type == "int" ? TYPE_INT : type == "bigint" ? TYPE_BIGINT :
+                   type == "double" ? TYPE_DOUBLE : TYPE_VARCHAR;
+    specs.push_back(std::make_pair(spec.substr(0, colon), t));
+  }
+
+  while (std::getline(in, line)) {
+    std::vector<std::string> row;
+    std::stringstream values(line);
+    std::string value;
+    while (std::getline(values, value, '\t'))
+      row.push_back(value);
+    row.resize(specs.size(), "\\N");
+    data->push_back(row);
+  }
+
+  result = ResultSet();
+  result.rows = data->size();
+  for (size_t i = 0; i < specs.size(); i++) {
+    result.columns.push_back(Column(specs[i].first, specs[i].second,
+      [data, i](size_t row, std::string &value) {
+        value = (*data)[row][i];
+        return value != "\\N";
+      }));
+  }
+  return true;
+}
+
+Server::Server() : listen_fd_(-1), port_(-1), running_(false) {}
+
+Server::~Server() {
+  stop();
+}
+
+void Server::add_result(const std::string &query, const ResultSet &result) {
+  std::shared_ptr<Response> r(new Response());
+  size_t columns = result.columns.size();
+  unsigned char seq = 1;
+  std::string count, value;
+
+  r->result = result;
+  for (size_t i = 0; i < columns; i++)
+    r->column_defs.push_back(column_def(result.columns[i].name, result.columns[i].type,
+                                        result.columns[i].is_unsigned));
+
+  /* text protocol */
+  put_lenenc(count, columns);
+  put_packet(r->text, count, seq);
+  for (size_t i = 0; i < columns; i++)
+    put_packet(r->text, r->column_defs[i], seq);
+  put_packet(r->text, eof_payload(), seq);
+  for (size_t row = 0; row < result.rows; row++) {
+    std::string p;
+    for (size_t i = 0; i < columns; i++) {
+      if (result.columns[i].value(row, value))
+        put_lenenc_str(p, value);
+      else
+        p += (char)0xFB;
+    }
+    put_packet(r->text, p, seq);
+  }
+  put_packet(r->text, eof_payload(), seq);
+
+  /* binary protocol */
+  seq = 1;
+  put_packet(r->binary, count, seq);
+  for (size_t i = 0; i < columns; i++)
+    put_packet(r->binary, r->column_defs[i], seq);
+  put_packet(r->binary, eof_payload(), seq);
+  for (size_t row = 0; row < result.rows; row++) {
+    std::string p(1, '\0');
+    size_t bitmap = p.size();
+    p.append((columns + 7 + 2) / 8, '\0');
+    for (size_t i = 0; i < columns; i++) {
+      if (result.columns[i].value(row, value))
+        put_binary_value(p, result.columns[i].type, value);
+      else
+        p[bitmap + (i + 2) / 8] |= (char)(1 << ((i + 2) % 8));
+    }
+    put_packet(r->binary, p, seq);
+  }
+  put_packet(r->binary, eof_payload(), seq);
+
+  std::lock_guard<std::mutex> guard(lock_);
+  results_[normalize(query)] = r;
+}
+
+const Server::Response *Server::find(const std::string &query) {
+  std::lock_guard<std::mutex> guard(lock_);
+  std::map<std::string, std::shared_ptr<Response> >::const_iterator it = results_.find(normalize(query));
+  return it == results_.end() ? NULL : it->second.get();
+}
+
+int Server::start(int port) {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  int on = 1;
+
+  if ((listen_fd_ = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    return -1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons((unsigned short)port);
+  if (bind(listen_fd_, (struct sockaddr *)&addr, sizeof(addr)) ||
+      listen(listen_fd_, 128) ||
+      getsockname(listen_fd_, (struct sockaddr *)&addr, &len)) {
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return -1;
+  }
+  port_ = ntohs(addr.sin_port);
+  running_ = true;
+  acceptor_ = std::thread(&Server::accept_loop, this);
+  return port_;
+}
+
+void Server::stop() {
+  if (!running_)
+    return;
+  running_ = false;
+  shutdown(listen_fd_, SHUT_RDWR);
+  close(listen_fd_);
+  acceptor_.join();
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    for (size_t i = 0; i < connections_.size(); i++)
+      shutdown(connections_[i], SHUT_RDWR);
+  }
+  for (size_t i = 0; i < threads_.size(); i++)
+    threads_[i].join();
+  threads_.clear();
+}
+
+void Server::accept_loop() {
+  unsigned int thread_id = 0;
+  for (;;) {
+    int fd = accept(listen_fd_, NULL, NULL);
+    if (fd < 0) {
+      if (!running_)
+        return;
+      continue;
+    }
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    std::lock_guard<std::mutex> guard(lock_);
+    connections_.push_back(fd);
+    threads_.push_back(std::thread(&Server::handle, this, fd, ++thread_id));
+  }
+}
+
+static bool write_all(int fd, const std::string &buf) {
+  size_t pos = 0;
+  while (pos < buf.size()) {
+    ssize_t n = send(fd, buf.data() + pos, buf.size() - pos, MSG_NOSIGNAL);
+    if (n <= 0)
+      return false;
+    pos += (size_t)n;
+  }
+  return true;
+}
+
+static bool read_all(int fd, char *buf, size_t len) {
+  while (len) {
+    ssize_t n = recv(fd, buf, len, 0);
+    if (n <= 0)
+      return false;
+    buf += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+/* reads a command, joining packets of 16M - 1 bytes */
+static bool read_packet(int fd, std::string &payload) {
+  unsigned char header[4];
+  size_t len;
+
+  payload.clear();
+  do {
+    if (!read_all(fd, (char *)header, 4))
+      return false;
+    len = header[0] | (header[1] << 8) | (header[2] << 16);
+    size_t pos = payload.size();
+    payload.resize(pos + len);
+    if (len && !read_all(fd, &payload[pos], len))
+      return false;
+  } while (len == PACKET_MAX);
+  return true;
+}
+
+static bool reply(int fd, const std::string &payload) {
+  std::string buf;
+  unsigned char seq = 1;
+  put_packet(buf, payload, seq);
+  return write_all(fd, buf);
+}
+
+void Server::handle(int fd, unsigned int thread_id) {
+  std::map<unsigned int, const Response *> statements;
+  unsigned int stmt_id = 0;
+  std::string payload, buf;
+  unsigned char seq = 0;
+
+  /* handshake */
+  std::string hs(1, (char)10);
+  hs += "5.5.5-11.4.0-MariaDB-mock";
+  hs += '\0';
+  put_int4(hs, thread_id);
+  hs += "01234567";
+  hs += '\0';
+  put_int2(hs, CAPABILITIES & 0xFFFF);
+  hs += (char)45;
+  put_int2(hs, SERVER_STATUS);
+  put_int2(hs, CAPABILITIES >> 16);
+  hs += (char)21;
+  hs.append(6, '\0');
+  put_int4(hs, MARIADB_CAPABILITIES);
+  hs += "890123456789";
+  hs += '\0';
+  hs += "mysql_native_password";
+  hs += '\0';
+  put_packet(buf, hs, seq);
+
+  /* credentials are not checked */
+  if (!write_all(fd, buf) || !read_packet(fd, payload))
+    goto end;
+  buf.clear();
+  seq = 2;
+  put_packet(buf, ok_payload(), seq);
+  if (!write_all(fd, buf))
+    goto end;
+
+  while (read_packet(fd, payload) && !payload.empty()) {
+    unsigned char command = (unsigned char)payload[0];
+    bool ok = true;
+
+    switch (command) {
+    case COM_QUIT:
+      goto end;
+    case COM_QUERY: {
+      std::string query = payload.substr(1);
+      const Response *r = find(query);
+      if (r)
+        ok = write_all(fd, r->text);
+      else if (normalize(query).compare(0, 6, "select") == 0)
+        ok = reply(fd, err_payload(1146, "42S02", "Mock server: no result set for '" + query + "'"));
+      else
+        ok = reply(fd, ok_payload());
+      break;
+    }
+    case COM_STMT_PREPARE: {
+      std::string query = payload.substr(1);
+      const Response *r = find(query);
+      unsigned int params = (unsigned int)std::count(query.begin(), query.end(), '?');
+      unsigned int columns = r ? (unsigned int)r->column_defs.size() : 0;
+      std::string p(1, '\0');
+
+      statements[++stmt_id] = r;
+      put_int4(p, stmt_id);
+      put_int2(p, columns);
+      put_int2(p, params);
+      p += '\0';
+      put_int2(p, 0);
+
+      buf.clear();
+      seq = 1;
+      put_packet(buf, p, seq);
+      if (params) {
+        std::string def = column_def("?", TYPE_VARCHAR, false);
+        for (unsigned int i = 0; i < params; i++)
+          put_packet(buf, def, seq);
+        put_packet(buf, eof_payload(), seq);
+      }
+      if (columns) {
+        for (unsigned int i = 0; i < columns; i++)
+          put_packet(buf, r->column_defs[i], seq);
+        put_packet(buf, eof_payload(), seq);
+      }
+      ok = write_all(fd, buf);
+      break;
+    }
+    case COM_STMT_EXECUTE:
+    case COM_STMT_BULK_EXECUTE: {
+      unsigned int id = payload.size() >= 5 ?
+        (unsigned char)payload[1] | ((unsigned char)payload[2] << 8) |
+        ((unsigned char)payload[3] << 16) | ((unsigned int)(unsigned char)payload[4] << 24) : 0;
+      /* mariadb_stmt_execute_direct() refers to the last prepared statement */
+      if (id == 0xFFFFFFFF)
+        id = stmt_id;
+      std::map<unsigned int, const Response *>::const_iterator it = statements.find(id);
+      if (it == statements.end())
+        ok = reply(fd, err_payload(1243, "HY000", "Unknown prepared statement handler"));
+      else if (it->second && command == COM_STMT_EXECUTE)
+        ok = write_all(fd, it->second->binary);
+      else
+        ok = reply(fd, ok_payload());
+      break;
+    }
+    case COM_STMT_CLOSE: {
+      if (payload.size() >= 5) {
+        unsigned int id = (unsigned char)payload[1] | ((unsigned char)payload[2] << 8) |
+          ((unsigned char)payload[3] << 16) | ((unsigned int)(unsigned char)payload[4] << 24);
+        statements.erase(id);
+      }
+      break;
+    }
+    case COM_STMT_SEND_LONG_DATA:
+      break;
+    case COM_SET_OPTION:
+      ok = reply(fd, eof_payload());
+      break;
+    case COM_INIT_DB:
+    case COM_PING:
+    case COM_STMT_RESET:
+    case COM_RESET_CONNECTION:
+      ok = reply(fd, ok_payload());
+      break;
+    default:
+      ok = reply(fd, err_payload(1047, "08S01", "Unknown command"));
+      break;
+    }
+    if (!ok)
+      break;
+  }
+
+end:
+  std::lock_guard<std::mutex> guard(lock_);
+  connections_.erase(std::remove(connections_.begin(), connections_.end(), fd), connections_.end());
+  close(fd);
+}
+
+}
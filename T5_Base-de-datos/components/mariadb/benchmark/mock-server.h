@@ -0,0 +1,98 @@
+/*
+  Mock MariaDB server for the client benchmarks.
+
+  Speaks enough of the client/server protocol to run main-benchmark.cc
+  without a database: handshake (mysql_native_password, any credentials
+  are accepted), COM_QUERY, COM_STMT_PREPARE/EXECUTE/CLOSE/RESET,
+  COM_STMT_BULK_EXECUTE, COM_PING, COM_INIT_DB and COM_RESET_CONNECTION.
+
+  Result sets are registered per query text, either synthetic (rows x
+  columns, values generated per row) or recorded (tab separated file).
+  Responses are encoded once when a result set is registered, so the
+  server spends almost no CPU per query and benchmark numbers are
+  dominated by the client.
+
+  Queries which have no registered result set return an OK packet, unless
+  they start with SELECT, in which case an error is returned.
+*/
+#ifndef MOCK_SERVER_H
+#define MOCK_SERVER_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mock {
+
+/* protocol type codes, see enum enum_field_types */
+enum ColumnType {
+  TYPE_INT = 3,
+  TYPE_DOUBLE = 5,
+  TYPE_BIGINT = 8,
+  TYPE_VARCHAR = 253
+};
+
+/* returns false if the value of the row is NULL */
+typedef std::function<bool(size_t row, std::string &value)> ValueFn;
+
+struct Column {
+  std::string name;
+  ColumnType type;
+  bool is_unsigned;
+  ValueFn value;       /* value in text protocol representation */
+
+  Column(const std::string &name, ColumnType type, ValueFn value, bool is_unsigned = false)
+    : name(name), type(type), is_unsigned(is_unsigned), value(value) {}
+};
+
+struct ResultSet {
+  std::vector<Column> columns;
+  size_t rows;
+
+  ResultSet() : rows(0) {}
+
+  /*
+    Reads a recorded result set. The first line contains the columns as
+    name:type (int, bigint, double, varchar), each following line one row.
+    Values are separated by tabs, \N is NULL.
+  */
+  static bool load(const std::string &path, ResultSet &result);
+};
+
+class Server {
+ public:
+  Server();
+  ~Server();
+
+  /* registers a result set, query text is compared case insensitive */
+  void add_result(const std::string &query, const ResultSet &result);
+
+  /* listens on 127.0.0.1, port 0 picks a free port. Returns the port or -1 */
+  int start(int port = 0);
+  void stop();
+  int port() const { return port_; }
+
+ private:
+  struct Response;
+
+  void accept_loop();
+  void handle(int fd, unsigned int thread_id);
+  const Response *find(const std::string &query);
+
+  std::map<std::string, std::shared_ptr<Response> > results_;
+  std::mutex lock_;
+  std::vector<std::thread> threads_;
+  std::vector<int> connections_;
+  std::thread acceptor_;
+  int listen_fd_;
+  int port_;
+  bool running_;
+};
+
+}
+
+#endif
@@ -36,6 +36,8 @@ ENDIF(HAVE_STDINT_H)
 CHECK_INCLUDE_FILES (stdlib.h HAVE_STDLIB_H)
 CHECK_INCLUDE_FILES (string.h HAVE_STRING_H)
 
+CHECK_INCLUDE_FILES (sys/epoll.h HAVE_EPOLL)
+CHECK_INCLUDE_FILES (linux/io_uring.h HAVE_LINUX_IO_URING_H)
 CHECK_INCLUDE_FILES (sys/ioctl.h HAVE_SYS_IOCTL_H)
 CHECK_INCLUDE_FILES (sys/select.h HAVE_SYS_SELECT_H)
 CHECK_INCLUDE_FILES (sys/socket.h HAVE_SYS_SOCKET_H)
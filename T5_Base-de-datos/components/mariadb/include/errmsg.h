@@ -116,10 +116,12 @@ extern const char *mariadb_client_errors[];	/* Error messages */
 #define CR_BINLOG_SEMI_SYNC_ERROR 5023
 #define CR_INVALID_CLIENT_FLAG 5024
 #define CR_STMT_NO_RESULT 5025
+#define CR_POOL_TIMEOUT 5026
+#define CR_LOOP_TIMEOUT 5027
 
 /* Always last, if you add new error codes please update the
    value for CR_MARIADB_LAST_ERROR */
-#define CR_MARIADB_LAST_ERROR CR_STMT_NO_RESULT
+#define CR_MARIADB_LAST_ERROR CR_LOOP_TIMEOUT
 
 #endif
 
@@ -88,6 +88,10 @@ struct st_mysql_options_extension {
   void (*status_callback)(void *ptr, enum enum_mariadb_status_info type, ...);
   void *status_data;
   my_bool tls_allow_invalid_server_cert;
+  my_bool compression_adaptive;
+  unsigned int stmt_cache_size;
+  my_bool io_uring;
+  struct st_mariadb_uring *uring;     /* shared ring, NULL = private ring */
 };
 
 typedef struct st_connection_handler
@@ -103,6 +107,10 @@ struct st_mariadb_net_extension {
   int extended_errno;
   ma_compress_ctx *compression_ctx;
   MARIADB_COMPRESSION_PLUGIN *compression_plugin;
+  unsigned char *compress_buf;       /* scratch buffer for (de)compression */
+  size_t compress_buf_size;
+  MARIADB_COMPRESSION_STATS compression_stats;
+  ma_compress_policy compress_policy;
 };
 
 struct st_mariadb_session_state
@@ -111,12 +119,30 @@ struct st_mariadb_session_state
        *current;
 };
 
+/* commands sent by the pipeline API, in order */
+struct st_mariadb_pipeline
+{
+  MYSQL_STMT **items;      /* statement, or NULL for a query */
+  unsigned int count;
+  unsigned int size;
+  unsigned int current;    /* next item to read the result for */
+  my_bool active;          /* between begin and flush */
+};
+
 struct st_mariadb_extension {
   MA_CONNECTION_HANDLER *conn_hdlr;
   struct st_mariadb_session_state session_state[SESSION_TRACK_TYPES];
   unsigned long mariadb_client_flag; /* MariaDB specific client flags */
   unsigned long mariadb_server_capabilities; /* MariaDB specific server capabilities */
   my_bool auto_local_infile;
+  MA_HASHTBL stmt_cache;       /* cached prepared statements, by SQL text */
+  LIST *stmt_cache_lru;        /* most recently cached statement first */
+  LIST *stmt_cache_lru_tail;   /* least recently cached statement */
+  unsigned int stmt_cache_count;
+  struct st_mariadb_pipeline pipeline;
+  struct st_ma_pool_conn *pool_conn;   /* set if owned by a MARIADB_POOL */
+  struct st_ma_loop_conn *loop_conn;   /* set if registered with a MARIADB_LOOP */
+  struct st_ma_uring_conn *uring_conn; /* set if the socket is attached to a ring */
 };
 
 #define OPT_EXT_VAL(a,key) \
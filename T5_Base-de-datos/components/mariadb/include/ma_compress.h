@@ -31,8 +31,23 @@ typedef struct {
   void *decompress_ctx;
   int compression_level;
   void *extra; /* reserved */
+  int min_level; /* level range for adaptive compression, */
+  int max_level; /* 0 if the level can't be changed       */
 } ma_compress_ctx;
 
+/* state of the adaptive compression policy */
+typedef struct {
+  my_bool adaptive;
+  unsigned int skip;       /* packets to send without compression */
+  unsigned int backoff;    /* next skip interval */
+  unsigned int packets;    /* packets in the current sample */
+  ulonglong raw_bytes;     /* sample: payload offered to compression */
+  ulonglong saved_bytes;   /* sample: bytes saved by compression */
+  ulonglong compress_time; /* sample: time spent compressing */
+  ulonglong link_bytes;    /* bytes sent while the socket buffer was full */
+  ulonglong link_time;     /* time the link needed to send them */
+} ma_compress_policy;
+
 enum enum_ma_compression_algorithm {
   COMPRESSION_NONE= 0,
   COMPRESSION_ZLIB,
@@ -41,8 +56,12 @@ enum enum_ma_compression_algorithm {
 };
 
 const char *_mariadb_compression_algorithm_str(enum enum_ma_compression_algorithm algorithm);
-my_bool _mariadb_compress(NET *net, unsigned char *, size_t *, size_t *);
+unsigned char *_mariadb_compress_buffer(NET *net, size_t size);
+unsigned char *_mariadb_compress(NET *net, const unsigned char *packet, size_t *len, size_t *complen);
 my_bool _mariadb_uncompress(NET *net, unsigned char *, size_t *, size_t *);
-unsigned char *_mariadb_compress_alloc(NET *net, const unsigned char *packet, size_t *len, size_t *complen);
+void _mariadb_compress_end(NET *net);
+ulonglong _mariadb_compress_time(void);
+void _mariadb_compress_written(NET *net, ulonglong write_time,
+                               size_t len, ulonglong link_time);
 
 #endif
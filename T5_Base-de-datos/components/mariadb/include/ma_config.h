@@ -85,6 +85,30 @@
 #  define HAVE_GETHOSTBYNAME_R 1
 #endif
 
+/*
+ * epoll is used by the event loop of mariadb_loop.c.
+ */
+#ifdef __linux__
+#  define HAVE_EPOLL 1
+#endif
+
+/*
+ * mmap() is used for the stacks of non-blocking calls in ma_context.c.
+ */
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__)
+#  define HAVE_MMAP 1
+#endif
+
+/*
+ * io_uring is used by the pvio_uring plugin, see mariadb_uring.c.
+ * Only if the kernel headers provide it.
+ */
+#if defined(__linux__) && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>)
+#    define HAVE_LINUX_IO_URING_H 1
+#  endif
+#endif
+
 /*
  * Specific for POSIX.
  */
@@ -38,6 +38,17 @@
 #define MY_CONTEXT_DISABLE
 #endif
 
+/* implementations which run on a stack allocated by ma_context.c */
+#if defined(MY_CONTEXT_USE_UCONTEXT) || defined(MY_CONTEXT_USE_X86_64_GCC_ASM) || \
+    defined(MY_CONTEXT_USE_I386_GCC_ASM)
+#define MY_CONTEXT_USE_STACK
+#endif
+
+#define ASYNC_CONTEXT_DEFAULT_STACK_SIZE (4096*15)
+
+struct st_ma_stack;
+struct st_mariadb_stack_pool;
+
 #ifdef MY_CONTEXT_USE_WIN32_FIBERS
 struct my_context {
   void (*user_func)(void *);
@@ -63,6 +74,8 @@ struct my_context {
   ucontext_t base_context;
   ucontext_t spawned_context;
   int active;
+  struct st_ma_stack *stack_mem;
+  struct st_mariadb_stack_pool *pool;   /* stack is borrowed for each call */
 #ifdef HAVE_VALGRIND
   unsigned int valgrind_stack_id;
 #endif
@@ -80,6 +93,8 @@ struct my_context {
   uint64_t save[9];
   void *stack_top;
   void *stack_bot;
+  struct st_ma_stack *stack_mem;
+  struct st_mariadb_stack_pool *pool;   /* stack is borrowed for each call */
 #ifdef HAVE_VALGRIND
   unsigned int valgrind_stack_id;
 #endif
@@ -97,6 +112,8 @@ struct my_context {
   uint64_t save[7];
   void *stack_top;
   void *stack_bot;
+  struct st_ma_stack *stack_mem;
+  struct st_mariadb_stack_pool *pool;   /* stack is borrowed for each call */
 #ifdef HAVE_VALGRIND
   unsigned int valgrind_stack_id;
 #endif
@@ -115,9 +132,16 @@ struct my_context {
 
 /*
   Initialize an asynchronous context object.
+
+  Without a pool the context gets its own stack of stack_size bytes. With
+  a pool, stack_size is ignored and a stack of the pool is only used while
+  a call is running: it is taken by my_context_spawn() and given back when
+  the spawned function returns.
+
   Returns 0 on success, non-zero on failure.
 */
-extern int my_context_init(struct my_context *c, size_t stack_size);
+extern int my_context_init(struct my_context *c, size_t stack_size,
+                           struct st_mariadb_stack_pool *pool);
 
 /* Free an asynchronous context object, deallocating any resources used. */
 extern void my_context_destroy(struct my_context *c);
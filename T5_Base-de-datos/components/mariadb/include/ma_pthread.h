@@ -29,6 +29,12 @@ typedef CRITICAL_SECTION pthread_mutex_t;
 #define pthread_mutex_unlock(A)  LeaveCriticalSection(A)
 #define pthread_mutex_destroy(A) DeleteCriticalSection(A)
 #define pthread_self() GetCurrentThreadId()
+typedef CONDITION_VARIABLE pthread_cond_t;
+#define pthread_cond_init(A,B)   InitializeConditionVariable(A)
+#define pthread_cond_signal(A)   WakeConditionVariable(A)
+#define pthread_cond_broadcast(A) WakeAllConditionVariable(A)
+#define pthread_cond_wait(A,B)   SleepConditionVariableCS((A),(B),INFINITE)
+#define pthread_cond_destroy(A)
 #endif /* defined(_WIN32) */
 
 #endif /* _my_ptread_h */
@@ -20,6 +20,7 @@ typedef unsigned char uchar;
 #define PVIO_READ_AHEAD_CACHE_SIZE 16384
 #define PVIO_READ_AHEAD_CACHE_MIN_SIZE 2048
 #define PVIO_EINTR_TRIES 2
+#define PVIO_IOV_MAX 16
 
 struct st_ma_pvio_methods;
 typedef struct st_ma_pvio_methods PVIO_METHODS;
@@ -88,6 +89,13 @@ struct st_ma_pvio {
   size_t bytes_sent;
 };
 
+/* segment for gather writes */
+typedef struct st_ma_pvio_iovec
+{
+  const uchar *base;
+  size_t length;
+} MA_PVIO_IOVEC;
+
 typedef struct st_ma_pvio_cinfo
 {
   const char *host;
@@ -116,6 +124,8 @@ struct st_ma_pvio_methods
   my_bool (*is_alive)(MARIADB_PVIO *pvio);
   my_bool (*has_data)(MARIADB_PVIO *pvio, ssize_t *data_len);
   int(*shutdown)(MARIADB_PVIO *pvio);
+  ssize_t (*writev)(MARIADB_PVIO *pvio, const MA_PVIO_IOVEC *iov, int iovcnt);
+  void (*established)(MARIADB_PVIO *pvio);
 };
 
 /* Function prototypes */
@@ -124,6 +134,7 @@ void ma_pvio_close(MARIADB_PVIO *pvio);
 ssize_t ma_pvio_cache_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length);
 ssize_t ma_pvio_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length);
 ssize_t ma_pvio_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length);
+ssize_t ma_pvio_writev(MARIADB_PVIO *pvio, const MA_PVIO_IOVEC *iov, int iovcnt);
 int ma_pvio_get_timeout(MARIADB_PVIO *pvio, enum enum_pvio_timeout type);
 my_bool ma_pvio_set_timeout(MARIADB_PVIO *pvio, enum enum_pvio_timeout type, int timeout);
 int ma_pvio_fast_send(MARIADB_PVIO *pvio);
@@ -137,5 +148,6 @@ my_bool ma_pvio_connect(MARIADB_PVIO *pvio, MA_PVIO_CINFO *cinfo);
 my_bool ma_pvio_is_alive(MARIADB_PVIO *pvio);
 my_bool ma_pvio_get_handle(MARIADB_PVIO *pvio, void *handle);
 my_bool ma_pvio_has_data(MARIADB_PVIO *pvio, ssize_t *length);
+void ma_pvio_established(MARIADB_PVIO *pvio);
 
 #endif /* _ma_pvio_h_ */
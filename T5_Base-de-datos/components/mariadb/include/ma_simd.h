@@ -0,0 +1,83 @@
+/* Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02111-1301, USA */
+#ifndef _ma_simd_h_
+#define _ma_simd_h_
+
+/*
+  Vectorized string kernels
+
+  The implementation is selected at runtime from the instruction sets
+  supported by the CPU. MA_SIMD_SCALAR processes one byte at a time like
+  the original code and is the reference for the tests, MA_SIMD_WORD
+  processes 8 bytes at a time with plain integer arithmetic and is used
+  on CPUs without a supported vector unit.
+*/
+
+enum enum_ma_simd_level {
+  MA_SIMD_SCALAR= 0,
+  MA_SIMD_WORD,
+  MA_SIMD_SSE2,
+  MA_SIMD_AVX2,
+  MA_SIMD_NEON
+};
+
+/* escape sets of ma_simd_escape_span() */
+#define MA_ESCAPE_QUOTES   1     /* ' */
+#define MA_ESCAPE_SLASHES  2     /* \0 \n \r \\ ' " \032 */
+#define MA_ESCAPE_JSON     4     /* " \\ and control characters < 0x20 */
+
+/* best level supported by the CPU */
+enum enum_ma_simd_level ma_simd_detect(void);
+
+/* level currently used */
+enum enum_ma_simd_level ma_simd_level(void);
+
+/* changes the level, returns 1 if the CPU doesn't support it */
+my_bool ma_simd_set_level(enum enum_ma_simd_level level);
+
+/*
+  Returns the number of leading bytes of str which are not in the escape
+  set. If stop_high is set, bytes >= 0x80 also end the span.
+*/
+size_t ma_simd_escape_span(const uchar *str, size_t length, int set,
+                           my_bool stop_high);
+
+/* writes 2 * length upper case hex digits, to is not terminated */
+void ma_simd_hex(char *to, const uchar *from, size_t length);
+
+/* flags of ma_simd_utf8_valid() */
+#define MA_UTF8_MB4     1     /* allow 4 byte characters (utf8mb4) */
+#define MA_UTF8_STRICT  2     /* reject surrogates U+D800..U+DFFF */
+
+/*
+  Validates UTF-8. Returns the length of the longest prefix of str which
+  consists of complete valid characters. If chars is not NULL, the number
+  of characters in this prefix is stored there.
+
+  Without MA_UTF8_STRICT the rules are the same as the ones of the
+  utf8mb3/utf8mb4 character sets (mb_valid), which accept surrogates.
+*/
+size_t ma_simd_utf8_valid(const uchar *str, size_t length, int flags,
+                          size_t *chars);
+
+/*
+  CRC-32 of buf, compatible with zlib's crc32(): crc is the checksum of the
+  preceding data, 0 for the first block.
+*/
+uint32 ma_simd_crc32(uint32 crc, const uchar *buf, size_t length);
+
+#endif
@@ -117,6 +117,7 @@ do {\
 
 	/* root_alloc flags */
 #define MY_KEEP_PREALLOC	1
+#define MY_MARK_BLOCKS_FREE	2	/* keep all blocks for reuse */
 
 	/* defines when allocating data */
 
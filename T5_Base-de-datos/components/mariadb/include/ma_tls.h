@@ -157,6 +157,17 @@ unsigned int ma_tls_get_finger_print(MARIADB_TLS *ctls, uint hash_type, char *fp
 int ma_tls_get_protocol_version(MARIADB_TLS *ctls);
 const char *ma_pvio_tls_get_protocol_version(MARIADB_TLS *ctls);
 int ma_pvio_tls_get_protocol_version_id(MARIADB_TLS *ctls);
+
+/* ma_tls_session_reused
+   returns if the handshake resumed a previous session
+   Parameter:
+     MARIADB_TLS    MariaDB SSL container
+   Returns:
+     1              session was resumed
+     0              full handshake or error
+*/
+my_bool ma_tls_session_reused(MARIADB_TLS *ctls);
+my_bool ma_pvio_tls_session_reused(MARIADB_TLS *ctls);
 unsigned int ma_tls_get_peer_cert_info(MARIADB_TLS *ctls, unsigned int size);
 void ma_tls_set_connection(MYSQL *mysql);
 
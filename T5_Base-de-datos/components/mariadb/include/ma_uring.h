@@ -0,0 +1,46 @@
+/* Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02111-1301, USA */
+#ifndef _ma_uring_h_
+#define _ma_uring_h_
+
+/* ring I/O of a connection, used by the pvio_uring plugin */
+
+#include <mariadb_uring.h>
+#include <ma_pvio.h>
+
+/* returned by ma_uring_release() if no data was received on the ring */
+#define MA_URING_NO_DATA -2
+
+typedef struct st_ma_uring_conn MA_URING_CONN;
+
+MARIADB_URING *ma_uring_private(void);
+void ma_uring_ref(MARIADB_URING *ring);
+void ma_uring_unref(MARIADB_URING *ring);
+
+MA_URING_CONN *ma_uring_attach(MARIADB_URING *ring, MARIADB_PVIO *pvio, my_socket fd);
+void ma_uring_detach(MA_URING_CONN *conn);
+my_bool ma_uring_is_shared(MA_URING_CONN *conn);
+size_t ma_uring_pending(MA_URING_CONN *conn);
+ssize_t ma_uring_release(MA_URING_CONN *conn, uchar *buffer, size_t length);
+
+ssize_t ma_uring_read(MA_URING_CONN *conn, uchar *buffer, size_t length, int timeout);
+ssize_t ma_uring_write(MA_URING_CONN *conn, const MA_PVIO_IOVEC *iov, int iovcnt, int timeout);
+ssize_t ma_uring_async_read(MA_URING_CONN *conn, uchar *buffer, size_t length);
+ssize_t ma_uring_async_write(MA_URING_CONN *conn, const uchar *buffer, size_t length, int timeout);
+int ma_uring_wait_io(MA_URING_CONN *conn, my_bool is_read, int timeout);
+
+#endif
@@ -0,0 +1,87 @@
+/* Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02111-1301, USA */
+#ifndef _mariadb_columnar_h_
+#define _mariadb_columnar_h_
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <mysql.h>
+
+/*
+  Columnar (column-at-a-time) result set access.
+
+  A batch holds up to N rows of a result set, decoded into one array per
+  column. The layout follows the Apache Arrow columnar format, so the
+  buffers can be handed to Arrow consumers without copying:
+
+  - validity: bitmap with one bit per row, least significant bit first.
+              A set bit means the value is not NULL. The bitmap is NULL if
+              the column contains no NULL values.
+  - values:   fixed width columns (integer, floating point, temporal)
+              store one value of value_size bytes per row. NULL rows are
+              zero filled.
+              Variable length columns (strings, blobs, decimals, ...) store
+              the concatenated values without terminating zero.
+  - offsets:  only for variable length columns: row_count + 1 offsets
+              into values. Value i spans offsets[i] .. offsets[i+1].
+*/
+
+enum enum_mariadb_column_format {
+  MARIADB_COLUMN_NULL= 0,  /* no value buffer, all rows are NULL */
+  MARIADB_COLUMN_INT8,
+  MARIADB_COLUMN_INT16,
+  MARIADB_COLUMN_INT32,
+  MARIADB_COLUMN_INT64,
+  MARIADB_COLUMN_FLOAT,
+  MARIADB_COLUMN_DOUBLE,
+  MARIADB_COLUMN_TIME,     /* MYSQL_TIME */
+  MARIADB_COLUMN_BINARY    /* variable length, offsets are valid */
+};
+
+typedef struct st_mariadb_column {
+  MYSQL_FIELD *field;      /* column metadata */
+  enum enum_mariadb_column_format format;
+  unsigned int value_size; /* 0 for variable length columns */
+  my_bool is_unsigned;
+  unsigned char *validity;
+  void *values;
+  unsigned int *offsets;
+  unsigned long long null_count;
+} MARIADB_COLUMN;
+
+typedef struct st_mariadb_column_batch {
+  MA_MEM_ROOT alloc;
+  unsigned long long row_count;
+  unsigned int column_count;
+  MARIADB_COLUMN *columns;
+} MARIADB_COLUMN_BATCH;
+
+#define MARIADB_COLUMN_IS_NULL(col, row)\
+  ((col)->validity && !((col)->validity[(row) >> 3] & (1 << ((row) & 7))))
+
+MARIADB_COLUMN_BATCH * STDCALL mariadb_fetch_columns(MYSQL_RES *result,
+                                                     unsigned long max_rows);
+MARIADB_COLUMN_BATCH * STDCALL mariadb_stmt_fetch_columns(MYSQL_STMT *stmt,
+                                                          unsigned long max_rows);
+void STDCALL mariadb_free_columns(MARIADB_COLUMN_BATCH *batch);
+
+#ifdef	__cplusplus
+}
+#endif
+#endif
@@ -186,6 +186,47 @@ mariadb_dyncol_update_many_named(DYNAMIC_COLUMN *str,
                                  MYSQL_LEX_STRING *column_keys,
                                  DYNAMIC_COLUMN_VALUE *values);
 
+/*
+  State of batched updates
+
+  mariadb_dyncol_update_rows_*() apply the same columns to many records.
+  The plan is sorted once for all records, and the memory of the plan and
+  of rebuilt records is kept in the structure for the next call instead
+  of being allocated for every record. The records may get a different
+  buffer by an update; like after mariadb_dyncol_update_many_*() they
+  have to be freed with mariadb_dyncol_free().
+*/
+struct st_dynamic_column_plan;
+
+typedef struct st_dynamic_column_update
+{
+  struct st_dynamic_column_plan *plan;
+  uint *order;                /* key position of the sorted plan entries */
+  uint plan_alloced;
+  uint order_count;           /* number of sorted keys, 0 if not sorted */
+  DYNAMIC_COLUMN scratch;     /* spare buffer for rebuilt records */
+} DYNAMIC_COLUMN_UPDATE;
+
+#define mariadb_dyncol_update_init(A) \
+  memset((A), 0, sizeof(DYNAMIC_COLUMN_UPDATE))
+
+/*
+  Sets column_keys[j] to values[i * column_count + j] in rows[i] for
+  all rows. On error the rows before the failing one are updated.
+*/
+enum enum_dyncol_func_result
+mariadb_dyncol_update_rows_num(DYNAMIC_COLUMN_UPDATE *update,
+                               DYNAMIC_COLUMN *rows, uint row_count,
+                               uint column_count, uint *column_keys,
+                               DYNAMIC_COLUMN_VALUE *values);
+enum enum_dyncol_func_result
+mariadb_dyncol_update_rows_named(DYNAMIC_COLUMN_UPDATE *update,
+                                 DYNAMIC_COLUMN *rows, uint row_count,
+                                 uint column_count,
+                                 MYSQL_LEX_STRING *column_keys,
+                                 DYNAMIC_COLUMN_VALUE *values);
+void mariadb_dyncol_update_free(DYNAMIC_COLUMN_UPDATE *update);
+
 
 enum enum_dyncol_func_result
 mariadb_dyncol_exists_num(DYNAMIC_COLUMN *org, uint column_nr);
@@ -209,6 +250,57 @@ enum enum_dyncol_func_result
 mariadb_dyncol_get_named(DYNAMIC_COLUMN *str, MYSQL_LEX_STRING *name,
                          DYNAMIC_COLUMN_VALUE *store_it_here);
 
+/*
+  Get several columns with one read of the header, values[i] gets the
+  value of column_keys[i] (NULL if the column does not exist). Keys in
+  ascending order are found fastest.
+*/
+enum enum_dyncol_func_result
+mariadb_dyncol_get_many_num(DYNAMIC_COLUMN *str, uint column_count,
+                            uint *column_keys, DYNAMIC_COLUMN_VALUE *values);
+enum enum_dyncol_func_result
+mariadb_dyncol_get_many_named(DYNAMIC_COLUMN *str, uint column_count,
+                              MYSQL_LEX_STRING *column_keys,
+                              DYNAMIC_COLUMN_VALUE *values);
+
+/*
+  Parsed dynamic column record
+
+  mariadb_dyncol_index_parse() decodes the header of a record once, the
+  index then finds columns by a direct table (dense column numbers) or a
+  hash table instead of searching the packed header for every lookup.
+  The index points into the record, which must not be changed or freed
+  while the index is used. Parsing the next record reuses the memory of
+  the index.
+*/
+struct st_dynamic_column_index_entry;
+
+typedef struct st_dynamic_column_index
+{
+  struct st_dynamic_column_index_entry *columns;
+  uint *slots;                /* column position + 1, 0 for empty slots */
+  uint column_count;
+  uint columns_alloced;
+  uint slot_count;
+  uint slots_alloced;
+  my_bool named;              /* record uses column names */
+  my_bool direct;             /* slots are indexed by column number */
+} DYNAMIC_COLUMN_INDEX;
+
+#define mariadb_dyncol_index_init(A) \
+  memset((A), 0, sizeof(DYNAMIC_COLUMN_INDEX))
+
+enum enum_dyncol_func_result
+mariadb_dyncol_index_parse(DYNAMIC_COLUMN_INDEX *index, DYNAMIC_COLUMN *str);
+enum enum_dyncol_func_result
+mariadb_dyncol_index_get_num(DYNAMIC_COLUMN_INDEX *index, uint column_nr,
+                             DYNAMIC_COLUMN_VALUE *store_it_here);
+enum enum_dyncol_func_result
+mariadb_dyncol_index_get_named(DYNAMIC_COLUMN_INDEX *index,
+                               MYSQL_LEX_STRING *name,
+                               DYNAMIC_COLUMN_VALUE *store_it_here);
+void mariadb_dyncol_index_free(DYNAMIC_COLUMN_INDEX *index);
+
 my_bool mariadb_dyncol_has_names(DYNAMIC_COLUMN *str);
 
 enum enum_dyncol_func_result
@@ -217,6 +309,39 @@ mariadb_dyncol_check(DYNAMIC_COLUMN *str);
 enum enum_dyncol_func_result
 mariadb_dyncol_json(DYNAMIC_COLUMN *str, DYNAMIC_STRING *json);
 
+/*
+  Output of mariadb_dyncol_json_write()
+
+  The JSON text is appended at str + length, it is not terminated. If less
+  space is left than the writer needs, flush() is called and has to make
+  room for at least need bytes (need is never larger than
+  DYNCOL_JSON_SINK_MIN), either by passing the buffer on and resetting
+  length or by enlarging str. Without flush function str is enlarged with
+  realloc(), it may be NULL at the beginning and has to be freed by the
+  caller.
+*/
+#define DYNCOL_JSON_SINK_MIN 64
+
+typedef struct st_dynamic_column_json_sink
+{
+  char *str;
+  size_t length;
+  size_t max_length;
+  my_bool (*flush)(struct st_dynamic_column_json_sink *sink, size_t need);
+  void *data;                 /* for use by flush() */
+} DYNAMIC_COLUMN_JSON_SINK;
+
+/*
+  Writes the record as JSON to a sink without intermediate strings.
+  Unlike mariadb_dyncol_json() the output is valid JSON for all strings:
+  names are escaped too and so are control characters.
+*/
+enum enum_dyncol_func_result
+mariadb_dyncol_json_write(DYNAMIC_COLUMN *str, DYNAMIC_COLUMN_JSON_SINK *sink);
+
+/* Estimated length of the JSON text of the record */
+size_t mariadb_dyncol_json_size_hint(DYNAMIC_COLUMN *str);
+
 void mariadb_dyncol_free(DYNAMIC_COLUMN *str);
 
 #define mariadb_dyncol_init(A) memset((A), 0, sizeof(DYNAMIC_COLUMN))
@@ -0,0 +1,147 @@
+/* Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02111-1301, USA */
+#ifndef _mariadb_loop_h_
+#define _mariadb_loop_h_
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <mysql.h>
+
+/*
+  Event loop for non-blocking connections
+
+  A loop drives any number of connections from a single thread with the
+  non-blocking API. Operations are submitted with mariadb_loop_connect(),
+  mariadb_loop_query() or mariadb_loop_ping() and run in the background
+  while mariadb_loop_run() or mariadb_loop_wait() is called. Operations on
+  the same connection are executed in submission order, operations on
+  different connections run concurrently.
+
+  If a callback is passed, it is called from mariadb_loop_run() or
+  mariadb_loop_wait() when the operation has finished, and the operation
+  is freed after the callback returns. Without a callback the returned
+  operation works like a future: wait for it with mariadb_loop_wait() and
+  free it with mariadb_loop_op_free().
+
+    loop= mariadb_loop_init();
+    for (i= 0; i < n; i++)
+    {
+      mysql[i]= mysql_init(NULL);
+      mariadb_loop_connect(loop, mysql[i], host, user, passwd, db, port,
+                           NULL, 0, connected, NULL);
+    }
+    while (mariadb_loop_run(loop, 1000) >= 0 && !done)
+      ;
+    ...
+    op= mariadb_loop_query(loop, mysql[0], "SELECT 1", -1, NULL, NULL);
+    mariadb_loop_wait(loop, op, 1000);
+    res= mariadb_loop_op_result(op);
+    mariadb_loop_op_free(op);
+    ...
+    mariadb_loop_close(loop);
+
+  A query operation stores the first result set, further result sets of a
+  multi statement are read and discarded. If MARIADB_LOOP_OP_TIMEOUT is set,
+  operations which run longer fail with CR_LOOP_TIMEOUT and the connection
+  has to be closed.
+
+  A loop and the connections registered with it must only be used by one
+  thread at a time. A connection must not be used with the blocking API
+  while it has operations pending in a loop, and must be removed with
+  mariadb_loop_remove() before mysql_close(). mariadb_loop_close() discards
+  operations which didn't complete yet, their connections can only be
+  closed afterwards.
+*/
+
+typedef struct st_mariadb_loop MARIADB_LOOP;
+typedef struct st_mariadb_loop_op MARIADB_LOOP_OP;
+
+typedef void (*mariadb_loop_callback)(MARIADB_LOOP_OP *op, void *data);
+
+enum mariadb_loop_option {
+  MARIADB_LOOP_OP_TIMEOUT,      /* abort operations after n milliseconds, 0 = never */
+  MARIADB_LOOP_MAX_EVENTS       /* events fetched per wakeup (unsigned int) */
+};
+
+enum mariadb_loop_op_type {
+  MARIADB_LOOP_OP_CONNECT,
+  MARIADB_LOOP_OP_QUERY,
+  MARIADB_LOOP_OP_PING
+};
+
+/* latency_histogram[i] counts operations which took less than 2^i
+   microseconds (and at least 2^(i-1)), the last bucket counts the rest */
+#define MARIADB_LOOP_LATENCY_BUCKETS 32
+
+typedef struct st_mariadb_loop_stats {
+  unsigned int connections;           /* registered connections */
+  unsigned int in_flight;             /* running operations */
+  unsigned int queued;                /* operations waiting for their connection */
+  unsigned int max_in_flight;
+  unsigned long long submitted;
+  unsigned long long completed;       /* including failed operations */
+  unsigned long long failed;
+  unsigned long long timeouts;        /* operations aborted by MARIADB_LOOP_OP_TIMEOUT */
+  unsigned long long wakeups;         /* returns from epoll_wait()/poll() */
+  unsigned long long events;          /* socket events processed */
+  unsigned long long latency_total;   /* microseconds, submission to completion */
+  unsigned long long latency_max;
+  unsigned long long latency_histogram[MARIADB_LOOP_LATENCY_BUCKETS];
+} MARIADB_LOOP_STATS;
+
+MARIADB_LOOP * STDCALL mariadb_loop_init(void);
+int STDCALL mariadb_loop_optionsv(MARIADB_LOOP *loop, enum mariadb_loop_option, ...);
+int STDCALL mariadb_loop_add(MARIADB_LOOP *loop, MYSQL *mysql);
+int STDCALL mariadb_loop_remove(MARIADB_LOOP *loop, MYSQL *mysql);
+MARIADB_LOOP_OP * STDCALL mariadb_loop_connect(MARIADB_LOOP *loop, MYSQL *mysql,
+                                               const char *host, const char *user,
+                                               const char *passwd, const char *db,
+                                               unsigned int port,
+                                               const char *unix_socket,
+                                               unsigned long client_flag,
+                                               mariadb_loop_callback callback,
+                                               void *data);
+MARIADB_LOOP_OP * STDCALL mariadb_loop_query(MARIADB_LOOP *loop, MYSQL *mysql,
+                                             const char *query, size_t length,
+                                             mariadb_loop_callback callback,
+                                             void *data);
+MARIADB_LOOP_OP * STDCALL mariadb_loop_ping(MARIADB_LOOP *loop, MYSQL *mysql,
+                                            mariadb_loop_callback callback,
+                                            void *data);
+int STDCALL mariadb_loop_run(MARIADB_LOOP *loop, int timeout_ms);
+int STDCALL mariadb_loop_wait(MARIADB_LOOP *loop, MARIADB_LOOP_OP *op, int timeout_ms);
+int STDCALL mariadb_loop_get_fd(MARIADB_LOOP *loop);
+int STDCALL mariadb_loop_next_timeout(MARIADB_LOOP *loop);
+void STDCALL mariadb_loop_get_stats(MARIADB_LOOP *loop, MARIADB_LOOP_STATS *stats);
+unsigned long long STDCALL mariadb_loop_stats_percentile(const MARIADB_LOOP_STATS *stats,
+                                                         double percentile);
+void STDCALL mariadb_loop_close(MARIADB_LOOP *loop);
+
+my_bool STDCALL mariadb_loop_op_done(MARIADB_LOOP_OP *op);
+enum mariadb_loop_op_type STDCALL mariadb_loop_op_type(MARIADB_LOOP_OP *op);
+unsigned int STDCALL mariadb_loop_op_status(MARIADB_LOOP_OP *op);
+MYSQL * STDCALL mariadb_loop_op_mysql(MARIADB_LOOP_OP *op);
+MYSQL_RES * STDCALL mariadb_loop_op_result(MARIADB_LOOP_OP *op);
+unsigned long long STDCALL mariadb_loop_op_latency(MARIADB_LOOP_OP *op);
+void STDCALL mariadb_loop_op_free(MARIADB_LOOP_OP *op);
+
+#ifdef	__cplusplus
+}
+#endif
+#endif
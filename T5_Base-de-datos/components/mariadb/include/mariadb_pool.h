@@ -0,0 +1,105 @@
+/* Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02111-1301, USA */
+#ifndef _mariadb_pool_h_
+#define _mariadb_pool_h_
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <mysql.h>
+
+/*
+  Connection pool
+
+  A pool keeps up to MARIADB_POOL_MAX_SIZE connections to the same server.
+  mariadb_pool_acquire() returns an idle connection (or opens a new one),
+  mariadb_pool_release() resets the connection with
+  mysql_reset_connection() and puts it back into the pool. A pool can be
+  shared by any number of threads, a connection must only be used by the
+  thread which acquired it.
+
+    pool= mariadb_pool_init();
+    mariadb_pool_optionsv(pool, MARIADB_POOL_MAX_SIZE, 16);
+    mariadb_pool_open(pool, host, user, passwd, db, port, NULL, 0);
+    ...
+    mysql= mariadb_pool_acquire(pool);
+    mysql_query(mysql, ...);
+    mariadb_pool_release(pool, mysql);
+    ...
+    mariadb_pool_close(pool);
+
+  Options must be set before mariadb_pool_open(). Connections must be
+  returned with mariadb_pool_release(), also if they are broken, and all
+  connections must be released before mariadb_pool_close() is called.
+
+  The utilization of the pool is busy_time / (lifetime * max_size).
+*/
+
+typedef struct st_mariadb_pool MARIADB_POOL;
+
+/* called for each new connection before connecting, non zero return
+   value aborts the connection attempt */
+typedef int (*mariadb_pool_init_callback)(MYSQL *mysql, void *data);
+
+enum mariadb_pool_option {
+  MARIADB_POOL_MIN_SIZE,        /* connections kept open (unsigned int) */
+  MARIADB_POOL_MAX_SIZE,        /* maximum number of connections (unsigned int) */
+  MARIADB_POOL_IDLE_TIMEOUT,    /* close idle connections after n seconds, 0 = never */
+  MARIADB_POOL_WAIT_TIMEOUT,    /* wait n milliseconds for a free connection */
+  MARIADB_POOL_PING_INTERVAL,   /* send COM_PING if idle for n milliseconds */
+  MARIADB_POOL_RESET,           /* reset connections on release (my_bool) */
+  MARIADB_POOL_INIT_CALLBACK    /* callback and callback data */
+};
+
+typedef struct st_mariadb_pool_stats {
+  unsigned int size;                  /* open connections */
+  unsigned int idle;                  /* connections waiting in the pool */
+  unsigned int in_use;                /* acquired connections */
+  unsigned int max_size;
+  unsigned long long acquired;        /* successful mariadb_pool_acquire() calls */
+  unsigned long long created;         /* connections opened */
+  unsigned long long closed;          /* connections closed */
+  unsigned long long broken;          /* closed due to a failed probe or reset */
+  unsigned long long evicted;         /* closed due to idle timeout */
+  unsigned long long waits;           /* acquires which had to wait */
+  unsigned long long timeouts;        /* acquires which timed out */
+  unsigned long long wait_time;       /* total wait time (microseconds) */
+  unsigned long long max_wait_time;   /* longest wait (microseconds) */
+  unsigned long long busy_time;       /* time connections were acquired (microseconds) */
+  unsigned long long lifetime;        /* time since mariadb_pool_open() (microseconds) */
+} MARIADB_POOL_STATS;
+
+MARIADB_POOL * STDCALL mariadb_pool_init(void);
+int STDCALL mariadb_pool_optionsv(MARIADB_POOL *pool, enum mariadb_pool_option, ...);
+int STDCALL mariadb_pool_open(MARIADB_POOL *pool, const char *host,
+                              const char *user, const char *passwd,
+                              const char *db, unsigned int port,
+                              const char *unix_socket,
+                              unsigned long client_flag);
+MYSQL * STDCALL mariadb_pool_acquire(MARIADB_POOL *pool);
+void STDCALL mariadb_pool_release(MARIADB_POOL *pool, MYSQL *mysql);
+unsigned int STDCALL mariadb_pool_evict(MARIADB_POOL *pool);
+void STDCALL mariadb_pool_get_stats(MARIADB_POOL *pool, MARIADB_POOL_STATS *stats);
+void STDCALL mariadb_pool_close(MARIADB_POOL *pool);
+const char * STDCALL mariadb_pool_error(MARIADB_POOL *pool);
+unsigned int STDCALL mariadb_pool_errno(MARIADB_POOL *pool);
+
+#ifdef	__cplusplus
+}
+#endif
+#endif
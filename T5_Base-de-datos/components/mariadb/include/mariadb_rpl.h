@@ -88,6 +88,14 @@ enum mariadb_rpl_option {
   MARIADB_RPL_PORT,
   MARIADB_RPL_EXTRACT_VALUES,
   MARIADB_RPL_SEMI_SYNC,
+  MARIADB_RPL_DECODE_THREADS,     /* Threads decoding row events, 0 = off */
+  MARIADB_RPL_DECODE_QUEUE_SIZE,  /* Row events waiting for a decode thread */
+  MARIADB_RPL_RESULT_QUEUE_SIZE,  /* Decoded events waiting for mariadb_rpl_fetch */
+  MARIADB_RPL_INCLUDE_TABLE,      /* Schema and table name, NULL matches all */
+  MARIADB_RPL_EXCLUDE_TABLE,      /* Schema and table name, NULL matches all */
+  MARIADB_RPL_TABLE_COLUMNS,      /* Schema, table, number and list of columns extracted */
+  MARIADB_RPL_LAZY_VALUES,        /* Decode column values in mariadb_rpl_row_value */
+  MARIADB_RPL_ZERO_COPY,          /* Events take over the network buffer, no packet copy */
 };
 
 /* Event types: From MariaDB Server sql/log_event.h */
@@ -318,6 +326,10 @@ typedef struct st_mariadb_gtid {
 } MARIADB_GTID;
 
 
+struct st_ma_rpl_decoder;
+struct st_ma_rpl_filter;
+struct st_ma_rpl_lazy_row;
+
 /* Generic replication handle */
 typedef struct st_mariadb_rpl {
   unsigned int version;
@@ -342,6 +354,13 @@ typedef struct st_mariadb_rpl {
   char nonce[12];
   uint8_t encrypted;
   uint8_t is_semi_sync;
+  uint32_t decode_threads;
+  uint32_t decode_queue_size;
+  uint32_t result_queue_size;
+  struct st_ma_rpl_decoder *decoder;
+  struct st_ma_rpl_filter *filter;
+  uint8_t lazy_values;
+  uint8_t zero_copy;
 }MARIADB_RPL;
 
 typedef struct st_mariadb_rpl_value {
@@ -362,6 +381,8 @@ typedef struct st_rpl_mariadb_row {
   uint32_t column_count;
   MARIADB_RPL_VALUE *columns;
   struct st_rpl_mariadb_row *next;
+  /* Added in C/C 3.4: set if values are decoded by mariadb_rpl_row_value */
+  struct st_ma_rpl_lazy_row *lazy;
 } MARIADB_RPL_ROW;
 
 /* Event header */
@@ -561,6 +582,15 @@ typedef struct st_mariadb_rpl_event
   uint8_t semi_sync_flags;
   /* Added in C/C 3.3.5 */
   MARIADB_RPL *rpl;
+  /* Added in C/C 3.4: rows of row events if MARIADB_RPL_EXTRACT_VALUES,
+     MARIADB_RPL_LAZY_VALUES or MARIADB_RPL_DECODE_THREADS was set */
+  MARIADB_RPL_ROW *rows;
+  /* Added in C/C 3.4: buffer holding raw_data, kept when the event is
+     reused. Strings and string values of the event point into raw_data,
+     they are valid until the event is freed or passed to
+     mariadb_rpl_fetch() again. */
+  unsigned char *packet_buffer;
+  size_t packet_buffer_size;
 } MARIADB_RPL_EVENT;
 
 /* compression uses myisampack format */
@@ -615,16 +645,18 @@ if (!(condition))\
    (a) == DELETE_ROWS_EVENT || (a) == WRITE_ROWS_COMPRESSED_EVENT ||\
    (a) == UPDATE_ROWS_COMPRESSED_EVENT || (a) == DELETE_ROWS_COMPRESSED_EVENT)
 
-#define IS_ROW_EVENT(a)\
-((a)->event_type == WRITE_ROWS_COMPRESSED_EVENT_V1 ||\
-(a)->event_type == UPDATE_ROWS_COMPRESSED_EVENT_V1 ||\
-(a)->event_type == DELETE_ROWS_COMPRESSED_EVENT_V1 ||\
-(a)->event_type == WRITE_ROWS_EVENT_V1 ||\
-(a)->event_type == UPDATE_ROWS_EVENT_V1 ||\
-(a)->event_type == DELETE_ROWS_EVENT_V1 ||\
-(a)->event_type == WRITE_ROWS_EVENT ||\
-(a)->event_type == UPDATE_ROWS_EVENT ||\
-(a)->event_type == DELETE_ROWS_EVENT)
+#define IS_ROW_EVENT_TYPE(a)\
+((a) == WRITE_ROWS_COMPRESSED_EVENT_V1 ||\
+(a) == UPDATE_ROWS_COMPRESSED_EVENT_V1 ||\
+(a) == DELETE_ROWS_COMPRESSED_EVENT_V1 ||\
+(a) == WRITE_ROWS_EVENT_V1 ||\
+(a) == UPDATE_ROWS_EVENT_V1 ||\
+(a) == DELETE_ROWS_EVENT_V1 ||\
+(a) == WRITE_ROWS_EVENT ||\
+(a) == UPDATE_ROWS_EVENT ||\
+(a) == DELETE_ROWS_EVENT)
+
+#define IS_ROW_EVENT(a) IS_ROW_EVENT_TYPE((a)->event_type)
 
 /* Function prototypes */
 MARIADB_RPL * STDCALL mariadb_rpl_init_ex(MYSQL *mysql, unsigned int version);
@@ -644,6 +676,11 @@ mariadb_rpl_extract_rows(MARIADB_RPL *rpl,
                          MARIADB_RPL_EVENT *tm_event,
                          MARIADB_RPL_EVENT *row_event);
 
+MARIADB_RPL_VALUE * STDCALL
+mariadb_rpl_row_value(MARIADB_RPL_EVENT *event,
+                      MARIADB_RPL_ROW *row,
+                      uint32_t column);
+
 #ifdef	__cplusplus
 }
 #endif
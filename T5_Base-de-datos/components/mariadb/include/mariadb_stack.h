@@ -0,0 +1,88 @@
+/* Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02111-1301, USA */
+#ifndef _mariadb_stack_h_
+#define _mariadb_stack_h_
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <mysql.h>
+
+/*
+  Stack pool for non-blocking connections
+
+  Every connection in non-blocking mode (MYSQL_OPT_NONBLOCK) owns a stack
+  on which the library runs while a call is suspended. Connections which
+  use a stack pool (MARIADB_OPT_ASYNC_STACK_POOL) only borrow a stack from
+  the pool while a call is in progress, so idle connections don't hold any
+  stack memory, and stacks are reused instead of being mapped and unmapped
+  for every connection.
+
+    pool= mariadb_stack_pool_init(0);
+    ...
+    mysql= mysql_init(NULL);
+    mysql_optionsv(mysql, MARIADB_OPT_ASYNC_STACK_POOL, pool);
+    ...
+    mysql_close(mysql);
+    ...
+    mariadb_stack_pool_close(pool);
+
+  Stacks are mapped with a guard page below them where mmap() is
+  available, so a stack overflow crashes instead of overwriting memory.
+  With MARIADB_STACK_POOL_MEASURE the stacks are filled with a pattern and
+  the deepest stack usage is reported in high_water, which helps to choose
+  the stack size. mariadb_stack_pool_trim() frees all but keep idle stacks
+  and returns the memory of the remaining ones to the operating system.
+
+  A pool can be shared by any number of connections and threads. It is
+  freed when it was closed and the last connection using it was closed.
+*/
+
+typedef struct st_mariadb_stack_pool MARIADB_STACK_POOL;
+
+enum mariadb_stack_pool_option {
+  MARIADB_STACK_POOL_MAX_IDLE,    /* idle stacks kept for reuse (unsigned int) */
+  MARIADB_STACK_POOL_GUARD_SIZE,  /* guard area below new stacks (size_t), 0 = none */
+  MARIADB_STACK_POOL_MEASURE      /* measure stack usage (my_bool) */
+};
+
+typedef struct st_mariadb_stack_pool_stats {
+  size_t stack_size;                  /* usable bytes per stack */
+  size_t high_water;                  /* deepest usage, needs MARIADB_STACK_POOL_MEASURE */
+  unsigned int in_use;                /* stacks used by running calls */
+  unsigned int idle;                  /* stacks kept for reuse */
+  unsigned int max_in_use;
+  unsigned long long acquired;        /* stacks handed out */
+  unsigned long long created;         /* stacks allocated */
+  unsigned long long destroyed;       /* stacks freed */
+  unsigned long long failed;          /* failed allocations */
+} MARIADB_STACK_POOL_STATS;
+
+MARIADB_STACK_POOL * STDCALL mariadb_stack_pool_init(size_t stack_size);
+int STDCALL mariadb_stack_pool_optionsv(MARIADB_STACK_POOL *pool,
+                                        enum mariadb_stack_pool_option, ...);
+unsigned int STDCALL mariadb_stack_pool_trim(MARIADB_STACK_POOL *pool,
+                                             unsigned int keep);
+void STDCALL mariadb_stack_pool_get_stats(MARIADB_STACK_POOL *pool,
+                                          MARIADB_STACK_POOL_STATS *stats);
+void STDCALL mariadb_stack_pool_close(MARIADB_STACK_POOL *pool);
+
+#ifdef	__cplusplus
+}
+#endif
+#endif
@@ -46,7 +46,10 @@ enum enum_stmt_attr_type
   STMT_ATTR_STATE,
   STMT_ATTR_CB_USER_DATA,
   STMT_ATTR_CB_PARAM,
-  STMT_ATTR_CB_RESULT
+  STMT_ATTR_CB_RESULT,
+  STMT_ATTR_FETCH_ARRAY_SIZE,
+  STMT_ATTR_FETCH_ROW_SIZE,
+  STMT_ATTR_ROWS_FETCHED
 };
 
 enum enum_cursor_type
@@ -0,0 +1,125 @@
+/* Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not, write to the Free
+   Software Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+   MA 02111-1301, USA */
+#ifndef _mariadb_uring_h_
+#define _mariadb_uring_h_
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#include <mysql.h>
+
+/*
+  io_uring for socket I/O (Linux)
+
+  Connections set up with MARIADB_OPT_IO_URING use the pvio_uring plugin:
+  packets are sent and received through an io_uring instead of one send(),
+  recv() and poll() system call each. With the blocking API a write
+  returns when the data was sent and a read waits for the response with a
+  single receive, so the socket behaves as with plain socket I/O between
+  calls (e.g. it can be polled after mysql_send_query()). With the
+  non-blocking API on a shared ring the sends of all connections are
+  queued and submitted together, and data is delivered by multishot
+  receives into a ring of registered buffers.
+
+  With a NULL ring every connection gets a private ring, which is all that
+  is needed for the blocking API:
+
+    mysql_optionsv(mysql, MARIADB_OPT_IO_URING, NULL);
+    mysql_real_connect(mysql, ...);
+
+  Many connections of one thread can share a ring. With the non-blocking
+  API the writes of all connections are then submitted together, and
+  mariadb_uring_wait() returns the connections which can continue:
+
+    ring= mariadb_uring_init(256);
+    for (i= 0; i < n; i++)
+    {
+      mysql_optionsv(mysql[i], MARIADB_OPT_IO_URING, ring);
+      mysql_optionsv(mysql[i], MYSQL_OPT_NONBLOCK, 0);
+      ...connect...
+    }
+    for (i= 0; i < n; i++)
+      status[i]= mysql_real_query_start(&err[i], mysql[i], query, length);
+    while (pending)
+    {
+      count= mariadb_uring_wait(ring, ready, n, 1000);
+      for (i= 0; i < count; i++)
+        ...mysql_real_query_cont(&err, ready[i], MYSQL_WAIT_READ)...
+    }
+
+  A connection which is suspended in a read or write on a shared ring
+  must be waited for with mariadb_uring_wait(), its socket doesn't become
+  readable. mariadb_uring_get_fd() returns a descriptor which is readable
+  when mariadb_uring_wait() has something to report, after queued requests
+  were submitted with mariadb_uring_submit(). With a private ring the
+  non-blocking API uses plain socket I/O, so event loops which wait for
+  the sockets (like MARIADB_LOOP) keep working. A connection on a shared
+  ring which was used with the non-blocking API keeps its receive armed,
+  its socket must not be polled even if it is used with the blocking API
+  afterwards.
+
+  The connection handshake and TLS connections use plain socket I/O, a
+  connection moves to the ring when mysql_real_connect() (or
+  mysql_real_connect_cont()) has finished. With the non-blocking API the
+  socket has to be waited for until then. If io_uring is not available
+  (older kernel, disabled by the administrator or not a Linux build)
+  mariadb_uring_init() returns NULL, and connections with
+  MARIADB_OPT_IO_URING silently use the pvio_socket plugin.
+
+  A ring and its connections must only be used by one thread at a time.
+  Connections keep a reference to the ring, so the ring may be closed
+  before them.
+*/
+
+typedef struct st_mariadb_uring MARIADB_URING;
+
+enum mariadb_uring_option {
+  MARIADB_URING_BUFFERS,        /* receive buffers (unsigned int, power of 2) */
+  MARIADB_URING_BUFFER_SIZE     /* bytes per receive buffer (unsigned int) */
+};
+
+typedef struct st_mariadb_uring_stats {
+  unsigned int connections;           /* attached connections */
+  unsigned int buffers;               /* registered receive buffers, 0 = none */
+  unsigned int buffers_free;
+  unsigned long long enters;          /* io_uring_enter() system calls */
+  unsigned long long submitted;       /* submission queue entries */
+  unsigned long long completed;       /* completion queue entries */
+  unsigned long long sends;
+  unsigned long long bytes_sent;
+  unsigned long long receives;        /* receive completions with data */
+  unsigned long long bytes_received;
+  unsigned long long recv_armed;      /* receives (re)armed */
+  unsigned long long no_buffers;      /* receives stopped, all buffers in use */
+  unsigned long long polls;           /* readiness polls used without buffers */
+  unsigned long long timeouts;
+} MARIADB_URING_STATS;
+
+MARIADB_URING * STDCALL mariadb_uring_init(unsigned int entries);
+int STDCALL mariadb_uring_optionsv(MARIADB_URING *ring, enum mariadb_uring_option, ...);
+int STDCALL mariadb_uring_get_fd(MARIADB_URING *ring);
+int STDCALL mariadb_uring_submit(MARIADB_URING *ring);
+int STDCALL mariadb_uring_wait(MARIADB_URING *ring, MYSQL **ready,
+                               unsigned int max_ready, int timeout_ms);
+void STDCALL mariadb_uring_get_stats(MARIADB_URING *ring, MARIADB_URING_STATS *stats);
+void STDCALL mariadb_uring_close(MARIADB_URING *ring);
+
+#ifdef	__cplusplus
+}
+#endif
+#endif
@@ -255,7 +255,11 @@ enum mysql_option {
    MARIADB_OPT_RPL_REGISTER_REPLICA,
    MARIADB_OPT_STATUS_CALLBACK,
    MARIADB_OPT_SERVER_PLUGINS,
-   MARIADB_OPT_BULK_UNIT_RESULTS
+   MARIADB_OPT_BULK_UNIT_RESULTS,
+   MARIADB_OPT_COMPRESSION_ADAPTIVE,
+   MARIADB_OPT_STMT_CACHE_SIZE,
+   MARIADB_OPT_ASYNC_STACK_POOL,  /* non-blocking mode with stacks of a MARIADB_STACK_POOL */
+   MARIADB_OPT_IO_URING           /* socket I/O with a MARIADB_URING, NULL = private ring */
 };
 
 enum mariadb_value {
@@ -296,7 +300,9 @@ enum mariadb_value {
    MARIADB_CONNECTION_BYTES_READ,
    MARIADB_CONNECTION_BYTES_SENT,
    MARIADB_TLS_PEER_CERT_INFO,
-   MARIADB_TLS_VERIFY_STATUS
+   MARIADB_TLS_VERIFY_STATUS,
+   MARIADB_CONNECTION_COMPRESSION_STATS,
+   MARIADB_CONNECTION_TLS_SESSION_REUSED
 };
 
 enum mysql_status {
@@ -460,6 +466,25 @@ typedef struct character_set {
    unsigned int mbmaxlen; /* max. length for multibyte strings */
 } MY_CHARSET_INFO;
 
+/* compressed protocol statistics (MARIADB_CONNECTION_COMPRESSION_STATS) */
+typedef struct st_mariadb_compression_stats {
+   unsigned long long packets_sent;       /* packets sent compressed     */
+   unsigned long long packets_sent_raw;   /* packets sent uncompressed   */
+   unsigned long long raw_bytes_sent;     /* payload before compression  */
+   unsigned long long compressed_bytes_sent;
+   unsigned long long packets_read;       /* compressed packets read     */
+   unsigned long long compressed_bytes_read;
+   unsigned long long raw_bytes_read;     /* payload after decompression */
+   unsigned long long compress_time;      /* microseconds                */
+   unsigned long long decompress_time;    /* microseconds                */
+   /* adaptive compression (MARIADB_OPT_COMPRESSION_ADAPTIVE) */
+   unsigned long long packets_skipped;    /* sent raw without compressing */
+   unsigned long long level_raised;
+   unsigned long long level_lowered;
+   unsigned long long write_time;         /* microseconds                */
+   int compression_level;                 /* current level               */
+} MARIADB_COMPRESSION_STATS;
+
 /* Local infile support functions */
 #define LOCAL_INFILE_ERROR_LEN 512
 
@@ -610,6 +635,11 @@ unsigned int STDCALL mysql_get_timeout_value(const MYSQL *mysql);
 unsigned int STDCALL mysql_get_timeout_value_ms(const MYSQL *mysql);
 my_bool STDCALL mariadb_reconnect(MYSQL *mysql);
 int STDCALL mariadb_cancel(MYSQL *mysql);
+int STDCALL mariadb_pipeline_begin(MYSQL *mysql);
+int STDCALL mariadb_pipeline_query(MYSQL *mysql, const char *query, unsigned long length);
+int STDCALL mariadb_pipeline_stmt_execute(MYSQL_STMT *stmt);
+int STDCALL mariadb_pipeline_flush(MYSQL *mysql);
+int STDCALL mariadb_pipeline_next_result(MYSQL *mysql, MYSQL_STMT **stmt);
 void STDCALL mysql_debug(const char *debug);
 unsigned long STDCALL mysql_net_read_packet(MYSQL *mysql);
 unsigned long STDCALL mysql_net_field_length(unsigned char **packet);
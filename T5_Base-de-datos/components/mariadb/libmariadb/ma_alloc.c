@@ -112,6 +112,24 @@ void * ma_alloc_root(MA_MEM_ROOT *mem_root, size_t Size)
 #endif
 }
 
+#if !(defined(HAVE_purify) && defined(EXTRA_DEBUG))
+/* moves all blocks to the free list, nothing is returned to malloc */
+static void mark_blocks_free(MA_MEM_ROOT *root)
+{
+  reg1 MA_USED_MEM *next;
+  reg2 MA_USED_MEM **last;
+
+  last= &root->free;
+  for (next= root->free; next; next= *(last= &next->next))
+    next->left= next->size - ALIGN_SIZE(sizeof(MA_USED_MEM));
+  *last= next= root->used;
+  for (; next; next= next->next)
+    next->left= next->size - ALIGN_SIZE(sizeof(MA_USED_MEM));
+  root->used= 0;
+  root->first_block_usage= 0;
+}
+#endif
+
 	/* deallocate everything used by alloc_root */
 
 void ma_free_root(MA_MEM_ROOT *root, myf MyFlags)
@@ -120,6 +138,13 @@ void ma_free_root(MA_MEM_ROOT *root, myf MyFlags)
 
   if (!root)
     return; /* purecov: inspected */
+#if !(defined(HAVE_purify) && defined(EXTRA_DEBUG))
+  if (MyFlags & MY_MARK_BLOCKS_FREE)
+  {
+    mark_blocks_free(root);
+    return;
+  }
+#endif
   if (!(MyFlags & MY_KEEP_PREALLOC))
     root->pre_alloc=0;
 
@@ -52,6 +52,7 @@
 #include <ma_global.h>
 #include <ma_string.h>
 #include <mariadb_ctype.h>
+#include <ma_simd.h>
 
 #ifdef HAVE_ICONV
 #ifdef _WIN32
@@ -201,6 +202,17 @@ static unsigned int check_mb_utf8_valid(const char *start, const char *end) {
    return (len > 1) ? len : 0;
 }
 
+/* flags for ma_simd_utf8_valid() matching mb_valid of cs, -1 if cs isn't UTF-8 */
+static int utf8_simd_flags(const MARIADB_CHARSET_INFO *cs) {
+   if (cs->mb_valid == check_mb_utf8_valid) {
+      return MA_UTF8_MB4;
+   }
+   if (cs->mb_valid == check_mb_utf8mb3_valid) {
+      return 0;
+   }
+   return -1;
+}
+
 static unsigned int mysql_mbcharlen_utf8mb3(unsigned int utf8) {
    if (utf8 < 0x80) {
       return 1; /* single byte character */
@@ -1038,9 +1050,35 @@ size_t mysql_cset_escape_quotes(const MARIADB_CHARSET_INFO *cset, char *newstr,
    const char *newstr_e = newstr + 2 * escapestr_len;
    const char *end = escapestr + escapestr_len;
    my_bool escape_overflow = FALSE;
+   /* ASCII compatible character sets: copy runs which need no escaping */
+   my_bool scan = cset->char_minlen == 1;
+   /* UTF-8: runs may also contain valid multibyte characters */
+   int utf8 = utf8_simd_flags(cset);
+   const char *valid_end = escapestr;
 
    for (; escapestr < end; escapestr++) {
       unsigned int len = 0;
+
+      if (scan) {
+         size_t clean;
+
+         if (utf8 >= 0) {
+            if (escapestr >= valid_end) {
+               valid_end = escapestr + ma_simd_utf8_valid((const uchar *)escapestr, end - escapestr, utf8, NULL);
+            }
+            clean = ma_simd_escape_span((const uchar *)escapestr, valid_end - escapestr, MA_ESCAPE_QUOTES, FALSE);
+         } else {
+            clean = ma_simd_escape_span((const uchar *)escapestr, end - escapestr, MA_ESCAPE_QUOTES,
+                                        cset->char_maxlen > 1);
+         }
+         /* output can't overflow, it has room for every byte twice */
+         memcpy(newstr, escapestr, clean);
+         newstr += clean;
+         escapestr += clean;
+         if (escapestr == end) {
+            break;
+         }
+      }
       /* check unicode characters */
 
       if (cset->char_maxlen > 1 && (len = cset->mb_valid(escapestr, end))) {
@@ -1087,11 +1125,36 @@ size_t mysql_cset_escape_slashes(const MARIADB_CHARSET_INFO *cset, char *newstr,
    const char *newstr_e = newstr + 2 * escapestr_len;
    const char *end = escapestr + escapestr_len;
    my_bool escape_overflow = FALSE;
+   /* ASCII compatible character sets: copy runs which need no escaping */
+   my_bool scan = cset->char_minlen == 1;
+   /* UTF-8: runs may also contain valid multibyte characters */
+   int utf8 = utf8_simd_flags(cset);
+   const char *valid_end = escapestr;
 
    for (; escapestr < end; escapestr++) {
       char esc = '\0';
       unsigned int len = 0;
 
+      if (scan) {
+         size_t clean;
+
+         if (utf8 >= 0) {
+            if (escapestr >= valid_end) {
+               valid_end = escapestr + ma_simd_utf8_valid((const uchar *)escapestr, end - escapestr, utf8, NULL);
+            }
+            clean = ma_simd_escape_span((const uchar *)escapestr, valid_end - escapestr, MA_ESCAPE_SLASHES, FALSE);
+         } else {
+            clean = ma_simd_escape_span((const uchar *)escapestr, end - escapestr, MA_ESCAPE_SLASHES,
+                                        cset->char_maxlen > 1);
+         }
+         /* output can't overflow, it has room for every byte twice */
+         memcpy(newstr, escapestr, clean);
+         newstr += clean;
+         escapestr += clean;
+         if (escapestr == end) {
+            break;
+         }
+      }
       /* check unicode characters */
       if (cset->char_maxlen > 1 && (len = cset->mb_valid(escapestr, end))) {
          /* check possible overflow */
@@ -1420,6 +1483,16 @@ size_t STDCALL mariadb_convert_string(const char *from __attribute__((unused)),
       return rc;
    }
 
+   /* UTF-8 to UTF-8: valid input is copied unchanged */
+   if (!strcmp(from_cs->encoding, "UTF-8") && !strcmp(to_cs->encoding, "UTF-8") && *to_len >= *from_len &&
+       ma_simd_utf8_valid((const uchar *)from, *from_len, MA_UTF8_MB4 | MA_UTF8_STRICT, NULL) == *from_len) {
+      rc = *from_len;
+      memcpy(to, from, rc);
+      *to_len -= rc;
+      *from_len = 0;
+      return rc;
+   }
+
    map_charset_name(to_cs->encoding, 1, to_encoding, sizeof(to_encoding));
    map_charset_name(from_cs->encoding, 0, from_encoding, sizeof(from_encoding));
 
@@ -24,6 +24,12 @@
 #include <ma_common.h>
 #include <ma_sys.h>
 #include <ma_string.h>
+#include <ma_pvio.h>
+#if defined(__linux__)
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#endif
 
 const char *compression_algorithms[] =
 {
@@ -44,68 +50,311 @@ const char *_mariadb_compression_algorithm_str(enum enum_ma_compression_algorith
       return compression_algorithms[COMPRESSION_UNKNOWN];
   }
 }
+/* monotonic time in microseconds, used for the compression statistics */
+ulonglong _mariadb_compress_time(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER count, freq;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&freq);
+  return (ulonglong)(count.QuadPart * 1000000 / freq.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (ulonglong)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
 /*
-** This replaces the packet with a compressed packet
-** Returns 1 on error
-** *complen is 0 if the packet wasn't compressed
+** Returns the connection's scratch buffer with at least size bytes.
+** The buffer is reused for all packets and grows geometrically, it will
+** be released in _mariadb_compress_end().
+** Returns NULL if we run out of memory
 */
-
-my_bool _mariadb_compress(NET *net, unsigned char *packet, size_t *len, size_t *complen)
+unsigned char *_mariadb_compress_buffer(NET *net, size_t size)
 {
-  if (*len < MIN_COMPRESS_LENGTH ||
-      !compression_plugin(net))
-    *complen=0;
-  else
+  struct st_mariadb_net_extension *ext= net->extension;
+
+  if (size > ext->compress_buf_size)
   {
-    unsigned char *compbuf=_mariadb_compress_alloc(net,packet,len,complen);
-    if (!compbuf)
-      return *complen ? 0 : 1;
-    memcpy(packet,compbuf,*len);
-    free(compbuf);
+    size_t new_size= MAX(size, ext->compress_buf_size * 2);
+    unsigned char *buf;
+
+    new_size= MAX(new_size, IO_SIZE);
+    if (!(buf= (unsigned char *)realloc(ext->compress_buf, new_size)))
+      return NULL;
+    ext->compress_buf= buf;
+    ext->compress_buf_size= new_size;
   }
+  return ext->compress_buf;
+}
+
+void _mariadb_compress_end(NET *net)
+{
+  if (!net->extension)
+    return;
+  free(net->extension->compress_buf);
+  net->extension->compress_buf= NULL;
+  net->extension->compress_buf_size= 0;
+}
+
+/*
+** Adaptive compression
+**
+** With MARIADB_OPT_COMPRESSION_ADAPTIVE the client decides per packet
+** whether compression is worth it:
+**
+** - large payloads are probed by compressing a small sample first,
+** - payloads which don't shrink by at least 1/COMPRESS_MIN_GAIN
+**   (already compressed data) are sent raw, and compression is skipped
+**   for an exponentially growing number of packets,
+** - every COMPRESS_SAMPLE_PACKETS packets the time spent compressing is
+**   compared with the time saved on the wire. The compression level is
+**   lowered if compression costs more than it saves (and compression is
+**   skipped at the lowest level), and raised if it is cheap.
+**
+** The time a write() call takes says nothing about the link: as long as
+** the packet fits into the socket buffer it only measures a memcpy.
+** The link rate is therefore measured from writes which filled the
+** socket buffer (see ma_net_real_write()): the remaining bytes of such
+** a packet are only accepted as fast as the link drains the buffer.
+** Until such a write was seen the rate is estimated from the congestion
+** window and round trip time of the TCP connection. If neither is
+** available the level is left unchanged.
+*/
+#define COMPRESS_MIN_GAIN        16
+#define COMPRESS_MAX_BACKOFF     64
+#define COMPRESS_SAMPLE_PACKETS  16
+#define COMPRESS_PROBE_LENGTH    4096
+#define COMPRESS_LINK_WINDOW     1000000 /* microseconds */
+
+static void ma_compress_policy_backoff(NET *net)
+{
+  ma_compress_policy *policy= &net->extension->compress_policy;
+
+  policy->backoff= policy->backoff ?
+                   MIN(policy->backoff * 2, COMPRESS_MAX_BACKOFF) : 1;
+  policy->skip= policy->backoff;
+}
+
+static void ma_compress_policy_set_level(NET *net, int level)
+{
+  ma_compress_ctx *ctx= compression_ctx(net);
+  MARIADB_COMPRESSION_STATS *stats= &net->extension->compression_stats;
+
+  if (level > ctx->compression_level)
+    stats->level_raised++;
+  else
+    stats->level_lowered++;
+  ctx->compression_level= stats->compression_level= level;
+}
+
+/*
+** Estimates the link rate in bytes per microsecond from TCP_INFO: one
+** congestion window is delivered per round trip.
+** Returns 0 if no estimate is available.
+*/
+static double ma_compress_tcp_rate(NET *net)
+{
+#if defined(__linux__) && defined(TCP_INFO)
+  struct tcp_info info;
+  socklen_t size= sizeof(info);
+  my_socket sock;
+
+  if (!net->pvio || net->pvio->type != PVIO_TYPE_SOCKET ||
+      ma_pvio_get_handle(net->pvio, &sock) ||
+      getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &size) ||
+      !info.tcpi_rtt)
+    return 0;
+  return (double)info.tcpi_snd_cwnd * info.tcpi_snd_mss / info.tcpi_rtt;
+#else
   return 0;
+#endif
 }
 
-unsigned char *_mariadb_compress_alloc(NET *net, const unsigned char *packet, size_t *len, size_t *complen)
+static void ma_compress_policy_tune(NET *net)
 {
-  unsigned char *compbuf;
-  *complen =  *len * 120 / 100 + 12;
+  ma_compress_policy *policy= &net->extension->compress_policy;
+  ma_compress_ctx *ctx= compression_ctx(net);
+  double cost, benefit, rate;
 
-  if (!(compbuf = (unsigned char *) malloc(*complen)))
-    return 0;					/* Not enough memory */
+  if (policy->link_time)
+    rate= (double)policy->link_bytes / policy->link_time;
+  else
+    rate= ma_compress_tcp_rate(net);
 
-  if (compression_plugin(net)->compress(compression_ctx(net), (void *)compbuf, complen, (void *)packet, *len))
+  if (rate > 0 && policy->raw_bytes)
   {
-    free(compbuf);
-    return 0;
+    /* wire time saved by compression, in microseconds */
+    benefit= (double)policy->saved_bytes / rate;
+    cost= (double)policy->compress_time;
+
+    if (cost > benefit)
+    {
+      if (ctx->max_level && ctx->compression_level > ctx->min_level)
+        ma_compress_policy_set_level(net, ctx->compression_level - 1);
+      else
+      {
+        policy->backoff= COMPRESS_MAX_BACKOFF;
+        policy->skip= COMPRESS_MAX_BACKOFF;
+      }
+    }
+    else if (cost * 4 < benefit && ctx->max_level &&
+             ctx->compression_level < ctx->max_level)
+      ma_compress_policy_set_level(net, ctx->compression_level + 1);
   }
 
-  if (*complen >= *len)
+  policy->packets= 0;
+  policy->raw_bytes= policy->saved_bytes= policy->compress_time= 0;
+}
+
+/*
+** Called by ma_net_real_write() after a packet was written in
+** write_time microseconds. If the write filled the socket buffer,
+** link_time is the time the link needed to take the last len bytes,
+** otherwise it is 0.
+*/
+void _mariadb_compress_written(NET *net, ulonglong write_time,
+                               size_t len, ulonglong link_time)
+{
+  ma_compress_policy *policy= &net->extension->compress_policy;
+
+  net->extension->compression_stats.write_time+= write_time;
+  if (!policy->adaptive)
+    return;
+  if (link_time)
   {
-    *complen=0;
-    free(compbuf);
-    return 0;
+    policy->link_bytes+= len;
+    policy->link_time+= link_time;
+    /* let old measurements fade out */
+    if (policy->link_time > COMPRESS_LINK_WINDOW)
+    {
+      policy->link_bytes/= 2;
+      policy->link_time/= 2;
+    }
   }
+  if (policy->packets >= COMPRESS_SAMPLE_PACKETS)
+    ma_compress_policy_tune(net);
+}
+
+/*
+** Compresses a sample of a large payload to find out if it is worth
+** compressing the complete payload.
+** Returns 1 if the payload is likely incompressible.
+*/
+static my_bool ma_compress_probe(NET *net, unsigned char *dst, size_t dst_len,
+                                 const unsigned char *packet, size_t len)
+{
+  size_t sample_len= COMPRESS_PROBE_LENGTH;
+  const unsigned char *sample= packet + (len - sample_len) / 2;
+
+  if (compression_plugin(net)->compress(compression_ctx(net), dst, &dst_len,
+                                        (void *)sample, sample_len))
+    return 1;
+  return dst_len > sample_len - sample_len / COMPRESS_MIN_GAIN;
+}
+
+/*
+** Compresses the packet into the connection's scratch buffer, leaving
+** room for the compressed protocol header (NET_HEADER_SIZE +
+** COMP_HEADER_SIZE bytes) in front of the payload.
+** On return *len is the length of the payload and *complen the
+** uncompressed length, or 0 if the packet was copied uncompressed.
+** Returns NULL if we run out of memory
+*/
 
-  swap(size_t,*len,*complen);			/* *len is now packet length */
-  return compbuf;
+unsigned char *_mariadb_compress(NET *net, const unsigned char *packet, size_t *len, size_t *complen)
+{
+  const size_t header_length= NET_HEADER_SIZE + COMP_HEADER_SIZE;
+  size_t bound= *len * 120 / 100 + 12;
+  MARIADB_COMPRESSION_STATS *stats= &net->extension->compression_stats;
+  ma_compress_policy *policy= &net->extension->compress_policy;
+  unsigned char *buf;
+
+  if (!(buf= _mariadb_compress_buffer(net, header_length + bound + 1)))
+    return NULL;
+
+  *complen= 0;
+  if (*len >= MIN_COMPRESS_LENGTH && compression_plugin(net))
+  {
+    size_t dst_len= bound;
+    ulonglong start;
+
+    if (policy->adaptive && policy->skip)
+    {
+      policy->skip--;
+      stats->packets_skipped++;
+      goto raw;
+    }
+
+    start= _mariadb_compress_time();
+    if (policy->adaptive && *len >= COMPRESS_PROBE_LENGTH * 4 &&
+        ma_compress_probe(net, buf + header_length, bound, packet, *len))
+    {
+      stats->compress_time+= _mariadb_compress_time() - start;
+      stats->packets_skipped++;
+      ma_compress_policy_backoff(net);
+      goto raw;
+    }
+
+    if (!compression_plugin(net)->compress(compression_ctx(net), buf + header_length,
+                                           &dst_len, (void *)packet, *len) &&
+        dst_len < *len)
+    {
+      ulonglong time= _mariadb_compress_time() - start;
+
+      stats->compress_time+= time;
+      stats->packets_sent++;
+      stats->raw_bytes_sent+= *len;
+      stats->compressed_bytes_sent+= dst_len;
+      if (policy->adaptive)
+      {
+        if (dst_len > *len - *len / COMPRESS_MIN_GAIN)
+          ma_compress_policy_backoff(net);
+        else
+          policy->backoff= 0;
+        policy->packets++;
+        policy->raw_bytes+= *len;
+        policy->saved_bytes+= *len - dst_len;
+        policy->compress_time+= time;
+      }
+      *complen= *len;
+      *len= dst_len;
+      return buf;
+    }
+    stats->compress_time+= _mariadb_compress_time() - start;
+    if (policy->adaptive)
+      ma_compress_policy_backoff(net);
+  }
+raw:
+  stats->packets_sent_raw++;
+  memcpy(buf + header_length, packet, *len);
+  return buf;
 }
 
+/*
+** Decompresses a packet into the net buffer.
+** If the packet is compressed (*complen > 0), ma_real_read() has already
+** read the compressed payload into the connection's scratch buffer, so we
+** can decompress it directly to its final position.
+** Returns 1 on error
+*/
 my_bool _mariadb_uncompress (NET *net, unsigned char *packet, size_t *len, size_t *complen)
 {
   if (*complen)					/* If compressed */
   {
-    unsigned char *compbuf = (unsigned char *) malloc (*complen);
-    if (!compbuf)
-      return 1;					/* Not enough memory */
-    if (compression_plugin(net)->decompress(compression_ctx(net), compbuf, complen, packet, len))
-    {						/* Probably wrong packet */
-      free(compbuf);
-      return 1;
-    }
+    MARIADB_COMPRESSION_STATS *stats= &net->extension->compression_stats;
+    ulonglong start= _mariadb_compress_time();
+    size_t compressed_len= *len;
+
+    if (compression_plugin(net)->decompress(compression_ctx(net), packet, complen,
+                                            net->extension->compress_buf, len))
+      return 1;                                 /* Probably wrong packet */
+    stats->decompress_time+= _mariadb_compress_time() - start;
+    stats->packets_read++;
+    stats->compressed_bytes_read+= compressed_len;
+    stats->raw_bytes_read+= *complen;
     *len = *complen;
-    memcpy(packet,compbuf,*len);
-    free(compbuf);
   }
   else *complen= *len;
   return 0;
@@ -23,14 +23,355 @@
 
 #include "ma_global.h"
 #include "ma_string.h"
+#include "ma_pthread.h"
 #include "ma_context.h"
+#include <mariadb_stack.h>
+#include <stdarg.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #ifdef HAVE_VALGRIND
 #include <valgrind/valgrind.h>
 #endif
 
+/*
+  Stacks
+
+  A stack is one allocation: the guard area at the lowest address (mapped
+  without any access rights), the usable stack above it, and the MA_STACK
+  header at the top, so no separate allocation is needed for bookkeeping.
+  With mmap() the pages are only committed when the stack grows into them.
+
+  A MARIADB_STACK_POOL keeps released stacks on a free list. Pooled
+  contexts take a stack in my_context_spawn() and give it back as soon as
+  the spawned function returned, since nothing lives on the stack between
+  two calls.
+*/
+
+#define MA_STACK_PATTERN 0xA5
+#define MA_STACK_HEADER ((sizeof(MA_STACK) + 63) & ~(size_t)63)
+#define MA_STACK_DEFAULT_MAX_IDLE 64
+
+#if defined(HAVE_MMAP) && !defined(MAP_ANONYMOUS)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#if defined(HAVE_MMAP) && !defined(MAP_STACK)
+#define MAP_STACK 0
+#endif
+
+typedef struct st_ma_stack {
+  struct st_ma_stack *next;         /* next idle stack of the pool */
+  void *map;                        /* start of the allocation */
+  size_t map_size;
+  unsigned char *bottom;            /* lowest usable address */
+  size_t size;                      /* usable bytes, up to the header */
+  my_bool painted;                  /* unused part holds MA_STACK_PATTERN */
+} MA_STACK;
+
+struct st_mariadb_stack_pool {
+  pthread_mutex_t lock;
+  unsigned int refs;                /* pool handle and contexts */
+  size_t stack_size;
+  size_t guard_size;
+  unsigned int max_idle;
+  my_bool measure;
+  MA_STACK *idle;
+  MARIADB_STACK_POOL_STATS stats;   /* protected by lock */
+};
+
+static size_t ma_stack_page_size(void)
+{
+#ifdef HAVE_MMAP
+  static size_t page_size;
+
+  if (!page_size)
+    page_size= (size_t)sysconf(_SC_PAGESIZE);
+  return page_size;
+#else
+  return 16;
+#endif
+}
+
+static void ma_stack_destroy(MA_STACK *stack)
+{
+#ifdef HAVE_MMAP
+  munmap(stack->map, stack->map_size);
+#else
+  free(stack->map);
+#endif
+}
+
+static void ma_stack_pool_unref(MARIADB_STACK_POOL *pool)
+{
+  MA_STACK *stack;
+  unsigned int refs;
+
+  pthread_mutex_lock(&pool->lock);
+  refs= --pool->refs;
+  pthread_mutex_unlock(&pool->lock);
+  if (refs)
+    return;
+
+  while ((stack= pool->idle))
+  {
+    pool->idle= stack->next;
+    ma_stack_destroy(stack);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+}
+
+#ifdef MY_CONTEXT_USE_STACK
+static MA_STACK *ma_stack_create(size_t stack_size, size_t guard_size,
+                                 my_bool paint)
+{
+  size_t page= ma_stack_page_size();
+  size_t size= (stack_size + MA_STACK_HEADER + page - 1) & ~(page - 1);
+  size_t map_size;
+  void *map;
+  MA_STACK *stack;
+
+#ifdef HAVE_MMAP
+  guard_size= (guard_size + page - 1) & ~(page - 1);
+  map_size= size + guard_size;
+  map= mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+  if (map == MAP_FAILED)
+    return NULL;
+  if (guard_size && mprotect(map, guard_size, PROT_NONE))
+  {
+    munmap(map, map_size);
+    return NULL;
+  }
+#else
+  guard_size= 0;
+  map_size= size;
+  if (!(map= malloc(map_size)))
+    return NULL;
+#endif
+
+  stack= (MA_STACK *)((unsigned char *)map + map_size - MA_STACK_HEADER);
+  stack->next= NULL;
+  stack->map= map;
+  stack->map_size= map_size;
+  stack->bottom= (unsigned char *)map + guard_size;
+  stack->size= (unsigned char *)stack - stack->bottom;
+  stack->painted= paint;
+  if (paint)
+    memset(stack->bottom, MA_STACK_PATTERN, stack->size);
+  return stack;
+}
+
+/*
+  Returns the number of bytes which were used since the stack was painted
+  and paints them again.
+*/
+static size_t ma_stack_measure(MA_STACK *stack)
+{
+  unsigned char *p= stack->bottom, *end= (unsigned char *)stack;
+
+  while (p < end && *p == MA_STACK_PATTERN)
+    p++;
+  memset(p, MA_STACK_PATTERN, end - p);
+  return end - p;
+}
+
+static MA_STACK *ma_stack_pool_get(MARIADB_STACK_POOL *pool)
+{
+  MA_STACK *stack;
+  size_t guard_size;
+  my_bool measure, created= 0;
+
+  pthread_mutex_lock(&pool->lock);
+  if ((stack= pool->idle))
+  {
+    pool->idle= stack->next;
+    pool->stats.idle--;
+  }
+  guard_size= pool->guard_size;
+  measure= pool->measure;
+  pthread_mutex_unlock(&pool->lock);
+
+  if (stack)
+  {
+    /* paint stacks which were trimmed or created before measuring */
+    if (measure && !stack->painted)
+    {
+      memset(stack->bottom, MA_STACK_PATTERN, stack->size);
+      stack->painted= 1;
+    }
+    else if (!measure)
+      stack->painted= 0;
+  }
+  else if (!(stack= ma_stack_create(pool->stack_size, guard_size, measure)))
+  {
+    pthread_mutex_lock(&pool->lock);
+    pool->stats.failed++;
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+  }
+  else
+    created= 1;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stats.created+= created;
+  pool->stats.acquired++;
+  if (++pool->stats.in_use > pool->stats.max_in_use)
+    pool->stats.max_in_use= pool->stats.in_use;
+  pthread_mutex_unlock(&pool->lock);
+  stack->next= NULL;
+  return stack;
+}
+
+static void ma_stack_pool_put(MARIADB_STACK_POOL *pool, MA_STACK *stack)
+{
+  size_t used= stack->painted ? ma_stack_measure(stack) : 0;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stats.in_use--;
+  if (used > pool->stats.high_water)
+    pool->stats.high_water= used;
+  if (pool->stats.idle < pool->max_idle)
+  {
+    stack->next= pool->idle;
+    pool->idle= stack;
+    pool->stats.idle++;
+    stack= NULL;
+  }
+  else
+    pool->stats.destroyed++;
+  pthread_mutex_unlock(&pool->lock);
+
+  if (stack)
+    ma_stack_destroy(stack);
+}
+#endif  /* MY_CONTEXT_USE_STACK */
+
+MARIADB_STACK_POOL * STDCALL mariadb_stack_pool_init(size_t stack_size)
+{
+  MARIADB_STACK_POOL *pool;
+  size_t page= ma_stack_page_size();
+
+  if (!(pool= (MARIADB_STACK_POOL *)calloc(1, sizeof(MARIADB_STACK_POOL))))
+    return NULL;
+  pthread_mutex_init(&pool->lock, NULL);
+  if (!stack_size)
+    stack_size= ASYNC_CONTEXT_DEFAULT_STACK_SIZE;
+  /* the usable size of the stacks which will be created */
+  pool->stack_size= ((stack_size + MA_STACK_HEADER + page - 1) & ~(page - 1)) -
+                    MA_STACK_HEADER;
+  pool->guard_size= page;
+  pool->max_idle= MA_STACK_DEFAULT_MAX_IDLE;
+  pool->refs= 1;
+  pool->stats.stack_size= pool->stack_size;
+  return pool;
+}
+
+int STDCALL mariadb_stack_pool_optionsv(MARIADB_STACK_POOL *pool,
+                                        enum mariadb_stack_pool_option option,
+                                        ...)
+{
+  va_list ap;
+  int rc= 0;
+
+  if (!pool)
+    return 1;
+
+  va_start(ap, option);
+  pthread_mutex_lock(&pool->lock);
+
+  switch (option) {
+  case MARIADB_STACK_POOL_MAX_IDLE:
+    pool->max_idle= va_arg(ap, unsigned int);
+    break;
+  case MARIADB_STACK_POOL_GUARD_SIZE:
+    pool->guard_size= va_arg(ap, size_t);
+    break;
+  case MARIADB_STACK_POOL_MEASURE:
+    pool->measure= (my_bool)va_arg(ap, int);
+    break;
+  default:
+    rc= 1;
+    break;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  va_end(ap);
+  return rc;
+}
+
+unsigned int STDCALL mariadb_stack_pool_trim(MARIADB_STACK_POOL *pool,
+                                             unsigned int keep)
+{
+  MA_STACK *stack, *free_list= NULL;
+  unsigned int count= 0, i= 0;
+
+  if (!pool)
+    return 0;
+
+  pthread_mutex_lock(&pool->lock);
+  if (!keep)
+  {
+    free_list= pool->idle;
+    pool->idle= NULL;
+  }
+  for (stack= pool->idle; stack; stack= stack->next)
+  {
+#if defined(HAVE_MMAP) && defined(MADV_DONTNEED)
+    /* drop the committed pages, the page with the header stays */
+    size_t size= ((unsigned char *)stack - stack->bottom) &
+                 ~(ma_stack_page_size() - 1);
+
+    if (size)
+    {
+      madvise(stack->bottom, size, MADV_DONTNEED);
+      stack->painted= 0;
+    }
+#endif
+    if (++i == keep)
+    {
+      free_list= stack->next;
+      stack->next= NULL;
+      break;
+    }
+  }
+  for (stack= free_list; stack; stack= stack->next)
+    count++;
+  pool->stats.idle-= count;
+  pool->stats.destroyed+= count;
+  pthread_mutex_unlock(&pool->lock);
+
+  while ((stack= free_list))
+  {
+    free_list= stack->next;
+    ma_stack_destroy(stack);
+  }
+  return count;
+}
+
+void STDCALL mariadb_stack_pool_get_stats(MARIADB_STACK_POOL *pool,
+                                          MARIADB_STACK_POOL_STATS *stats)
+{
+  if (!pool || !stats)
+    return;
+  pthread_mutex_lock(&pool->lock);
+  *stats= pool->stats;
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void STDCALL mariadb_stack_pool_close(MARIADB_STACK_POOL *pool)
+{
+  if (pool)
+    ma_stack_pool_unref(pool);
+}
+
 #ifdef MY_CONTEXT_USE_UCONTEXT
 
+#if SIZEOF_CHARP > SIZEOF_INT*2
+#error Error: Unable to store pointer in 2 ints on this architecture
+#endif
+
 typedef void (*uc_func_t)(void);
 
 /*
@@ -67,8 +408,8 @@ my_context_spawn_internal(int i0, int i1)
 }
 
 
-int
-my_context_continue(struct my_context *c)
+static int
+my_context_continue_on_stack(struct my_context *c)
 {
   int err;
 
@@ -87,8 +428,8 @@ my_context_continue(struct my_context *c)
 }
 
 
-int
-my_context_spawn(struct my_context *c, void (*f)(void *), void *d)
+static int
+my_context_spawn_on_stack(struct my_context *c, void (*f)(void *), void *d)
 {
   int err;
   union pass_void_ptr_as_2_int u;
@@ -106,7 +447,7 @@ my_context_spawn(struct my_context *c, void (*f)(void *), void *d)
   makecontext(&c->spawned_context, (uc_func_t)my_context_spawn_internal, 2,
               u.a[0], u.a[1]);
 
-  return my_context_continue(c);
+  return my_context_continue_on_stack(c);
 }
 
 
@@ -124,36 +465,6 @@ my_context_yield(struct my_context *c)
   return 0;
 }
 
-int
-my_context_init(struct my_context *c, size_t stack_size)
-{
-#if SIZEOF_CHARP > SIZEOF_INT*2
-#error Error: Unable to store pointer in 2 ints on this architecture
-#endif
-
-  memset(c, 0, sizeof(*c));
-  if (!(c->stack= malloc(stack_size)))
-    return -1;                                  /* Out of memory */
-  c->stack_size= stack_size;
-#ifdef HAVE_VALGRIND
-  c->valgrind_stack_id=
-    VALGRIND_STACK_REGISTER(c->stack, ((unsigned char *)(c->stack))+stack_size);
-#endif
-  return 0;
-}
-
-void
-my_context_destroy(struct my_context *c)
-{
-  if (c->stack)
-  {
-#ifdef HAVE_VALGRIND
-    VALGRIND_STACK_DEREGISTER(c->valgrind_stack_id);
-#endif
-    free(c->stack);
-  }
-}
-
 #endif  /* MY_CONTEXT_USE_UCONTEXT */
 
 
@@ -186,8 +497,8 @@ my_context_destroy(struct my_context *c)
    8   64   %rip for yield/continue
 */
 
-int
-my_context_spawn(struct my_context *c, void (*f)(void *), void *d)
+static int
+my_context_spawn_on_stack(struct my_context *c, void (*f)(void *), void *d)
 {
   int ret;
 
@@ -255,8 +566,8 @@ my_context_spawn(struct my_context *c, void (*f)(void *), void *d)
   return ret;
 }
 
-int
-my_context_continue(struct my_context *c)
+static int
+my_context_continue_on_stack(struct my_context *c)
 {
   int ret;
 
@@ -361,40 +672,6 @@ my_context_yield(struct my_context *c)
   return 0;
 }
 
-int
-my_context_init(struct my_context *c, size_t stack_size)
-{
-  memset(c, 0, sizeof(*c));
-
-  if (!(c->stack_bot= malloc(stack_size)))
-    return -1;                                  /* Out of memory */
-  /*
-    The x86_64 ABI specifies 16-byte stack alignment.
-    Also put two zero words at the top of the stack.
-  */
-  c->stack_top= (void *)
-    (( ((intptr)c->stack_bot + stack_size) & ~(intptr)0xf) - 16);
-  memset(c->stack_top, 0, 16);
-
-#ifdef HAVE_VALGRIND
-  c->valgrind_stack_id=
-    VALGRIND_STACK_REGISTER(c->stack_bot, c->stack_top);
-#endif
-  return 0;
-}
-
-void
-my_context_destroy(struct my_context *c)
-{
-  if (c->stack_bot)
-  {
-    free(c->stack_bot);
-#ifdef HAVE_VALGRIND
-    VALGRIND_STACK_DEREGISTER(c->valgrind_stack_id);
-#endif
-  }
-}
-
 #endif  /* MY_CONTEXT_USE_X86_64_GCC_ASM */
 
 
@@ -425,8 +702,8 @@ my_context_destroy(struct my_context *c)
    6   24   %eip for yield/continue
 */
 
-int
-my_context_spawn(struct my_context *c, void (*f)(void *), void *d)
+static int
+my_context_spawn_on_stack(struct my_context *c, void (*f)(void *), void *d)
 {
   int ret;
 
@@ -493,8 +770,8 @@ my_context_spawn(struct my_context *c, void (*f)(void *), void *d)
   return ret;
 }
 
-int
-my_context_continue(struct my_context *c)
+static int
+my_context_continue_on_stack(struct my_context *c)
 {
   int ret;
 
@@ -593,35 +870,6 @@ my_context_yield(struct my_context *c)
   return 0;
 }
 
-int
-my_context_init(struct my_context *c, size_t stack_size)
-{
-  memset(c, 0, sizeof(*c));
-  if (!(c->stack_bot= malloc(stack_size)))
-    return -1;                                  /* Out of memory */
-  c->stack_top= (void *)
-    (( ((intptr)c->stack_bot + stack_size) & ~(intptr)0xf) - 16);
-  memset(c->stack_top, 0, 16);
-
-#ifdef HAVE_VALGRIND
-  c->valgrind_stack_id=
-    VALGRIND_STACK_REGISTER(c->stack_bot, c->stack_top);
-#endif
-  return 0;
-}
-
-void
-my_context_destroy(struct my_context *c)
-{
-  if (c->stack_bot)
-  {
-    free(c->stack_bot);
-#ifdef HAVE_VALGRIND
-    VALGRIND_STACK_DEREGISTER(c->valgrind_stack_id);
-#endif
-  }
-}
-
 #endif  /* MY_CONTEXT_USE_I386_GCC_ASM */
 
 
@@ -655,8 +903,10 @@ my_context_trampoline(void *p)
 }
 
 int
-my_context_init(struct my_context *c, size_t stack_size)
+my_context_init(struct my_context *c, size_t stack_size,
+                struct st_mariadb_stack_pool *pool)
 {
+  /* fibers come with their own stack */
   memset(c, 0, sizeof(*c));
   c->lib_fiber= CreateFiber(stack_size, my_context_trampoline, c);
   if (c->lib_fiber)
@@ -715,7 +965,8 @@ my_context_yield(struct my_context *c)
 }
 
 int
-my_context_init(struct my_context *c, size_t stack_size)
+my_context_init(struct my_context *c, size_t stack_size,
+                struct st_mariadb_stack_pool *pool)
 {
   return -1;                                  /* Out of memory */
 }
@@ -726,3 +977,108 @@ my_context_destroy(struct my_context *c)
 }
 
 #endif
+
+
+#ifdef MY_CONTEXT_USE_STACK
+static void
+my_context_attach_stack(struct my_context *c, MA_STACK *stack)
+{
+  c->stack_mem= stack;
+#ifdef MY_CONTEXT_USE_UCONTEXT
+  c->stack= stack->bottom;
+  c->stack_size= stack->size;
+#else
+  /*
+    The x86 ABIs specify 16-byte stack alignment.
+    Also put two zero words at the top of the stack.
+  */
+  c->stack_bot= stack->bottom;
+  c->stack_top= (void *)
+    (( ((intptr)stack->bottom + stack->size) & ~(intptr)0xf) - 16);
+  memset(c->stack_top, 0, 16);
+#endif
+#ifdef HAVE_VALGRIND
+  c->valgrind_stack_id=
+    VALGRIND_STACK_REGISTER(stack->bottom, stack->bottom + stack->size);
+#endif
+}
+
+static void
+my_context_release_stack(struct my_context *c)
+{
+  MA_STACK *stack= c->stack_mem;
+
+  if (!stack)
+    return;
+#ifdef HAVE_VALGRIND
+  VALGRIND_STACK_DEREGISTER(c->valgrind_stack_id);
+#endif
+  c->stack_mem= NULL;
+  if (c->pool)
+    ma_stack_pool_put(c->pool, stack);
+  else
+    ma_stack_destroy(stack);
+}
+
+int
+my_context_spawn(struct my_context *c, void (*f)(void *), void *d)
+{
+  int ret;
+
+  if (!c->stack_mem)
+  {
+    MA_STACK *stack;
+
+    if (!c->pool || !(stack= ma_stack_pool_get(c->pool)))
+      return -1;
+    my_context_attach_stack(c, stack);
+  }
+  ret= my_context_spawn_on_stack(c, f, d);
+  if (ret <= 0 && c->pool)
+    my_context_release_stack(c);
+  return ret;
+}
+
+int
+my_context_continue(struct my_context *c)
+{
+  int ret= my_context_continue_on_stack(c);
+
+  /* on error the call is still suspended and needs its stack */
+  if (ret == 0 && c->pool)
+    my_context_release_stack(c);
+  return ret;
+}
+
+int
+my_context_init(struct my_context *c, size_t stack_size,
+                struct st_mariadb_stack_pool *pool)
+{
+  MA_STACK *stack;
+
+  memset(c, 0, sizeof(*c));
+  if (pool)
+  {
+    pthread_mutex_lock(&pool->lock);
+    pool->refs++;
+    pthread_mutex_unlock(&pool->lock);
+    c->pool= pool;
+    return 0;
+  }
+  if (!(stack= ma_stack_create(stack_size, ma_stack_page_size(), 0)))
+    return -1;                                  /* Out of memory */
+  my_context_attach_stack(c, stack);
+  return 0;
+}
+
+void
+my_context_destroy(struct my_context *c)
+{
+  my_context_release_stack(c);
+  if (c->pool)
+  {
+    ma_stack_pool_unref(c->pool);
+    c->pool= NULL;
+  }
+}
+#endif  /* MY_CONTEXT_USE_STACK */
@@ -56,6 +56,7 @@
 
 static char *dtoa(double, int, int, int *, int *, char **, char *, size_t);
 static void dtoa_free(char *, char *, size_t);
+static char *dtoa_fast(double, int, int, int *, int *, char **, char *, size_t);
 
 /**
    @brief
@@ -95,7 +96,7 @@ size_t ma_fcvt(double x, int precision, char *to, my_bool *error)
   char buf[DTOA_BUFF_SIZE];
   DBUG_ASSERT(precision >= 0 && precision < NOT_FIXED_DEC && to != NULL);
   
-  res= dtoa(x, 5, precision, &decpt, &sign, &end, buf, sizeof(buf));
+  res= dtoa_fast(x, 5, precision, &decpt, &sign, &end, buf, sizeof(buf));
 
   if (decpt == DTOA_OVERFLOW)
   {
@@ -224,8 +225,8 @@ size_t ma_gcvt(double x, my_gcvt_arg_type type, int width, char *to,
   if (x < 0.)
     width--;
 
-  res= dtoa(x, 4, type == MY_GCVT_ARG_DOUBLE ? width : MIN(width, FLT_DIG),
-            &decpt, &sign, &end, buf, sizeof(buf));
+  res= dtoa_fast(x, 4, type == MY_GCVT_ARG_DOUBLE ? width : MIN(width, FLT_DIG),
+                 &decpt, &sign, &end, buf, sizeof(buf));
   if (decpt == DTOA_OVERFLOW)
   {
     dtoa_free(res, buf, sizeof(buf));
@@ -330,7 +331,7 @@ size_t ma_gcvt(double x, my_gcvt_arg_type type, int width, char *to,
         number of significant digits = (len-decpt) - (len-width) = width-decpt
       */
       dtoa_free(res, buf, sizeof(buf));
-      res= dtoa(x, 5, width - decpt, &decpt, &sign, &end, buf, sizeof(buf));
+      res= dtoa_fast(x, 5, width - decpt, &decpt, &sign, &end, buf, sizeof(buf));
       src= res;
       len= (int)(end - res);
     }
@@ -396,7 +397,7 @@ size_t ma_gcvt(double x, my_gcvt_arg_type type, int width, char *to,
     {
       /* Yes, re-convert with a smaller width */
       dtoa_free(res, buf, sizeof(buf));
-      res= dtoa(x, 4, width, &decpt, &sign, &end, buf, sizeof(buf));
+      res= dtoa_fast(x, 4, width, &decpt, &sign, &end, buf, sizeof(buf));
       src= res;
       len= (int)(end - res);
       if (--decpt < 0)
@@ -1922,3 +1923,368 @@ ret1:
     *rve= s;
   return s0;
 }
+
+/*
+  Grisu3 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+  Accurately with Integers", PLDI 2010) fast paths for dtoa() modes 4 and 5.
+
+  Grisu works on 64-bit integers only and produces the shortest digit
+  string for ~99.5% of all doubles.
+  For the remaining numbers it reports that it can't decide and the caller
+  falls back to the bignum based dtoa(), so the results are identical.
+*/
+
+typedef struct
+{
+  ulonglong f;
+  int e;
+} grisu_fp;
+
+typedef struct
+{
+  ulonglong significand;
+  short binary_exponent;
+  short decimal_exponent;
+} grisu_cached_power;
+
+/* normalized 10^k, k= -348, -340, ..., 340 */
+static const grisu_cached_power grisu_cached_powers[]=
+{
+  {0xfa8fd5a0081c0288ULL, -1220, -348},
+  {0xbaaee17fa23ebf76ULL, -1193, -340},
+  {0x8b16fb203055ac76ULL, -1166, -332},
+  {0xcf42894a5dce35eaULL, -1140, -324},
+  {0x9a6bb0aa55653b2dULL, -1113, -316},
+  {0xe61acf033d1a45dfULL, -1087, -308},
+  {0xab70fe17c79ac6caULL, -1060, -300},
+  {0xff77b1fcbebcdc4fULL, -1034, -292},
+  {0xbe5691ef416bd60cULL, -1007, -284},
+  {0x8dd01fad907ffc3cULL, -980, -276},
+  {0xd3515c2831559a83ULL, -954, -268},
+  {0x9d71ac8fada6c9b5ULL, -927, -260},
+  {0xea9c227723ee8bcbULL, -901, -252},
+  {0xaecc49914078536dULL, -874, -244},
+  {0x823c12795db6ce57ULL, -847, -236},
+  {0xc21094364dfb5637ULL, -821, -228},
+  {0x9096ea6f3848984fULL, -794, -220},
+  {0xd77485cb25823ac7ULL, -768, -212},
+  {0xa086cfcd97bf97f4ULL, -741, -204},
+  {0xef340a98172aace5ULL, -715, -196},
+  {0xb23867fb2a35b28eULL, -688, -188},
+  {0x84c8d4dfd2c63f3bULL, -661, -180},
+  {0xc5dd44271ad3cdbaULL, -635, -172},
+  {0x936b9fcebb25c996ULL, -608, -164},
+  {0xdbac6c247d62a584ULL, -582, -156},
+  {0xa3ab66580d5fdaf6ULL, -555, -148},
+  {0xf3e2f893dec3f126ULL, -529, -140},
+  {0xb5b5ada8aaff80b8ULL, -502, -132},
+  {0x87625f056c7c4a8bULL, -475, -124},
+  {0xc9bcff6034c13053ULL, -449, -116},
+  {0x964e858c91ba2655ULL, -422, -108},
+  {0xdff9772470297ebdULL, -396, -100},
+  {0xa6dfbd9fb8e5b88fULL, -369, -92},
+  {0xf8a95fcf88747d94ULL, -343, -84},
+  {0xb94470938fa89bcfULL, -316, -76},
+  {0x8a08f0f8bf0f156bULL, -289, -68},
+  {0xcdb02555653131b6ULL, -263, -60},
+  {0x993fe2c6d07b7facULL, -236, -52},
+  {0xe45c10c42a2b3b06ULL, -210, -44},
+  {0xaa242499697392d3ULL, -183, -36},
+  {0xfd87b5f28300ca0eULL, -157, -28},
+  {0xbce5086492111aebULL, -130, -20},
+  {0x8cbccc096f5088ccULL, -103, -12},
+  {0xd1b71758e219652cULL, -77, -4},
+  {0x9c40000000000000ULL, -50, 4},
+  {0xe8d4a51000000000ULL, -24, 12},
+  {0xad78ebc5ac620000ULL, 3, 20},
+  {0x813f3978f8940984ULL, 30, 28},
+  {0xc097ce7bc90715b3ULL, 56, 36},
+  {0x8f7e32ce7bea5c70ULL, 83, 44},
+  {0xd5d238a4abe98068ULL, 109, 52},
+  {0x9f4f2726179a2245ULL, 136, 60},
+  {0xed63a231d4c4fb27ULL, 162, 68},
+  {0xb0de65388cc8ada8ULL, 189, 76},
+  {0x83c7088e1aab65dbULL, 216, 84},
+  {0xc45d1df942711d9aULL, 242, 92},
+  {0x924d692ca61be758ULL, 269, 100},
+  {0xda01ee641a708deaULL, 295, 108},
+  {0xa26da3999aef774aULL, 322, 116},
+  {0xf209787bb47d6b85ULL, 348, 124},
+  {0xb454e4a179dd1877ULL, 375, 132},
+  {0x865b86925b9bc5c2ULL, 402, 140},
+  {0xc83553c5c8965d3dULL, 428, 148},
+  {0x952ab45cfa97a0b3ULL, 455, 156},
+  {0xde469fbd99a05fe3ULL, 481, 164},
+  {0xa59bc234db398c25ULL, 508, 172},
+  {0xf6c69a72a3989f5cULL, 534, 180},
+  {0xb7dcbf5354e9beceULL, 561, 188},
+  {0x88fcf317f22241e2ULL, 588, 196},
+  {0xcc20ce9bd35c78a5ULL, 614, 204},
+  {0x98165af37b2153dfULL, 641, 212},
+  {0xe2a0b5dc971f303aULL, 667, 220},
+  {0xa8d9d1535ce3b396ULL, 694, 228},
+  {0xfb9b7cd9a4a7443cULL, 720, 236},
+  {0xbb764c4ca7a44410ULL, 747, 244},
+  {0x8bab8eefb6409c1aULL, 774, 252},
+  {0xd01fef10a657842cULL, 800, 260},
+  {0x9b10a4e5e9913129ULL, 827, 268},
+  {0xe7109bfba19c0c9dULL, 853, 276},
+  {0xac2820d9623bf429ULL, 880, 284},
+  {0x80444b5e7aa7cf85ULL, 907, 292},
+  {0xbf21e44003acdd2dULL, 933, 300},
+  {0x8e679c2f5e44ff8fULL, 960, 308},
+  {0xd433179d9c8cb841ULL, 986, 316},
+  {0x9e19db92b4e31ba9ULL, 1013, 324},
+  {0xeb96bf6ebadf77d9ULL, 1039, 332},
+  {0xaf87023b9bf0ee6bULL, 1066, 340}
+};
+
+#define GRISU_CACHED_POWERS_OFFSET 348
+#define GRISU_DECIMAL_EXPONENT_DISTANCE 8
+#define GRISU_MIN_TARGET_EXPONENT -60
+#define GRISU_MAX_TARGET_EXPONENT -32
+#define GRISU_MAX_DIGITS 18
+
+static const uint32 grisu_small_powers[]=
+{
+  0, 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+  1000000000
+};
+
+static grisu_fp grisu_multiply(grisu_fp x, grisu_fp y)
+{
+  const ulonglong m32= 0xFFFFFFFFULL;
+  ulonglong a= x.f >> 32, b= x.f & m32, c= y.f >> 32, d= y.f & m32;
+  ulonglong ac= a * c, bc= b * c, ad= a * d, bd= b * d;
+  ulonglong tmp= (bd >> 32) + (ad & m32) + (bc & m32);
+  grisu_fp r;
+
+  tmp+= 1ULL << 31; /* round */
+  r.f= ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+  r.e= x.e + y.e + 64;
+  return r;
+}
+
+static grisu_fp grisu_normalize(grisu_fp x)
+{
+  while (!(x.f & 0xFFC0000000000000ULL))
+  {
+    x.f<<= 10;
+    x.e-= 10;
+  }
+  while (!(x.f & 0x8000000000000000ULL))
+  {
+    x.f<<= 1;
+    x.e--;
+  }
+  return x;
+}
+
+/* returns v as f * 2^e (not normalized) and its rounding boundaries */
+static grisu_fp grisu_boundaries(double v, grisu_fp *minus, grisu_fp *plus)
+{
+  U u;
+  ulonglong bits, frac;
+  int biased_exp;
+  grisu_fp w;
+
+  dval(&u)= v;
+  bits= ((ulonglong)word0(&u) << 32) | (ulonglong)word1(&u);
+  frac= bits & 0x000FFFFFFFFFFFFFULL;
+  biased_exp= (int)((bits >> 52) & 0x7FF);
+  if (biased_exp)
+  {
+    w.f= frac | 0x0010000000000000ULL;
+    w.e= biased_exp - 1075;
+  }
+  else
+  {
+    w.f= frac;
+    w.e= -1074;
+  }
+
+  plus->f= (w.f << 1) + 1;
+  plus->e= w.e - 1;
+  *plus= grisu_normalize(*plus);
+  /* the lower boundary is closer if v is a power of two (but not denormal) */
+  if (!frac && biased_exp > 1)
+  {
+    minus->f= (w.f << 2) - 1;
+    minus->e= w.e - 2;
+  }
+  else
+  {
+    minus->f= (w.f << 1) - 1;
+    minus->e= w.e - 1;
+  }
+  minus->f<<= minus->e - plus->e;
+  minus->e= plus->e;
+  return w;
+}
+
+/* cached power c with GRISU_MIN_TARGET_EXPONENT <= c.e + w_e + 64 <= GRISU_MAX_TARGET_EXPONENT */
+static grisu_fp grisu_get_cached_power(int w_e, int *decimal_exponent)
+{
+  int min_exponent= GRISU_MIN_TARGET_EXPONENT - (w_e + 64);
+  int k= (int)ceil((min_exponent + 63) * 0.30102999566398114);
+  int index= (GRISU_CACHED_POWERS_OFFSET + k - 1) /
+             GRISU_DECIMAL_EXPONENT_DISTANCE + 1;
+  grisu_fp c;
+
+  c.f= grisu_cached_powers[index].significand;
+  c.e= grisu_cached_powers[index].binary_exponent;
+  *decimal_exponent= grisu_cached_powers[index].decimal_exponent;
+  return c;
+}
+
+static void grisu_biggest_power_ten(uint32 number, int number_bits,
+                                    uint32 *power, int *exponent_plus_one)
+{
+  int guess= ((number_bits + 1) * 1233 >> 12) + 1;
+
+  if (number < grisu_small_powers[guess])
+    guess--;
+  *power= grisu_small_powers[guess];
+  *exponent_plus_one= guess;
+}
+
+static int grisu_round_weed(char *buffer, int length,
+                            ulonglong distance_too_high_w,
+                            ulonglong unsafe_interval, ulonglong rest,
+                            ulonglong ten_kappa, ulonglong unit)
+{
+  ulonglong small_distance= distance_too_high_w - unit;
+  ulonglong big_distance= distance_too_high_w + unit;
+
+  while (rest < small_distance &&
+         unsafe_interval - rest >= ten_kappa &&
+         (rest + ten_kappa < small_distance ||
+          small_distance - rest >= rest + ten_kappa - small_distance))
+  {
+    buffer[length - 1]--;
+    rest+= ten_kappa;
+  }
+
+  if (rest < big_distance &&
+      unsafe_interval - rest >= ten_kappa &&
+      (rest + ten_kappa < big_distance ||
+       big_distance - rest > rest + ten_kappa - big_distance))
+    return 1;
+
+  return !(2 * unit <= rest && rest <= unsafe_interval - 4 * unit);
+}
+
+/**
+  Shortest digit string for a positive, finite, non zero double.
+
+  @return 0 on success (digits * 10^decimal_exponent is the shortest
+          representation which rounds to v), 1 if dtoa() has to be used
+*/
+static int grisu_shortest(double v, char *buffer, int *length,
+                          int *decimal_exponent)
+{
+  grisu_fp w, minus, plus, c, low, high, too_low, too_high, one;
+  ulonglong unit= 1, unsafe_interval, fractionals, rest;
+  uint32 integrals, divisor;
+  int mk, kappa;
+
+  w= grisu_normalize(grisu_boundaries(v, &minus, &plus));
+  c= grisu_get_cached_power(w.e, &mk);
+  w= grisu_multiply(w, c);
+  low= grisu_multiply(minus, c);
+  high= grisu_multiply(plus, c);
+
+  too_low.f= low.f - unit;
+  too_low.e= low.e;
+  too_high.f= high.f + unit;
+  too_high.e= high.e;
+  unsafe_interval= too_high.f - too_low.f;
+  one.f= 1ULL << -w.e;
+  one.e= w.e;
+  integrals= (uint32)(too_high.f >> -one.e);
+  fractionals= too_high.f & (one.f - 1);
+
+  grisu_biggest_power_ten(integrals, 64 + one.e, &divisor, &kappa);
+  *length= 0;
+
+  while (kappa > 0)
+  {
+    buffer[(*length)++]= '0' + integrals / divisor;
+    integrals%= divisor;
+    kappa--;
+    rest= ((ulonglong)integrals << -one.e) + fractionals;
+    if (rest < unsafe_interval)
+    {
+      *decimal_exponent= kappa - mk;
+      return grisu_round_weed(buffer, *length, too_high.f - w.f,
+                              unsafe_interval, rest,
+                              (ulonglong)divisor << -one.e, unit);
+    }
+    divisor/= 10;
+  }
+
+  for (;;)
+  {
+    fractionals*= 10;
+    unit*= 10;
+    unsafe_interval*= 10;
+    buffer[(*length)++]= '0' + (int)(fractionals >> -one.e);
+    fractionals&= one.f - 1;
+    kappa--;
+    if (fractionals < unsafe_interval)
+    {
+      *decimal_exponent= kappa - mk;
+      return grisu_round_weed(buffer, *length, (too_high.f - w.f) * unit,
+                              unsafe_interval, fractionals, one.f, unit);
+    }
+  }
+}
+
+/**
+  Wrapper around dtoa() which uses Grisu3 for modes 4 and 5 when the
+  result can be determined with it. Arguments and return value are the
+  same as for dtoa().
+*/
+static char *dtoa_fast(double x, int mode, int ndigits, int *decpt, int *sign,
+                       char **rve, char *buf, size_t buf_size)
+{
+  char digits[GRISU_MAX_DIGITS + 1];
+  int len, exp10, ilim;
+  double ax= x < 0 ? -x : x;
+  U u;
+
+  dval(&u)= x;
+  if ((mode != 4 && mode != 5) || x == 0.0 ||
+      (word0(&u) & Exp_mask) == Exp_mask || buf_size <= GRISU_MAX_DIGITS)
+    return dtoa(x, mode, ndigits, decpt, sign, rve, buf, buf_size);
+
+  /*
+    If no more than Quick_max digits are requested, dtoa() uses a fast
+    floating point path already. For mode 5 the number of digits depends
+    on the decimal exponent, which we estimate from the binary one.
+  */
+  if (mode == 5)
+    ilim= ndigits + 1 + (int)(((word0(&u) & Exp_mask) >> Exp_shift) - Bias) * 3 / 10;
+  else
+    ilim= ndigits;
+  if (ilim <= Quick_max)
+    return dtoa(x, mode, ndigits, decpt, sign, rve, buf, buf_size);
+
+  /*
+    mode 4: at most ndigits significant digits, mode 5: at most ndigits
+    digits after the decimal point. If the shortest representation doesn't
+    fit, the number has to be rounded and we let dtoa() do this.
+  */
+  if (!grisu_shortest(ax, digits, &len, &exp10) &&
+      (mode == 4 ? len <= MAX(ndigits, 1) : -exp10 <= ndigits))
+    goto found;
+  return dtoa(x, mode, ndigits, decpt, sign, rve, buf, buf_size);
+
+found:
+  memcpy(buf, digits, len);
+  buf[len]= '\0';
+  *decpt= len + exp10;
+  *sign= x < 0;
+  *rve= buf + len;
+  return buf;
+}
@@ -120,6 +120,8 @@ const char *mariadb_client_errors[] =
   /* 5023 */ "Semi sync request error: %s",
   /* 5024 */ "Invalid client flags (%lu) specified. Supported flags: %lu",
   /* 5025 */ "Statement has no result set",
+  /* 5026 */ "Timeout while waiting for a free connection (pool size %u)",
+  /* 5027 */ "Operation aborted after %u ms",
   ""
 };
 
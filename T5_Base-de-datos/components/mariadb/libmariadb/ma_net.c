@@ -74,6 +74,7 @@ ulong net_buffer_length= 8192;	/* Default length. Enlarged if necessary */
  */
 
 static int ma_net_write_buff(NET *net,const char *packet, size_t len);
+static int ma_net_real_writev(NET *net, const uchar *packet, size_t len);
 
 
 /* Init with packet info */
@@ -113,6 +114,9 @@ void ma_net_end(NET *net)
 {
   free(net->buff);
   net->buff=0;
+#ifdef HAVE_COMPRESS
+  _mariadb_compress_end(net);
+#endif
 }
 
 /* Realloc the packet buffer */
@@ -261,6 +265,10 @@ static int ma_net_write_buff(NET *net,const char *packet, size_t len)
 
   if (len > left_length)
   {
+    /* send buffered data and packet together, without copying the packet */
+    if (!net->compress)
+      return ma_net_real_writev(net, (const uchar *)packet, len);
+
     if (net->write_pos != net->buff)
     {
       memcpy((char*) net->write_pos,packet,left_length);
@@ -300,6 +308,10 @@ int ma_net_real_write(NET *net, const char *packet, size_t len)
 {
   ssize_t length;
   char *pos,*end;
+#ifdef HAVE_COMPRESS
+  ulonglong start= 0, blocked_start= 0;
+  char *blocked= NULL;
+#endif
 
   if (net->error == 2)
     return(-1);				/* socket can't be used */
@@ -311,24 +323,20 @@ int ma_net_real_write(NET *net, const char *packet, size_t len)
     size_t complen;
     uchar *b;
     uint header_length=NET_HEADER_SIZE+COMP_HEADER_SIZE;
-    if (!(b=(uchar*) malloc(len + NET_HEADER_SIZE + COMP_HEADER_SIZE + 1)))
+    /* b is the connection's scratch buffer, it must not be freed */
+    if (!(b= _mariadb_compress(net, (const uchar *)packet, &len, &complen)))
     {
       net->pvio->set_error(net->pvio->mysql, CR_OUT_OF_MEMORY, SQLSTATE_UNKNOWN, 0);
       net->error=2;
       net->reading_or_writing=0;
       return(1);
     }
-    memcpy(b+header_length,packet,len);
-
-    if (_mariadb_compress(net, (unsigned char*) b+header_length,&len,&complen))
-    {
-      complen=0;
-    }
     int3store(&b[NET_HEADER_SIZE],complen);
     int3store(b,len);
     b[3]=(uchar) (net->compress_pkt_nr++);
     len+= header_length;
     packet= (char*) b;
+    start= _mariadb_compress_time();
   }
 #endif /* HAVE_COMPRESS */
 
@@ -345,22 +353,89 @@ int ma_net_real_write(NET *net, const char *packet, size_t len)
       net->pvio->set_error(net->pvio->mysql, CR_ERR_NET_WRITE, SQLSTATE_UNKNOWN, 0,
                            errmsg, save_errno);
       net->reading_or_writing=0;
-#ifdef HAVE_COMPRESS
-      if (net->compress)
-        free((char*) packet);
-#endif
       return(1);
     }
     pos+=length;
+#ifdef HAVE_COMPRESS
+    /*
+      A partial write means the socket buffer is full: from now on the
+      remaining bytes are accepted at the rate of the link.
+    */
+    if (net->compress && pos != end && !blocked)
+    {
+      blocked= pos;
+      blocked_start= _mariadb_compress_time();
+    }
+#endif
   }
 #ifdef HAVE_COMPRESS
   if (net->compress)
-    free((char*) packet);
+  {
+    ulonglong now= _mariadb_compress_time();
+    if (blocked)
+      _mariadb_compress_written(net, now - start, (size_t)(end - blocked),
+                                now - blocked_start);
+    else
+      _mariadb_compress_written(net, now - start, 0, 0);
+  }
 #endif
   net->reading_or_writing=0;
   return(((int) (pos != end)));
 }
 
+/*
+ ** Gather write of the buffered data (net->buff .. net->write_pos)
+ ** followed by packet. Used for packets which don't fit into the net
+ ** buffer, they are sent directly instead of being copied into the
+ ** buffer chunk by chunk. Not used with compression, since the
+ ** compressed protocol needs the complete payload in one buffer.
+ */
+static int ma_net_real_writev(NET *net, const uchar *packet, size_t len)
+{
+  MA_PVIO_IOVEC iov[2];
+  ssize_t length;
+  int i= 0;
+
+  if (net->error == 2)
+    return(-1);				/* socket can't be used */
+
+  net->reading_or_writing=2;
+  iov[0].base= net->buff;
+  iov[0].length= (size_t)(net->write_pos - net->buff);
+  iov[1].base= packet;
+  iov[1].length= len;
+
+  while (i < 2)
+  {
+    if ((length=ma_pvio_writev(net->pvio, iov + i, 2 - i)) <= 0)
+    {
+      int save_errno= errno;
+      char errmsg[100];
+
+      net->error=2;				/* Close socket */
+      strerror_r(save_errno, errmsg, 100);
+      net->pvio->set_error(net->pvio->mysql, CR_ERR_NET_WRITE, SQLSTATE_UNKNOWN, 0,
+                           errmsg, save_errno);
+      net->reading_or_writing=0;
+      return(1);
+    }
+    /* skip the segments which were sent completely */
+    while (i < 2 && (size_t)length >= iov[i].length)
+    {
+      length-= iov[i].length;
+      i++;
+    }
+    if (i < 2)
+    {
+      iov[i].base+= length;
+      iov[i].length-= length;
+    }
+  }
+  net->write_pos= net->buff;
+  net->reading_or_writing=0;
+  return 0;
+}
+
 /*****************************************************************************
  ** Read something from server/clinet
  *****************************************************************************/
@@ -419,6 +494,19 @@ static ulong ma_real_read(NET *net, size_t *complen)
         }
       }
       pos=net->buff + net->where_b;
+#ifdef HAVE_COMPRESS
+      /*
+        Compressed payload is read into the scratch buffer, so it can be
+        decompressed directly into net->buff by _mariadb_uncompress()
+      */
+      if (*complen && !(pos= _mariadb_compress_buffer(net, len)))
+      {
+        net->pvio->set_error(net->pvio->mysql, CR_OUT_OF_MEMORY, SQLSTATE_UNKNOWN, 0);
+        net->error= 2;
+        len= packet_error;
+        goto end;
+      }
+#endif
       remain = len;
     }
   }
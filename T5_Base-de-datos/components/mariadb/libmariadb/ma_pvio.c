@@ -37,8 +37,12 @@
 
    ma_pvio_write         sends data to server
 
+   ma_pvio_writev        sends multiple buffers to server
+
    ma_pvio_set_timeout   sets timeout for connection, read and write
 
+   ma_pvio_established   tells the plugin that the handshake has completed
+
    ma_pvio_register_callback
                         register callback functions for read and write
  */
@@ -69,8 +73,9 @@ MARIADB_PVIO *ma_pvio_init(MA_PVIO_CINFO *cinfo)
    *   pvio_socket
    *   pvio_namedpipe
    *   pvio_sharedmed
+   *   pvio_uring (sockets with MARIADB_OPT_IO_URING)
    */
-  const char *pvio_plugins[] = {"pvio_socket", "pvio_npipe", "pvio_shmem"};
+  const char *pvio_plugins[] = {"pvio_socket", "pvio_npipe", "pvio_shmem", "pvio_uring"};
   int type;
   MARIADB_PVIO_PLUGIN *pvio_plugin;
   MARIADB_PVIO *pvio= NULL;
@@ -79,7 +84,7 @@ MARIADB_PVIO *ma_pvio_init(MA_PVIO_CINFO *cinfo)
   {
     case PVIO_TYPE_UNIXSOCKET:
     case PVIO_TYPE_SOCKET:
-      type= 0;
+      type= OPT_EXT_VAL(cinfo->mysql, io_uring) ? 3 : 0;
       break;
 #ifdef _WIN32
     case PVIO_TYPE_NAMEDPIPE:
@@ -98,8 +103,16 @@ MARIADB_PVIO *ma_pvio_init(MA_PVIO_CINFO *cinfo)
                                           pvio_plugins[type], 
                                           MARIADB_CLIENT_PVIO_PLUGIN)))
   {
-    /* error already set in mysql_client_find_plugin */
-    return NULL;
+    /* without io_uring support fall back to plain sockets */
+    if (type != 3 ||
+        !(pvio_plugin= (MARIADB_PVIO_PLUGIN *)
+                 mysql_client_find_plugin(cinfo->mysql, pvio_plugins[0],
+                                          MARIADB_CLIENT_PVIO_PLUGIN)))
+    {
+      /* error already set in mysql_client_find_plugin */
+      return NULL;
+    }
+    CLEAR_CLIENT_ERROR(cinfo->mysql);
   }
 
 /* coverity[var_deref_op] */
@@ -399,6 +412,64 @@ end:
 }
 /* }}} */
 
+/* {{{ size_t ma_pvio_writev */
+/*
+  Gather write: sends up to iovcnt segments with a single system call.
+  If the pvio plugin doesn't support gather writes, or the connection
+  is secure or asynchronous, only the first non empty segment will be
+  written. Like ma_pvio_write() this may write less than requested,
+  the caller has to resend the remaining data.
+*/
+ssize_t ma_pvio_writev(MARIADB_PVIO *pvio, const MA_PVIO_IOVEC *iov, int iovcnt)
+{
+  ssize_t r;
+
+  if (!pvio)
+    return -1;
+
+  while (iovcnt > 1 && !iov->length)
+  {
+    iov++;
+    iovcnt--;
+  }
+
+  if (iovcnt == 1 || !pvio->methods->writev || pvio->ctls ||
+      IS_PVIO_ASYNC_ACTIVE(pvio))
+    return ma_pvio_write(pvio, iov->base, iov->length);
+
+  if (IS_PVIO_ASYNC(pvio))
+  {
+    my_bool old_mode;
+    ma_pvio_blocking(pvio, TRUE, &old_mode);
+  }
+
+  r= pvio->methods->writev(pvio, iov, MIN(iovcnt, PVIO_IOV_MAX));
+
+  if (pvio_callback && r > 0)
+  {
+    void (*callback)(int mode, MYSQL *mysql, const uchar *buffer, size_t length);
+    ssize_t left= r;
+    int i;
+
+    for (i= 0; left > 0 && i < iovcnt; i++)
+    {
+      size_t length= MIN((size_t)left, iov[i].length);
+      LIST *p= pvio_callback;
+      while (p)
+      {
+        callback= p->data;
+        callback(1, pvio->mysql, iov[i].base, length);
+        p= p->next;
+      }
+      left-= length;
+    }
+  }
+  if (r > 0)
+    pvio->bytes_sent+= r;
+  return r;
+}
+/* }}} */
+
 /* {{{ void ma_pvio_close */
 void ma_pvio_close(MARIADB_PVIO *pvio)
 {
@@ -521,6 +592,18 @@ my_bool ma_pvio_has_data(MARIADB_PVIO *pvio, ssize_t *data_len)
 }
 /* }}} */
 
+/* {{{ ma_pvio_established */
+/*
+  Called when the handshake has completed: from now on the connection
+  will neither switch to TLS nor send or receive outside of the pvio.
+*/
+void ma_pvio_established(MARIADB_PVIO *pvio)
+{
+  if (pvio && pvio->methods->established)
+    pvio->methods->established(pvio);
+}
+/* }}} */
+
 #ifdef HAVE_TLS
 
 /* {{{ my_bool ma_pvio_start_ssl */
@@ -0,0 +1,1045 @@
+/************************************************************************************
+   Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not see <http://www.gnu.org/licenses>
+   or write to the Free Software Foundation, Inc.,
+   51 Franklin St., Fifth Floor, Boston, MA 02110, USA
+*************************************************************************************/
+
+/*
+  Vectorized string kernels, see ma_simd.h
+
+  SSE2 is part of x86_64 and NEON of aarch64, so both are used without
+  a runtime check. AVX2 kernels are compiled with a target attribute and
+  only used if the CPU reports AVX2 support, the same applies to the
+  CRC32 kernels (PCLMULQDQ and the ARMv8 CRC32 instructions).
+*/
+
+#include <ma_global.h>
+#include <ma_simd.h>
+#include <string.h>
+#include <zlib.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || \
+    (defined(__i386__) && defined(__SSE2__))
+#define MA_HAVE_SSE2
+#include <emmintrin.h>
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+#define MA_HAVE_AVX2
+#define MA_TARGET_AVX2 __attribute__((target("avx2")))
+#define MA_HAVE_PCLMUL
+#define MA_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define MA_HAVE_AVX2
+#define MA_TARGET_AVX2
+#define MA_HAVE_PCLMUL
+#define MA_TARGET_PCLMUL
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define MA_HAVE_NEON
+#include <arm_neon.h>
+#if !defined(__AARCH64EB__)
+#if defined(_MSC_VER) && !defined(__clang__)
+#define MA_HAVE_ARM_CRC32
+#define MA_TARGET_CRC32
+#define MA_CRC32B(c, b) __crc32b((c), (b))
+#define MA_CRC32D(c, d) __crc32d((c), (d))
+#include <intrin.h>
+#elif defined(__clang__)
+#define MA_HAVE_ARM_CRC32
+#define MA_TARGET_CRC32 __attribute__((target("crc")))
+#define MA_CRC32B(c, b) __builtin_arm_crc32b((c), (b))
+#define MA_CRC32D(c, d) __builtin_arm_crc32d((c), (d))
+#elif defined(__GNUC__) && __GNUC__ >= 6
+#define MA_HAVE_ARM_CRC32
+#define MA_TARGET_CRC32 __attribute__((target("+crc")))
+#define MA_CRC32B(c, b) __builtin_aarch64_crc32b((c), (b))
+#define MA_CRC32D(c, d) __builtin_aarch64_crc32x((c), (d))
+#endif
+#if defined(MA_HAVE_ARM_CRC32) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+#endif
+#endif
+
+static int simd_level= -1;
+
+static inline unsigned int ma_ctz(unsigned long long x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_ctzll(x);
+#else
+  unsigned int n= 0;
+  while (!(x & 1))
+  {
+    x>>= 1;
+    n++;
+  }
+  return n;
+#endif
+}
+
+/* {{{ detection */
+#ifdef MA_HAVE_AVX2
+static my_bool ma_cpu_has_avx2(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return 0;
+  __cpuid(info, 1);
+  /* OSXSAVE and AVX, and the OS saves the ymm registers */
+  if ((info[2] & (1 << 27 | 1 << 28)) != (1 << 27 | 1 << 28) ||
+      (_xgetbv(0) & 6) != 6)
+    return 0;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#endif
+
+enum enum_ma_simd_level ma_simd_detect(void)
+{
+#if defined(MA_HAVE_AVX2)
+  if (ma_cpu_has_avx2())
+    return MA_SIMD_AVX2;
+#endif
+#if defined(MA_HAVE_SSE2)
+  return MA_SIMD_SSE2;
+#elif defined(MA_HAVE_NEON)
+  return MA_SIMD_NEON;
+#else
+  return MA_SIMD_WORD;
+#endif
+}
+
+enum enum_ma_simd_level ma_simd_level(void)
+{
+  if (simd_level < 0)
+    simd_level= ma_simd_detect();
+  return (enum enum_ma_simd_level)simd_level;
+}
+
+my_bool ma_simd_set_level(enum enum_ma_simd_level level)
+{
+  enum enum_ma_simd_level best= ma_simd_detect();
+
+  switch (level) {
+  case MA_SIMD_SCALAR:
+  case MA_SIMD_WORD:
+    break;
+  case MA_SIMD_SSE2:
+    if (best != MA_SIMD_SSE2 && best != MA_SIMD_AVX2)
+      return 1;
+    break;
+  case MA_SIMD_AVX2:
+  case MA_SIMD_NEON:
+    if (best != level)
+      return 1;
+    break;
+  default:
+    return 1;
+  }
+  simd_level= level;
+  return 0;
+}
+/* }}} */
+
+/* {{{ escape span */
+
+/* MA_ESCAPE_* bits of the sets a character belongs to */
+static const uchar escape_class[256]= {
+  6, 4, 4, 4, 4, 4, 4, 4, 4, 4, 6, 4, 4, 6, 4, 4,   /* \0 \n \r */
+  4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 6, 4, 4, 4, 4, 4,   /* \032 */
+  0, 0, 6, 0, 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0,   /* " ' */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0,   /* \\ */
+};
+
+#define ESCAPE_QUOTE_SETS (MA_ESCAPE_QUOTES | MA_ESCAPE_SLASHES)
+
+static size_t escape_span_bytes(const uchar *str, size_t length, int set,
+                                my_bool stop_high)
+{
+  size_t i;
+
+  for (i= 0; i < length; i++)
+    if ((escape_class[str[i]] & set) || (stop_high && str[i] >= 0x80))
+      break;
+  return i;
+}
+
+#define WORD_ONES  0x0101010101010101ULL
+#define WORD_HIGHS 0x8080808080808080ULL
+/* non zero if one of the bytes of v is zero */
+#define WORD_HAS_ZERO(v) (((v) - WORD_ONES) & ~(v) & WORD_HIGHS)
+#define WORD_HAS_BYTE(v, b) WORD_HAS_ZERO((v) ^ (WORD_ONES * (b)))
+/* non zero if one of the bytes of v is less than b (b <= 0x80) */
+#define WORD_HAS_LESS(v, b) (((v) - WORD_ONES * (b)) & ~(v) & WORD_HIGHS)
+
+static size_t escape_span_word(const uchar *str, size_t length, int set,
+                               my_bool stop_high)
+{
+  size_t i= 0;
+
+  for (; i + 8 <= length; i+= 8)
+  {
+    unsigned long long v, hit;
+
+    memcpy(&v, str + i, 8);
+    hit= (set & ESCAPE_QUOTE_SETS) ? WORD_HAS_BYTE(v, '\'') : 0;
+    if (set & MA_ESCAPE_SLASHES)
+      hit|= WORD_HAS_ZERO(v) | WORD_HAS_BYTE(v, '\n') |
+            WORD_HAS_BYTE(v, '\r') | WORD_HAS_BYTE(v, '\\') |
+            WORD_HAS_BYTE(v, '"') | WORD_HAS_BYTE(v, '\032');
+    if (set & MA_ESCAPE_JSON)
+      hit|= WORD_HAS_LESS(v, 0x20) | WORD_HAS_BYTE(v, '\\') |
+            WORD_HAS_BYTE(v, '"');
+    if (stop_high)
+      hit|= v & WORD_HIGHS;
+    if (hit)
+      break;
+  }
+  return i + escape_span_bytes(str + i, length - i, set, stop_high);
+}
+
+#ifdef MA_HAVE_SSE2
+static size_t escape_span_sse2(const uchar *str, size_t length, int set,
+                               my_bool stop_high)
+{
+  size_t i= 0;
+  const __m128i quote= _mm_set1_epi8('\'');
+
+  for (; i + 16 <= length; i+= 16)
+  {
+    __m128i v= _mm_loadu_si128((const __m128i *)(str + i));
+    __m128i m= (set & ESCAPE_QUOTE_SETS) ? _mm_cmpeq_epi8(v, quote) :
+                                           _mm_setzero_si128();
+    unsigned int mask;
+
+    if (set & MA_ESCAPE_SLASHES)
+    {
+      m= _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+      m= _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+      m= _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+      m= _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+      m= _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+      m= _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\032')));
+    }
+    if (set & MA_ESCAPE_JSON)
+    {
+      /* v <= 0x1f (unsigned) */
+      m= _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v));
+      m= _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+      m= _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    }
+    /* movemask takes the high bit of every byte */
+    if (stop_high)
+      m= _mm_or_si128(m, v);
+    if ((mask= (unsigned int)_mm_movemask_epi8(m)))
+      return i + ma_ctz(mask);
+  }
+  return i + escape_span_bytes(str + i, length - i, set, stop_high);
+}
+#endif
+
+#ifdef MA_HAVE_AVX2
+MA_TARGET_AVX2
+static size_t escape_span_avx2(const uchar *str, size_t length, int set,
+                               my_bool stop_high)
+{
+  size_t i= 0;
+  const __m256i quote= _mm256_set1_epi8('\'');
+
+  for (; i + 32 <= length; i+= 32)
+  {
+    __m256i v= _mm256_loadu_si256((const __m256i *)(str + i));
+    __m256i m= (set & ESCAPE_QUOTE_SETS) ? _mm256_cmpeq_epi8(v, quote) :
+                                           _mm256_setzero_si256();
+    unsigned int mask;
+
+    if (set & MA_ESCAPE_SLASHES)
+    {
+      m= _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+      m= _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+      m= _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+      m= _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+      m= _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+      m= _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\032')));
+    }
+    if (set & MA_ESCAPE_JSON)
+    {
+      m= _mm256_or_si256(m, _mm256_cmpeq_epi8(
+                              _mm256_min_epu8(v, _mm256_set1_epi8(0x1f)), v));
+      m= _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+      m= _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')));
+    }
+    if (stop_high)
+      m= _mm256_or_si256(m, v);
+    if ((mask= (unsigned int)_mm256_movemask_epi8(m)))
+      return i + ma_ctz(mask);
+  }
+  /* avoids the AVX to SSE transition penalty in the SSE2 code */
+  _mm256_zeroupper();
+  return i + escape_span_sse2(str + i, length - i, set, stop_high);
+}
+#endif
+
+#ifdef MA_HAVE_NEON
+/* 4 bits per byte of a compare result, see ARM's "porting x86 vector
+   bitmask optimizations to Arm NEON" */
+static inline unsigned long long neon_mask(uint8x16_t m)
+{
+  uint8x8_t n= vshrn_n_u16(vreinterpretq_u16_u8(m), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(n), 0);
+}
+
+static size_t escape_span_neon(const uchar *str, size_t length, int set,
+                               my_bool stop_high)
+{
+  size_t i= 0;
+  const uint8x16_t quote= vdupq_n_u8('\'');
+
+  for (; i + 16 <= length; i+= 16)
+  {
+    uint8x16_t v= vld1q_u8(str + i);
+    uint8x16_t m= (set & ESCAPE_QUOTE_SETS) ? vceqq_u8(v, quote) :
+                                              vdupq_n_u8(0);
+    unsigned long long mask;
+
+    if (set & MA_ESCAPE_SLASHES)
+    {
+      m= vorrq_u8(m, vceqq_u8(v, vdupq_n_u8(0)));
+      m= vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\n')));
+      m= vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\r')));
+      m= vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\\')));
+      m= vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('"')));
+      m= vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\032')));
+    }
+    if (set & MA_ESCAPE_JSON)
+    {
+      m= vorrq_u8(m, vcltq_u8(v, vdupq_n_u8(0x20)));
+      m= vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('\\')));
+      m= vorrq_u8(m, vceqq_u8(v, vdupq_n_u8('"')));
+    }
+    if (stop_high)
+      m= vorrq_u8(m, vcgeq_u8(v, vdupq_n_u8(0x80)));
+    if ((mask= neon_mask(m)))
+      return i + (ma_ctz(mask) >> 2);
+  }
+  return i + escape_span_bytes(str + i, length - i, set, stop_high);
+}
+#endif
+
+size_t ma_simd_escape_span(const uchar *str, size_t length, int set,
+                           my_bool stop_high)
+{
+  switch (ma_simd_level()) {
+  case MA_SIMD_SCALAR:
+    return 0;
+#ifdef MA_HAVE_SSE2
+  case MA_SIMD_SSE2:
+    return escape_span_sse2(str, length, set, stop_high);
+#endif
+#ifdef MA_HAVE_AVX2
+  case MA_SIMD_AVX2:
+    return escape_span_avx2(str, length, set, stop_high);
+#endif
+#ifdef MA_HAVE_NEON
+  case MA_SIMD_NEON:
+    return escape_span_neon(str, length, set, stop_high);
+#endif
+  default:
+    return escape_span_word(str, length, set, stop_high);
+  }
+}
+/* }}} */
+
+/* {{{ hex */
+static const char hexdigits[]= "0123456789ABCDEF";
+
+#define HEX_ROW(h) h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7" \
+                   h "8" h "9" h "A" h "B" h "C" h "D" h "E" h "F"
+/* two digits for every byte value */
+static const char hex_pairs[]=
+  HEX_ROW("0") HEX_ROW("1") HEX_ROW("2") HEX_ROW("3")
+  HEX_ROW("4") HEX_ROW("5") HEX_ROW("6") HEX_ROW("7")
+  HEX_ROW("8") HEX_ROW("9") HEX_ROW("A") HEX_ROW("B")
+  HEX_ROW("C") HEX_ROW("D") HEX_ROW("E") HEX_ROW("F");
+
+static void hex_bytes(char *to, const uchar *from, size_t length)
+{
+  while (length--)
+  {
+    *to++= hexdigits[*from >> 4];
+    *to++= hexdigits[*from & 0x0F];
+    from++;
+  }
+}
+
+static void hex_table(char *to, const uchar *from, size_t length)
+{
+  while (length--)
+  {
+    memcpy(to, hex_pairs + 2 * *from++, 2);
+    to+= 2;
+  }
+}
+
+#ifdef MA_HAVE_SSE2
+/* converts nibbles 0..15 to '0'..'9', 'A'..'F' */
+static inline __m128i hex_digits_sse2(__m128i n)
+{
+  __m128i letter= _mm_cmpgt_epi8(n, _mm_set1_epi8(9));
+  return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')),
+                      _mm_and_si128(letter, _mm_set1_epi8('A' - '0' - 10)));
+}
+
+static void hex_sse2(char *to, const uchar *from, size_t length)
+{
+  const __m128i low= _mm_set1_epi8(0x0F);
+
+  for (; length >= 16; length-= 16, from+= 16, to+= 32)
+  {
+    __m128i v= _mm_loadu_si128((const __m128i *)from);
+    __m128i hi= hex_digits_sse2(_mm_and_si128(_mm_srli_epi16(v, 4), low));
+    __m128i lo= hex_digits_sse2(_mm_and_si128(v, low));
+    _mm_storeu_si128((__m128i *)to, _mm_unpacklo_epi8(hi, lo));
+    _mm_storeu_si128((__m128i *)(to + 16), _mm_unpackhi_epi8(hi, lo));
+  }
+  hex_table(to, from, length);
+}
+#endif
+
+#ifdef MA_HAVE_NEON
+static void hex_neon(char *to, const uchar *from, size_t length)
+{
+  const uint8x16_t digits= vld1q_u8((const uchar *)hexdigits);
+
+  for (; length >= 16; length-= 16, from+= 16, to+= 32)
+  {
+    uint8x16_t v= vld1q_u8(from);
+    uint8x16x2_t out;
+    out.val[0]= vqtbl1q_u8(digits, vshrq_n_u8(v, 4));
+    out.val[1]= vqtbl1q_u8(digits, vandq_u8(v, vdupq_n_u8(0x0F)));
+    /* interleaves high and low digits */
+    vst2q_u8((uchar *)to, out);
+  }
+  hex_table(to, from, length);
+}
+#endif
+
+void ma_simd_hex(char *to, const uchar *from, size_t length)
+{
+  switch (ma_simd_level()) {
+  case MA_SIMD_SCALAR:
+    hex_bytes(to, from, length);
+    break;
+#ifdef MA_HAVE_SSE2
+  case MA_SIMD_SSE2:
+  case MA_SIMD_AVX2:
+    hex_sse2(to, from, length);
+    break;
+#endif
+#ifdef MA_HAVE_NEON
+  case MA_SIMD_NEON:
+    hex_neon(to, from, length);
+    break;
+#endif
+  default:
+    hex_table(to, from, length);
+  }
+}
+/* }}} */
+
+/* {{{ utf8 validation */
+static inline unsigned int ma_popcount(unsigned int x)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_popcount(x);
+#else
+  unsigned int n= 0;
+  for (; x; x&= x - 1)
+    n++;
+  return n;
+#endif
+}
+
+/* length of the character at s, 0 if it is invalid or incomplete */
+static inline unsigned int utf8_char_length(const uchar *s, const uchar *end,
+                                            int flags)
+{
+  uchar c= s[0];
+
+  if (c < 0x80)
+    return 1;
+  if (c < 0xC2)
+    return 0;
+  if (c < 0xE0)
+    return (end - s >= 2 && (s[1] ^ 0x80) < 0x40) ? 2 : 0;
+  if (c < 0xF0)
+  {
+    if (end - s < 3 || (s[1] ^ 0x80) >= 0x40 || (s[2] ^ 0x80) >= 0x40 ||
+        (c == 0xE0 && s[1] < 0xA0) ||
+        (c == 0xED && s[1] >= 0xA0 && (flags & MA_UTF8_STRICT)))
+      return 0;
+    return 3;
+  }
+  if (!(flags & MA_UTF8_MB4) || c > 0xF4 || end - s < 4 ||
+      (s[1] ^ 0x80) >= 0x40 || (s[2] ^ 0x80) >= 0x40 ||
+      (s[3] ^ 0x80) >= 0x40 ||
+      (c == 0xF0 && s[1] < 0x90) || (c == 0xF4 && s[1] > 0x8F))
+    return 0;
+  return 4;
+}
+
+static size_t utf8_valid_bytes(const uchar *str, size_t length, int flags,
+                               size_t *chars)
+{
+  const uchar *p= str, *end= str + length;
+  size_t n= 0;
+  unsigned int len;
+
+  while (p < end && (len= utf8_char_length(p, end, flags)))
+  {
+    p+= len;
+    n++;
+  }
+  *chars+= n;
+  return p - str;
+}
+
+static size_t utf8_valid_word(const uchar *str, size_t length, int flags,
+                              size_t *chars)
+{
+  size_t i= 0;
+
+  while (i < length)
+  {
+    unsigned int len;
+
+    for (; i + 8 <= length; i+= 8, *chars+= 8)
+    {
+      unsigned long long v;
+      memcpy(&v, str + i, 8);
+      if (v & WORD_HIGHS)
+        break;
+    }
+    if (i >= length || !(len= utf8_char_length(str + i, str + length, flags)))
+      break;
+    i+= len;
+    (*chars)++;
+  }
+  return i;
+}
+
+#ifdef MA_HAVE_SSE2
+/* SSE2 has no byte shuffle, so only ASCII blocks are skipped */
+static size_t utf8_valid_sse2(const uchar *str, size_t length, int flags,
+                              size_t *chars)
+{
+  size_t i= 0;
+
+  while (i < length)
+  {
+    unsigned int len;
+
+    for (; i + 16 <= length; i+= 16, *chars+= 16)
+      if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(str + i))))
+        break;
+    if (i >= length || !(len= utf8_char_length(str + i, str + length, flags)))
+      break;
+    i+= len;
+    (*chars)++;
+  }
+  return i;
+}
+#endif
+
+#if defined(MA_HAVE_AVX2) || defined(MA_HAVE_NEON)
+/*
+  Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per
+  Byte". Three table lookups (high and low nibble of the previous byte,
+  high nibble of the current byte) classify all errors in 2 byte
+  sequences, a second check verifies that 3rd and 4th bytes of longer
+  sequences are continuation bytes and no others.
+*/
+#define U8_TOO_SHORT       (1 << 0)
+#define U8_TOO_LONG        (1 << 1)
+#define U8_OVERLONG_3      (1 << 2)
+#define U8_TOO_LARGE       (1 << 3)
+#define U8_SURROGATE       (1 << 4)
+#define U8_OVERLONG_2      (1 << 5)
+#define U8_TOO_LARGE_1000  (1 << 6)
+#define U8_OVERLONG_4      (1 << 6)
+#define U8_TWO_CONTS       (1 << 7)
+#define U8_CARRY           (U8_TOO_SHORT | U8_TOO_LONG | U8_TWO_CONTS)
+
+static const uchar utf8_byte_1_high[16]= {
+  /* 0_______ ________ ASCII followed by continuation */
+  U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+  U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG, U8_TOO_LONG,
+  /* 10______ ________ */
+  U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS, U8_TWO_CONTS,
+  /* 1100____ ________ */
+  U8_TOO_SHORT | U8_OVERLONG_2,
+  /* 1101____ ________ */
+  U8_TOO_SHORT,
+  /* 1110____ ________ */
+  U8_TOO_SHORT | U8_OVERLONG_3 | U8_SURROGATE,
+  /* 1111____ ________ */
+  U8_TOO_SHORT | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_OVERLONG_4
+};
+
+static const uchar utf8_byte_1_low[16]= {
+  /* ____0000 ________ */
+  U8_CARRY | U8_OVERLONG_3 | U8_OVERLONG_2 | U8_OVERLONG_4,
+  /* ____0001 ________ */
+  U8_CARRY | U8_OVERLONG_2,
+  /* ____001_ ________ */
+  U8_CARRY,
+  U8_CARRY,
+  /* ____0100 ________ */
+  U8_CARRY | U8_TOO_LARGE,
+  /* ____0101 ________ */
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  /* ____011_ ________ */
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  /* ____1___ ________ */
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  /* ____1101 ________ */
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000 | U8_SURROGATE,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000,
+  U8_CARRY | U8_TOO_LARGE | U8_TOO_LARGE_1000
+};
+
+static const uchar utf8_byte_2_high[16]= {
+  /* ________ 0_______ */
+  U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+  U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT,
+  /* ________ 1000____ */
+  U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 |
+  U8_TOO_LARGE_1000 | U8_OVERLONG_4,
+  /* ________ 1001____ */
+  U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_OVERLONG_3 | U8_TOO_LARGE,
+  /* ________ 101_____ */
+  U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+  U8_TOO_LONG | U8_OVERLONG_2 | U8_TWO_CONTS | U8_SURROGATE | U8_TOO_LARGE,
+  /* ________ 11______ */
+  U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT, U8_TOO_SHORT
+};
+
+/*
+  Called when the block at offset i failed: the blocks before are valid,
+  but may end with an incomplete character. Continues byte by byte at the
+  start of this character.
+*/
+static size_t utf8_valid_tail(const uchar *str, size_t length, size_t i,
+                              int flags, size_t *chars)
+{
+  size_t start= i, k;
+
+  for (k= 1; k <= 3 && k <= i; k++)
+  {
+    if ((str[i - k] & 0xC0) != 0x80)
+    {
+      start= i - k;
+      /* this character was already counted */
+      (*chars)--;
+      break;
+    }
+  }
+  return start + utf8_valid_bytes(str + start, length - start, flags, chars);
+}
+#endif
+
+#ifdef MA_HAVE_AVX2
+/* input shifted by n bytes, the first n bytes taken from prev */
+#define AVX2_PREV(input, prev, n) \
+  _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev, input, 0x21), 16 - (n))
+
+MA_TARGET_AVX2
+static inline __m256i avx2_table(const uchar *table)
+{
+  return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)table));
+}
+
+MA_TARGET_AVX2
+static size_t utf8_valid_avx2(const uchar *str, size_t length, int flags,
+                              size_t *chars)
+{
+  const __m256i byte_1_high= avx2_table(utf8_byte_1_high);
+  const __m256i byte_1_low= avx2_table(utf8_byte_1_low);
+  const __m256i byte_2_high= avx2_table(utf8_byte_2_high);
+  const __m256i low= _mm256_set1_epi8(0x0F);
+  const __m256i mask= _mm256_set1_epi8((char)((flags & MA_UTF8_STRICT) ?
+                                              0xFF : ~U8_SURROGATE));
+  /* a lead byte in the last 3 bytes needs bytes of the next block */
+  const __m256i incomplete_max= _mm256_setr_epi8(
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+  __m256i prev= _mm256_setzero_si256(), incomplete= _mm256_setzero_si256();
+  size_t i= 0;
+
+  for (; i + 32 <= length; i+= 32)
+  {
+    __m256i input= _mm256_loadu_si256((const __m256i *)(str + i));
+    __m256i error;
+
+    if (!_mm256_movemask_epi8(input))
+    {
+      error= incomplete;
+      incomplete= _mm256_setzero_si256();
+    }
+    else
+    {
+      __m256i prev1= AVX2_PREV(input, prev, 1);
+      __m256i prev2= AVX2_PREV(input, prev, 2);
+      __m256i prev3= AVX2_PREV(input, prev, 3);
+      __m256i special, must23;
+
+      special= _mm256_and_si256(
+        _mm256_and_si256(
+          _mm256_shuffle_epi8(byte_1_high,
+                              _mm256_and_si256(_mm256_srli_epi16(prev1, 4), low)),
+          _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, low))),
+        _mm256_shuffle_epi8(byte_2_high,
+                            _mm256_and_si256(_mm256_srli_epi16(input, 4), low)));
+      /* high bit set if prev2 >= 0xE0 or prev3 >= 0xF0 */
+      must23= _mm256_or_si256(
+        _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)),
+        _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80)));
+      must23= _mm256_and_si256(must23, _mm256_set1_epi8((char)0x80));
+      error= _mm256_and_si256(_mm256_xor_si256(must23, special), mask);
+      if (!(flags & MA_UTF8_MB4))
+        error= _mm256_or_si256(error,
+                 _mm256_subs_epu8(input, _mm256_set1_epi8((char)0xEF)));
+      incomplete= _mm256_subs_epu8(input, incomplete_max);
+    }
+    if (!_mm256_testz_si256(error, error))
+    {
+      _mm256_zeroupper();
+      return utf8_valid_tail(str, length, i, flags, chars);
+    }
+    /* bytes which are not continuation bytes start a character */
+    *chars+= ma_popcount((unsigned int)_mm256_movemask_epi8(
+                 _mm256_cmpgt_epi8(input, _mm256_set1_epi8(-65))));
+    prev= input;
+  }
+  _mm256_zeroupper();
+  return utf8_valid_tail(str, length, i, flags, chars);
+}
+#endif
+
+#ifdef MA_HAVE_NEON
+static size_t utf8_valid_neon(const uchar *str, size_t length, int flags,
+                              size_t *chars)
+{
+  const uint8x16_t byte_1_high= vld1q_u8(utf8_byte_1_high);
+  const uint8x16_t byte_1_low= vld1q_u8(utf8_byte_1_low);
+  const uint8x16_t byte_2_high= vld1q_u8(utf8_byte_2_high);
+  const uint8x16_t low= vdupq_n_u8(0x0F);
+  const uint8x16_t mask= vdupq_n_u8((flags & MA_UTF8_STRICT) ?
+                                    0xFF : (uchar)~U8_SURROGATE);
+  static const uchar incomplete_bytes[16]= {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 - 1, 0xE0 - 1, 0xC0 - 1};
+  const uint8x16_t incomplete_max= vld1q_u8(incomplete_bytes);
+  uint8x16_t prev= vdupq_n_u8(0), incomplete= vdupq_n_u8(0);
+  size_t i= 0;
+
+  for (; i + 16 <= length; i+= 16)
+  {
+    uint8x16_t input= vld1q_u8(str + i);
+    uint8x16_t error;
+
+    if (vmaxvq_u8(input) < 0x80)
+    {
+      error= incomplete;
+      incomplete= vdupq_n_u8(0);
+    }
+    else
+    {
+      uint8x16_t prev1= vextq_u8(prev, input, 15);
+      uint8x16_t prev2= vextq_u8(prev, input, 14);
+      uint8x16_t prev3= vextq_u8(prev, input, 13);
+      uint8x16_t special, must23;
+
+      special= vandq_u8(
+        vandq_u8(vqtbl1q_u8(byte_1_high, vshrq_n_u8(prev1, 4)),
+                 vqtbl1q_u8(byte_1_low, vandq_u8(prev1, low))),
+        vqtbl1q_u8(byte_2_high, vshrq_n_u8(input, 4)));
+      must23= vorrq_u8(vqsubq_u8(prev2, vdupq_n_u8(0xE0 - 0x80)),
+                       vqsubq_u8(prev3, vdupq_n_u8(0xF0 - 0x80)));
+      must23= vandq_u8(must23, vdupq_n_u8(0x80));
+      error= vandq_u8(veorq_u8(must23, special), mask);
+      if (!(flags & MA_UTF8_MB4))
+        error= vorrq_u8(error, vqsubq_u8(input, vdupq_n_u8(0xEF)));
+      incomplete= vqsubq_u8(input, incomplete_max);
+    }
+    if (vmaxvq_u8(error))
+      return utf8_valid_tail(str, length, i, flags, chars);
+    *chars+= vaddvq_u8(vshrq_n_u8(vcgtq_s8(vreinterpretq_s8_u8(input),
+                                           vdupq_n_s8(-65)), 7));
+    prev= input;
+  }
+  return utf8_valid_tail(str, length, i, flags, chars);
+}
+#endif
+
+size_t ma_simd_utf8_valid(const uchar *str, size_t length, int flags,
+                          size_t *chars)
+{
+  size_t count= 0, valid;
+
+  switch (ma_simd_level()) {
+  case MA_SIMD_SCALAR:
+    valid= utf8_valid_bytes(str, length, flags, &count);
+    break;
+#ifdef MA_HAVE_SSE2
+  case MA_SIMD_SSE2:
+    valid= utf8_valid_sse2(str, length, flags, &count);
+    break;
+#endif
+#ifdef MA_HAVE_AVX2
+  case MA_SIMD_AVX2:
+    valid= utf8_valid_avx2(str, length, flags, &count);
+    break;
+#endif
+#ifdef MA_HAVE_NEON
+  case MA_SIMD_NEON:
+    valid= utf8_valid_neon(str, length, flags, &count);
+    break;
+#endif
+  default:
+    valid= utf8_valid_word(str, length, flags, &count);
+  }
+  if (chars)
+    *chars= count;
+  return valid;
+}
+/* }}} */
+
+/* {{{ crc32 */
+
+/*
+  CRC-32 as computed by zlib's crc32(), which is also the checksum of
+  binlog events.
+
+  The x86 kernel folds 64 bytes per iteration with carry-less
+  multiplication, see "Fast CRC Computation for Generic Polynomials Using
+  PCLMULQDQ Instruction" (Intel, 2009), the constants are the ones of
+  zlib's crc32_simd.c. aarch64 uses the CRC32 instructions of ARMv8.
+  Both are optional extensions, if the CPU doesn't support them zlib is
+  used.
+*/
+static int crc32_hw= -1;
+
+static uint32 crc32_zlib(uint32 crc, const uchar *buf, size_t length)
+{
+  while (length)
+  {
+    uInt len= (uInt)MIN(length, 1U << 30);
+    crc= (uint32)crc32(crc, buf, len);
+    buf+= len;
+    length-= len;
+  }
+  return crc;
+}
+
+#ifdef MA_HAVE_PCLMUL
+static my_bool ma_cpu_has_crc32(void)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4];
+
+  __cpuid(info, 1);
+  /* PCLMULQDQ and SSE4.1 */
+  return (info[2] & (1 << 1 | 1 << 19)) == (1 << 1 | 1 << 19);
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+/* length must be a multiple of 16 and at least 64, crc is not inverted */
+MA_TARGET_PCLMUL
+static uint32 crc32_fold_pclmul(uint32 crc, const uchar *buf, size_t length)
+{
+  static const uint64 k1k2[]= {0x0154442bd4ULL, 0x01c6e41596ULL};
+  static const uint64 k3k4[]= {0x01751997d0ULL, 0x00ccaa009eULL};
+  static const uint64 k5k0[]= {0x0163cd6124ULL, 0x0000000000ULL};
+  static const uint64 poly[]= {0x01db710641ULL, 0x01f7011641ULL};
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, mask;
+
+  x1= _mm_loadu_si128((const __m128i *)(buf + 0x00));
+  x2= _mm_loadu_si128((const __m128i *)(buf + 0x10));
+  x3= _mm_loadu_si128((const __m128i *)(buf + 0x20));
+  x4= _mm_loadu_si128((const __m128i *)(buf + 0x30));
+  x1= _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+  x0= _mm_loadu_si128((const __m128i *)k1k2);
+  buf+= 64;
+  length-= 64;
+
+  /* fold 4 x 128 bits in parallel */
+  for (; length >= 64; buf+= 64, length-= 64)
+  {
+    x5= _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6= _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7= _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8= _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1= _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2= _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3= _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4= _mm_clmulepi64_si128(x4, x0, 0x11);
+    x1= _mm_xor_si128(_mm_xor_si128(x1, x5),
+                      _mm_loadu_si128((const __m128i *)(buf + 0x00)));
+    x2= _mm_xor_si128(_mm_xor_si128(x2, x6),
+                      _mm_loadu_si128((const __m128i *)(buf + 0x10)));
+    x3= _mm_xor_si128(_mm_xor_si128(x3, x7),
+                      _mm_loadu_si128((const __m128i *)(buf + 0x20)));
+    x4= _mm_xor_si128(_mm_xor_si128(x4, x8),
+                      _mm_loadu_si128((const __m128i *)(buf + 0x30)));
+  }
+
+  /* fold into 128 bits */
+  x0= _mm_loadu_si128((const __m128i *)k3k4);
+  x5= _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1= _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1= _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5= _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1= _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1= _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5= _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1= _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1= _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  for (; length >= 16; buf+= 16, length-= 16)
+  {
+    x5= _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1= _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1= _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i *)buf)), x5);
+  }
+
+  /* fold 128 bits to 64 bits */
+  mask= _mm_setr_epi32(~0, 0, ~0, 0);
+  x2= _mm_clmulepi64_si128(x1, x0, 0x10);
+  x1= _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x0= _mm_loadl_epi64((const __m128i *)k5k0);
+  x2= _mm_srli_si128(x1, 4);
+  x1= _mm_clmulepi64_si128(_mm_and_si128(x1, mask), x0, 0x00);
+  x1= _mm_xor_si128(x1, x2);
+
+  /* Barrett reduction to 32 bits */
+  x0= _mm_loadu_si128((const __m128i *)poly);
+  x2= _mm_clmulepi64_si128(_mm_and_si128(x1, mask), x0, 0x10);
+  x2= _mm_clmulepi64_si128(_mm_and_si128(x2, mask), x0, 0x00);
+  x1= _mm_xor_si128(x1, x2);
+  return (uint32)_mm_extract_epi32(x1, 1);
+}
+
+static uint32 crc32_pclmul(uint32 crc, const uchar *buf, size_t length)
+{
+  if (length >= 64)
+  {
+    size_t chunk= length & ~(size_t)15;
+
+    crc= ~crc32_fold_pclmul(~crc, buf, chunk);
+    buf+= chunk;
+    length-= chunk;
+  }
+  return crc32_zlib(crc, buf, length);
+}
+#endif
+
+#ifdef MA_HAVE_ARM_CRC32
+static my_bool ma_cpu_has_crc32(void)
+{
+#if defined(__APPLE__) || defined(__ARM_FEATURE_CRC32)
+  return 1;
+#elif defined(_WIN32)
+  return IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE) != 0;
+#elif defined(__linux__)
+  return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0;
+#else
+  return 0;
+#endif
+}
+
+MA_TARGET_CRC32
+static uint32 crc32_armv8(uint32 crc, const uchar *buf, size_t length)
+{
+  uint32 c= ~crc;
+
+  for (; length && ((uintptr_t)buf & 7); length--)
+    c= MA_CRC32B(c, *buf++);
+  for (; length >= 32; buf+= 32, length-= 32)
+  {
+    c= MA_CRC32D(c, *(const uint64 *)(buf + 0));
+    c= MA_CRC32D(c, *(const uint64 *)(buf + 8));
+    c= MA_CRC32D(c, *(const uint64 *)(buf + 16));
+    c= MA_CRC32D(c, *(const uint64 *)(buf + 24));
+  }
+  for (; length >= 8; buf+= 8, length-= 8)
+    c= MA_CRC32D(c, *(const uint64 *)buf);
+  for (; length; length--)
+    c= MA_CRC32B(c, *buf++);
+  return ~c;
+}
+#endif
+
+uint32 ma_simd_crc32(uint32 crc, const uchar *buf, size_t length)
+{
+#if defined(MA_HAVE_PCLMUL) || defined(MA_HAVE_ARM_CRC32)
+  if (crc32_hw < 0)
+    crc32_hw= ma_cpu_has_crc32();
+#endif
+  switch (ma_simd_level()) {
+#ifdef MA_HAVE_PCLMUL
+  case MA_SIMD_SSE2:
+  case MA_SIMD_AVX2:
+    if (crc32_hw)
+      return crc32_pclmul(crc, buf, length);
+    break;
+#endif
+#ifdef MA_HAVE_ARM_CRC32
+  case MA_SIMD_NEON:
+    if (crc32_hw)
+      return crc32_armv8(crc, buf, length);
+    break;
+#endif
+  default:
+    break;
+  }
+  return crc32_zlib(crc, buf, length);
+}
+/* }}} */
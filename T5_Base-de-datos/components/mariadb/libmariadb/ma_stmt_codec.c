@@ -50,6 +50,7 @@
 #include "mysql.h"
 #include <math.h> /* ceil() */
 #include <limits.h>
+#include <float.h>
 
 #ifdef WIN32
 #include <malloc.h>
@@ -135,18 +136,57 @@ void ps_fetch_from_1_to_8_bytes(MYSQL_BIND *r_param, const MYSQL_FIELD * const f
 }
 /* }}} */
 
+/*
+  SWAR (SIMD within a register) helpers for the integer parser: a little
+  endian 64-bit load holds 8 ASCII characters, which can be validated and
+  converted with a few multiplications instead of 8 loop iterations.
+*/
+#define MA_SWAR_DIGITS 8
+
+static inline my_bool ma_swar_is_8digits(ulonglong val)
+{
+  return (((val & 0xF0F0F0F0F0F0F0F0ULL) |
+          (((val + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+          0x3333333333333333ULL);
+}
+
+static inline uint32 ma_swar_parse_8digits(ulonglong val)
+{
+  const ulonglong mask= 0x000000FF000000FFULL;
+  const ulonglong mul1= 100 + (1000000ULL << 32);
+  const ulonglong mul2= 1 + (10000ULL << 32);
+
+  val-= 0x3030303030303030ULL;
+  val= (val * 10) + (val >> 8);
+  return (uint32)((((val & mask) * mul1) + (((val >> 16) & mask) * mul2)) >> 32);
+}
+
 static unsigned long long my_strtoull(const char *str, size_t len, const char **end, int *err)
 {
   unsigned long long val = 0;
   const char *p = str;
   const char *end_str = p + len;
 
+  /*
+    Fast path: a number with up to 19 digits can't overflow, so we
+    convert 8 digits at a time as long as the result stays below that.
+  */
+  while (end_str - p >= MA_SWAR_DIGITS && p - str <= 19 - MA_SWAR_DIGITS)
+  {
+    ulonglong chunk= uint8korr(p);
+    if (!ma_swar_is_8digits(chunk))
+      break;
+    val= val * 100000000 + ma_swar_parse_8digits(chunk);
+    p+= MA_SWAR_DIGITS;
+  }
+
   for (; p < end_str; p++)
   {
     if (*p < '0' || *p > '9')
       break;
 
-    if (val > ULONGLONG_MAX /10 || val*10 > ULONGLONG_MAX - (*p - '0'))
+    if (p - str >= 19 &&
+        (val > ULONGLONG_MAX /10 || val*10 > ULONGLONG_MAX - (*p - '0')))
     {
       *err = ERANGE;
       break;
@@ -254,14 +294,100 @@ static unsigned long long my_atoull(const char *str, const char *end_str, int *e
   return ret;
 }
 
+/*
+  Clinger's fast path: if the decimal significand fits into 53 bits and
+  the decimal exponent is small enough that 10^exp is exactly representable,
+  a single IEEE multiplication or division returns the correctly rounded
+  result. Returns 1 if the number can't be converted this way.
+*/
+static const double ma_exact_pow10[]=
+{
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static my_bool ma_fast_atod(const char *p, const char *end, double *val)
+{
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD != 0
+  /* excess precision (x87) would round twice */
+  return 1;
+#else
+  ulonglong mantissa= 0;
+  int digits= 0, exp10= 0;
+  my_bool neg= 0;
+  const char *start;
+
+  if (p < end && (*p == '-' || *p == '+'))
+    neg= (*p++ == '-');
+
+  start= p;
+  while (p < end && *p >= '0' && *p <= '9')
+  {
+    if (mantissa || *p != '0')
+      digits++;
+    mantissa= mantissa * 10 + (*p++ - '0');
+    if (digits > 19)
+      return 1;
+  }
+  if (p < end && *p == '.')
+  {
+    const char *frac= ++p;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+      if (mantissa || *p != '0')
+        digits++;
+      mantissa= mantissa * 10 + (*p++ - '0');
+      if (digits > 19)
+        return 1;
+    }
+    exp10= -(int)(p - frac);
+    if (p - frac == 0 && frac - 1 == start)
+      return 1;
+  }
+  if (p == start)
+    return 1;
+  if (p < end && (*p == 'e' || *p == 'E'))
+  {
+    int exp_neg= 0, e= 0;
+    const char *exp_start;
+
+    p++;
+    if (p < end && (*p == '-' || *p == '+'))
+      exp_neg= (*p++ == '-');
+    exp_start= p;
+    while (p < end && *p >= '0' && *p <= '9' && e < 1000)
+      e= e * 10 + (*p++ - '0');
+    if (p == exp_start)
+      return 1;
+    exp10+= exp_neg ? -e : e;
+  }
+  /* trailing garbage, whitespace etc. is left to strtod */
+  if (p != end || mantissa > (1ULL << 53) ||
+      exp10 < -22 || exp10 > 22)
+    return 1;
+
+  *val= (double)mantissa;
+  if (exp10 < 0)
+    *val/= ma_exact_pow10[-exp10];
+  else
+    *val*= ma_exact_pow10[exp10];
+  if (neg)
+    *val= -*val;
+  return 0;
+#endif
+}
+
 double my_atod(const char *number, const char *end, int *error)
 {
   double val= 0.0;
   char buffer[MAX_DBL_STR + 1];
   int len= (int)(end - number);
 
-  *error= errno= 0;
+  *error= 0;
+  if (len <= MAX_DBL_STR && !ma_fast_atod(number, end, &val))
+    return val;
 
+  errno= 0;
   if (len > MAX_DBL_STR)
   {
     *error= 1;
@@ -1055,7 +1181,7 @@ void ps_fetch_float(MYSQL_BIND *r_param, const MYSQL_FIELD * field, unsigned cha
 }
 /* }}} */
 
-static void convert_to_datetime(MYSQL_TIME *t, unsigned char **row, uint len, enum enum_field_types type)
+void convert_to_datetime(MYSQL_TIME *t, unsigned char **row, uint len, enum enum_field_types type)
 {
   memset(t, 0, sizeof(MYSQL_TIME));
 
@@ -168,6 +168,11 @@ int ma_pvio_tls_get_protocol_version_id(MARIADB_TLS *ctls)
   return ma_tls_get_protocol_version(ctls);
 }
 
+my_bool ma_pvio_tls_session_reused(MARIADB_TLS *ctls)
+{
+  return ma_tls_session_reused(ctls);
+}
+
 const char *ma_pvio_tls_get_protocol_version(MARIADB_TLS *ctls)
 {
   int version;
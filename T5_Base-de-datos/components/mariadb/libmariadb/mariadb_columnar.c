@@ -0,0 +1,524 @@
+/************************************************************************************
+   Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not see <http://www.gnu.org/licenses>
+   or write to the Free Software Foundation, Inc.,
+   51 Franklin St., Fifth Floor, Boston, MA 02110, USA
+*************************************************************************************/
+
+/*
+  Columnar result set fetch
+
+  Rows are fetched in two passes: first all rows of a batch are split into
+  cells (pointer and length of each value), then every column is converted
+  in one loop which is selected once per column, so there is no per value
+  dispatch through mysql_ps_fetch_functions.
+*/
+
+#include <ma_global.h>
+#include <ma_sys.h>
+#include <ma_string.h>
+#include <mysql.h>
+#include <errmsg.h>
+#include <mariadb_columnar.h>
+#include <limits.h>
+
+extern int str_to_TIME(const char *str, size_t length, MYSQL_TIME *tm);
+extern double my_atod(const char *number, const char *end, int *error);
+extern void convert_to_datetime(MYSQL_TIME *t, unsigned char **row, uint len,
+                                enum enum_field_types type);
+
+#define MA_COLUMN_INITIAL_ROWS 64
+
+typedef struct st_ma_column_cells {
+  unsigned char **cells;        /* row major: cells[row * columns + column] */
+  unsigned long *lengths;
+  unsigned long long rows;
+  unsigned long long max_rows;  /* allocated rows */
+  unsigned int columns;
+  MA_MEM_ROOT copies;           /* row copies for unbuffered results */
+} MA_COLUMN_CELLS;
+
+static void ma_column_cells_init(MA_COLUMN_CELLS *c, unsigned int columns)
+{
+  memset(c, 0, sizeof(MA_COLUMN_CELLS));
+  c->columns= columns;
+  ma_init_alloc_root(&c->copies, 8192, 0);
+}
+
+static void ma_column_cells_free(MA_COLUMN_CELLS *c)
+{
+  free(c->cells);
+  free(c->lengths);
+  ma_free_root(&c->copies, MYF(0));
+}
+
+/* returns the cell and length slots of a new row, or 1 if out of memory */
+static my_bool ma_column_cells_add(MA_COLUMN_CELLS *c,
+                                   unsigned char ***cell,
+                                   unsigned long **length)
+{
+  if (c->rows == c->max_rows)
+  {
+    unsigned long long new_rows= c->max_rows ? c->max_rows * 2 : MA_COLUMN_INITIAL_ROWS;
+    unsigned char **cells;
+    unsigned long *lengths;
+
+    if (!(cells= (unsigned char **)realloc(c->cells,
+                   (size_t)new_rows * c->columns * sizeof(unsigned char *))))
+      return 1;
+    c->cells= cells;
+    if (!(lengths= (unsigned long *)realloc(c->lengths,
+                     (size_t)new_rows * c->columns * sizeof(unsigned long))))
+      return 1;
+    c->lengths= lengths;
+    c->max_rows= new_rows;
+  }
+  *cell= c->cells + c->rows * c->columns;
+  *length= c->lengths + c->rows * c->columns;
+  c->rows++;
+  return 0;
+}
+
+static enum enum_mariadb_column_format ma_column_format(const MYSQL_FIELD *field,
+                                                        unsigned int *value_size)
+{
+  switch (field->type) {
+  case MYSQL_TYPE_NULL:
+    *value_size= 0;
+    return MARIADB_COLUMN_NULL;
+  case MYSQL_TYPE_TINY:
+    *value_size= 1;
+    return MARIADB_COLUMN_INT8;
+  case MYSQL_TYPE_SHORT:
+  case MYSQL_TYPE_YEAR:
+    *value_size= 2;
+    return MARIADB_COLUMN_INT16;
+  case MYSQL_TYPE_INT24:
+  case MYSQL_TYPE_LONG:
+    *value_size= 4;
+    return MARIADB_COLUMN_INT32;
+  case MYSQL_TYPE_LONGLONG:
+    *value_size= 8;
+    return MARIADB_COLUMN_INT64;
+  case MYSQL_TYPE_FLOAT:
+    *value_size= sizeof(float);
+    return MARIADB_COLUMN_FLOAT;
+  case MYSQL_TYPE_DOUBLE:
+    *value_size= sizeof(double);
+    return MARIADB_COLUMN_DOUBLE;
+  case MYSQL_TYPE_DATE:
+  case MYSQL_TYPE_TIME:
+  case MYSQL_TYPE_DATETIME:
+  case MYSQL_TYPE_TIMESTAMP:
+    *value_size= sizeof(MYSQL_TIME);
+    return MARIADB_COLUMN_TIME;
+  default:
+    *value_size= 0;
+    return MARIADB_COLUMN_BINARY;
+  }
+}
+
+/*
+  Text protocol integers are always well formed (optional sign followed by
+  digits), so we don't need the overflow checks of my_atoll here.
+*/
+static inline longlong ma_column_atoll(const unsigned char *p, unsigned long len)
+{
+  const unsigned char *end= p + len;
+  ulonglong val= 0;
+  my_bool neg= 0;
+
+  if (p < end && *p == '-')
+  {
+    neg= 1;
+    p++;
+  }
+  for (; p < end && *p >= '0' && *p <= '9'; p++)
+    val= val * 10 + (*p - '0');
+  return neg ? -(longlong)val : (longlong)val;
+}
+
+/* loop over all non NULL cells of column nr */
+#define MA_COLUMN_LOOP(c, nr, body)\
+  do {\
+    unsigned long long r;\
+    unsigned char **cell= (c)->cells + (nr);\
+    unsigned long *len= (c)->lengths + (nr);\
+    for (r= 0; r < (c)->rows; r++, cell+= (c)->columns, len+= (c)->columns)\
+    {\
+      if (!*cell)\
+        continue;\
+      body;\
+    }\
+  } while(0)
+
+static void ma_column_convert_text(MARIADB_COLUMN *col, unsigned int nr,
+                                   MA_COLUMN_CELLS *c)
+{
+  int error;
+
+  switch (col->format) {
+  case MARIADB_COLUMN_INT8:
+    MA_COLUMN_LOOP(c, nr, ((int8 *)col->values)[r]= (int8)ma_column_atoll(*cell, *len));
+    break;
+  case MARIADB_COLUMN_INT16:
+    MA_COLUMN_LOOP(c, nr, ((int16 *)col->values)[r]= (int16)ma_column_atoll(*cell, *len));
+    break;
+  case MARIADB_COLUMN_INT32:
+    MA_COLUMN_LOOP(c, nr, ((int32 *)col->values)[r]= (int32)ma_column_atoll(*cell, *len));
+    break;
+  case MARIADB_COLUMN_INT64:
+    MA_COLUMN_LOOP(c, nr, ((longlong *)col->values)[r]= ma_column_atoll(*cell, *len));
+    break;
+  case MARIADB_COLUMN_FLOAT:
+    MA_COLUMN_LOOP(c, nr, ((float *)col->values)[r]=
+                   (float)my_atod((char *)*cell, (char *)*cell + *len, &error));
+    break;
+  case MARIADB_COLUMN_DOUBLE:
+    MA_COLUMN_LOOP(c, nr, ((double *)col->values)[r]=
+                   my_atod((char *)*cell, (char *)*cell + *len, &error));
+    break;
+  case MARIADB_COLUMN_TIME:
+    MA_COLUMN_LOOP(c, nr, str_to_TIME((char *)*cell, *len, &((MYSQL_TIME *)col->values)[r]));
+    break;
+  default:
+    break;
+  }
+}
+
+static void ma_column_convert_binary(MARIADB_COLUMN *col, unsigned int nr,
+                                     MA_COLUMN_CELLS *c)
+{
+  switch (col->format) {
+  case MARIADB_COLUMN_INT8:
+    MA_COLUMN_LOOP(c, nr, ((int8 *)col->values)[r]= (int8)**cell);
+    break;
+  case MARIADB_COLUMN_INT16:
+    MA_COLUMN_LOOP(c, nr, ((int16 *)col->values)[r]= (int16)sint2korr(*cell));
+    break;
+  case MARIADB_COLUMN_INT32:
+    MA_COLUMN_LOOP(c, nr, ((int32 *)col->values)[r]= (int32)sint4korr(*cell));
+    break;
+  case MARIADB_COLUMN_INT64:
+    MA_COLUMN_LOOP(c, nr, ((longlong *)col->values)[r]= (longlong)sint8korr(*cell));
+    break;
+  case MARIADB_COLUMN_FLOAT:
+    MA_COLUMN_LOOP(c, nr, float4get(((float *)col->values)[r], *cell));
+    break;
+  case MARIADB_COLUMN_DOUBLE:
+    MA_COLUMN_LOOP(c, nr, float8get(((double *)col->values)[r], *cell));
+    break;
+  case MARIADB_COLUMN_TIME:
+    MA_COLUMN_LOOP(c, nr, convert_to_datetime(&((MYSQL_TIME *)col->values)[r], cell,
+                                              (uint)*len, col->field->type));
+    break;
+  default:
+    break;
+  }
+}
+
+static my_bool ma_column_convert(MARIADB_COLUMN_BATCH *batch,
+                                 MARIADB_COLUMN *col,
+                                 unsigned int nr,
+                                 MA_COLUMN_CELLS *c,
+                                 my_bool binary)
+{
+  unsigned long long rows= c->rows;
+
+  {
+    unsigned long long r;
+    unsigned char **cell= c->cells + nr;
+
+    for (r= 0; r < rows; r++, cell+= c->columns)
+      if (!*cell)
+        col->null_count++;
+  }
+
+  if (col->null_count)
+  {
+    unsigned long long r;
+    unsigned char **cell= c->cells + nr;
+    size_t bitmap_len= (size_t)(rows + 7) / 8;
+
+    if (!(col->validity= (unsigned char *)ma_alloc_root(&batch->alloc, bitmap_len)))
+      return 1;
+    memset(col->validity, 0, bitmap_len);
+    for (r= 0; r < rows; r++, cell+= c->columns)
+      if (*cell)
+        col->validity[r >> 3]|= (1 << (r & 7));
+  }
+
+  switch (col->format) {
+  case MARIADB_COLUMN_NULL:
+    break;
+  case MARIADB_COLUMN_BINARY:
+  {
+    ulonglong total= 0;
+    unsigned int offset= 0;
+    unsigned char *data;
+
+    MA_COLUMN_LOOP(c, nr, total+= *len);
+    if (total > UINT_MAX)
+      return 1;
+    if (!(col->offsets= (unsigned int *)ma_alloc_root(&batch->alloc,
+                          (size_t)(rows + 1) * sizeof(unsigned int))) ||
+        !(col->values= ma_alloc_root(&batch->alloc, (size_t)(total ? total : 1))))
+      return 1;
+    data= (unsigned char *)col->values;
+    col->offsets[0]= 0;
+    {
+      unsigned long long r;
+      unsigned char **cell= c->cells + nr;
+      unsigned long *len= c->lengths + nr;
+
+      for (r= 0; r < rows; r++, cell+= c->columns, len+= c->columns)
+      {
+        if (*cell && *len)
+        {
+          memcpy(data + offset, *cell, *len);
+          offset+= (unsigned int)*len;
+        }
+        col->offsets[r + 1]= offset;
+      }
+    }
+    break;
+  }
+  default:
+  {
+    size_t size= (size_t)rows * col->value_size;
+
+    if (!(col->values= ma_alloc_root(&batch->alloc, size ? size : 1)))
+      return 1;
+    memset(col->values, 0, size);
+    if (binary)
+      ma_column_convert_binary(col, nr, c);
+    else
+      ma_column_convert_text(col, nr, c);
+    break;
+  }
+  }
+  return 0;
+}
+
+static MARIADB_COLUMN_BATCH *ma_column_batch_create(MYSQL_FIELD *fields,
+                                                    unsigned int field_count,
+                                                    MA_COLUMN_CELLS *c,
+                                                    my_bool binary)
+{
+  MARIADB_COLUMN_BATCH *batch;
+  unsigned int i;
+
+  if (!(batch= (MARIADB_COLUMN_BATCH *)calloc(1, sizeof(MARIADB_COLUMN_BATCH))))
+    return NULL;
+  ma_init_alloc_root(&batch->alloc, 8192, 0);
+  batch->row_count= c->rows;
+  batch->column_count= field_count;
+
+  if (!(batch->columns= (MARIADB_COLUMN *)ma_alloc_root(&batch->alloc,
+                          field_count * sizeof(MARIADB_COLUMN))))
+    goto error;
+  memset(batch->columns, 0, field_count * sizeof(MARIADB_COLUMN));
+
+  for (i= 0; i < field_count; i++)
+  {
+    MARIADB_COLUMN *col= &batch->columns[i];
+
+    col->field= &fields[i];
+    col->format= ma_column_format(&fields[i], &col->value_size);
+    col->is_unsigned= test(fields[i].flags & UNSIGNED_FLAG);
+    if (ma_column_convert(batch, col, i, c, binary))
+      goto error;
+  }
+  return batch;
+error:
+  mariadb_free_columns(batch);
+  return NULL;
+}
+
+MARIADB_COLUMN_BATCH * STDCALL mariadb_fetch_columns(MYSQL_RES *result,
+                                                     unsigned long max_rows)
+{
+  MA_COLUMN_CELLS c;
+  MARIADB_COLUMN_BATCH *batch= NULL;
+  MYSQL *mysql;
+  MYSQL_ROW row;
+
+  if (!result)
+    return NULL;
+
+  /* handle will be reset by mysql_fetch_row at end of an unbuffered result */
+  mysql= result->handle;
+  ma_column_cells_init(&c, result->field_count);
+
+  while (!max_rows || c.rows < max_rows)
+  {
+    unsigned char **cell;
+    unsigned long *length, *lengths;
+    unsigned int i;
+
+    if (!(row= mysql_fetch_row(result)))
+      break;
+    lengths= mysql_fetch_lengths(result);
+    if (ma_column_cells_add(&c, &cell, &length))
+      goto oom;
+
+    for (i= 0; i < result->field_count; i++)
+    {
+      length[i]= lengths[i];
+      cell[i]= (unsigned char *)row[i];
+      /* unbuffered rows are overwritten by the next network read */
+      if (row[i] && !result->data)
+      {
+        if (!(cell[i]= (unsigned char *)ma_memdup_root(&c.copies, row[i], lengths[i] + 1)))
+          goto oom;
+      }
+    }
+  }
+
+  if (mysql && mysql->net.last_errno)
+    goto end;
+
+  if (!(batch= ma_column_batch_create(result->fields, result->field_count, &c, 0)))
+    goto oom;
+  goto end;
+
+oom:
+  if (mysql)
+    SET_CLIENT_ERROR(mysql, CR_OUT_OF_MEMORY, SQLSTATE_UNKNOWN, 0);
+end:
+  ma_column_cells_free(&c);
+  return batch;
+}
+
+/*
+  Splits a binary protocol row into cells. Returns the end of the row.
+*/
+static unsigned char *ma_column_split_binary_row(MYSQL_STMT *stmt,
+                                                 unsigned char *row,
+                                                 unsigned char **cell,
+                                                 unsigned long *length)
+{
+  unsigned char *null_ptr, bit_offset= 4;
+  unsigned int i;
+
+  row++; /* skip status byte */
+  null_ptr= row;
+  row+= (stmt->field_count + 9) / 8;
+
+  for (i= 0; i < stmt->field_count; i++)
+  {
+    if (*null_ptr & bit_offset)
+    {
+      cell[i]= NULL;
+      length[i]= 0;
+    }
+    else
+    {
+      int pack_len= mysql_ps_fetch_functions[stmt->fields[i].type].pack_len;
+
+      if (pack_len >= 0)
+        length[i]= (unsigned long)pack_len;
+      else
+        length[i]= net_field_length(&row);
+      cell[i]= row;
+      row+= length[i];
+    }
+    if (!((bit_offset <<= 1) & 255))
+    {
+      bit_offset= 1; /* To next byte */
+      null_ptr++;
+    }
+  }
+  return row;
+}
+
+MARIADB_COLUMN_BATCH * STDCALL mariadb_stmt_fetch_columns(MYSQL_STMT *stmt,
+                                                          unsigned long max_rows)
+{
+  MA_COLUMN_CELLS c;
+  MARIADB_COLUMN_BATCH *batch= NULL;
+  my_bool copy;
+
+  if (stmt->state <= MYSQL_STMT_EXECUTED || !stmt->field_count)
+  {
+    stmt_set_error(stmt, CR_COMMANDS_OUT_OF_SYNC, SQLSTATE_UNKNOWN, 0);
+    return NULL;
+  }
+  if (stmt->state == MYSQL_STMT_WAITING_USE_OR_STORE)
+    stmt->default_rset_handler(stmt);
+
+  /* unbuffered rows point into the net buffer, cursor rows will be freed
+     by the next COM_STMT_FETCH */
+  copy= stmt->cursor_exists || !stmt->result.data;
+
+  ma_column_cells_init(&c, stmt->field_count);
+
+  while (stmt->state != MYSQL_STMT_FETCH_DONE &&
+         (!max_rows || c.rows < max_rows))
+  {
+    unsigned char *row, *end;
+    unsigned char **cell;
+    unsigned long *length;
+    int rc;
+
+    if ((rc= stmt->mysql->methods->db_stmt_fetch(stmt, &row)))
+    {
+      stmt->state= MYSQL_STMT_FETCH_DONE;
+      stmt->mysql->status= MYSQL_STATUS_READY;
+      if (rc == MYSQL_NO_DATA)
+        break;
+      if (!stmt->last_errno)
+        stmt_set_error(stmt, stmt->mysql->net.last_errno, stmt->mysql->net.sqlstate,
+                       stmt->mysql->net.last_error);
+      goto end;
+    }
+    stmt->state= MYSQL_STMT_USER_FETCHING;
+
+    if (ma_column_cells_add(&c, &cell, &length))
+      goto oom;
+    end= ma_column_split_binary_row(stmt, row, cell, length);
+
+    if (copy)
+    {
+      unsigned char *buf;
+      unsigned int i;
+
+      if (!(buf= (unsigned char *)ma_memdup_root(&c.copies, (char *)row, end - row)))
+        goto oom;
+      for (i= 0; i < stmt->field_count; i++)
+        if (cell[i])
+          cell[i]= buf + (cell[i] - row);
+    }
+  }
+
+  if (!(batch= ma_column_batch_create(stmt->fields, stmt->field_count, &c, 1)))
+    goto oom;
+  CLEAR_CLIENT_STMT_ERROR(stmt);
+  goto end;
+
+oom:
+  stmt_set_error(stmt, CR_OUT_OF_MEMORY, SQLSTATE_UNKNOWN, 0);
+end:
+  ma_column_cells_free(&c);
+  return batch;
+}
+
+void STDCALL mariadb_free_columns(MARIADB_COLUMN_BATCH *batch)
+{
+  if (!batch)
+    return;
+  ma_free_root(&batch->alloc, MYF(0));
+  free(batch);
+}
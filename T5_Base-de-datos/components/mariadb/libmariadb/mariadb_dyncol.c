@@ -65,6 +65,7 @@
 #include <ma_global.h>
 #include <ma_sys.h>
 #include <ma_string.h>
+#include <ma_simd.h>
 //#include <ma_hashtbl.h>
 #include <mariadb_dyncol.h>
 #include <mysql.h>
@@ -158,7 +159,8 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
                                uint add_column_count,
                                void *column_keys,
                                DYNAMIC_COLUMN_VALUE *values,
-                               my_bool string_keys);
+                               my_bool string_keys,
+                               DYNAMIC_COLUMN_UPDATE *update);
 static int plan_sort_num(const void *a, const void *b);
 static int plan_sort_named(const void *a, const void *b);
 
@@ -2008,18 +2010,21 @@ static int header_compar_num(const void *a, const void *b)
   Find entry in the numeric format header by the column number
 
   @param hdr             descriptor of dynamic column record
+  @param first           first header entry to search
+  @param end             end of the header entries to search
   @param key             number to find
 
   @return pointer to the entry or NULL
 */
 
-static uchar *find_entry_num(DYN_HEADER *hdr, uint key)
+static uchar *find_entry_num(DYN_HEADER *hdr, uchar *first, uchar *end,
+                             uint key)
 {
   uchar header_entry[2+4];
   DBUG_ASSERT(hdr->format == dyncol_fmt_num);
   int2store(header_entry, key);
-  return hdr->entry= bsearch(header_entry, hdr->header,
-                             (size_t)hdr->column_count,
+  return hdr->entry= bsearch(header_entry, first,
+                             (size_t)(end - first) / hdr->entry_size,
                              hdr->entry_size, &header_compar_num);
 }
 
@@ -2061,17 +2066,22 @@ static my_bool read_name(DYN_HEADER *hdr, uchar *entry, LEX_STRING *name)
   Find entry in the names format header by the column number
 
   @param hdr             descriptor of dynamic column record
+  @param first           first header entry to search
+  @param end             end of the header entries to search
   @param key             name to find
 
   @return pointer to the entry or NULL
 */
-static uchar *find_entry_named(DYN_HEADER *hdr, LEX_STRING *key)
+static uchar *find_entry_named(DYN_HEADER *hdr, uchar *first, uchar *end,
+                               LEX_STRING *key)
 {
-  uchar *min= hdr->header;
-  uchar *max= hdr->header + (hdr->column_count - 1) * hdr->entry_size;
+  uchar *min= first;
+  uchar *max= end - hdr->entry_size;
   uchar *mid;
   DBUG_ASSERT(hdr->format == dyncol_fmt_str);
   DBUG_ASSERT(hdr->nmpool != NULL);
+  if (first == end)
+    return NULL;
   while (max >= min)
   {
     LEX_STRING name;
@@ -2117,7 +2127,13 @@ static char *backwritenum(char *chr, uint numkey)
 /**
   Find column and fill information about it
 
+  The search starts at the header entry first and continues with the
+  entries before it if the column was not found there, so a caller which
+  looks for columns in ascending order can pass the entry after the last
+  found column.
+
   @param hdr             descriptor of dynamic column record
+  @param first           header entry to start the search with
   @param numkey          Number of the column to fetch (if strkey is NULL)
   @param strkey          Name of the column to fetch (or NULL)
 
@@ -2126,11 +2142,14 @@ static char *backwritenum(char *chr, uint numkey)
 */
 
 static my_bool
-find_column(DYN_HEADER *hdr, uint numkey, LEX_STRING *strkey)
+find_column_from(DYN_HEADER *hdr, uchar *first,
+                 uint numkey, LEX_STRING *strkey)
 {
   LEX_STRING nmkey;
   char nmkeybuff[DYNCOL_NUM_CHAR]; /* to fit max 2 bytes number */
+  uchar *end= hdr->header + hdr->header_size;
   DBUG_ASSERT(hdr->header != NULL);
+  DBUG_ASSERT(first >= hdr->header && first <= end);
 
   if (hdr->header + hdr->header_size > hdr->data_end)
     return TRUE;
@@ -2154,9 +2173,16 @@ find_column(DYN_HEADER *hdr, uint numkey, LEX_STRING *strkey)
     strkey= &nmkey;
   }
   if (hdr->format == dyncol_fmt_num)
-    hdr->entry= find_entry_num(hdr, numkey);
+  {
+    if (!find_entry_num(hdr, first, end, numkey) && first > hdr->header)
+      find_entry_num(hdr, hdr->header, first, numkey);
+  }
   else
-    hdr->entry= find_entry_named(hdr, strkey);
+  {
+    if (!(hdr->entry= find_entry_named(hdr, first, end, strkey)) &&
+        first > hdr->header)
+      hdr->entry= find_entry_named(hdr, hdr->header, first, strkey);
+  }
 
   if (!hdr->entry)
   {
@@ -2177,6 +2203,12 @@ find_column(DYN_HEADER *hdr, uint numkey, LEX_STRING *strkey)
   return 0;
 }
 
+static inline my_bool
+find_column(DYN_HEADER *hdr, uint numkey, LEX_STRING *strkey)
+{
+  return find_column_from(hdr, hdr->header, numkey, strkey);
+}
+
 
 /**
   Read and check the header of the dynamic string
@@ -2262,7 +2294,7 @@ mariadb_dyncol_get_named(DYNAMIC_COLUMN *str, LEX_STRING *name,
 static enum enum_dyncol_func_result
 dynamic_column_get_value(DYN_HEADER *hdr, DYNAMIC_COLUMN_VALUE *store_it_here)
 {
-  static enum enum_dyncol_func_result rc;
+  enum enum_dyncol_func_result rc;
   switch ((store_it_here->type= hdr->type)) {
   case DYN_COL_INT:
     rc= dynamic_column_sint_read(store_it_here, hdr->data, hdr->length);
@@ -2348,6 +2380,405 @@ err:
 }
 
 
+/**
+  Get values of several columns by numbers or names
+
+  The header is read once and the search for every key starts after the
+  column found for the previous one.
+
+  @param str             The packed string to extract the columns
+  @param count           Number of columns to fetch
+  @param num_keys        Numbers of the columns (if str_keys is NULL)
+  @param str_keys        Names of the columns (or NULL)
+  @param values          Where to store the extracted values
+
+  @return ER_DYNCOL_* return code
+*/
+
+static enum enum_dyncol_func_result
+dynamic_column_get_many_internal(DYNAMIC_COLUMN *str, uint count,
+                                 uint *num_keys, LEX_STRING *str_keys,
+                                 DYNAMIC_COLUMN_VALUE *values)
+{
+  DYN_HEADER header;
+  uchar *first;
+  uint i= 0;
+  enum enum_dyncol_func_result rc, res= ER_DYNCOL_OK;
+  memset(&header, 0, sizeof(header));
+
+  if (str->length == 0)
+    goto null;
+
+  if ((rc= init_read_hdr(&header, str)) < 0)
+    goto err;
+
+  if (header.column_count == 0)
+    goto null;
+
+  for (first= header.header; i < count; i++)
+  {
+    if (find_column_from(&header, first,
+                         str_keys ? 0 : num_keys[i],
+                         str_keys ? str_keys + i : NULL))
+    {
+      rc= ER_DYNCOL_FORMAT;
+      goto err;
+    }
+    if ((rc= dynamic_column_get_value(&header, values + i)) < 0)
+      goto err;
+    if (rc != ER_DYNCOL_OK)
+      res= rc;
+    if (header.entry)
+      first= header.entry + header.entry_size;
+  }
+  return res;
+
+null:
+  rc= ER_DYNCOL_OK;
+err:
+  for (; i < count; i++)
+    values[i].type= DYN_COL_NULL;
+  return rc;
+}
+
+
+/**
+  Get values of several columns by numbers
+
+  @param str             The packed string to extract the columns
+  @param count           Number of columns to fetch
+  @param column_keys     Numbers of the columns
+  @param values          Where to store the extracted values
+
+  @return ER_DYNCOL_* return code
+*/
+
+enum enum_dyncol_func_result
+mariadb_dyncol_get_many_num(DYNAMIC_COLUMN *str, uint count,
+                            uint *column_keys, DYNAMIC_COLUMN_VALUE *values)
+{
+  return dynamic_column_get_many_internal(str, count, column_keys, NULL,
+                                          values);
+}
+
+
+/**
+  Get values of several columns by names
+
+  @param str             The packed string to extract the columns
+  @param count           Number of columns to fetch
+  @param column_keys     Names of the columns
+  @param values          Where to store the extracted values
+
+  @return ER_DYNCOL_* return code
+*/
+
+enum enum_dyncol_func_result
+mariadb_dyncol_get_many_named(DYNAMIC_COLUMN *str, uint count,
+                              LEX_STRING *column_keys,
+                              DYNAMIC_COLUMN_VALUE *values)
+{
+  DBUG_ASSERT(count == 0 || column_keys != NULL);
+  return dynamic_column_get_many_internal(str, count, NULL, column_keys,
+                                          values);
+}
+
+
+/*
+  Column of a parsed record (DYNAMIC_COLUMN_INDEX)
+*/
+
+struct st_dynamic_column_index_entry
+{
+  LEX_STRING name;                /* name (records with names) */
+  uchar *data;
+  size_t length;
+  uint num;                       /* number (records with numbers) */
+  uint hash;
+  DYNAMIC_COLUMN_TYPE type;
+};
+
+typedef struct st_dynamic_column_index_entry DYN_INDEX_ENTRY;
+
+/*
+  Column numbers up to 4 * column_count + DYNCOL_INDEX_DIRECT are looked
+  up in a table indexed by the number, larger ones are hashed
+*/
+#define DYNCOL_INDEX_DIRECT 64
+
+static inline uint dyncol_hash_num(uint num)
+{
+  uint hash= num * 2654435761U;
+  return hash ^ (hash >> 16);
+}
+
+static uint dyncol_hash_named(const LEX_STRING *name)
+{
+  const uchar *pos= (const uchar *)name->str;
+  const uchar *end= pos + name->length;
+  uint hash= 2166136261U;
+  for (; pos < end; pos++)
+    hash= (hash ^ *pos) * 16777619U;
+  return hash;
+}
+
+
+/**
+  Parse the header of a dynamic columns record into an index
+
+  @param index           index to fill, initialized with
+                         mariadb_dyncol_index_init() or used before
+  @param str             The packed string
+
+  @return ER_DYNCOL_* return code
+*/
+
+enum enum_dyncol_func_result
+mariadb_dyncol_index_parse(DYNAMIC_COLUMN_INDEX *index, DYNAMIC_COLUMN *str)
+{
+  DYN_HEADER header;
+  DYN_INDEX_ENTRY *col;
+  uint i, max_num= 0, slot_count, mask;
+  enum enum_dyncol_func_result rc;
+
+  index->column_count= 0;
+  index->slot_count= 0;
+  index->named= 0;
+  index->direct= 0;
+
+  if (str->length == 0)
+    return ER_DYNCOL_OK;                      /* no columns */
+
+  if ((rc= init_read_hdr(&header, str)) < 0)
+    return rc;
+
+  index->named= (header.format == dyncol_fmt_str);
+  if (header.column_count == 0)
+    return ER_DYNCOL_OK;
+
+  if (header.header + header.header_size > header.data_end)
+    return ER_DYNCOL_FORMAT;
+
+  if (header.column_count > index->columns_alloced)
+  {
+    free(index->columns);
+    if (!(index->columns= (DYN_INDEX_ENTRY *)
+          malloc(sizeof(DYN_INDEX_ENTRY) * header.column_count)))
+    {
+      index->columns_alloced= 0;
+      return ER_DYNCOL_RESOURCE;
+    }
+    index->columns_alloced= header.column_count;
+  }
+
+  for (i= 0, header.entry= header.header, col= index->columns;
+       i < header.column_count;
+       i++, header.entry+= header.entry_size, col++)
+  {
+    header.length=
+      hdr_interval_length(&header, header.entry + header.entry_size);
+    /*
+      Check that the found data is within the ranges. This can happen if
+      we get data with wrong offsets.
+    */
+    if (header.length == DYNCOL_OFFSET_ERROR ||
+        header.length > INT_MAX || header.offset > header.data_size)
+      return ER_DYNCOL_FORMAT;
+    col->type= header.type;
+    col->data= header.dtpool + header.offset;
+    col->length= header.length;
+    if (index->named)
+    {
+      if (read_name(&header, header.entry, &col->name))
+        return ER_DYNCOL_FORMAT;
+      col->hash= dyncol_hash_named(&col->name);
+    }
+    else
+    {
+      col->num= uint2korr(header.entry);
+      col->hash= dyncol_hash_num(col->num);
+      set_if_bigger(max_num, col->num);
+    }
+  }
+
+  if (!index->named &&
+      max_num < 4 * header.column_count + DYNCOL_INDEX_DIRECT)
+  {
+    index->direct= 1;
+    slot_count= max_num + 1;
+  }
+  else
+  {
+    slot_count= 8;
+    while (slot_count < 2 * header.column_count)
+      slot_count*= 2;
+  }
+  if (slot_count > index->slots_alloced)
+  {
+    free(index->slots);
+    if (!(index->slots= (uint *)malloc(sizeof(uint) * slot_count)))
+    {
+      index->slots_alloced= 0;
+      return ER_DYNCOL_RESOURCE;
+    }
+    index->slots_alloced= slot_count;
+  }
+  memset(index->slots, 0, sizeof(uint) * slot_count);
+
+  mask= slot_count - 1;
+  for (i= 0, col= index->columns; i < header.column_count; i++, col++)
+  {
+    uint slot;
+    if (index->direct)
+      slot= col->num;
+    else
+    {
+      slot= col->hash & mask;
+      while (index->slots[slot])
+        slot= (slot + 1) & mask;
+    }
+    if (!index->slots[slot])
+      index->slots[slot]= i + 1;
+  }
+
+  index->slot_count= slot_count;
+  index->column_count= header.column_count;
+  return ER_DYNCOL_OK;
+}
+
+
+/**
+  Find a column in the index
+
+  @param index           parsed record
+  @param numkey          Number of the column to find (if strkey is NULL)
+  @param strkey          Name of the column to find (or NULL)
+
+  @return the column or NULL
+*/
+
+static DYN_INDEX_ENTRY *
+index_find_column(DYNAMIC_COLUMN_INDEX *index, uint numkey,
+                  LEX_STRING *strkey)
+{
+  LEX_STRING nmkey;
+  char nmkeybuff[DYNCOL_NUM_CHAR]; /* to fit max 2 bytes number */
+  DYN_INDEX_ENTRY *col;
+  uint slot, mask, hash;
+
+  if (index->column_count == 0)
+    return NULL;
+
+  /* fix key */
+  if (!index->named && strkey != NULL)
+  {
+    char *end;
+    numkey= (uint) strtoul(strkey->str, &end, 10);
+    if (end != strkey->str + strkey->length)
+      return NULL;       /* we can't find non-numeric key among numeric ones */
+  }
+  else if (index->named && strkey == NULL)
+  {
+    nmkey.str= backwritenum(nmkeybuff + sizeof(nmkeybuff), numkey);
+    nmkey.length= (nmkeybuff + sizeof(nmkeybuff)) - nmkey.str;
+    strkey= &nmkey;
+  }
+
+  if (index->direct)
+  {
+    if (numkey >= index->slot_count || !index->slots[numkey])
+      return NULL;
+    return index->columns + index->slots[numkey] - 1;
+  }
+
+  hash= index->named ? dyncol_hash_named(strkey) : dyncol_hash_num(numkey);
+  mask= index->slot_count - 1;
+  for (slot= hash & mask; index->slots[slot]; slot= (slot + 1) & mask)
+  {
+    col= index->columns + index->slots[slot] - 1;
+    if (col->hash != hash)
+      continue;
+    if (index->named ?
+        (col->name.length == strkey->length &&
+         memcmp(col->name.str, strkey->str, strkey->length) == 0) :
+        col->num == numkey)
+      return col;
+  }
+  return NULL;
+}
+
+
+static enum enum_dyncol_func_result
+index_get_internal(DYNAMIC_COLUMN_INDEX *index,
+                   DYNAMIC_COLUMN_VALUE *store_it_here,
+                   uint num_key, LEX_STRING *str_key)
+{
+  DYN_HEADER header;
+  DYN_INDEX_ENTRY *col;
+
+  if (!(col= index_find_column(index, num_key, str_key)))
+  {
+    store_it_here->type= DYN_COL_NULL;
+    return ER_DYNCOL_OK;
+  }
+  header.type= col->type;
+  header.data= col->data;
+  header.length= col->length;
+  return dynamic_column_get_value(&header, store_it_here);
+}
+
+
+/**
+  Get dynamic column value by column number from a parsed record
+
+  @param index           parsed record
+  @param column_nr       Number of column to fetch
+  @param store_it_here   Where to store the extracted value
+
+  @return ER_DYNCOL_* return code
+*/
+
+enum enum_dyncol_func_result
+mariadb_dyncol_index_get_num(DYNAMIC_COLUMN_INDEX *index, uint column_nr,
+                             DYNAMIC_COLUMN_VALUE *store_it_here)
+{
+  return index_get_internal(index, store_it_here, column_nr, NULL);
+}
+
+
+/**
+  Get dynamic column value by name from a parsed record
+
+  @param index           parsed record
+  @param name            Name of column to fetch
+  @param store_it_here   Where to store the extracted value
+
+  @return ER_DYNCOL_* return code
+*/
+
+enum enum_dyncol_func_result
+mariadb_dyncol_index_get_named(DYNAMIC_COLUMN_INDEX *index, LEX_STRING *name,
+                               DYNAMIC_COLUMN_VALUE *store_it_here)
+{
+  DBUG_ASSERT(name != NULL);
+  return index_get_internal(index, store_it_here, 0, name);
+}
+
+
+/**
+  Release memory of a parsed record
+
+  @param index           parsed record
+*/
+
+void mariadb_dyncol_index_free(DYNAMIC_COLUMN_INDEX *index)
+{
+  free(index->columns);
+  free(index->slots);
+  memset(index, 0, sizeof(DYNAMIC_COLUMN_INDEX));
+}
+
+
 /**
   Check existence of the column in the packed string (by number)
 
@@ -2668,7 +3099,7 @@ find_place(DYN_HEADER *hdr, void *key, my_bool string_keys)
 
 typedef enum {PLAN_REPLACE, PLAN_ADD, PLAN_DELETE, PLAN_NOP} PLAN_ACT;
 
-struct st_plan {
+struct st_dynamic_column_plan {
   DYNAMIC_COLUMN_VALUE *val;
   void *key;
   uchar *place;
@@ -2678,7 +3109,7 @@ struct st_plan {
   uint mv_end;
   PLAN_ACT act;
 };
-typedef struct st_plan PLAN;
+typedef struct st_dynamic_column_plan PLAN;
 
 
 /**
@@ -2710,6 +3141,38 @@ static int plan_sort_named(const void *a, const void *b)
     (C)= TRUE;                      \
   }
 
+/**
+  Make room for a record of the given length
+
+  The buffer grows at least to twice its size, so that records which get
+  columns appended one by one are not reallocated for every update.
+
+  @param str             Dynamic column record
+  @param length          Needed length of the buffer
+
+  @retval FALSE OK
+  @retval TRUE  error
+*/
+
+static my_bool dynamic_column_reserve(DYNAMIC_COLUMN *str, size_t length)
+{
+  if (!str->alloc_increment)
+    str->alloc_increment= DYNCOL_SYZERESERVE;
+  if (length > str->max_length)
+  {
+    size_t new_length= str->max_length * 2;
+    char *new_str;
+    if (new_length < length)
+      new_length= length;
+    if (!(new_str= (char *)realloc(str->str, new_length)))
+      return TRUE;
+    str->str= new_str;
+    str->max_length= new_length;
+  }
+  return FALSE;
+}
+
+
 /**
   Update dynamic column by copying in a new record (string).
 
@@ -2719,6 +3182,8 @@ static int plan_sort_named(const void *a, const void *b)
   @param hdr             descriptor of old dynamic column record
   @param new_hdr         descriptor of new dynamic column record
   @param convert         need conversion from numeric to names format
+  @param scratch         buffer to build the new record in, gets the old
+                         record afterwards (NULL to allocate a new one)
 
   @return ER_DYNCOL_* return code
 */
@@ -2727,18 +3192,25 @@ static enum enum_dyncol_func_result
 dynamic_column_update_copy(DYNAMIC_COLUMN *str, PLAN *plan,
                            uint add_column_count,
                            DYN_HEADER *hdr, DYN_HEADER *new_hdr,
-                           my_bool convert)
+                           my_bool convert, DYNAMIC_COLUMN *scratch)
 {
   DYNAMIC_COLUMN tmp;
   struct st_service_funcs *fmt= fmt_data + hdr->format,
                           *new_fmt= fmt_data + new_hdr->format;
   uint i, j, k;
   size_t all_headers_size;
+  size_t size= (new_fmt->fixed_hdr + new_hdr->header_size +
+                new_hdr->nmpool_size + new_hdr->data_size +
+                DYNCOL_SYZERESERVE);
 
-  if (dynamic_column_init_named(&tmp,
-                              (new_fmt->fixed_hdr + new_hdr->header_size +
-                               new_hdr->nmpool_size +
-                               new_hdr->data_size + DYNCOL_SYZERESERVE)))
+  if (scratch)
+  {
+    if (dynamic_column_reserve(scratch, size))
+      return ER_DYNCOL_RESOURCE;
+    tmp= *scratch;
+    tmp.length= 0;
+  }
+  else if (dynamic_column_init_named(&tmp, size))
   {
     return ER_DYNCOL_RESOURCE;
   }
@@ -2869,14 +3341,193 @@ dynamic_column_update_copy(DYNAMIC_COLUMN *str, PLAN *plan,
       }
     }
   }
-  dynamic_column_column_free(str);
+  if (scratch)
+    *scratch= *str;
+  else
+    dynamic_column_column_free(str);
   *str= tmp;
   return ER_DYNCOL_OK;
 err:
-  dynamic_column_column_free(&tmp);
+  if (scratch)
+    *scratch= tmp;
+  else
+    dynamic_column_column_free(&tmp);
   return ER_DYNCOL_FORMAT;
 }
 
+
+/**
+  Encode a value of an in-place update behind the record.
+
+  Checks that the header entry of the value can be written and that the
+  value has the length the plan expects, so that nothing is left to fail
+  when the record is changed.
+
+  @param str             Dynamic column record, the value is appended
+  @param plan            Plan of the value
+  @param hdr             descriptor of the dynamic column record
+  @param offset          Offset of the value in the data pool
+
+  @return ER_DYNCOL_* return code
+*/
+
+static enum enum_dyncol_func_result
+dynamic_column_in_place_value(DYNAMIC_COLUMN *str, PLAN *plan,
+                              DYN_HEADER *hdr, size_t offset)
+{
+  uchar entry[COLUMN_NAMEPTR_SIZE + MAX_OFFSET_LENGTH_NM];
+  size_t start= str->length;
+  enum enum_dyncol_func_result rc;
+
+  if (hdr->format == dyncol_fmt_num ?
+      type_and_offset_store_num(entry, hdr->offset_size,
+                                plan->val->type, offset) :
+      type_and_offset_store_named(entry, hdr->offset_size,
+                                  plan->val->type, offset))
+    return ER_DYNCOL_FORMAT;
+  if ((rc= data_store(str, plan->val, hdr->format)) < 0)
+    return rc;
+  if (str->length - start != plan->length)
+    return ER_DYNCOL_FORMAT;
+  return ER_DYNCOL_OK;
+}
+
+
+/**
+  Update dynamic column without rebuilding the record.
+
+  Used when no column is deleted, every replaced value has the same
+  length as the old one and all added columns sort after the existing
+  ones, so that the offsets of the other columns do not change. Replaced
+  values are written over the old ones, added columns are appended to
+  the header, the name pool and the data, which are moved to make room.
+
+  All values are encoded behind the record before the record is changed,
+  so an error leaves the record as it was.
+
+  @param str             Dynamic column record to change
+  @param plan            Plan of changing the record
+  @param add_column_count number of records in the plan array.
+  @param hdr             descriptor of old dynamic column record
+  @param new_hdr         descriptor of new dynamic column record
+
+  @return ER_DYNCOL_* return code
+*/
+
+static enum enum_dyncol_func_result
+dynamic_column_update_in_place(DYNAMIC_COLUMN *str, PLAN *plan,
+                               uint add_column_count,
+                               DYN_HEADER *hdr, DYN_HEADER *new_hdr)
+{
+  struct st_service_funcs *fmt= fmt_data + hdr->format;
+  size_t old_length= str->length;
+  size_t header_offs= hdr->header - (uchar *)str->str;
+  size_t nmpool_offs= hdr->nmpool - (uchar *)str->str;
+  size_t dtpool_offs= hdr->dtpool - (uchar *)str->str;
+  size_t add_header= new_hdr->header_size - hdr->header_size;
+  size_t add_names= new_hdr->nmpool_size - hdr->nmpool_size;
+  size_t add_data= (size_t)plan[add_column_count].ddelta;
+  /* the record ends here once the header and the names are moved */
+  size_t new_length= old_length + add_header + add_names;
+  size_t replaced= 0, offs, value;
+  enum enum_dyncol_func_result rc;
+  DYNAMIC_COLUMN_TYPE tp;
+  uint i;
+
+  /* the buffer may move, remember the places as offsets */
+  for (i= 0; i < add_column_count; i++)
+  {
+    plan[i].mv_offset= plan[i].place - (uchar *)str->str;
+    if (plan[i].act == PLAN_REPLACE)
+      replaced+= plan[i].length;
+  }
+  if (dynamic_column_reserve(str, new_length + add_data + replaced +
+                             DYNCOL_SYZERESERVE))
+    return ER_DYNCOL_RESOURCE;
+
+  /*
+    Encode all values behind the new end of the record: first the added
+    ones, which are then already in place at the end of the data, then
+    the replaced ones.
+  */
+  str->length= new_length;
+  offs= hdr->data_size;
+  for (i= 0; i < add_column_count; i++)
+  {
+    if (plan[i].act != PLAN_ADD)
+      continue;
+    if ((rc= dynamic_column_in_place_value(str, plan + i, hdr, offs)) < 0)
+      goto err;
+    offs+= plan[i].length;
+  }
+  for (i= 0; i < add_column_count; i++)
+  {
+    if (plan[i].act != PLAN_REPLACE)
+      continue;
+    if ((*fmt->type_and_offset_read)(&tp, &offs,
+                                     (uchar *)str->str + plan[i].mv_offset +
+                                     fmt->fixed_hdr_entry,
+                                     hdr->offset_size) ||
+        offs + plan[i].length > hdr->data_size)
+    {
+      rc= ER_DYNCOL_FORMAT;
+      goto err;
+    }
+    if ((rc= dynamic_column_in_place_value(str, plan + i, hdr, offs)) < 0)
+      goto err;
+  }
+
+  /* nothing can fail from here on */
+  value= new_length + add_data;
+  for (i= 0; i < add_column_count; i++)
+  {
+    uchar *entry= (uchar *)str->str + plan[i].mv_offset;
+    if (plan[i].act != PLAN_REPLACE)
+      continue;
+    (*fmt->type_and_offset_read)(&tp, &offs, entry + fmt->fixed_hdr_entry,
+                                 hdr->offset_size);
+    memcpy(str->str + dtpool_offs + offs, str->str + value, plan[i].length);
+    value+= plan[i].length;
+    if (hdr->format == dyncol_fmt_num)
+      type_and_offset_store_num(entry, hdr->offset_size,
+                                plan[i].val->type, offs);
+    else
+      type_and_offset_store_named(entry, hdr->offset_size,
+                                  plan[i].val->type, offs);
+  }
+
+  if (!add_header)
+  {
+    str->length= old_length;
+    return ER_DYNCOL_OK;
+  }
+
+  /* make room for the new header entries and names */
+  memmove(str->str + dtpool_offs + add_header + add_names,
+          str->str + dtpool_offs, hdr->data_size);
+  memmove(str->str + nmpool_offs + add_header,
+          str->str + nmpool_offs, hdr->nmpool_size);
+  str->length= new_length + add_data;
+  (*fmt->set_fixed_hdr)(str, new_hdr);
+  DBUG_ASSERT(new_hdr->header == (uchar *)str->str + header_offs);
+  new_hdr->entry= new_hdr->header + hdr->column_count * new_hdr->entry_size;
+  new_hdr->name= new_hdr->nmpool + hdr->nmpool_size;
+
+  offs= hdr->data_size;
+  for (i= 0; i < add_column_count; i++)
+  {
+    if (plan[i].act != PLAN_ADD)
+      continue;
+    (*fmt->put_header_entry)(new_hdr, plan[i].key, plan[i].val, offs);
+    offs+= plan[i].length;
+  }
+  return ER_DYNCOL_OK;
+
+err:
+  str->length= old_length;
+  return rc;
+}
+
 static enum enum_dyncol_func_result
 dynamic_column_update_move_left(DYNAMIC_COLUMN *str, PLAN *plan,
                                 size_t offset_size,
@@ -3281,27 +3932,95 @@ dynamic_column_update_many(DYNAMIC_COLUMN *str,
                            DYNAMIC_COLUMN_VALUE *values)
 {
   return dynamic_column_update_many_fmt(str, add_column_count, column_numbers,
-                                        values, FALSE);
+                                        values, FALSE, NULL);
+}
+
+enum enum_dyncol_func_result
+mariadb_dyncol_update_many_num(DYNAMIC_COLUMN *str,
+                               uint add_column_count,
+                               uint *column_numbers,
+                               DYNAMIC_COLUMN_VALUE *values)
+{
+  return dynamic_column_update_many_fmt(str, add_column_count, column_numbers,
+                                        values, FALSE, NULL);
+}
+
+enum enum_dyncol_func_result
+mariadb_dyncol_update_many_named(DYNAMIC_COLUMN *str,
+                                 uint add_column_count,
+                                 LEX_STRING *column_names,
+                                 DYNAMIC_COLUMN_VALUE *values)
+{
+  return dynamic_column_update_many_fmt(str, add_column_count, column_names,
+                                        values, TRUE, NULL);
+}
+
+
+/**
+  Update several records with the same columns
+
+  @param update          Plan and buffers kept between the records
+  @param rows            Array of records
+  @param row_count       Number of records
+  @param column_count    Number of columns to change in every record
+  @param column_keys     Array of column numbers or names
+  @param values          column_count values for every record
+  @param string_keys     keys are names
+
+  @return ER_DYNCOL_* return code
+*/
+
+static enum enum_dyncol_func_result
+dynamic_column_update_rows(DYNAMIC_COLUMN_UPDATE *update,
+                           DYNAMIC_COLUMN *rows, uint row_count,
+                           uint column_count, void *column_keys,
+                           DYNAMIC_COLUMN_VALUE *values,
+                           my_bool string_keys)
+{
+  enum enum_dyncol_func_result rc= ER_DYNCOL_OK;
+  uint i;
+
+  /* the keys are sorted by the first record which has columns */
+  update->order_count= 0;
+  for (i= 0; i < row_count; i++)
+  {
+    if ((rc= dynamic_column_update_many_fmt(rows + i, column_count,
+                                            column_keys,
+                                            values + (size_t)i * column_count,
+                                            string_keys, update)) < 0)
+      break;
+  }
+  update->order_count= 0;
+  return rc;
 }
 
 enum enum_dyncol_func_result
-mariadb_dyncol_update_many_num(DYNAMIC_COLUMN *str,
-                               uint add_column_count,
-                               uint *column_numbers,
+mariadb_dyncol_update_rows_num(DYNAMIC_COLUMN_UPDATE *update,
+                               DYNAMIC_COLUMN *rows, uint row_count,
+                               uint column_count, uint *column_keys,
                                DYNAMIC_COLUMN_VALUE *values)
 {
-  return dynamic_column_update_many_fmt(str, add_column_count, column_numbers,
-                                        values, FALSE);
+  return dynamic_column_update_rows(update, rows, row_count, column_count,
+                                    column_keys, values, FALSE);
 }
 
 enum enum_dyncol_func_result
-mariadb_dyncol_update_many_named(DYNAMIC_COLUMN *str,
-                                 uint add_column_count,
-                                 LEX_STRING *column_names,
+mariadb_dyncol_update_rows_named(DYNAMIC_COLUMN_UPDATE *update,
+                                 DYNAMIC_COLUMN *rows, uint row_count,
+                                 uint column_count,
+                                 LEX_STRING *column_keys,
                                  DYNAMIC_COLUMN_VALUE *values)
 {
-  return dynamic_column_update_many_fmt(str, add_column_count, column_names,
-                                        values, TRUE);
+  return dynamic_column_update_rows(update, rows, row_count, column_count,
+                                    column_keys, values, TRUE);
+}
+
+void mariadb_dyncol_update_free(DYNAMIC_COLUMN_UPDATE *update)
+{
+  free(update->plan);
+  free(update->order);
+  free(update->scratch.str);
+  memset(update, 0, sizeof(DYNAMIC_COLUMN_UPDATE));
 }
 
 static uint numlen(uint val)
@@ -3323,7 +4042,8 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
                                uint add_column_count,
                                void *column_keys,
                                DYNAMIC_COLUMN_VALUE *values,
-                               my_bool string_keys)
+                               my_bool string_keys,
+                               DYNAMIC_COLUMN_UPDATE *update)
 {
   PLAN *plan, *alloc_plan= NULL, in_place_plan[IN_PLACE_PLAN];
   uchar *element;
@@ -3337,6 +4057,8 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
   int copy= FALSE;
   enum enum_dyncol_func_result rc;
   my_bool convert;
+  my_bool in_place;
+  my_bool sorted= FALSE;
 
   if (add_column_count == 0)
     return ER_DYNCOL_OK;
@@ -3350,7 +4072,26 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
     Get columns in column order. As the data in 'str' is already
     in column order this allows to replace all columns in one loop.
   */
-  if (IN_PLACE_PLAN > add_column_count)
+  if (update)
+  {
+    /* the plan is kept for the next record */
+    if (update->plan_alloced < add_column_count + 1)
+    {
+      uint alloc= MAX(add_column_count + 1, update->plan_alloced * 2);
+      PLAN *new_plan= (PLAN *)realloc(update->plan, sizeof(PLAN) * alloc);
+      uint *new_order;
+      if (!new_plan)
+        return ER_DYNCOL_RESOURCE;
+      update->plan= new_plan;
+      if (!(new_order= (uint *)realloc(update->order, sizeof(uint) * alloc)))
+        return ER_DYNCOL_RESOURCE;
+      update->order= new_order;
+      update->plan_alloced= alloc;
+    }
+    plan= update->plan;
+    sorted= (update->order_count == add_column_count);
+  }
+  else if (IN_PLACE_PLAN > add_column_count)
     plan= in_place_plan;
   else if (!(alloc_plan= plan=
              (PLAN *)malloc(sizeof(PLAN) * (add_column_count + 1))))
@@ -3361,14 +4102,16 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
        i < add_column_count;
        i++, element+= new_fmt->key_size_in_array)
   {
+    uint k= sorted ? update->order[i] : i;
+
     if ((*new_fmt->check_limit)(&element))
     {
       rc= ER_DYNCOL_DATA;
       goto end;
     }
 
-    plan[i].val= values + i;
-    plan[i].key= element;
+    plan[i].val= values + k;
+    plan[i].key= (uchar *) column_keys + k * new_fmt->key_size_in_array;
     if (values[i].type == DYN_COL_NULL)
       not_null--;
 
@@ -3393,10 +4136,21 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
   if (header.column_count == 0)
     goto create_new_string;
 
-  qsort(plan, (size_t)add_column_count, sizeof(PLAN), new_fmt->plan_sort);
+  if (!sorted)
+  {
+    qsort(plan, (size_t)add_column_count, sizeof(PLAN), new_fmt->plan_sort);
+    if (update)
+    {
+      /* the next records use the same keys */
+      for (i= 0; i < add_column_count; i++)
+        update->order[i]= (uint)(plan[i].val - values);
+      update->order_count= add_column_count;
+    }
+  }
 
   new_header.column_count= header.column_count;
   new_header.nmpool_size= header.nmpool_size;
+  in_place= (new_header.format == header.format);
   if ((convert= (new_header.format == dyncol_fmt_str &&
                  header.format == dyncol_fmt_num)))
   {
@@ -3476,6 +4230,7 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
         /* Inserting a NULL means delete the old data */
 
         plan[i].act= PLAN_DELETE;	        /* Remove old value */
+        in_place= FALSE;
         header_delta--;                         /* One row less in header */
         data_delta-= entry_data_size;           /* Less data to store */
         name_delta-= entry_name_size;
@@ -3494,6 +4249,8 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
           goto end;
         }
         data_delta+= plan[i].length - entry_data_size;
+        if (plan[i].length != entry_data_size)
+          in_place= FALSE;
         if (new_header.format == dyncol_fmt_str)
         {
           name_delta+= ((LEX_STRING *)(plan[i].key))->length - entry_name_size;
@@ -3525,6 +4282,10 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
         data_delta+= plan[i].length;
         if (new_header.format == dyncol_fmt_str)
           name_delta+= ((LEX_STRING *)plan[i].key)->length;
+        /* only columns after the last one can be added in place */
+        if (header.entry != header.header +
+                            header.column_count * header.entry_size)
+          in_place= FALSE;
       }
     }
     plan[i].place= header.entry;
@@ -3570,6 +4331,17 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
              new_fmt->fixed_hdr_entry,
              new_header.offset_size, new_header.column_count);
 
+  /*
+    Same length values and added columns at the end don't change the
+    offsets of the other columns, so the record is changed in place.
+  */
+  if (in_place && new_header.offset_size == header.offset_size)
+  {
+    rc= dynamic_column_update_in_place(str, plan, add_column_count,
+                                       &header, &new_header);
+    goto end;
+  }
+
   /*
     Need copy because:
     1, Header/data parts moved in different directions.
@@ -3582,7 +4354,8 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
        (header_delta_sign > 0 && data_delta_sign < 0))) /*3.*/
     rc= dynamic_column_update_copy(str, plan, add_column_count,
                                    &header, &new_header,
-                                   convert);
+                                   convert,
+                                   update ? &update->scratch : NULL);
   else
     if (header_delta_sign < 0)
       rc= dynamic_column_update_move_left(str, plan, header.offset_size,
@@ -3608,7 +4381,8 @@ dynamic_column_update_many_fmt(DYNAMIC_COLUMN *str,
                                          */
       rc= dynamic_column_update_copy(str, plan, add_column_count,
                                      &header, &new_header,
-                                     convert);
+                                     convert,
+                                     update ? &update->scratch : NULL);
 end:
   free(alloc_plan);
   return rc;
@@ -3825,7 +4599,8 @@ mariadb_dyncol_val_str(DYNAMIC_STRING *str, DYNAMIC_COLUMN_VALUE *val,
         return ER_DYNCOL_RESOURCE;
       break;
     case DYN_COL_DOUBLE:
-      len= snprintf(buff, sizeof(buff), "%g", val->x.double_value);
+      len= ma_gcvt(val->x.double_value, MY_GCVT_ARG_DOUBLE,
+                   (int)sizeof(buff) - 1, buff, NULL);
       if (ma_dynstr_realloc(str, len + (quote ? 2 : 0)))
         return ER_DYNCOL_RESOURCE;
       if (quote)
@@ -4225,6 +5000,424 @@ mariadb_dyncol_json(DYNAMIC_COLUMN *str, DYNAMIC_STRING *json)
   return mariadb_dyncol_json_internal(str, json, 1);
 }
 
+
+/*
+  Streaming JSON writer (mariadb_dyncol_json_write)
+*/
+
+/* escape character for the bytes which can't be written as they are */
+static const char json_escape[256]= {
+  'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+  'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+  0, 0, '"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0
+};
+
+static const char json_hex[]= "0123456789abcdef";
+
+static const char json_digit_pairs[]=
+  "00010203040506070809101112131415161718192021222324252627282930313233"
+  "34353637383940414243444546474849505152535455565758596061626364656667"
+  "6869707172737475767778798081828384858687888990919293949596979899";
+
+/* space for a quoted number or date, the same buffer size as in
+   mariadb_dyncol_val_str() plus quotes */
+#define JSON_VALUE_SPACE (40 + 2)
+
+static my_bool json_sink_grow(DYNAMIC_COLUMN_JSON_SINK *sink, size_t need)
+{
+  char *new_str;
+  size_t new_length;
+
+  if (sink->flush)
+  {
+    DBUG_ASSERT(need <= DYNCOL_JSON_SINK_MIN);
+    return (*sink->flush)(sink, need) ||
+           sink->max_length - sink->length < need;
+  }
+  new_length= MAX(sink->max_length * 2, sink->length + need);
+  set_if_bigger(new_length, 256);
+  if (!(new_str= (char *)realloc(sink->str, new_length)))
+    return 1;
+  sink->str= new_str;
+  sink->max_length= new_length;
+  return 0;
+}
+
+static inline my_bool json_reserve(DYNAMIC_COLUMN_JSON_SINK *sink,
+                                   size_t need)
+{
+  return sink->max_length - sink->length < need &&
+         json_sink_grow(sink, need);
+}
+
+static my_bool json_put(DYNAMIC_COLUMN_JSON_SINK *sink, const char *str,
+                        size_t length)
+{
+  while (length > sink->max_length - sink->length)
+  {
+    size_t part= sink->max_length - sink->length;
+    if (!sink->flush)
+    {
+      if (json_sink_grow(sink, length))
+        return 1;
+      break;
+    }
+    /* a flushing sink gets the string in pieces */
+    memcpy(sink->str + sink->length, str, part);
+    sink->length+= part;
+    str+= part;
+    length-= part;
+    if (json_sink_grow(sink, MIN(length, DYNCOL_JSON_SINK_MIN)))
+      return 1;
+  }
+  memcpy(sink->str + sink->length, str, length);
+  sink->length+= length;
+  return 0;
+}
+
+/* writes a quoted and escaped UTF-8 string */
+static my_bool json_put_string(DYNAMIC_COLUMN_JSON_SINK *sink,
+                               const char *str, size_t length)
+{
+  const uchar *pos= (const uchar *)str, *end= pos + length;
+
+  if (json_reserve(sink, 1))
+    return 1;
+  sink->str[sink->length++]= '"';
+  while (pos < end)
+  {
+    size_t span= ma_simd_escape_span(pos, end - pos, MA_ESCAPE_JSON, 0);
+    char *to;
+
+    /* the scalar level leaves the work to the caller */
+    while (pos + span < end && !json_escape[pos[span]])
+      span++;
+    if (span && json_put(sink, (const char *)pos, span))
+      return 1;
+    if ((pos+= span) == end)
+      break;
+    if (json_reserve(sink, 6))
+      return 1;
+    to= sink->str + sink->length;
+    to[0]= '\\';
+    if ((to[1]= json_escape[*pos]) == 'u')
+    {
+      to[2]= '0';
+      to[3]= '0';
+      to[4]= json_hex[*pos >> 4];
+      to[5]= json_hex[*pos & 15];
+      sink->length+= 6;
+    }
+    else
+      sink->length+= 2;
+    pos++;
+  }
+  if (json_reserve(sink, 1))
+    return 1;
+  sink->str[sink->length++]= '"';
+  return 0;
+}
+
+/* writes the decimal digits of a number to to, returns the end */
+static char *json_uint(char *to, ulonglong val)
+{
+  char buff[20], *pos= buff + sizeof(buff);
+  size_t length;
+
+  while (val >= 100)
+  {
+    uint rem= (uint)(val % 100);
+    val/= 100;
+    pos-= 2;
+    memcpy(pos, json_digit_pairs + 2 * rem, 2);
+  }
+  if (val >= 10)
+  {
+    pos-= 2;
+    memcpy(pos, json_digit_pairs + 2 * val, 2);
+  }
+  else
+    *--pos= (char)('0' + val);
+  length= buff + sizeof(buff) - pos;
+  memcpy(to, pos, length);
+  return to + length;
+}
+
+static my_bool json_utf8_charset(MARIADB_CHARSET_INFO *cs)
+{
+  return cs == ma_charset_utf8_general_ci ||
+         !strcmp(cs->encoding, "UTF-8") || !strcmp(cs->encoding, "ASCII");
+}
+
+/* writes a string value, strings in other character sets are converted */
+static enum enum_dyncol_func_result
+json_put_value_string(DYNAMIC_COLUMN_JSON_SINK *sink,
+                      DYNAMIC_COLUMN_VALUE *val)
+{
+  char buff[512], *alloc= NULL, *to= buff;
+  size_t length= val->x.string.value.length, to_length;
+  int error;
+  my_bool rc;
+
+  if (json_utf8_charset(val->x.string.charset))
+    return json_put_string(sink, val->x.string.value.str, length) ?
+           ER_DYNCOL_RESOURCE : ER_DYNCOL_OK;
+
+  to_length= length * ma_charset_utf8_general_ci->char_maxlen;
+  if (to_length > sizeof(buff) && !(to= alloc= (char *)malloc(to_length)))
+    return ER_DYNCOL_RESOURCE;
+  length= mariadb_convert_string(val->x.string.value.str, &length,
+                                 val->x.string.charset, to, &to_length,
+                                 ma_charset_utf8_general_ci, &error);
+  if (length == (size_t)-1)
+  {
+    free(alloc);
+    return ER_DYNCOL_DATA;
+  }
+  rc= json_put_string(sink, to, length);
+  free(alloc);
+  return rc ? ER_DYNCOL_RESOURCE : ER_DYNCOL_OK;
+}
+
+static enum enum_dyncol_func_result
+json_put_value(DYNAMIC_COLUMN_JSON_SINK *sink, DYNAMIC_COLUMN_VALUE *val)
+{
+  char *to;
+
+  if (val->type == DYN_COL_STRING)
+    return json_put_value_string(sink, val);
+
+  if (json_reserve(sink, JSON_VALUE_SPACE))
+    return ER_DYNCOL_RESOURCE;
+  to= sink->str + sink->length;
+  switch (val->type) {
+  case DYN_COL_INT:
+    if (val->x.long_value < 0)
+    {
+      *to++= '-';
+      to= json_uint(to, 0ULL - (ulonglong)val->x.long_value);
+    }
+    else
+      to= json_uint(to, (ulonglong)val->x.long_value);
+    break;
+  case DYN_COL_UINT:
+    to= json_uint(to, val->x.ulong_value);
+    break;
+  case DYN_COL_DOUBLE:
+    /* quoted like mariadb_dyncol_json() does */
+    *to++= '"';
+    to+= ma_gcvt(val->x.double_value, MY_GCVT_ARG_DOUBLE, 39, to, NULL);
+    *to++= '"';
+    break;
+  case DYN_COL_DATETIME:
+  case DYN_COL_DATE:
+  case DYN_COL_TIME:
+    *to++= '"';
+#ifndef LIBMARIADB
+    to+= my_TIME_to_str(&val->x.time_value, to, AUTO_SEC_PART_DIGITS);
+#else
+    to+= mariadb_time_to_string(&val->x.time_value, to, 39,
+                                AUTO_SEC_PART_DIGITS);
+#endif
+    *to++= '"';
+    break;
+#ifndef LIBMARIADB
+  case DYN_COL_DECIMAL:
+    {
+      int len= 40;
+      decimal2string(&val->x.decimal.value, to, &len,
+                     0, val->x.decimal.value.frac, '0');
+      to+= len;
+      break;
+    }
+#endif
+  case DYN_COL_NULL:
+    memcpy(to, "null", 4);
+    to+= 4;
+    break;
+  default:
+    return ER_DYNCOL_FORMAT;
+  }
+  sink->length= to - sink->str;
+  return ER_DYNCOL_OK;
+}
+
+static enum enum_dyncol_func_result
+mariadb_dyncol_json_write_internal(DYNAMIC_COLUMN *str,
+                                   DYNAMIC_COLUMN_JSON_SINK *sink, uint lvl)
+{
+  DYN_HEADER header;
+  uint i;
+  enum enum_dyncol_func_result rc;
+
+  if (lvl >= JSON_STACK_PROTECTION)
+    return ER_DYNCOL_RESOURCE;
+
+  if (str->length == 0)
+    return ER_DYNCOL_OK;                        /* no columns */
+
+  if ((rc= init_read_hdr(&header, str)) < 0)
+    return rc;
+
+  if (header.entry_size * header.column_count + FIXED_HEADER_SIZE >
+      str->length)
+    return ER_DYNCOL_FORMAT;
+
+  if (json_reserve(sink, 1))
+    return ER_DYNCOL_RESOURCE;
+  sink->str[sink->length++]= '{';
+  for (i= 0, header.entry= header.header;
+       i < header.column_count;
+       i++, header.entry+= header.entry_size)
+  {
+    DYNAMIC_COLUMN_VALUE val;
+    header.length=
+      hdr_interval_length(&header, header.entry + header.entry_size);
+    header.data= header.dtpool + header.offset;
+    /*
+      Check that the found data is within the ranges. This can happen if
+      we get data with wrong offsets.
+    */
+    if (header.length == DYNCOL_OFFSET_ERROR ||
+        header.length > INT_MAX || header.offset > header.data_size)
+      return ER_DYNCOL_FORMAT;
+    if ((rc= dynamic_column_get_value(&header, &val)) < 0)
+      return rc;
+
+    if (header.format == dyncol_fmt_num)
+    {
+      char *to;
+      if (json_reserve(sink, DYNCOL_NUM_CHAR + 4))
+        return ER_DYNCOL_RESOURCE;
+      to= sink->str + sink->length;
+      if (i != 0)
+        *to++= ',';
+      *to++= '"';
+      to= json_uint(to, uint2korr(header.entry));
+      *to++= '"';
+      *to++= ':';
+      sink->length= to - sink->str;
+    }
+    else
+    {
+      LEX_STRING name;
+      if (read_name(&header, header.entry, &name))
+        return ER_DYNCOL_FORMAT;
+      if ((i != 0 && json_put(sink, ",", 1)) ||
+          json_put_string(sink, name.str, name.length) ||
+          json_put(sink, ":", 1))
+        return ER_DYNCOL_RESOURCE;
+    }
+
+    if (val.type == DYN_COL_DYNCOL)
+    {
+      /* here we use it only for read so can cheat a bit */
+      DYNAMIC_COLUMN dc;
+      memset(&dc, 0, sizeof(dc));
+      dc.str= val.x.string.value.str;
+      dc.length= val.x.string.value.length;
+      if ((rc= mariadb_dyncol_json_write_internal(&dc, sink, lvl + 1)) < 0)
+        return rc;
+    }
+    else if ((rc= json_put_value(sink, &val)) < 0)
+      return rc;
+  }
+  if (json_reserve(sink, 1))
+    return ER_DYNCOL_RESOURCE;
+  sink->str[sink->length++]= '}';
+  return ER_DYNCOL_OK;
+}
+
+
+/**
+  Write the record as JSON to a sink
+
+  @param str             The packed string
+  @param sink            where to write the JSON text
+
+  @return ER_DYNCOL_* return code, on errors a part of the text may have
+          been written
+*/
+
+enum enum_dyncol_func_result
+mariadb_dyncol_json_write(DYNAMIC_COLUMN *str, DYNAMIC_COLUMN_JSON_SINK *sink)
+{
+  /* a growing sink is enlarged once for the whole record */
+  if (!sink->flush && str->length &&
+      json_reserve(sink, mariadb_dyncol_json_size_hint(str)))
+    return ER_DYNCOL_RESOURCE;
+  return mariadb_dyncol_json_write_internal(str, sink, 1);
+}
+
+
+static size_t json_size_hint(DYNAMIC_COLUMN *str, uint lvl)
+{
+  DYN_HEADER header;
+  size_t size;
+  uint i;
+
+  if (str->length == 0 || lvl >= JSON_STACK_PROTECTION ||
+      init_read_hdr(&header, str) < 0 ||
+      header.header + header.header_size > header.data_end)
+    return 0;
+
+  /* {} and per column "":, */
+  size= 2 + header.column_count * 4 + header.nmpool_size;
+  for (i= 0, header.entry= header.header;
+       i < header.column_count;
+       i++, header.entry+= header.entry_size)
+  {
+    header.length=
+      hdr_interval_length(&header, header.entry + header.entry_size);
+    if (header.length == DYNCOL_OFFSET_ERROR ||
+        header.length > INT_MAX || header.offset > header.data_size)
+      return size;
+    if (header.format == dyncol_fmt_num)
+      size+= DYNCOL_NUM_CHAR - 1;
+    switch (header.type) {
+    case DYN_COL_STRING:
+      size+= header.length + 2;
+      break;
+    case DYN_COL_DYNCOL:
+      {
+        DYNAMIC_COLUMN dc;
+        dc.str= (char *)header.dtpool + header.offset;
+        dc.length= header.length;
+        size+= json_size_hint(&dc, lvl + 1);
+        break;
+      }
+    case DYN_COL_INT:
+    case DYN_COL_UINT:
+      size+= 20;
+      break;
+    default:
+      size+= 28;
+      break;
+    }
+  }
+  return size;
+}
+
+
+/**
+  Estimate the length of the JSON text of a record
+
+  The estimate doesn't include escape sequences, it is meant for
+  allocating the output once.
+
+  @param str             The packed string
+
+  @return estimated length in bytes
+*/
+
+size_t mariadb_dyncol_json_size_hint(DYNAMIC_COLUMN *str)
+{
+  return json_size_hint(str, 1);
+}
+
 /**
   Convert to DYNAMIC_COLUMN_VALUE values and names (LEX_STING) dynamic array
 
@@ -29,6 +29,7 @@
 #include <mariadb_ctype.h>
 #include <ma_common.h>
 #include "ma_priv.h"
+#include <ma_simd.h>
 #include "ma_context.h"
 #include "mysql.h"
 #include "mariadb_version.h"
@@ -71,6 +72,7 @@
 #include <poll.h>
 #endif
 #include <ma_pvio.h>
+#include <ma_uring.h>
 #ifdef HAVE_TLS
 #include <ma_tls.h>
 #endif
@@ -81,7 +83,6 @@
 #define strncasecmp _strnicmp
 #endif
 
-#define ASYNC_CONTEXT_DEFAULT_STACK_SIZE (4096*15)
 #define MA_RPL_VERSION_HACK "5.5.5-"
 
 #define CHARSET_NAME_LEN 64
@@ -122,6 +123,7 @@ extern int mthd_stmt_fetch_row(MYSQL_STMT *stmt, unsigned char **row);
 extern int mthd_stmt_fetch_to_bind(MYSQL_STMT *stmt, unsigned char *row);
 extern int mthd_stmt_read_all_rows(MYSQL_STMT *stmt);
 extern void mthd_stmt_flush_unbuffered(MYSQL_STMT *stmt);
+extern void ma_stmt_cache_free(MYSQL *mysql);
 extern my_bool _mariadb_read_options(MYSQL *mysql, const char *dir, const char *config_file, const char *group, unsigned int recursion);
 extern unsigned char *mysql_net_store_length(unsigned char *packet, ulonglong length);
 
@@ -694,6 +696,8 @@ struct st_default_options mariadb_defaults[] =
   {{MARIADB_OPT_RESTRICTED_AUTH}, MARIADB_OPTION_STR, "restricted-auth"},
   {{.option_func=parse_connection_string}, MARIADB_OPTION_FUNC, "connection"},
   {{MARIADB_OPT_BULK_UNIT_RESULTS}, MARIADB_OPTION_BOOL, "bulk-unit-results"},
+  {{MARIADB_OPT_COMPRESSION_ADAPTIVE}, MARIADB_OPTION_BOOL, "compression-adaptive"},
+  {{MARIADB_OPT_STMT_CACHE_SIZE}, MARIADB_OPTION_INT, "stmt-cache-size"},
   /* Aliases */
   {{MARIADB_OPT_SCHEMA}, MARIADB_OPTION_STR, "db"},
   {{MARIADB_OPT_UNIXSOCKET}, MARIADB_OPTION_STR, "unix_socket"},
@@ -1990,6 +1994,10 @@ restart:
                    _mariadb_compression_algorithm_str(alg));
       goto error;
     }
+    net->extension->compress_policy.adaptive=
+      OPT_EXT_VAL(mysql, compression_adaptive);
+    net->extension->compression_stats.compression_level=
+      compression_ctx(net)->compression_level;
     net->compress= 1;
   }
 
@@ -2036,6 +2044,7 @@ restart:
   /* connection established, apply timeouts */
   ma_pvio_set_timeout(mysql->net.pvio, PVIO_READ_TIMEOUT, mysql->options.read_timeout);
   ma_pvio_set_timeout(mysql->net.pvio, PVIO_WRITE_TIMEOUT, mysql->options.write_timeout);
+  ma_pvio_established(mysql->net.pvio);
 
   free(host_list);
   free(host_copy);
@@ -2173,6 +2182,9 @@ my_bool STDCALL mariadb_reconnect(MYSQL *mysql)
 
 void ma_invalidate_stmts(MYSQL *mysql, const char *function_name)
 {
+  /* server side statements are gone, cached ones too */
+  ma_stmt_cache_free(mysql);
+
   if (mysql->stmts)
   {
     LIST *li_stmt= mysql->stmts;
@@ -2350,7 +2362,7 @@ static void mysql_close_options(MYSQL *mysql)
       ma_hashtbl_free(&mysql->options.extension->userdata);
     free(mysql->options.extension->restricted_auth);
     free(mysql->options.extension->rpl_host);
-
+    ma_uring_unref(mysql->options.extension->uring);
   }
   free(mysql->options.extension);
   /* clear all pointer */
@@ -2483,7 +2495,10 @@ mysql_close(MYSQL *mysql)
     memset((char*) &mysql->options, 0, sizeof(mysql->options));
 
     if (mysql->extension)
+    {
+      free(mysql->extension->pipeline.items);
       free(mysql->extension);
+    }
 
     /* Clear pointers for better safety */
     mysql->net.extension = NULL;
@@ -2925,6 +2940,186 @@ mysql_read_query_result(MYSQL *mysql)
   return test(mysql->methods->db_read_query_result(mysql)) ? 1 : 0;
 }
 
+/*
+  Pipelining
+
+  Commands queued between mariadb_pipeline_begin() and
+  mariadb_pipeline_flush() are written back to back without waiting for
+  the server's responses, on uncompressed connections they are sent with
+  a single write when the batch is flushed. Afterwards the results are
+  read in the order the commands were queued by calling
+  mariadb_pipeline_next_result() once per command. A failing command
+  doesn't affect the following ones, its error is reported by the
+  corresponding mariadb_pipeline_next_result() call.
+
+  Result sets must be consumed (mysql_store_result/mysql_use_result or
+  mysql_stmt_store_result/mysql_stmt_fetch) before the next result can
+  be read, and queued statements must not be closed before their result
+  was read.
+*/
+static int ma_pipeline_out_of_sync(MYSQL *mysql)
+{
+  SET_CLIENT_ERROR(mysql, CR_COMMANDS_OUT_OF_SYNC, SQLSTATE_UNKNOWN, 0);
+  return 1;
+}
+
+static int ma_pipeline_flush_net(MYSQL *mysql)
+{
+  mysql->net.extension->multi_status= COM_MULTI_OFF;
+  return ma_net_flush(&mysql->net);
+}
+
+static int ma_pipeline_add(MYSQL *mysql, MYSQL_STMT *stmt)
+{
+  struct st_mariadb_pipeline *pipeline= &mysql->extension->pipeline;
+
+  if (pipeline->count == pipeline->size)
+  {
+    unsigned int size= pipeline->size ? pipeline->size * 2 : 16;
+    MYSQL_STMT **items;
+
+    if (!(items= (MYSQL_STMT **)realloc(pipeline->items, size * sizeof(MYSQL_STMT *))))
+    {
+      SET_CLIENT_ERROR(mysql, CR_OUT_OF_MEMORY, SQLSTATE_UNKNOWN, 0);
+      return 1;
+    }
+    pipeline->items= items;
+    pipeline->size= size;
+  }
+  pipeline->items[pipeline->count++]= stmt;
+  return 0;
+}
+
+/* called after a command was queued */
+static int ma_pipeline_queued(MYSQL *mysql, int rc)
+{
+  if (rc)
+  {
+    mysql->extension->pipeline.count--;
+    return rc;
+  }
+  /* The compressed protocol sends one compressed packet per command */
+  if (mysql->net.compress)
+  {
+    if (ma_pipeline_flush_net(mysql))
+      return 1;
+    mysql->net.extension->multi_status= COM_MULTI_ENABLED;
+  }
+  return 0;
+}
+
+int STDCALL mariadb_pipeline_begin(MYSQL *mysql)
+{
+  struct st_mariadb_pipeline *pipeline= &mysql->extension->pipeline;
+
+  if (pipeline->active || pipeline->current < pipeline->count ||
+      mysql->status != MYSQL_STATUS_READY ||
+      mysql->server_status & SERVER_MORE_RESULTS_EXIST)
+    return ma_pipeline_out_of_sync(mysql);
+
+  if (!mysql->net.pvio && mariadb_reconnect(mysql))
+    return 1;
+
+  CLEAR_CLIENT_ERROR(mysql);
+  free_old_query(mysql);
+  if (ma_multi_command(mysql, COM_MULTI_ENABLED))
+    return ma_pipeline_out_of_sync(mysql);
+  pipeline->count= pipeline->current= 0;
+  pipeline->active= 1;
+  return 0;
+}
+
+int STDCALL mariadb_pipeline_query(MYSQL *mysql, const char *query, unsigned long length)
+{
+  if (!mysql->extension->pipeline.active)
+    return ma_pipeline_out_of_sync(mysql);
+
+  if (length == (unsigned long)-1)
+    length= (unsigned long)strlen(query);
+
+  if (ma_pipeline_add(mysql, NULL))
+    return 1;
+  return ma_pipeline_queued(mysql,
+                            ma_simple_command(mysql, COM_QUERY, query, length, 1, 0));
+}
+
+int STDCALL mariadb_pipeline_stmt_execute(MYSQL_STMT *stmt)
+{
+  MYSQL *mysql= stmt->mysql;
+
+  if (!mysql)
+  {
+    stmt_set_error(stmt, CR_SERVER_LOST, SQLSTATE_UNKNOWN, 0);
+    return 1;
+  }
+  if (!mysql->extension->pipeline.active)
+  {
+    stmt_set_error(stmt, CR_COMMANDS_OUT_OF_SYNC, SQLSTATE_UNKNOWN, 0);
+    return ma_pipeline_out_of_sync(mysql);
+  }
+
+  if (ma_pipeline_add(mysql, stmt))
+  {
+    stmt_set_error(stmt, CR_OUT_OF_MEMORY, SQLSTATE_UNKNOWN, 0);
+    return 1;
+  }
+  /* while the pipeline is active mysql_stmt_execute doesn't read the response */
+  return ma_pipeline_queued(mysql, mysql_stmt_execute(stmt));
+}
+
+int STDCALL mariadb_pipeline_flush(MYSQL *mysql)
+{
+  struct st_mariadb_pipeline *pipeline= &mysql->extension->pipeline;
+
+  if (!pipeline->active)
+    return ma_pipeline_out_of_sync(mysql);
+
+  pipeline->active= 0;
+  if (ma_pipeline_flush_net(mysql))
+  {
+    /* no results will arrive */
+    pipeline->count= pipeline->current= 0;
+    if (!mysql->net.last_errno)
+      my_set_error(mysql, CR_SERVER_LOST, SQLSTATE_UNKNOWN, 0);
+    return 1;
+  }
+  return 0;
+}
+
+/*
+  Reads the result of the next queued command. If stmt is not NULL it
+  will be set to the executed statement, or NULL if the command was a
+  query.
+  Returns 0 on success, 1 if the command failed and -1 if all results
+  were read.
+*/
+int STDCALL mariadb_pipeline_next_result(MYSQL *mysql, MYSQL_STMT **stmt)
+{
+  struct st_mariadb_pipeline *pipeline= &mysql->extension->pipeline;
+  MYSQL_STMT *item;
+
+  if (pipeline->active)
+    return ma_pipeline_out_of_sync(mysql);
+
+  if (pipeline->current >= pipeline->count)
+  {
+    pipeline->count= pipeline->current= 0;
+    return -1;
+  }
+
+  if (mysql->status != MYSQL_STATUS_READY ||
+      mysql->server_status & SERVER_MORE_RESULTS_EXIST)
+    return ma_pipeline_out_of_sync(mysql);
+
+  item= pipeline->items[pipeline->current++];
+  if (stmt)
+    *stmt= item;
+
+  if (!item)
+    return mysql->methods->db_read_query_result(mysql) ? 1 : 0;
+  return mthd_stmt_read_execute_response(item) ? 1 : 0;
+}
+
 int STDCALL
 mysql_real_query(MYSQL *mysql, const char *query, unsigned long length)
 {
@@ -3522,6 +3717,7 @@ mysql_optionsv(MYSQL *mysql,enum mysql_option option, ...)
     OPT_SET_EXTENDED_VALUE_STR(&mysql->options, default_auth, (char *)arg1);
     break;
   case MYSQL_OPT_NONBLOCK:
+  case MARIADB_OPT_ASYNC_STACK_POOL:
     if (mysql->options.extension &&
         (ctxt = mysql->options.extension->async_context) != 0)
     {
@@ -3533,6 +3729,7 @@ mysql_optionsv(MYSQL *mysql,enum mysql_option option, ...)
         goto end;
       my_context_destroy(&ctxt->async_context);
       free(ctxt);
+      mysql->options.extension->async_context= 0;
     }
     if (!(ctxt= (struct mysql_async_context *)
           calloc(1, sizeof(*ctxt))))
@@ -3541,11 +3738,13 @@ mysql_optionsv(MYSQL *mysql,enum mysql_option option, ...)
       goto end;
     }
     stacksize= 0;
-    if (arg1)
+    if (arg1 && option == MYSQL_OPT_NONBLOCK)
       stacksize= *(const size_t *)arg1;
     if (!stacksize)
       stacksize= ASYNC_CONTEXT_DEFAULT_STACK_SIZE;
-    if (my_context_init(&ctxt->async_context, stacksize))
+    if (my_context_init(&ctxt->async_context, stacksize,
+                        option == MARIADB_OPT_ASYNC_STACK_POOL ?
+                        (struct st_mariadb_stack_pool *)arg1 : NULL))
     {
       free(ctxt);
       goto end;
@@ -3853,6 +4052,20 @@ mysql_optionsv(MYSQL *mysql,enum mysql_option option, ...)
   case MARIADB_OPT_BULK_UNIT_RESULTS:
     OPT_SET_EXTENDED_VALUE_INT(&mysql->options, bulk_unit_results, *(my_bool *)arg1);
     break;
+  case MARIADB_OPT_COMPRESSION_ADAPTIVE:
+    OPT_SET_EXTENDED_VALUE_INT(&mysql->options, compression_adaptive, *(my_bool *)arg1);
+    break;
+  case MARIADB_OPT_STMT_CACHE_SIZE:
+    OPT_SET_EXTENDED_VALUE_INT(&mysql->options, stmt_cache_size, *(unsigned int *)arg1);
+    break;
+  case MARIADB_OPT_IO_URING:
+    OPT_SET_EXTENDED_VALUE(&mysql->options, io_uring, 1);
+    /* connections keep a reference, see mariadb_uring.h */
+    if (arg1)
+      ma_uring_ref((MARIADB_URING *)arg1);
+    ma_uring_unref(mysql->options.extension->uring);
+    mysql->options.extension->uring= (MARIADB_URING *)arg1;
+    break;
   default:
     va_end(ap);
     SET_CLIENT_ERROR(mysql, CR_NOT_IMPLEMENTED, SQLSTATE_UNKNOWN, 0);
@@ -4078,6 +4291,15 @@ mysql_get_optionv(MYSQL *mysql, enum mysql_option option, void *arg, ...)
   case MARIADB_OPT_BULK_UNIT_RESULTS:
     *((my_bool *)arg)= mysql->options.extension ? mysql->options.extension->bulk_unit_results : 0;
     break;
+  case MARIADB_OPT_COMPRESSION_ADAPTIVE:
+    *((my_bool *)arg)= mysql->options.extension ? mysql->options.extension->compression_adaptive : 0;
+    break;
+  case MARIADB_OPT_STMT_CACHE_SIZE:
+    *((unsigned int *)arg)= mysql->options.extension ? mysql->options.extension->stmt_cache_size : 0;
+    break;
+  case MARIADB_OPT_IO_URING:
+    *((MARIADB_URING **)arg)= mysql->options.extension ? mysql->options.extension->uring : NULL;
+    break;
   default:
     va_end(ap);
     SET_CLIENT_ERROR(mysql, CR_NOT_IMPLEMENTED, SQLSTATE_UNKNOWN, 0);
@@ -4467,17 +4689,9 @@ ulong STDCALL mysql_get_client_version(void)
 
 ulong STDCALL mysql_hex_string(char *to, const char *from, unsigned long len)
 {
-  char *start= to;
-  char hexdigits[]= "0123456789ABCDEF";
-
-  while (len--)
-  {
-    *to++= hexdigits[((unsigned char)*from) >> 4];
-    *to++= hexdigits[((unsigned char)*from) & 0x0F];
-    from++;
-  }
-  *to= 0;
-  return (ulong)(to - start);
+  ma_simd_hex(to, (const uchar *)from, len);
+  to[2 * (size_t)len]= 0;
+  return (ulong)(2 * len);
 }
 
 my_bool STDCALL mariadb_connection(MYSQL *mysql)
@@ -4554,6 +4768,12 @@ my_bool mariadb_get_infov(MYSQL *mysql, enum mariadb_value value, void *arg, ...
   case MARIADB_TLS_VERIFY_STATUS:
     *((unsigned int *)arg)= (unsigned int)mysql->net.tls_verify_status;
     break;
+  case MARIADB_CONNECTION_TLS_SESSION_REUSED:
+    if (mysql && mysql->net.pvio && mysql->net.pvio->ctls)
+      *((my_bool *)arg)= ma_pvio_tls_session_reused(mysql->net.pvio->ctls);
+    else
+      *((my_bool *)arg)= 0;
+    break;
 #endif
   case MARIADB_MAX_ALLOWED_PACKET:
     *((size_t *)arg)= (size_t)max_allowed_packet;
@@ -4761,6 +4981,11 @@ my_bool mariadb_get_infov(MYSQL *mysql, enum mariadb_value value, void *arg, ...
   case MARIADB_CONNECTION_BYTES_SENT:
     *((size_t *)arg)= mysql->net.pvio->bytes_sent;
     break;
+  case MARIADB_CONNECTION_COMPRESSION_STATS:
+    if (!mysql || !mysql->net.extension)
+      goto error;
+    *((MARIADB_COMPRESSION_STATS *)arg)= mysql->net.extension->compression_stats;
+    break;
   default:
     va_end(ap);
     return(-1);
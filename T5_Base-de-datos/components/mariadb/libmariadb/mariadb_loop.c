@@ -0,0 +1,1126 @@
+/************************************************************************************
+   Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not see <http://www.gnu.org/licenses>
+   or write to the Free Software Foundation, Inc.,
+   51 Franklin St., Fifth Floor, Boston, MA 02110, USA
+*************************************************************************************/
+
+/*
+  Event loop for non-blocking connections
+
+  Every registered connection runs at most one operation at a time, further
+  operations wait in a FIFO queue of the connection. An operation is a
+  small state machine on top of the mysql_xxx_start()/mysql_xxx_cont()
+  functions: whenever the library suspends, the socket is (re)armed in the
+  epoll set with EPOLLONESHOT for exactly the events the library asked for,
+  so a wakeup never reports a connection which isn't waiting, and the
+  connection is resumed with the events which occurred.
+
+  Timeouts requested by the library (MYSQL_WAIT_TIMEOUT) and the deadline
+  of an operation (MARIADB_LOOP_OP_TIMEOUT) are kept in a hashed timer
+  wheel with MA_LOOP_WHEEL_SIZE slots of one millisecond. Adding and
+  removing a timer is O(1), timers which are due after more than one
+  revolution of the wheel stay in their slot until they expire. An expired
+  timer resumes the connection with MYSQL_WAIT_TIMEOUT, which makes the
+  pending read or write fail.
+
+  Callbacks are never called from the submitting function, also if the
+  operation completes immediately. Completed operations are queued and the
+  callbacks are called from mariadb_loop_run() or mariadb_loop_wait(),
+  where they may submit new operations.
+
+  Platforms without epoll use poll() over all connections instead.
+*/
+
+#include <ma_global.h>
+#include <ma_sys.h>
+#include <ma_string.h>
+#include <mysql.h>
+#include <errmsg.h>
+#include <ma_common.h>
+#include <mariadb_loop.h>
+#include <stdarg.h>
+#ifdef HAVE_EPOLL
+#include <sys/epoll.h>
+#elif defined(_WIN32)
+#include <winsock2.h>
+#define poll(fds, nfds, timeout) WSAPoll((fds), (nfds), (timeout))
+#else
+#include <poll.h>
+#endif
+#ifndef _WIN32
+#include <time.h>
+#include <errno.h>
+#endif
+
+extern int STDCALL mysql_real_connect_start(MYSQL **ret, MYSQL *mysql,
+                                            const char *host, const char *user,
+                                            const char *passwd, const char *db,
+                                            unsigned int port,
+                                            const char *unix_socket,
+                                            unsigned long client_flags);
+extern int STDCALL mysql_real_connect_cont(MYSQL **ret, MYSQL *mysql, int status);
+extern int STDCALL mysql_real_query_start(int *ret, MYSQL *mysql,
+                                          const char *query, unsigned long length);
+extern int STDCALL mysql_real_query_cont(int *ret, MYSQL *mysql, int status);
+extern int STDCALL mysql_store_result_start(MYSQL_RES **ret, MYSQL *mysql);
+extern int STDCALL mysql_store_result_cont(MYSQL_RES **ret, MYSQL *mysql, int status);
+extern int STDCALL mysql_next_result_start(int *ret, MYSQL *mysql);
+extern int STDCALL mysql_next_result_cont(int *ret, MYSQL *mysql, int status);
+extern int STDCALL mysql_ping_start(int *ret, MYSQL *mysql);
+extern int STDCALL mysql_ping_cont(int *ret, MYSQL *mysql, int status);
+
+#define MA_LOOP_WHEEL_SIZE          512     /* milliseconds */
+#define MA_LOOP_DEFAULT_MAX_EVENTS  64
+
+#define MA_LOOP_WAIT_IO (MYSQL_WAIT_READ | MYSQL_WAIT_WRITE | MYSQL_WAIT_EXCEPT)
+
+enum enum_ma_loop_stage {
+  MA_LOOP_STAGE_CONNECT,
+  MA_LOOP_STAGE_QUERY,
+  MA_LOOP_STAGE_STORE,
+  MA_LOOP_STAGE_NEXT,
+  MA_LOOP_STAGE_DRAIN,        /* further result sets, which are discarded */
+  MA_LOOP_STAGE_PING
+};
+
+typedef struct st_ma_loop_timer {
+  unsigned long long expires;          /* milliseconds */
+  struct st_ma_loop_timer **list;      /* wheel slot or expired list, NULL if idle */
+  struct st_ma_loop_timer *prev, *next;
+  struct st_ma_loop_conn *conn;
+} MA_LOOP_TIMER;
+
+typedef struct st_ma_loop_conn {
+  MYSQL *mysql;
+  MARIADB_LOOP *loop;
+  MARIADB_LOOP_OP *current;            /* running operation */
+  MARIADB_LOOP_OP *head, *tail;        /* queued operations */
+  int status;                          /* MYSQL_WAIT_xxx of the running operation */
+  my_socket fd;                        /* socket in the epoll set */
+  my_bool registered;
+  MA_LOOP_TIMER io_timer;              /* timeout requested by the library */
+  MA_LOOP_TIMER deadline;              /* MARIADB_LOOP_OP_TIMEOUT */
+  struct st_ma_loop_conn *prev, *next;
+} MA_LOOP_CONN;
+
+struct st_mariadb_loop_op {
+  MARIADB_LOOP *loop;
+  MYSQL *mysql;
+  enum mariadb_loop_op_type type;
+  enum enum_ma_loop_stage stage;
+  mariadb_loop_callback callback;
+  void *data;
+  /* parameters, the strings are stored behind the structure */
+  const char *host, *user, *passwd, *db, *unix_socket;
+  unsigned int port;
+  unsigned long client_flag;
+  const char *query;
+  unsigned long length;
+  /* outcome */
+  MYSQL_RES *result;
+  unsigned int error_no;
+  unsigned long long submitted_at;     /* microseconds */
+  unsigned long long latency;
+  my_bool done;
+  my_bool timed_out;
+  my_bool free_on_done;                /* mariadb_loop_op_free() was called before completion */
+  struct st_mariadb_loop_op *next;
+};
+
+struct st_mariadb_loop {
+#ifdef HAVE_EPOLL
+  int epfd;
+  struct epoll_event *events;
+#else
+  struct pollfd *pollfds;
+  MA_LOOP_CONN **pollconns;
+  unsigned int pollsize;
+#endif
+  unsigned int max_events;
+  unsigned int op_timeout;
+  MA_LOOP_CONN *conns;
+  MA_LOOP_TIMER *wheel[MA_LOOP_WHEEL_SIZE];
+  MA_LOOP_TIMER *expired;
+  unsigned long long wheel_time;       /* last processed tick (milliseconds) */
+  unsigned int timers;
+  MARIADB_LOOP_OP *done_head, *done_tail;   /* callbacks to call */
+  unsigned int done_count;
+  MARIADB_LOOP_STATS stats;
+};
+
+static unsigned long long ma_loop_time(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER count, freq;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&freq);
+  return (unsigned long long)(count.QuadPart * 1000000 / freq.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/* {{{ timer wheel */
+static void ma_loop_timer_link(MA_LOOP_TIMER **list, MA_LOOP_TIMER *timer)
+{
+  timer->list= list;
+  timer->prev= NULL;
+  timer->next= *list;
+  if (*list)
+    (*list)->prev= timer;
+  *list= timer;
+}
+
+static void ma_loop_timer_cancel(MARIADB_LOOP *loop, MA_LOOP_TIMER *timer)
+{
+  if (!timer->list)
+    return;
+  if (timer->prev)
+    timer->prev->next= timer->next;
+  else
+    *timer->list= timer->next;
+  if (timer->next)
+    timer->next->prev= timer->prev;
+  timer->list= NULL;
+  timer->prev= timer->next= NULL;
+  loop->timers--;
+}
+
+static void ma_loop_timer_set(MARIADB_LOOP *loop, MA_LOOP_TIMER *timer,
+                              unsigned long long now, unsigned int ms)
+{
+  unsigned long long expires= now / 1000 + ms;
+
+  ma_loop_timer_cancel(loop, timer);
+  /* a timer can't expire in a tick which was already processed */
+  if (expires <= loop->wheel_time)
+    expires= loop->wheel_time + 1;
+  timer->expires= expires;
+  ma_loop_timer_link(&loop->wheel[expires % MA_LOOP_WHEEL_SIZE], timer);
+  loop->timers++;
+}
+
+/*
+  Moves all timers which are due at now_ms to the expired list. Every
+  slot is visited at most once, also if the loop didn't run for more than
+  one revolution.
+*/
+static void ma_loop_timer_advance(MARIADB_LOOP *loop, unsigned long long now_ms)
+{
+  unsigned long long tick, last;
+
+  if (now_ms <= loop->wheel_time)
+    return;
+  last= MIN(now_ms, loop->wheel_time + MA_LOOP_WHEEL_SIZE);
+  if (loop->timers)
+  {
+    for (tick= loop->wheel_time + 1; tick <= last; tick++)
+    {
+      MA_LOOP_TIMER *timer= loop->wheel[tick % MA_LOOP_WHEEL_SIZE], *next;
+
+      for (; timer; timer= next)
+      {
+        next= timer->next;
+        if (timer->expires <= now_ms)
+        {
+          ma_loop_timer_cancel(loop, timer);
+          ma_loop_timer_link(&loop->expired, timer);
+          loop->timers++;
+        }
+      }
+    }
+  }
+  loop->wheel_time= now_ms;
+}
+
+/* milliseconds until the next timer expires, capped at one revolution */
+static int ma_loop_timer_next(MARIADB_LOOP *loop, unsigned long long now_ms)
+{
+  unsigned long long tick;
+
+  if (loop->expired)
+    return 0;
+  if (!loop->timers)
+    return -1;
+  for (tick= loop->wheel_time + 1;
+       tick <= loop->wheel_time + MA_LOOP_WHEEL_SIZE; tick++)
+  {
+    MA_LOOP_TIMER *timer;
+
+    for (timer= loop->wheel[tick % MA_LOOP_WHEEL_SIZE]; timer; timer= timer->next)
+      if (timer->expires <= tick)
+        return tick > now_ms ? (int)(tick - now_ms) : 0;
+  }
+  return MA_LOOP_WHEEL_SIZE;
+}
+/* }}} */
+
+/* {{{ socket registration */
+static int ma_loop_arm(MARIADB_LOOP *loop, MA_LOOP_CONN *conn)
+{
+  my_socket fd= mysql_get_socket(conn->mysql);
+#ifdef HAVE_EPOLL
+  struct epoll_event ev;
+  int rc;
+
+  ev.events= EPOLLONESHOT;
+  if (conn->status & MYSQL_WAIT_READ)
+    ev.events|= EPOLLIN;
+  if (conn->status & MYSQL_WAIT_WRITE)
+    ev.events|= EPOLLOUT;
+  if (conn->status & MYSQL_WAIT_EXCEPT)
+    ev.events|= EPOLLPRI;
+  ev.data.ptr= conn;
+
+  /*
+    A failed connection attempt closes the socket, which also removes it
+    from the epoll set, and the next attempt may get the same descriptor.
+    So ADD and MOD fall back to each other instead of trusting our state.
+  */
+  if (conn->registered && conn->fd == fd)
+  {
+    if ((rc= epoll_ctl(loop->epfd, EPOLL_CTL_MOD, fd, &ev)) && errno == ENOENT)
+      rc= epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev);
+  }
+  else if ((rc= epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev)) && errno == EEXIST)
+    rc= epoll_ctl(loop->epfd, EPOLL_CTL_MOD, fd, &ev);
+  if (rc)
+  {
+    conn->registered= 0;
+    return 1;
+  }
+  conn->registered= 1;
+#endif
+  conn->fd= fd;
+  return 0;
+}
+
+static void ma_loop_disarm(MARIADB_LOOP *loop, MA_LOOP_CONN *conn)
+{
+#ifdef HAVE_EPOLL
+  if (conn->registered)
+  {
+    struct epoll_event ev;
+
+    /* the socket may already be closed, errors don't matter */
+    epoll_ctl(loop->epfd, EPOLL_CTL_DEL, conn->fd, &ev);
+  }
+#endif
+  conn->registered= 0;
+}
+/* }}} */
+
+/* {{{ operations */
+static MARIADB_LOOP_OP *ma_loop_op_new(size_t extra)
+{
+  MARIADB_LOOP_OP *op;
+
+  if (!(op= (MARIADB_LOOP_OP *)calloc(1, sizeof(MARIADB_LOOP_OP) + extra)))
+    return NULL;
+  return op;
+}
+
+/* copies str behind the operation, returns the new end of the buffer */
+static char *ma_loop_op_str(const char **to, char *buf, const char *str)
+{
+  size_t length;
+
+  if (!str)
+  {
+    *to= NULL;
+    return buf;
+  }
+  length= strlen(str) + 1;
+  memcpy(buf, str, length);
+  *to= buf;
+  return buf + length;
+}
+
+static void ma_loop_op_release(MARIADB_LOOP_OP *op)
+{
+  if (op->result)
+    mysql_free_result(op->result);
+  free(op);
+}
+
+/* takes the next queued operation of the connection */
+static MARIADB_LOOP_OP *ma_loop_next_op(MA_LOOP_CONN *conn)
+{
+  MARIADB_LOOP_OP *op;
+
+  if (!(op= conn->head))
+    return NULL;
+  if (!(conn->head= op->next))
+    conn->tail= NULL;
+  op->next= NULL;
+  conn->loop->stats.queued--;
+  return op;
+}
+
+static void ma_loop_begin(MA_LOOP_CONN *conn, MARIADB_LOOP_OP *op,
+                          unsigned long long now)
+{
+  MARIADB_LOOP *loop= conn->loop;
+
+  conn->current= op;
+  conn->status= 0;
+  if (++loop->stats.in_flight > loop->stats.max_in_flight)
+    loop->stats.max_in_flight= loop->stats.in_flight;
+  if (loop->op_timeout)
+    ma_loop_timer_set(loop, &conn->deadline, now, loop->op_timeout);
+}
+
+static void ma_loop_finish(MA_LOOP_CONN *conn, my_bool failed)
+{
+  MARIADB_LOOP *loop= conn->loop;
+  MARIADB_LOOP_OP *op= conn->current;
+  MARIADB_LOOP_STATS *stats= &loop->stats;
+  unsigned int bucket= 0;
+
+  ma_loop_timer_cancel(loop, &conn->io_timer);
+  ma_loop_timer_cancel(loop, &conn->deadline);
+  conn->current= NULL;
+  conn->status= 0;
+  stats->in_flight--;
+
+  if (op->timed_out)
+  {
+    my_set_error(conn->mysql, CR_LOOP_TIMEOUT, SQLSTATE_UNKNOWN, 0,
+                 loop->op_timeout);
+    stats->timeouts++;
+    failed= 1;
+  }
+  if (failed)
+  {
+    if (!(op->error_no= mysql_errno(conn->mysql)))
+      op->error_no= CR_UNKNOWN_ERROR;
+    stats->failed++;
+  }
+
+  op->latency= ma_loop_time() - op->submitted_at;
+  while (bucket < MARIADB_LOOP_LATENCY_BUCKETS - 1 && (op->latency >> bucket))
+    bucket++;
+  stats->latency_histogram[bucket]++;
+  stats->latency_total+= op->latency;
+  if (op->latency > stats->latency_max)
+    stats->latency_max= op->latency;
+  stats->completed++;
+  op->done= 1;
+
+  if (op->callback)
+  {
+    if (loop->done_tail)
+      loop->done_tail->next= op;
+    else
+      loop->done_head= op;
+    loop->done_tail= op;
+    loop->done_count++;
+  }
+  else if (op->free_on_done)
+    ma_loop_op_release(op);
+}
+
+/*
+  Runs the operations of a connection until one of them has to wait for
+  the socket or a timer. ready is 0 to start the current operation or the
+  MYSQL_WAIT_xxx events to resume it with.
+*/
+static void ma_loop_step(MA_LOOP_CONN *conn, int ready)
+{
+  MARIADB_LOOP *loop= conn->loop;
+  MYSQL *mysql= conn->mysql;
+  MARIADB_LOOP_OP *op;
+  MYSQL *ret_mysql;
+  MYSQL_RES *res;
+  int status, rc;
+
+  while ((op= conn->current))
+  {
+    switch (op->stage) {
+    case MA_LOOP_STAGE_CONNECT:
+      status= ready ? mysql_real_connect_cont(&ret_mysql, mysql, ready)
+                    : mysql_real_connect_start(&ret_mysql, mysql, op->host,
+                                               op->user, op->passwd, op->db,
+                                               op->port, op->unix_socket,
+                                               op->client_flag);
+      if (status)
+        goto suspend;
+      ma_loop_finish(conn, ret_mysql == NULL);
+      break;
+    case MA_LOOP_STAGE_QUERY:
+      status= ready ? mysql_real_query_cont(&rc, mysql, ready)
+                    : mysql_real_query_start(&rc, mysql, op->query, op->length);
+      if (status)
+        goto suspend;
+      if (rc)
+        ma_loop_finish(conn, 1);
+      else
+        op->stage= MA_LOOP_STAGE_STORE;
+      break;
+    case MA_LOOP_STAGE_STORE:
+    case MA_LOOP_STAGE_DRAIN:
+      status= ready ? mysql_store_result_cont(&res, mysql, ready)
+                    : mysql_store_result_start(&res, mysql);
+      if (status)
+        goto suspend;
+      if (op->stage == MA_LOOP_STAGE_STORE)
+        op->result= res;
+      else if (res)
+        mysql_free_result(res);
+      if (!res && mysql_field_count(mysql))
+        ma_loop_finish(conn, 1);
+      else if (!mysql_more_results(mysql))
+        ma_loop_finish(conn, 0);
+      else
+        op->stage= MA_LOOP_STAGE_NEXT;
+      break;
+    case MA_LOOP_STAGE_NEXT:
+      status= ready ? mysql_next_result_cont(&rc, mysql, ready)
+                    : mysql_next_result_start(&rc, mysql);
+      if (status)
+        goto suspend;
+      if (rc)
+        ma_loop_finish(conn, rc > 0);
+      else
+        op->stage= MA_LOOP_STAGE_DRAIN;
+      break;
+    case MA_LOOP_STAGE_PING:
+      status= ready ? mysql_ping_cont(&rc, mysql, ready)
+                    : mysql_ping_start(&rc, mysql);
+      if (status)
+        goto suspend;
+      ma_loop_finish(conn, rc != 0);
+      break;
+    }
+    ready= 0;
+    if (!conn->current && (op= ma_loop_next_op(conn)))
+      ma_loop_begin(conn, op, ma_loop_time());
+    continue;
+
+suspend:
+    /*
+      After the deadline every wait fails immediately, so the library
+      unwinds (and possibly tries the next address) without waiting.
+    */
+    if (op->timed_out)
+    {
+      ready= MYSQL_WAIT_TIMEOUT;
+      continue;
+    }
+    conn->status= status;
+    if ((status & MA_LOOP_WAIT_IO) && ma_loop_arm(loop, conn))
+    {
+      ready= MYSQL_WAIT_TIMEOUT;
+      continue;
+    }
+    if (status & MYSQL_WAIT_TIMEOUT)
+      ma_loop_timer_set(loop, &conn->io_timer, ma_loop_time(),
+                        mysql_get_timeout_value_ms(mysql));
+    return;
+  }
+}
+
+static void ma_loop_resume(MA_LOOP_CONN *conn, int ready)
+{
+  if (!conn->current || !conn->status)
+    return;
+  ma_loop_timer_cancel(conn->loop, &conn->io_timer);
+  conn->status= 0;
+  ma_loop_step(conn, ready);
+}
+
+static void ma_loop_fire_timers(MARIADB_LOOP *loop)
+{
+  MA_LOOP_TIMER *timer;
+
+  while ((timer= loop->expired))
+  {
+    MA_LOOP_CONN *conn= timer->conn;
+
+    ma_loop_timer_cancel(loop, timer);
+    if (timer == &conn->deadline && conn->current)
+      conn->current->timed_out= 1;
+    ma_loop_resume(conn, MYSQL_WAIT_TIMEOUT);
+  }
+}
+
+static void ma_loop_deliver(MARIADB_LOOP *loop)
+{
+  MARIADB_LOOP_OP *op;
+
+  /* callbacks may complete further operations, which are appended */
+  while ((op= loop->done_head))
+  {
+    if (!(loop->done_head= op->next))
+      loop->done_tail= NULL;
+    op->next= NULL;
+    loop->done_count--;
+    op->callback(op, op->data);
+    ma_loop_op_release(op);
+  }
+}
+/* }}} */
+
+static MA_LOOP_CONN *ma_loop_get_conn(MARIADB_LOOP *loop, MYSQL *mysql)
+{
+  MA_LOOP_CONN *conn;
+
+  if (!mysql || !mysql->extension)
+    return NULL;
+  if ((conn= mysql->extension->loop_conn))
+    return conn->loop == loop ? conn : NULL;
+  if (mariadb_loop_add(loop, mysql))
+    return NULL;
+  return mysql->extension->loop_conn;
+}
+
+static MARIADB_LOOP_OP *ma_loop_submit(MARIADB_LOOP *loop, MA_LOOP_CONN *conn,
+                                       MARIADB_LOOP_OP *op,
+                                       mariadb_loop_callback callback,
+                                       void *data)
+{
+  unsigned long long now= ma_loop_time();
+
+  op->loop= loop;
+  op->mysql= conn->mysql;
+  op->callback= callback;
+  op->data= data;
+  op->submitted_at= now;
+  loop->stats.submitted++;
+
+  if (conn->current)
+  {
+    if (conn->tail)
+      conn->tail->next= op;
+    else
+      conn->head= op;
+    conn->tail= op;
+    loop->stats.queued++;
+    return op;
+  }
+  ma_loop_begin(conn, op, now);
+  ma_loop_step(conn, 0);
+  return op;
+}
+
+MARIADB_LOOP * STDCALL mariadb_loop_init(void)
+{
+  MARIADB_LOOP *loop;
+
+  if (!(loop= (MARIADB_LOOP *)calloc(1, sizeof(MARIADB_LOOP))))
+    return NULL;
+  loop->max_events= MA_LOOP_DEFAULT_MAX_EVENTS;
+  loop->wheel_time= ma_loop_time() / 1000;
+#ifdef HAVE_EPOLL
+  if ((loop->epfd= epoll_create1(EPOLL_CLOEXEC)) < 0 ||
+      !(loop->events= (struct epoll_event *)
+          malloc(loop->max_events * sizeof(struct epoll_event))))
+  {
+    if (loop->epfd >= 0)
+      close(loop->epfd);
+    free(loop);
+    return NULL;
+  }
+#endif
+  return loop;
+}
+
+int STDCALL mariadb_loop_optionsv(MARIADB_LOOP *loop,
+                                  enum mariadb_loop_option option,
+                                  ...)
+{
+  va_list ap;
+  int rc= 0;
+
+  if (!loop)
+    return 1;
+
+  va_start(ap, option);
+
+  switch (option) {
+  case MARIADB_LOOP_OP_TIMEOUT:
+    loop->op_timeout= va_arg(ap, unsigned int);
+    break;
+  case MARIADB_LOOP_MAX_EVENTS:
+  {
+    unsigned int max_events= va_arg(ap, unsigned int);
+#ifdef HAVE_EPOLL
+    struct epoll_event *events;
+
+    if (!max_events ||
+        !(events= (struct epoll_event *)
+            realloc(loop->events, max_events * sizeof(struct epoll_event))))
+    {
+      rc= 1;
+      break;
+    }
+    loop->events= events;
+#endif
+    loop->max_events= max_events;
+    break;
+  }
+  default:
+    rc= 1;
+    break;
+  }
+  va_end(ap);
+  return rc;
+}
+
+int STDCALL mariadb_loop_add(MARIADB_LOOP *loop, MYSQL *mysql)
+{
+  MA_LOOP_CONN *conn;
+
+  if (!loop || !mysql || !mysql->extension)
+    return 1;
+  if ((conn= mysql->extension->loop_conn))
+    return conn->loop != loop;
+
+  /* setting the option while an operation is active would free its context */
+  if ((!mysql->options.extension || !mysql->options.extension->async_context) &&
+      mysql_options(mysql, MYSQL_OPT_NONBLOCK, 0))
+    return 1;
+
+  if (!(conn= (MA_LOOP_CONN *)calloc(1, sizeof(MA_LOOP_CONN))))
+  {
+    SET_CLIENT_ERROR(mysql, CR_OUT_OF_MEMORY, SQLSTATE_UNKNOWN, 0);
+    return 1;
+  }
+  conn->mysql= mysql;
+  conn->loop= loop;
+  conn->fd= INVALID_SOCKET;
+  conn->io_timer.conn= conn->deadline.conn= conn;
+  conn->next= loop->conns;
+  if (loop->conns)
+    loop->conns->prev= conn;
+  loop->conns= conn;
+  loop->stats.connections++;
+  mysql->extension->loop_conn= conn;
+  return 0;
+}
+
+int STDCALL mariadb_loop_remove(MARIADB_LOOP *loop, MYSQL *mysql)
+{
+  MA_LOOP_CONN *conn;
+
+  if (!loop || !mysql || !mysql->extension ||
+      !(conn= mysql->extension->loop_conn) || conn->loop != loop)
+    return 1;
+  /* operations can't be moved to another loop */
+  if (conn->current || conn->head)
+    return 1;
+
+  ma_loop_disarm(loop, conn);
+  if (conn->prev)
+    conn->prev->next= conn->next;
+  else
+    loop->conns= conn->next;
+  if (conn->next)
+    conn->next->prev= conn->prev;
+  loop->stats.connections--;
+  mysql->extension->loop_conn= NULL;
+  free(conn);
+  return 0;
+}
+
+MARIADB_LOOP_OP * STDCALL mariadb_loop_connect(MARIADB_LOOP *loop, MYSQL *mysql,
+                                               const char *host, const char *user,
+                                               const char *passwd, const char *db,
+                                               unsigned int port,
+                                               const char *unix_socket,
+                                               unsigned long client_flag,
+                                               mariadb_loop_callback callback,
+                                               void *data)
+{
+  MA_LOOP_CONN *conn;
+  MARIADB_LOOP_OP *op;
+  size_t length= 0;
+  char *buf;
+
+  if (!(conn= ma_loop_get_conn(loop, mysql)))
+    return NULL;
+
+  if (host) length+= strlen(host) + 1;
+  if (user) length+= strlen(user) + 1;
+  if (passwd) length+= strlen(passwd) + 1;
+  if (db) length+= strlen(db) + 1;
+  if (unix_socket) length+= strlen(unix_socket) + 1;
+  if (!(op= ma_loop_op_new(length)))
+  {
+    SET_CLIENT_ERROR(mysql, CR_OUT_OF_MEMORY, SQLSTATE_UNKNOWN, 0);
+    return NULL;
+  }
+  buf= (char *)(op + 1);
+  buf= ma_loop_op_str(&op->host, buf, host);
+  buf= ma_loop_op_str(&op->user, buf, user);
+  buf= ma_loop_op_str(&op->passwd, buf, passwd);
+  buf= ma_loop_op_str(&op->db, buf, db);
+  ma_loop_op_str(&op->unix_socket, buf, unix_socket);
+  op->port= port;
+  op->client_flag= client_flag;
+  op->type= MARIADB_LOOP_OP_CONNECT;
+  op->stage= MA_LOOP_STAGE_CONNECT;
+  return ma_loop_submit(loop, conn, op, callback, data);
+}
+
+MARIADB_LOOP_OP * STDCALL mariadb_loop_query(MARIADB_LOOP *loop, MYSQL *mysql,
+                                             const char *query, size_t length,
+                                             mariadb_loop_callback callback,
+                                             void *data)
+{
+  MA_LOOP_CONN *conn;
+  MARIADB_LOOP_OP *op;
+  char *buf;
+
+  if (!query || !(conn= ma_loop_get_conn(loop, mysql)))
+    return NULL;
+  if (length == (size_t)-1)
+    length= strlen(query);
+
+  if (!(op= ma_loop_op_new(length + 1)))
+  {
+    SET_CLIENT_ERROR(mysql, CR_OUT_OF_MEMORY, SQLSTATE_UNKNOWN, 0);
+    return NULL;
+  }
+  buf= (char *)(op + 1);
+  memcpy(buf, query, length);
+  buf[length]= 0;
+  op->query= buf;
+  op->length= (unsigned long)length;
+  op->type= MARIADB_LOOP_OP_QUERY;
+  op->stage= MA_LOOP_STAGE_QUERY;
+  return ma_loop_submit(loop, conn, op, callback, data);
+}
+
+MARIADB_LOOP_OP * STDCALL mariadb_loop_ping(MARIADB_LOOP *loop, MYSQL *mysql,
+                                            mariadb_loop_callback callback,
+                                            void *data)
+{
+  MA_LOOP_CONN *conn;
+  MARIADB_LOOP_OP *op;
+
+  if (!(conn= ma_loop_get_conn(loop, mysql)))
+    return NULL;
+  if (!(op= ma_loop_op_new(0)))
+  {
+    SET_CLIENT_ERROR(mysql, CR_OUT_OF_MEMORY, SQLSTATE_UNKNOWN, 0);
+    return NULL;
+  }
+  op->type= MARIADB_LOOP_OP_PING;
+  op->stage= MA_LOOP_STAGE_PING;
+  return ma_loop_submit(loop, conn, op, callback, data);
+}
+
+/*
+  Waits up to timeout milliseconds (-1 = infinite) for socket events,
+  resumes the connections and fires the expired timers. Returns -1 on
+  error.
+*/
+static int ma_loop_poll(MARIADB_LOOP *loop, int timeout)
+{
+  unsigned long long now;
+  int next, count, i;
+
+  now= ma_loop_time() / 1000;
+  ma_loop_timer_advance(loop, now);
+  next= ma_loop_timer_next(loop, now);
+  if (next >= 0 && (timeout < 0 || next < timeout))
+    timeout= next;
+
+#ifdef HAVE_EPOLL
+  count= epoll_wait(loop->epfd, loop->events, (int)loop->max_events, timeout);
+  loop->stats.wakeups++;
+  if (count < 0 && errno != EINTR)
+    return -1;
+  for (i= 0; i < count; i++)
+  {
+    MA_LOOP_CONN *conn= (MA_LOOP_CONN *)loop->events[i].data.ptr;
+    unsigned int events= loop->events[i].events;
+    int ready= 0;
+
+    if (events & EPOLLIN)
+      ready|= MYSQL_WAIT_READ;
+    if (events & EPOLLOUT)
+      ready|= MYSQL_WAIT_WRITE;
+    if (events & EPOLLPRI)
+      ready|= MYSQL_WAIT_EXCEPT;
+    /* let the library run into the error */
+    if (events & (EPOLLERR | EPOLLHUP))
+      ready|= conn->status & MA_LOOP_WAIT_IO;
+    loop->stats.events++;
+    ma_loop_resume(conn, ready);
+  }
+#else
+  {
+    MA_LOOP_CONN *conn;
+    unsigned int n= 0;
+
+    if (loop->pollsize < loop->stats.connections)
+    {
+      struct pollfd *fds;
+      MA_LOOP_CONN **conns;
+
+      if (!(fds= (struct pollfd *)realloc(loop->pollfds,
+                   loop->stats.connections * sizeof(struct pollfd))))
+        return -1;
+      loop->pollfds= fds;
+      if (!(conns= (MA_LOOP_CONN **)realloc(loop->pollconns,
+                     loop->stats.connections * sizeof(MA_LOOP_CONN *))))
+        return -1;
+      loop->pollconns= conns;
+      loop->pollsize= loop->stats.connections;
+    }
+    for (conn= loop->conns; conn; conn= conn->next)
+    {
+      if (!conn->current || !(conn->status & MA_LOOP_WAIT_IO))
+        continue;
+      loop->pollfds[n].fd= conn->fd;
+      loop->pollfds[n].events= 0;
+      loop->pollfds[n].revents= 0;
+      if (conn->status & MYSQL_WAIT_READ)
+        loop->pollfds[n].events|= POLLIN;
+      if (conn->status & MYSQL_WAIT_WRITE)
+        loop->pollfds[n].events|= POLLOUT;
+      if (conn->status & MYSQL_WAIT_EXCEPT)
+        loop->pollfds[n].events|= POLLPRI;
+      loop->pollconns[n++]= conn;
+    }
+    count= poll(loop->pollfds, n, timeout);
+    loop->stats.wakeups++;
+    if (count < 0 && errno != EINTR)
+      return -1;
+    for (i= 0; count > 0 && i < (int)n; i++)
+    {
+      short revents= loop->pollfds[i].revents;
+      int ready= 0;
+
+      if (!revents)
+        continue;
+      conn= loop->pollconns[i];
+      if (revents & POLLIN)
+        ready|= MYSQL_WAIT_READ;
+      if (revents & POLLOUT)
+        ready|= MYSQL_WAIT_WRITE;
+      if (revents & POLLPRI)
+        ready|= MYSQL_WAIT_EXCEPT;
+      if (revents & (POLLERR | POLLHUP | POLLNVAL))
+        ready|= conn->status & MA_LOOP_WAIT_IO;
+      loop->stats.events++;
+      ma_loop_resume(conn, ready);
+    }
+  }
+#endif
+
+  ma_loop_timer_advance(loop, ma_loop_time() / 1000);
+  ma_loop_fire_timers(loop);
+  return 0;
+}
+
+int STDCALL mariadb_loop_run(MARIADB_LOOP *loop, int timeout_ms)
+{
+  unsigned long long start, completed;
+  my_bool polled= 0;
+
+  if (!loop)
+    return -1;
+
+  start= ma_loop_time();
+  /* operations which completed earlier but whose callback wasn't called yet */
+  completed= loop->stats.completed - loop->done_count;
+  for (;;)
+  {
+    int wait= timeout_ms;
+
+    ma_loop_deliver(loop);
+    if (loop->stats.completed != completed || !loop->stats.in_flight)
+      return (int)(loop->stats.completed - completed);
+    if (timeout_ms >= 0)
+    {
+      unsigned long long elapsed= (ma_loop_time() - start) / 1000;
+
+      if (polled && elapsed >= (unsigned long long)timeout_ms)
+        return 0;
+      wait= elapsed >= (unsigned long long)timeout_ms ?
+            0 : timeout_ms - (int)elapsed;
+    }
+    if (ma_loop_poll(loop, wait))
+      return -1;
+    polled= 1;
+  }
+}
+
+int STDCALL mariadb_loop_wait(MARIADB_LOOP *loop, MARIADB_LOOP_OP *op,
+                              int timeout_ms)
+{
+  unsigned long long start;
+
+  if (!loop || !op || op->loop != loop || op->callback)
+    return -1;
+
+  start= ma_loop_time();
+  while (!op->done)
+  {
+    int wait= -1;
+
+    if (timeout_ms >= 0)
+    {
+      unsigned long long elapsed= (ma_loop_time() - start) / 1000;
+
+      if (elapsed >= (unsigned long long)timeout_ms)
+        return 1;
+      wait= timeout_ms - (int)elapsed;
+    }
+    if (mariadb_loop_run(loop, wait) < 0)
+      return -1;
+  }
+  return 0;
+}
+
+int STDCALL mariadb_loop_get_fd(MARIADB_LOOP *loop)
+{
+#ifdef HAVE_EPOLL
+  return loop ? loop->epfd : -1;
+#else
+  return -1;
+#endif
+}
+
+int STDCALL mariadb_loop_next_timeout(MARIADB_LOOP *loop)
+{
+  unsigned long long now;
+
+  if (!loop)
+    return -1;
+  if (loop->done_head)
+    return 0;
+  now= ma_loop_time() / 1000;
+  ma_loop_timer_advance(loop, now);
+  return ma_loop_timer_next(loop, now);
+}
+
+void STDCALL mariadb_loop_get_stats(MARIADB_LOOP *loop, MARIADB_LOOP_STATS *stats)
+{
+  if (!loop || !stats)
+    return;
+  *stats= loop->stats;
+}
+
+unsigned long long STDCALL mariadb_loop_stats_percentile(const MARIADB_LOOP_STATS *stats,
+                                                         double percentile)
+{
+  unsigned long long target, sum= 0;
+  unsigned int i;
+
+  if (!stats || !stats->completed)
+    return 0;
+  target= (unsigned long long)(stats->completed * percentile / 100.0 + 0.5);
+  if (!target)
+    target= 1;
+  for (i= 0; i < MARIADB_LOOP_LATENCY_BUCKETS - 1; i++)
+  {
+    if ((sum+= stats->latency_histogram[i]) >= target)
+      return MIN(1ULL << i, stats->latency_max);
+  }
+  return stats->latency_max;
+}
+
+void STDCALL mariadb_loop_close(MARIADB_LOOP *loop)
+{
+  MARIADB_LOOP_OP *op;
+
+  if (!loop)
+    return;
+
+  /* pending callbacks are not called */
+  while ((op= loop->done_head))
+  {
+    loop->done_head= op->next;
+    ma_loop_op_release(op);
+  }
+  while (loop->conns)
+  {
+    MA_LOOP_CONN *conn= loop->conns;
+
+    while ((op= ma_loop_next_op(conn)))
+      ma_loop_op_release(op);
+    if ((op= conn->current))
+    {
+      ma_loop_timer_cancel(loop, &conn->io_timer);
+      ma_loop_timer_cancel(loop, &conn->deadline);
+      conn->current= NULL;
+      ma_loop_op_release(op);
+    }
+    mariadb_loop_remove(loop, conn->mysql);
+  }
+#ifdef HAVE_EPOLL
+  close(loop->epfd);
+  free(loop->events);
+#else
+  free(loop->pollfds);
+  free(loop->pollconns);
+#endif
+  free(loop);
+}
+
+my_bool STDCALL mariadb_loop_op_done(MARIADB_LOOP_OP *op)
+{
+  return op ? op->done : 1;
+}
+
+enum mariadb_loop_op_type STDCALL mariadb_loop_op_type(MARIADB_LOOP_OP *op)
+{
+  return op->type;
+}
+
+unsigned int STDCALL mariadb_loop_op_status(MARIADB_LOOP_OP *op)
+{
+  return op ? op->error_no : CR_UNKNOWN_ERROR;
+}
+
+MYSQL * STDCALL mariadb_loop_op_mysql(MARIADB_LOOP_OP *op)
+{
+  return op ? op->mysql : NULL;
+}
+
+/* the caller takes ownership of the result set */
+MYSQL_RES * STDCALL mariadb_loop_op_result(MARIADB_LOOP_OP *op)
+{
+  MYSQL_RES *res;
+
+  if (!op || !op->done)
+    return NULL;
+  res= op->result;
+  op->result= NULL;
+  return res;
+}
+
+unsigned long long STDCALL mariadb_loop_op_latency(MARIADB_LOOP_OP *op)
+{
+  return op ? op->latency : 0;
+}
+
+void STDCALL mariadb_loop_op_free(MARIADB_LOOP_OP *op)
+{
+  /* operations with a callback are freed by the loop */
+  if (!op || op->callback)
+    return;
+  if (op->done)
+    ma_loop_op_release(op);
+  else
+    op->free_on_done= 1;
+}
@@ -0,0 +1,730 @@
+/************************************************************************************
+   Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not see <http://www.gnu.org/licenses>
+   or write to the Free Software Foundation, Inc.,
+   51 Franklin St., Fifth Floor, Boston, MA 02110, USA
+*************************************************************************************/
+
+/*
+  Connection pool
+
+  Idle connections are kept in MA_POOL_SHARDS lists, each protected by its
+  own mutex. A thread releases connections into and acquires connections
+  from its "home" shard first, so threads running on different cores
+  usually don't touch the same lock or cache line. Every list is used as a
+  stack: the most recently released connection is handed out first, which
+  keeps a hot set of connections busy and lets the others age at the tail
+  of the list until they are evicted.
+
+  The pool mutex only protects the number of open connections, the
+  statistics and the wait queue. It is taken when a connection is opened
+  or closed, or if a thread has to wait for a free connection. Connecting,
+  probing and resetting connections is always done without holding any
+  lock.
+
+  Lock order is pool->lock before shard->lock.
+*/
+
+#include <ma_global.h>
+#include <ma_sys.h>
+#include <ma_string.h>
+#include <ma_pthread.h>
+#include <mysql.h>
+#include <errmsg.h>
+#include <ma_common.h>
+#include <ma_pvio.h>
+#include <mariadb_pool.h>
+#include <stdarg.h>
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+extern int STDCALL mysql_reset_connection(MYSQL *mysql);
+
+#define MA_POOL_SHARDS 8
+
+#define MA_POOL_DEFAULT_MAX_SIZE      8
+#define MA_POOL_DEFAULT_IDLE_TIMEOUT  300     /* seconds */
+#define MA_POOL_DEFAULT_WAIT_TIMEOUT  10000   /* milliseconds */
+#define MA_POOL_DEFAULT_PING_INTERVAL 5000    /* milliseconds */
+
+typedef struct st_ma_pool_conn {
+  MYSQL *mysql;
+  MARIADB_POOL *pool;
+  unsigned long long idle_since;   /* microseconds */
+  unsigned long long acquired_at;
+  struct st_ma_pool_conn *prev, *next;
+} MA_POOL_CONN;
+
+typedef struct st_ma_pool_shard {
+  pthread_mutex_t lock;
+  MA_POOL_CONN *head;              /* most recently released */
+  MA_POOL_CONN *tail;              /* longest idle */
+  unsigned int idle;
+  unsigned long long acquired;
+  unsigned long long busy_time;
+  char pad[64];                    /* keep shards in different cache lines */
+} MA_POOL_SHARD;
+
+struct st_mariadb_pool {
+  MA_POOL_SHARD shards[MA_POOL_SHARDS];
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  unsigned int size;               /* open connections, including reserved slots */
+  unsigned int waiters;
+  my_bool open;
+  /* options */
+  unsigned int min_size;
+  unsigned int max_size;
+  unsigned int idle_timeout;
+  unsigned int wait_timeout;
+  unsigned int ping_interval;
+  my_bool reset;
+  mariadb_pool_init_callback init_callback;
+  void *init_data;
+  /* connection parameters */
+  char *host, *user, *passwd, *db, *unix_socket;
+  unsigned int port;
+  unsigned long client_flag;
+  /* statistics, protected by lock */
+  unsigned long long opened_at;
+  unsigned long long acquired;
+  unsigned long long created;
+  unsigned long long closed;
+  unsigned long long broken;
+  unsigned long long evicted;
+  unsigned long long waits;
+  unsigned long long timeouts;
+  unsigned long long wait_time;
+  unsigned long long max_wait_time;
+  unsigned long long busy_time;
+  /* last error */
+  unsigned int error_no;
+  char error_msg[MYSQL_ERRMSG_SIZE];
+};
+
+static unsigned long long ma_pool_time(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER count, freq;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&freq);
+  return (unsigned long long)(count.QuadPart * 1000000 / freq.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/* pool->lock must be held */
+static void ma_pool_set_error(MARIADB_POOL *pool, unsigned int error_nr,
+                              const char *format, ...)
+{
+  va_list ap;
+
+  pool->error_no= error_nr;
+  va_start(ap, format);
+  vsnprintf(pool->error_msg, MYSQL_ERRMSG_SIZE - 1,
+            format ? format : ER(error_nr), ap);
+  va_end(ap);
+}
+
+/*
+  Threads run on different stacks, so hashing the address of a local
+  variable spreads them over the shards without asking the OS for a
+  thread id.
+*/
+static unsigned int ma_pool_home_shard(void)
+{
+  char c;
+  unsigned long long addr= (unsigned long long)(size_t)&c >> 12;
+
+  return (unsigned int)((addr * 0x9E3779B97F4A7C15ULL) >> 61) % MA_POOL_SHARDS;
+}
+
+/* shard->lock must be held */
+static void ma_pool_push(MA_POOL_SHARD *shard, MA_POOL_CONN *conn)
+{
+  conn->prev= NULL;
+  conn->next= shard->head;
+  if (shard->head)
+    shard->head->prev= conn;
+  else
+    shard->tail= conn;
+  shard->head= conn;
+  shard->idle++;
+}
+
+/* shard->lock must be held */
+static void ma_pool_unlink(MA_POOL_SHARD *shard, MA_POOL_CONN *conn)
+{
+  if (conn->prev)
+    conn->prev->next= conn->next;
+  else
+    shard->head= conn->next;
+  if (conn->next)
+    conn->next->prev= conn->prev;
+  else
+    shard->tail= conn->prev;
+  conn->prev= conn->next= NULL;
+  shard->idle--;
+}
+
+/*
+  Takes an idle connection, starting with the home shard. The shard it
+  was taken from is returned in *from.
+*/
+static MA_POOL_CONN *ma_pool_get_idle(MARIADB_POOL *pool, unsigned int home,
+                                      MA_POOL_SHARD **from)
+{
+  unsigned int i;
+
+  for (i= 0; i < MA_POOL_SHARDS; i++)
+  {
+    MA_POOL_SHARD *shard= &pool->shards[(home + i) % MA_POOL_SHARDS];
+    MA_POOL_CONN *conn;
+
+    pthread_mutex_lock(&shard->lock);
+    if ((conn= shard->head))
+      ma_pool_unlink(shard, conn);
+    pthread_mutex_unlock(&shard->lock);
+    if (conn)
+    {
+      *from= shard;
+      return conn;
+    }
+  }
+  return NULL;
+}
+
+static MA_POOL_CONN *ma_pool_connect(MARIADB_POOL *pool)
+{
+  MA_POOL_CONN *conn;
+  MYSQL *mysql= NULL;
+
+  if (!(conn= (MA_POOL_CONN *)calloc(1, sizeof(MA_POOL_CONN))) ||
+      !(mysql= mysql_init(NULL)))
+  {
+    free(conn);
+    pthread_mutex_lock(&pool->lock);
+    ma_pool_set_error(pool, CR_OUT_OF_MEMORY, 0);
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+  }
+
+  if ((pool->init_callback && pool->init_callback(mysql, pool->init_data)) ||
+      !mysql_real_connect(mysql, pool->host, pool->user, pool->passwd,
+                          pool->db, pool->port, pool->unix_socket,
+                          pool->client_flag))
+  {
+    pthread_mutex_lock(&pool->lock);
+    if (mysql_errno(mysql))
+      ma_pool_set_error(pool, mysql_errno(mysql), "%s", mysql_error(mysql));
+    else
+      ma_pool_set_error(pool, CR_UNKNOWN_ERROR, 0);
+    pthread_mutex_unlock(&pool->lock);
+    mysql_close(mysql);
+    free(conn);
+    return NULL;
+  }
+
+  conn->mysql= mysql;
+  conn->pool= pool;
+  mysql->extension->pool_conn= conn;
+  return conn;
+}
+
+/* closes the idle connections of all shards, returns their number */
+static unsigned int ma_pool_close_idle(MARIADB_POOL *pool)
+{
+  unsigned int i, count= 0;
+
+  for (i= 0; i < MA_POOL_SHARDS; i++)
+  {
+    MA_POOL_SHARD *shard= &pool->shards[i];
+    MA_POOL_CONN *conn;
+
+    pthread_mutex_lock(&shard->lock);
+    while ((conn= shard->head))
+    {
+      ma_pool_unlink(shard, conn);
+      mysql_close(conn->mysql);
+      free(conn);
+      count++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+  }
+  return count;
+}
+
+static void ma_pool_free_params(MARIADB_POOL *pool)
+{
+  free(pool->host);
+  free(pool->user);
+  free(pool->passwd);
+  free(pool->db);
+  free(pool->unix_socket);
+  pool->host= pool->user= pool->passwd= pool->db= pool->unix_socket= NULL;
+}
+
+/* closes a connection which isn't in any shard and releases its slot */
+static void ma_pool_discard(MARIADB_POOL *pool, MA_POOL_CONN *conn,
+                            unsigned long long busy_time)
+{
+  mysql_close(conn->mysql);
+  free(conn);
+
+  pthread_mutex_lock(&pool->lock);
+  pool->size--;
+  pool->closed++;
+  pool->broken++;
+  pool->busy_time+= busy_time;
+  if (pool->waiters)
+    pthread_cond_signal(&pool->cond);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+  Checks if an idle connection can be handed out. A closed socket is
+  detected locally by the pvio plugin. Connections which were idle for
+  more than ping_interval are also checked with a COM_PING round trip,
+  since the server might have dropped them in the meantime.
+*/
+static my_bool ma_pool_is_alive(MARIADB_POOL *pool, MA_POOL_CONN *conn,
+                                unsigned long long now)
+{
+  if (!ma_pvio_is_alive(conn->mysql->net.pvio))
+    return 0;
+  if (pool->ping_interval &&
+      conn->idle_since + (unsigned long long)pool->ping_interval * 1000 <= now)
+    return mysql_ping(conn->mysql) == 0;
+  return 1;
+}
+
+/*
+  Probes a connection taken from a shard. A live connection is counted
+  as acquired in its shard, a dead one is closed.
+*/
+static my_bool ma_pool_check_idle(MARIADB_POOL *pool, MA_POOL_SHARD *shard,
+                                  MA_POOL_CONN *conn, unsigned long long now)
+{
+  if (!ma_pool_is_alive(pool, conn, now))
+  {
+    ma_pool_discard(pool, conn, 0);
+    return 0;
+  }
+  pthread_mutex_lock(&shard->lock);
+  shard->acquired++;
+  pthread_mutex_unlock(&shard->lock);
+  return 1;
+}
+
+/* pool->lock must be held */
+static void ma_pool_add_wait(MARIADB_POOL *pool, unsigned long long start)
+{
+  unsigned long long wait;
+
+  if (!start)
+    return;
+  wait= ma_pool_time() - start;
+  pool->wait_time+= wait;
+  if (wait > pool->max_wait_time)
+    pool->max_wait_time= wait;
+}
+
+/* pool->lock must be held */
+static void ma_pool_wait(MARIADB_POOL *pool, unsigned long long remaining)
+{
+#ifdef _WIN32
+  SleepConditionVariableCS(&pool->cond, &pool->lock,
+                           (DWORD)((remaining + 999) / 1000));
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  remaining+= (unsigned long long)ts.tv_nsec / 1000;
+  ts.tv_sec+= (time_t)(remaining / 1000000);
+  ts.tv_nsec= (long)(remaining % 1000000) * 1000;
+  pthread_cond_timedwait(&pool->cond, &pool->lock, &ts);
+#endif
+}
+
+MARIADB_POOL * STDCALL mariadb_pool_init(void)
+{
+  MARIADB_POOL *pool;
+  unsigned int i;
+
+  if (!(pool= (MARIADB_POOL *)calloc(1, sizeof(MARIADB_POOL))))
+    return NULL;
+
+  for (i= 0; i < MA_POOL_SHARDS; i++)
+    pthread_mutex_init(&pool->shards[i].lock, NULL);
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->cond, NULL);
+
+  pool->max_size= MA_POOL_DEFAULT_MAX_SIZE;
+  pool->idle_timeout= MA_POOL_DEFAULT_IDLE_TIMEOUT;
+  pool->wait_timeout= MA_POOL_DEFAULT_WAIT_TIMEOUT;
+  pool->ping_interval= MA_POOL_DEFAULT_PING_INTERVAL;
+  pool->reset= 1;
+  return pool;
+}
+
+int STDCALL mariadb_pool_optionsv(MARIADB_POOL *pool,
+                                  enum mariadb_pool_option option,
+                                  ...)
+{
+  va_list ap;
+  int rc= 0;
+
+  /* options can't be changed while the pool is in use */
+  if (!pool || pool->open)
+    return 1;
+
+  va_start(ap, option);
+
+  switch (option) {
+  case MARIADB_POOL_MIN_SIZE:
+    pool->min_size= va_arg(ap, unsigned int);
+    break;
+  case MARIADB_POOL_MAX_SIZE:
+    pool->max_size= va_arg(ap, unsigned int);
+    break;
+  case MARIADB_POOL_IDLE_TIMEOUT:
+    pool->idle_timeout= va_arg(ap, unsigned int);
+    break;
+  case MARIADB_POOL_WAIT_TIMEOUT:
+    pool->wait_timeout= va_arg(ap, unsigned int);
+    break;
+  case MARIADB_POOL_PING_INTERVAL:
+    pool->ping_interval= va_arg(ap, unsigned int);
+    break;
+  case MARIADB_POOL_RESET:
+    pool->reset= (my_bool)va_arg(ap, int);
+    break;
+  case MARIADB_POOL_INIT_CALLBACK:
+    pool->init_callback= va_arg(ap, mariadb_pool_init_callback);
+    pool->init_data= va_arg(ap, void *);
+    break;
+  default:
+    rc= 1;
+    break;
+  }
+  va_end(ap);
+  return rc;
+}
+
+int STDCALL mariadb_pool_open(MARIADB_POOL *pool, const char *host,
+                              const char *user, const char *passwd,
+                              const char *db, unsigned int port,
+                              const char *unix_socket,
+                              unsigned long client_flag)
+{
+  unsigned int i;
+
+  if (!pool || pool->open)
+    return 1;
+
+  if (!pool->max_size || pool->min_size > pool->max_size)
+  {
+    ma_pool_set_error(pool, CR_INVALID_PARAMETER, 0, "MARIADB_POOL_MAX_SIZE");
+    return 1;
+  }
+
+  if ((host && !(pool->host= strdup(host))) ||
+      (user && !(pool->user= strdup(user))) ||
+      (passwd && !(pool->passwd= strdup(passwd))) ||
+      (db && !(pool->db= strdup(db))) ||
+      (unix_socket && !(pool->unix_socket= strdup(unix_socket))))
+  {
+    ma_pool_free_params(pool);
+    ma_pool_set_error(pool, CR_OUT_OF_MEMORY, 0);
+    return 1;
+  }
+  pool->port= port;
+  pool->client_flag= client_flag;
+
+  for (i= 0; i < pool->min_size; i++)
+  {
+    MA_POOL_SHARD *shard= &pool->shards[i % MA_POOL_SHARDS];
+    MA_POOL_CONN *conn;
+
+    if (!(conn= ma_pool_connect(pool)))
+    {
+      /* the pool stays closed and can be opened again */
+      pool->closed+= ma_pool_close_idle(pool);
+      pool->size= 0;
+      ma_pool_free_params(pool);
+      return 1;
+    }
+    conn->idle_since= ma_pool_time();
+    pthread_mutex_lock(&pool->lock);
+    pool->size++;
+    pool->created++;
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_lock(&shard->lock);
+    ma_pool_push(shard, conn);
+    pthread_mutex_unlock(&shard->lock);
+  }
+  pool->opened_at= ma_pool_time();
+  pool->open= 1;
+  return 0;
+}
+
+MYSQL * STDCALL mariadb_pool_acquire(MARIADB_POOL *pool)
+{
+  MA_POOL_CONN *conn;
+  MA_POOL_SHARD *shard;
+  unsigned int home;
+  unsigned long long start= 0, now;
+
+  if (!pool || !pool->open)
+    return NULL;
+
+  home= ma_pool_home_shard();
+
+  for (;;)
+  {
+    if ((conn= ma_pool_get_idle(pool, home, &shard)))
+    {
+      now= ma_pool_time();
+      if (ma_pool_check_idle(pool, shard, conn, now))
+        break;
+      continue;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->size < pool->max_size)
+    {
+      /* reserve a slot and connect without holding the lock */
+      pool->size++;
+      pthread_mutex_unlock(&pool->lock);
+
+      conn= ma_pool_connect(pool);
+
+      pthread_mutex_lock(&pool->lock);
+      if (!conn)
+      {
+        pool->size--;
+        if (pool->waiters)
+          pthread_cond_signal(&pool->cond);
+        ma_pool_add_wait(pool, start);
+        pthread_mutex_unlock(&pool->lock);
+        return NULL;
+      }
+      pool->created++;
+      pool->acquired++;
+      pthread_mutex_unlock(&pool->lock);
+      now= ma_pool_time();
+      break;
+    }
+
+    /* the pool is exhausted: wait for a release */
+    now= ma_pool_time();
+    if (!start)
+    {
+      start= now;
+      pool->waits++;
+    }
+    if (now - start >= (unsigned long long)pool->wait_timeout * 1000)
+    {
+      pool->timeouts++;
+      ma_pool_add_wait(pool, start);
+      ma_pool_set_error(pool, CR_POOL_TIMEOUT, 0, pool->max_size);
+      pthread_mutex_unlock(&pool->lock);
+      return NULL;
+    }
+
+    /*
+      Check the shards again while holding pool->lock: a connection
+      released after our first check either shows up here, or its
+      release sees waiters > 0 and signals us.
+    */
+    pool->waiters++;
+    if (!(conn= ma_pool_get_idle(pool, home, &shard)))
+      ma_pool_wait(pool, (unsigned long long)pool->wait_timeout * 1000 - (now - start));
+    pool->waiters--;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (conn)
+    {
+      now= ma_pool_time();
+      if (ma_pool_check_idle(pool, shard, conn, now))
+        break;
+    }
+  }
+
+  if (start)
+  {
+    pthread_mutex_lock(&pool->lock);
+    ma_pool_add_wait(pool, start);
+    pthread_mutex_unlock(&pool->lock);
+  }
+  conn->acquired_at= now;
+  return conn->mysql;
+}
+
+void STDCALL mariadb_pool_release(MARIADB_POOL *pool, MYSQL *mysql)
+{
+  MA_POOL_CONN *conn;
+  MA_POOL_SHARD *shard;
+  unsigned long long now;
+  my_bool expired;
+
+  if (!pool || !mysql || !mysql->extension ||
+      !(conn= mysql->extension->pool_conn) || conn->pool != pool)
+    return;
+
+  /* a connection which can't be reset cleanly is not reused */
+  if (!mysql->net.pvio || mysql->extension->pipeline.active ||
+      (pool->reset && mysql_reset_connection(mysql)))
+  {
+    ma_pool_discard(pool, conn, ma_pool_time() - conn->acquired_at);
+    return;
+  }
+
+  now= ma_pool_time();
+  conn->idle_since= now;
+  shard= &pool->shards[ma_pool_home_shard()];
+
+  pthread_mutex_lock(&shard->lock);
+  shard->busy_time+= now - conn->acquired_at;
+  ma_pool_push(shard, conn);
+  expired= pool->idle_timeout &&
+           shard->tail->idle_since + (unsigned long long)pool->idle_timeout * 1000000 <= now;
+  pthread_mutex_unlock(&shard->lock);
+
+  if (pool->waiters || expired)
+  {
+    pthread_mutex_lock(&pool->lock);
+    if (pool->waiters)
+      pthread_cond_signal(&pool->cond);
+    /* connections above min_size are closed when they expire */
+    expired= expired && pool->size > pool->min_size;
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  if (expired)
+    mariadb_pool_evict(pool);
+}
+
+unsigned int STDCALL mariadb_pool_evict(MARIADB_POOL *pool)
+{
+  MA_POOL_CONN *list= NULL, *conn;
+  unsigned long long now, timeout;
+  unsigned int i, count= 0;
+
+  if (!pool || !pool->idle_timeout)
+    return 0;
+
+  now= ma_pool_time();
+  timeout= (unsigned long long)pool->idle_timeout * 1000000;
+
+  pthread_mutex_lock(&pool->lock);
+  for (i= 0; i < MA_POOL_SHARDS && pool->size > pool->min_size; i++)
+  {
+    MA_POOL_SHARD *shard= &pool->shards[i];
+
+    pthread_mutex_lock(&shard->lock);
+    while ((conn= shard->tail) && conn->idle_since + timeout <= now &&
+           pool->size > pool->min_size)
+    {
+      ma_pool_unlink(shard, conn);
+      conn->next= list;
+      list= conn;
+      pool->size--;
+      count++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+  }
+  pool->closed+= count;
+  pool->evicted+= count;
+  if (count && pool->waiters)
+    pthread_cond_broadcast(&pool->cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  while ((conn= list))
+  {
+    list= conn->next;
+    mysql_close(conn->mysql);
+    free(conn);
+  }
+  return count;
+}
+
+void STDCALL mariadb_pool_get_stats(MARIADB_POOL *pool, MARIADB_POOL_STATS *stats)
+{
+  unsigned int i;
+
+  if (!pool || !stats)
+    return;
+
+  memset(stats, 0, sizeof(MARIADB_POOL_STATS));
+  pthread_mutex_lock(&pool->lock);
+  for (i= 0; i < MA_POOL_SHARDS; i++)
+  {
+    MA_POOL_SHARD *shard= &pool->shards[i];
+
+    pthread_mutex_lock(&shard->lock);
+    stats->idle+= shard->idle;
+    stats->acquired+= shard->acquired;
+    stats->busy_time+= shard->busy_time;
+    pthread_mutex_unlock(&shard->lock);
+  }
+  stats->size= pool->size;
+  stats->in_use= pool->size > stats->idle ? pool->size - stats->idle : 0;
+  stats->max_size= pool->max_size;
+  stats->acquired+= pool->acquired;
+  stats->created= pool->created;
+  stats->closed= pool->closed;
+  stats->broken= pool->broken;
+  stats->evicted= pool->evicted;
+  stats->waits= pool->waits;
+  stats->timeouts= pool->timeouts;
+  stats->wait_time= pool->wait_time;
+  stats->max_wait_time= pool->max_wait_time;
+  stats->busy_time+= pool->busy_time;
+  if (pool->open)
+    stats->lifetime= ma_pool_time() - pool->opened_at;
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/* all connections must have been released before */
+void STDCALL mariadb_pool_close(MARIADB_POOL *pool)
+{
+  unsigned int i;
+
+  if (!pool)
+    return;
+
+  ma_pool_close_idle(pool);
+  for (i= 0; i < MA_POOL_SHARDS; i++)
+    pthread_mutex_destroy(&pool->shards[i].lock);
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->cond);
+  ma_pool_free_params(pool);
+  free(pool);
+}
+
+const char * STDCALL mariadb_pool_error(MARIADB_POOL *pool)
+{
+  return pool ? pool->error_msg : "";
+}
+
+unsigned int STDCALL mariadb_pool_errno(MARIADB_POOL *pool)
+{
+  return pool ? pool->error_no : 0;
+}
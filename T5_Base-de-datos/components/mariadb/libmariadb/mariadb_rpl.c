@@ -21,6 +21,8 @@
 #include <ma_global.h>
 #include <ma_sys.h>
 #include <ma_common.h>
+#include <ma_pthread.h>
+#include <ma_pvio.h>
 #include <mysql.h>
 #include <errmsg.h>
 #include <stdlib.h>
@@ -29,6 +31,7 @@
 #include <zlib.h>
 #include <ma_decimal.h>
 #include <mariadb_rpl.h>
+#include <ma_simd.h>
 
 
 #ifdef WIN32
@@ -38,6 +41,14 @@
 #endif
 
 #define RPL_EVENT_HEADER_SIZE 19
+#define RPL_DEFAULT_QUEUE_SIZE 64
+/* events up to this size keep their memory root blocks when reused */
+#define RPL_RECYCLE_SIZE (64 * 1024)
+/* size of new packet buffers, larger ones are freed when the event is reused */
+#define RPL_PACKET_BUFFER_SIZE 16384
+#define RPL_PACKET_BUFFER_MAX (1024 * 1024)
+/* released table maps kept for the next statement */
+#define RPL_TABLE_CACHE_SIZE 16
 #define RPL_ERR_POS(r) (r)->filename_length, (r)->filename, (r)->start_position
 #define RPL_CHECK_NULL_POS(position, end)\
 {\
@@ -292,6 +303,7 @@ static uint8_t rpl_metadata_size(enum enum_field_types field_type)
     case MYSQL_TYPE_TINY_BLOB:
     case MYSQL_TYPE_MEDIUM_BLOB:
     case MYSQL_TYPE_LONG_BLOB:
+    case MYSQL_TYPE_GEOMETRY:
       return 1;
     case MYSQL_TYPE_STRING:
     case MYSQL_TYPE_ENUM:
@@ -330,13 +342,320 @@ static uint8_t ma_rpl_get_second_part(MYSQL_TIME *tm, uchar *ptr, uchar *metadat
   }
 }
 
-MARIADB_RPL_ROW * STDCALL
-mariadb_rpl_extract_rows(MARIADB_RPL *rpl,
-                         MARIADB_RPL_EVENT *tm_event,
-                         MARIADB_RPL_EVENT *row_event)
+/* enum and set columns are stored as MYSQL_TYPE_STRING, the first
+   metadata byte contains the real type */
+static enum enum_field_types rpl_column_type(uchar type, const uchar *metadata)
+{
+  if (type == MYSQL_TYPE_STRING &&
+      (metadata[0] == MYSQL_TYPE_ENUM || metadata[0] == MYSQL_TYPE_SET))
+    return (enum enum_field_types)metadata[0];
+  return (enum enum_field_types)type;
+}
+
+/* type reported in MARIADB_RPL_VALUE if the value is not NULL */
+static enum enum_field_types rpl_value_type(enum enum_field_types type,
+                                            const uchar *metadata)
+{
+  switch (type) {
+    case MYSQL_TYPE_BLOB:
+      switch (metadata[0]) {
+        case 1:
+          return MYSQL_TYPE_TINY_BLOB;
+        case 3:
+          return MYSQL_TYPE_MEDIUM_BLOB;
+        case 4:
+          return MYSQL_TYPE_LONG_BLOB;
+        default:
+          return type;
+      }
+    case MYSQL_TYPE_TIME2:
+      return MYSQL_TYPE_TIME;
+    case MYSQL_TYPE_DATETIME2:
+      return MYSQL_TYPE_DATETIME;
+    default:
+      return type;
+  }
+}
+
+#define RPL_VALUE_ERROR ((size_t)-1)
+
+/*
+  Returns the length of the value at pos. If column is not NULL, the value
+  is decoded into column and RPL_VALUE_ERROR is returned if memory
+  allocation failed. String values point into the row data of the event,
+  only converted values (decimals, timestamps) are allocated.
+*/
+static size_t rpl_decode_value(MARIADB_RPL_EVENT *event,
+                               MARIADB_RPL_VALUE *column,
+                               enum enum_field_types type,
+                               uchar *pos, uchar *metadata)
 {
-  uchar *start, *pos, *end;
+  MARIADB_RPL_VALUE scratch;
+  my_bool decode= column != NULL;
+
+  /* fixed size values are cheap, they are decoded into scratch */
+  if (!decode)
+    column= &scratch;
+  column->field_type= rpl_value_type(type, metadata);
+
+  switch (type) {
+    case MYSQL_TYPE_TINY:
+      column->val.ll= sint1korr(pos);
+      column->val.ull= uint1korr(pos);
+      return 1;
+    case MYSQL_TYPE_YEAR:
+      column->val.ull= uint1korr(pos) + 1900;
+      return 1;
+    case MYSQL_TYPE_SHORT:
+      column->val.ll= sint2korr(pos);
+      column->val.ull= uint2korr(pos);
+      return 2;
+    case MYSQL_TYPE_INT24:
+      column->val.ll= sint3korr(pos);
+      column->val.ull= uint3korr(pos);
+      return 3;
+    case MYSQL_TYPE_LONG:
+      column->val.ll= sint4korr(pos);
+      column->val.ull= uint4korr(pos);
+      return 4;
+    case MYSQL_TYPE_LONGLONG:
+      column->val.ll= sint8korr(pos);
+      column->val.ull= uint8korr(pos);
+      return 8;
+    case MYSQL_TYPE_NEWDECIMAL:
+    {
+      uint8_t precision= metadata[0];
+      uint8_t scale= metadata[1];
+      uint32_t bin_size= decimal_bin_size(precision, scale);
+
+      if (decode)
+      {
+        decimal dec;
+        char str[200];
+        char buf[100];
+        int s_len= sizeof(str) - 1;
+
+        dec.buf= (void *)buf;
+        dec.len= sizeof(buf) / sizeof(decimal_digit);
+
+        bin2decimal((char *)pos, &dec, precision, scale);
+        decimal2string(&dec, str, &s_len);
+
+        if (rpl_alloc_set_string_and_len(event, &column->val.str, str, s_len))
+          return RPL_VALUE_ERROR;
+      }
+      return bin_size;
+    }
+    case MYSQL_TYPE_FLOAT:
+    case MYSQL_TYPE_DOUBLE:
+    {
+      uint8_t flen= metadata[0];
+      if (flen == 4)
+      {
+        float4get(column->val.f, pos);
+      }
+      if (flen == 8)
+      {
+        float8get(column->val.d, pos);
+      }
+      return flen;
+    }
+    case MYSQL_TYPE_BIT:
+    {
+      uint8_t num_bits= (metadata[0] & 0xFF) + metadata[1] * 8;
+      uint8_t b_len= (num_bits + 7) / 8;
+      if (decode)
+        rpl_set_string_and_len(&column->val.str, pos, b_len);
+      return b_len;
+    }
+    case MYSQL_TYPE_TIMESTAMP:
+      column->val.ull= uint4korr(pos);
+      return 4;
+    case MYSQL_TYPE_TIMESTAMP2:
+    {
+      uint8_t f_len= metadata[0];
+      if (decode)
+      {
+        char tmp[20];
+        uint32_t p1= uint4korr(pos);
+        uint32_t p2= (uint32_t)uintNkorr(f_len, pos + 4);
+        sprintf(tmp, "%d.%d", p1, p2);
+        if (rpl_alloc_set_string_and_len(event, &column->val.str, tmp, strlen(tmp)))
+          return RPL_VALUE_ERROR;
+      }
+      return 4 + f_len;
+    }
+    case MYSQL_TYPE_DATE:
+    {
+      MYSQL_TIME *tm= &column->val.tm;
+      uint32_t d_val= uint3korr(pos);
+      tm->year= (int)(d_val / (16 * 32));
+      tm->month= (int)(d_val / 32 % 16);
+      tm->day= d_val % 32;
+      tm->time_type= MYSQL_TIMESTAMP_DATE;
+      return 3;
+    }
+    case MYSQL_TYPE_TIME2:
+    {
+      MYSQL_TIME *tm= &column->val.tm;
+      int64_t t_val= myisam_uint3korr(pos) - 0x800000LL;
+
+      if ((tm->neg = t_val < 0))
+        t_val= -t_val;
+
+      tm->hour= (t_val >> 12) % (1 << 10);
+      tm->minute= (t_val >> 6) % (1 << 6);
+      tm->second= t_val % (1 << 6);
+      tm->time_type= MYSQL_TIMESTAMP_TIME;
+      return 3 + ma_rpl_get_second_part(tm, pos + 3, metadata);
+    }
+    case MYSQL_TYPE_DATETIME2:
+    {
+      MYSQL_TIME *tm= &column->val.tm;
+      uint64_t dt_val= mi_uint5korr(pos) - 0x8000000000LL,
+               date_part, time_part;
+
+      date_part= dt_val >> 17;
+      time_part= dt_val % (1 << 17);
+
+      tm->day= (unsigned int)date_part % (1 << 5);
+      tm->month= (unsigned int)(date_part >> 5) % 13;
+      tm->year= (unsigned int)(date_part >> 5) / 13;
+
+      tm->second= time_part % (1 << 6);
+      tm->minute= (time_part >> 6) % (1 << 6);
+      tm->hour= (uint32_t)(time_part >> 12);
+
+      tm->time_type= MYSQL_TIMESTAMP_DATETIME;
+      return 5 + ma_rpl_get_second_part(tm, pos + 5, metadata);
+    }
+    case MYSQL_TYPE_STRING:
+    {
+      uint8_t s_len= metadata[2];
+      if (decode)
+        rpl_set_string_and_len(&column->val.str, pos, s_len);
+      return s_len;
+    }
+    case MYSQL_TYPE_ENUM:
+    case MYSQL_TYPE_SET:
+    {
+      uint8_t e_len= metadata[2];
+      column->val.ull= uintNkorr(e_len, pos);
+      return e_len;
+    }
+    case MYSQL_TYPE_TINY_BLOB:
+    case MYSQL_TYPE_MEDIUM_BLOB:
+    case MYSQL_TYPE_LONG_BLOB:
+    case MYSQL_TYPE_BLOB:
+    case MYSQL_TYPE_GEOMETRY:
+    {
+      uint8_t h_len= metadata[0];
+      uint64_t b_len= uintNkorr(h_len, pos);
+      if (decode)
+        rpl_set_string_and_len(&column->val.str, pos + h_len, (size_t)b_len);
+      return h_len + (size_t)b_len;
+    }
+    case MYSQL_TYPE_VARCHAR:
+    case MYSQL_TYPE_VAR_STRING:
+    {
+      uint32_t s_len= uint2korr(metadata);
+      uint8_t byte_len= rpl_byte_size(s_len);
+      s_len= (uint32_t)uintNkorr(byte_len, pos);
+      if (decode)
+        rpl_set_string_and_len(&column->val.str, pos + byte_len, s_len);
+      return byte_len + s_len;
+    }
+    case MYSQL_TYPE_TIME:
+    {
+      MYSQL_TIME *tm= &column->val.tm;
+      uint64_t t= uint8korr(pos);
+      tm->hour= (unsigned int)(t/100)/100;
+      tm->minute= (unsigned int)(t/100) % 100;
+      tm->second= (unsigned int)t % 100;
+      tm->time_type= MYSQL_TIMESTAMP_TIME;
+      return 8;
+    }
+    case MYSQL_TYPE_DATETIME:
+    {
+      MYSQL_TIME *tm= &column->val.tm;
+      uint64_t t= uint8korr(pos);
+      uint32_t d_val= (uint32_t)t / 1000000,
+               t_val= (uint32_t)t % 1000000;
+      tm->year= (unsigned int)(d_val / 100) / 100;
+      tm->month= (unsigned int)(d_val / 100) % 100;
+      tm->day= (unsigned int)d_val % 100;
+      tm->hour= (t_val/100)/100;
+      tm->minute= (t_val/100) % 100;
+      tm->second= t_val % 100;
+      tm->time_type= MYSQL_TIMESTAMP_DATETIME;
+      return 8;
+    }
+    default:
+      return 0;
+  }
+}
+
+/*
+  Rows which are decoded on access (MARIADB_RPL_LAZY_VALUES) only store
+  the offsets of the values. The table map may be freed before the values
+  are accessed, so column types and metadata are copied into the memroot
+  of the row event, metadata offsets don't depend on the row.
+*/
+typedef struct {
+  uchar *column_types;
+  uchar *metadata;
+  uint32_t *metadata_ofs;
+} MA_RPL_ROW_FORMAT;
+
+struct st_ma_rpl_lazy_row {
+  MA_RPL_ROW_FORMAT *format;
+  uchar *data;        /* null bitmap of the row, followed by the values */
+  uint32_t *offsets;  /* offsets of the values relative to data */
+  uchar *decoded;     /* bitmap of decoded values */
+};
+
+static MA_RPL_ROW_FORMAT *rpl_row_format_create(MARIADB_RPL_EVENT *event,
+                                                MARIADB_RPL_EVENT *tm_event)
+{
+  struct st_mariadb_rpl_table_map_event *map= &tm_event->event.table_map;
+  MA_RPL_ROW_FORMAT *format;
+  MARIADB_STRING types, metadata;
+  uint32_t i, ofs= 0;
+
+  memset(&types, 0, sizeof(types));
+  memset(&metadata, 0, sizeof(metadata));
+  if (!(format= (MA_RPL_ROW_FORMAT *)ma_alloc_root(&event->memroot, sizeof(MA_RPL_ROW_FORMAT))) ||
+      !(format->metadata_ofs= (uint32_t *)ma_alloc_root(&event->memroot,
+                                                        sizeof(uint32_t) * map->column_count)) ||
+      rpl_alloc_set_string_and_len(event, &types, map->column_types.str, map->column_types.length) ||
+      rpl_alloc_set_string_and_len(event, &metadata, map->metadata.str, map->metadata.length))
+    return NULL;
+  format->column_types= (uchar *)types.str;
+  format->metadata= (uchar *)metadata.str;
+
+  for (i= 0; i < map->column_count; i++)
+  {
+    format->metadata_ofs[i]= ofs;
+    ofs+= rpl_metadata_size(rpl_column_type(format->column_types[i],
+                                            format->metadata + ofs));
+  }
+  return format;
+}
+
+/*
+  Extracts the rows of row_event. Columns which are not set in projection
+  are not extracted and reported as MYSQL_TYPE_NULL, if lazy is set values
+  are decoded by mariadb_rpl_row_value().
+*/
+static MARIADB_RPL_ROW *rpl_extract_rows(MARIADB_RPL *rpl,
+                                         MARIADB_RPL_EVENT *tm_event,
+                                         MARIADB_RPL_EVENT *row_event,
+                                         const uchar *projection,
+                                         my_bool lazy)
+{
+  uchar *start, *pos, *end, *types;
   MARIADB_RPL_ROW *f_row= NULL, *p_row= NULL, *c_row= NULL;
+  MA_RPL_ROW_FORMAT *format= NULL;
   uint32_t column_count;
 
   if (!rpl || !tm_event || !row_event)
@@ -362,6 +681,10 @@ mariadb_rpl_extract_rows(MARIADB_RPL *rpl,
   }
 
   column_count= tm_event->event.table_map.column_count;
+  types= (uchar *)tm_event->event.table_map.column_types.str;
+
+  if (lazy && !(format= rpl_row_format_create(row_event, tm_event)))
+    goto mem_error;
 
   start= pos = row_event->event.rows.row_data;
   end= start + row_event->event.rows.row_data_size;
@@ -370,6 +693,7 @@ mariadb_rpl_extract_rows(MARIADB_RPL *rpl,
   {
     uchar *n_bitmap;
     uint32_t i;
+    struct st_ma_rpl_lazy_row *lazy_row= NULL;
 
     uchar *metadata= (uchar *)tm_event->event.table_map.metadata.str;
 
@@ -381,6 +705,18 @@ mariadb_rpl_extract_rows(MARIADB_RPL *rpl,
       return NULL;
     }
 
+    if (format)
+    {
+      if (!(lazy_row= (struct st_ma_rpl_lazy_row *)ma_alloc_root(&row_event->memroot, sizeof(*lazy_row))) ||
+          !(lazy_row->offsets= (uint32_t *)ma_alloc_root(&row_event->memroot,
+                                                         sizeof(uint32_t) * column_count)) ||
+          !(lazy_row->decoded= (uchar *)ma_calloc_root(&row_event->memroot, (column_count + 7) / 8)))
+        goto mem_error;
+      lazy_row->format= format;
+      lazy_row->data= pos;
+      c_row->lazy= lazy_row;
+    }
+
     if (!f_row)
       f_row= c_row;
     if (p_row)
@@ -393,274 +729,35 @@ mariadb_rpl_extract_rows(MARIADB_RPL *rpl,
     for (i= 0; i < column_count; i++)
     {
       MARIADB_RPL_VALUE *column= &c_row->columns[i];
-      column->field_type= (uchar)tm_event->event.table_map.column_types.str[i];
-      /* enum, set and string types are stored as string - first metadata
-         byte contains real_type, second byte contains the length */
-      if (column->field_type == MYSQL_TYPE_STRING)
+      enum enum_field_types type= rpl_column_type(types[i], metadata);
+      my_bool is_null= (n_bitmap[i / 8] >> (i % 8)) & 1;
+      size_t len;
+
+      if (projection && !((projection[i / 8] >> (i % 8)) & 1))
       {
-        if (metadata[0] == MYSQL_TYPE_ENUM || metadata[0] == MYSQL_TYPE_SET)
-          column->field_type = metadata[0];
+        column->field_type= MYSQL_TYPE_NULL;
+        column->is_null= 1;
+        if (!is_null)
+          pos+= rpl_decode_value(row_event, NULL, type, pos, metadata);
       }
-
-      if ((n_bitmap[i / 8] >> (i % 8)) & 1)
+      else if (is_null)
       {
+        column->field_type= type;
         column->is_null= 1;
-        metadata+= rpl_metadata_size(column->field_type);
-        continue;
       }
-      if (column->field_type == MYSQL_TYPE_BLOB)
+      else if (lazy_row)
       {
-        switch(metadata[0])
-        {
-          case 1:
-            column->field_type= MYSQL_TYPE_TINY_BLOB;
-            break;
-          case 3:
-            column->field_type= MYSQL_TYPE_MEDIUM_BLOB;
-            break;
-          case 4:
-            column->field_type= MYSQL_TYPE_LONG_BLOB;
-            break;
-          default:
-            break;
-        }
+        lazy_row->offsets[i]= (uint32_t)(pos - lazy_row->data);
+        column->field_type= rpl_value_type(type, metadata);
+        pos+= rpl_decode_value(row_event, NULL, type, pos, metadata);
       }
-      switch (column->field_type) {
-        case MYSQL_TYPE_TINY:
-          column->val.ll= sint1korr(pos);
-          column->val.ull= uint1korr(pos);
-          pos++;
-          break;
-        case MYSQL_TYPE_YEAR: 
-          column->val.ull= uint1korr(pos++) + 1900;
-          break;
-        case MYSQL_TYPE_SHORT:
-          column->val.ll= sint2korr(pos);
-          column->val.ull= uint2korr(pos);
-          pos+= 2;
-          break;
-        case MYSQL_TYPE_INT24: 
-          column->val.ll= sint3korr(pos);
-          column->val.ull= uint3korr(pos);
-          pos+= 3;
-          break;
-        case MYSQL_TYPE_LONG: 
-          column->val.ll= sint4korr(pos);
-          column->val.ull= uint4korr(pos);
-          pos+= 4;
-          break;
-        case MYSQL_TYPE_LONGLONG:
-          column->val.ll= sint8korr(pos);
-          column->val.ull= uint8korr(pos);
-          pos+= 8;
-          break;
-        case MYSQL_TYPE_NEWDECIMAL:
-        {
-          uint8_t precision= *metadata++;
-          uint8_t scale= *metadata++;
-          uint32_t bin_size;
-          decimal dec;
-          char str[200];
-          char buf[100];
-          int s_len= sizeof(str) - 1;
-
-          dec.buf= (void *)buf;
-          dec.len= sizeof(buf) / sizeof(decimal_digit);
-
-          bin_size= decimal_bin_size(precision, scale);
-          bin2decimal((char *)pos, &dec, precision, scale); 
-          decimal2string(&dec, str, &s_len);
-          pos+= bin_size;
-
-          if (rpl_alloc_set_string_and_len(row_event, &column->val.str, str, s_len))
-            goto mem_error;
-
-          break;
-        }
-        case MYSQL_TYPE_FLOAT:
-        case MYSQL_TYPE_DOUBLE:
-        {
-          uint8_t flen= *metadata++;
-          if (flen == 4)
-          {
-            float4get(column->val.f, pos);
-          }
-          if (flen == 8)
-          {
-            float8get(column->val.d, pos);
-          }
-          pos+= flen;
-          break;
-        }
-        case MYSQL_TYPE_BIT:
-        {
-          uint8_t num_bits= (metadata[0] & 0xFF) + metadata[1] * 8;
-          uint8_t b_len= (num_bits + 7) / 8;
-          metadata+= 2;
-          if (rpl_alloc_set_string_and_len(row_event, &column->val.str, pos, b_len))
-            goto mem_error;
-          pos+= b_len;
-          break;
-        }
-        case MYSQL_TYPE_TIMESTAMP:
-        {
-          column->val.ull= uint4korr(pos);
-          pos+= 4;
-          break;
-        }
-        case MYSQL_TYPE_TIMESTAMP2:
-        {
-          char tmp[20];
-          uint32_t p1= uint4korr(pos);
-          uint8_t f_len= *metadata++;
-          uint32_t p2;
-          pos+= 4;
-          p2= (uint32_t)uintNkorr(f_len, pos);
-          pos+= f_len;
-          sprintf(tmp, "%d.%d", p1, p2);
-          if (rpl_alloc_set_string_and_len(row_event, &column->val.str, tmp, strlen(tmp)))
-            goto mem_error;
-          break;
-        }
-        case MYSQL_TYPE_DATE:
-        {
-          MYSQL_TIME *tm= &column->val.tm;
-          uint32_t d_val= uint3korr(pos);
-          pos+= 3;
-          tm->year= (int)(d_val / (16 * 32));
-          tm->month= (int)(d_val / 32 % 16);
-          tm->day= d_val % 32;
-          tm->time_type= MYSQL_TIMESTAMP_DATE;
-          break; 
-        }
-        case MYSQL_TYPE_TIME2:
-        {
-          MYSQL_TIME *tm= &column->val.tm;
-          int64_t t_val= myisam_uint3korr(pos) - 0x800000LL;
-
-          if ((tm->neg = t_val < 0))
-            t_val= -t_val;
-
-          pos+= 3;
-          tm->hour= (t_val >> 12) % (1 << 10);
-          tm->minute= (t_val >> 6) % (1 << 6);
-          tm->second= t_val % (1 << 6);
-
-          pos+= ma_rpl_get_second_part(tm, pos, metadata);
-          metadata++;
-          tm->time_type= MYSQL_TIMESTAMP_TIME;
-          column->field_type= MYSQL_TYPE_TIME;
-          break;
-        }
-        case MYSQL_TYPE_DATETIME2:
-        {
-          MYSQL_TIME *tm= &column->val.tm;
-          uint64_t dt_val= mi_uint5korr(pos) - 0x8000000000LL,
-                   date_part, time_part;
-          pos+= 5;
-
-          date_part= dt_val >> 17;
-          time_part= dt_val % (1 << 17);
-
-          tm->day= (unsigned int)date_part % (1 << 5);
-          tm->month= (unsigned int)(date_part >> 5) % 13;
-          tm->year= (unsigned int)(date_part >> 5) / 13;
- 
-          tm->second= time_part % (1 << 6);
-          tm->minute= (time_part >> 6) % (1 << 6);
-          tm->hour= (uint32_t)(time_part >> 12);
-
-          tm->time_type= MYSQL_TIMESTAMP_DATETIME;
-          column->field_type= MYSQL_TYPE_DATETIME;
-
-          pos+= ma_rpl_get_second_part(tm, pos, metadata);
-          metadata++;
-          break;
-        }
-        case MYSQL_TYPE_STRING:
-        {
-          uint8_t s_len= metadata[2];
-          metadata+= 2;
-          if (rpl_alloc_set_string_and_len(row_event, &column->val.str, pos, s_len))
-            goto mem_error;
-          pos+= s_len;
-          break;
-        }
-        case MYSQL_TYPE_ENUM:
-        {
-          uint8_t e_len= metadata[2];
-          metadata+= 2;
-          column->val.ull= uintNkorr(e_len, pos);
-          pos+= e_len;
-          break;
-        }
-        case MYSQL_TYPE_SET:
-        {
-          uint8_t e_len= metadata[2];
-          metadata+= 2;
-          column->val.ull= uintNkorr(e_len, pos);
-          pos+= e_len;
-          break;
-        }
-        case MYSQL_TYPE_TINY_BLOB:
-        case MYSQL_TYPE_MEDIUM_BLOB:
-        case MYSQL_TYPE_LONG_BLOB:
-        case MYSQL_TYPE_BLOB:
-        case MYSQL_TYPE_GEOMETRY:
-        {
-          uint8_t h_len= *metadata++;
-          uint64_t b_len= uintNkorr(h_len, pos);
-          pos+= h_len;
-          if (rpl_alloc_set_string_and_len(row_event, &column->val.str, pos, (size_t)b_len))
-            goto mem_error;
-          pos+= b_len;
-          break;
-        }
-        case MYSQL_TYPE_VARCHAR:
-        case MYSQL_TYPE_VAR_STRING:
-        {
-          uint32_t s_len= uint2korr(metadata);
-          uint8_t byte_len= rpl_byte_size(s_len);
-          metadata+= 2;
-          s_len= (uint32_t)uintNkorr(byte_len, pos);
-          pos+= byte_len;
-          if (rpl_alloc_set_string_and_len(row_event, &column->val.str, pos, s_len))
-            goto mem_error;
-          pos+= s_len;
-          break;
-        }
-        case MYSQL_TYPE_TIME:
-        {
-          MYSQL_TIME *tm= &column->val.tm;
-          uint64_t t= uint8korr(pos);
-          pos+= 8;
-          tm->hour= (unsigned int)(t/100)/100;
-          tm->minute= (unsigned int)(t/100) % 100;
-          tm->second= (unsigned int)t % 100;
-          tm->time_type= MYSQL_TIMESTAMP_TIME;
-          break;  
-        }
-        case MYSQL_TYPE_DATETIME:
-        {
-          MYSQL_TIME *tm= &column->val.tm;
-          uint64_t t= uint8korr(pos);
-          uint32_t d_val= (uint32_t)t / 1000000,
-                   t_val= (uint32_t)t % 1000000;
-          pos+= 8;
-          tm->year= (unsigned int)(d_val / 100) / 100;
-          tm->month= (unsigned int)(d_val / 100) % 100;
-          tm->day= (unsigned int)d_val % 100;
-          tm->hour= (t_val/100)/100;
-          tm->minute= (t_val/100) % 100;
-          tm->second= t_val % 100;
-          tm->time_type= MYSQL_TIMESTAMP_DATETIME;
-          break;
-        }
-       
-
-        default:
-          break;
+      else
+      {
+        if ((len= rpl_decode_value(row_event, column, type, pos, metadata)) == RPL_VALUE_ERROR)
+          goto mem_error;
+        pos+= len;
       }
+      metadata+= rpl_metadata_size(type);
     }
     p_row= c_row;
   }
@@ -671,6 +768,40 @@ mem_error:
   return NULL;
 }
 
+MARIADB_RPL_ROW * STDCALL
+mariadb_rpl_extract_rows(MARIADB_RPL *rpl,
+                         MARIADB_RPL_EVENT *tm_event,
+                         MARIADB_RPL_EVENT *row_event)
+{
+  return rpl_extract_rows(rpl, tm_event, row_event, NULL, 0);
+}
+
+MARIADB_RPL_VALUE * STDCALL
+mariadb_rpl_row_value(MARIADB_RPL_EVENT *event,
+                      MARIADB_RPL_ROW *row,
+                      uint32_t column)
+{
+  struct st_ma_rpl_lazy_row *lazy;
+  MARIADB_RPL_VALUE *value;
+  uchar *metadata;
+
+  if (!event || !row || column >= row->column_count)
+    return NULL;
+
+  value= &row->columns[column];
+  if (!(lazy= row->lazy) || value->is_null ||
+      ((lazy->decoded[column / 8] >> (column % 8)) & 1))
+    return value;
+
+  metadata= lazy->format->metadata + lazy->format->metadata_ofs[column];
+  if (rpl_decode_value(event, value,
+                       rpl_column_type(lazy->format->column_types[column], metadata),
+                       lazy->data + lazy->offsets[column], metadata) == RPL_VALUE_ERROR)
+    return NULL;
+  lazy->decoded[column / 8]|= (uchar)(1 << (column % 8));
+  return value;
+}
+
 MARIADB_RPL * STDCALL mariadb_rpl_init_ex(MYSQL *mysql, unsigned int version)
 {
   MARIADB_RPL *rpl;
@@ -690,6 +821,8 @@ MARIADB_RPL * STDCALL mariadb_rpl_init_ex(MYSQL *mysql, unsigned int version)
     return 0;
   }
   rpl->version= version;
+  rpl->decode_queue_size= RPL_DEFAULT_QUEUE_SIZE;
+  rpl->result_queue_size= RPL_DEFAULT_QUEUE_SIZE;
 
   if ((rpl->mysql= mysql))
   {
@@ -723,6 +856,7 @@ void STDCALL mariadb_free_rpl_event(MARIADB_RPL_EVENT *event)
   if (event)
   {
     ma_free_root(&event->memroot, MYF(0));
+    free(event->packet_buffer);
     free(event);
   }
 }
@@ -988,7 +1122,316 @@ static uint8_t mariadb_rpl_send_semisync_ack(MARIADB_RPL* rpl, MARIADB_RPL_EVENT
   return 0;
 }
 
-MARIADB_RPL_EVENT * STDCALL mariadb_rpl_fetch(MARIADB_RPL *rpl, MARIADB_RPL_EVENT *event)
+/* {{{ table filter */
+
+/*
+  Include and exclude rules are evaluated once per TABLE_MAP_EVENT, the
+  result is stored in a bitmap indexed by table_id. rpl_read_event() skips
+  table maps and row events of tables which were not accepted before they
+  are copied or uncompressed. Row events without a preceding table map are
+  skipped too. Table ids which don't fit into the bitmap are kept in a
+  list, only a few tables are accepted usually.
+*/
+#define RPL_FILTER_MAX_BITMAP_ID (1ULL << 24)
+
+enum enum_rpl_filter_rule {
+  RPL_FILTER_INCLUDE,
+  RPL_FILTER_EXCLUDE,
+  RPL_FILTER_COLUMNS
+};
+
+typedef struct st_ma_rpl_filter_rule {
+  enum enum_rpl_filter_rule type;
+  char *database;        /* NULL matches all schemas */
+  char *table;           /* NULL matches all tables */
+  uint32_t column_count;
+  uint32_t *columns;     /* RPL_FILTER_COLUMNS: columns which are extracted */
+  struct st_ma_rpl_filter_rule *next;
+} MA_RPL_FILTER_RULE;
+
+typedef struct st_ma_rpl_filter {
+  MA_RPL_FILTER_RULE *rules;
+  uint32_t include_rules;
+  uchar *accepted;       /* bitmap of accepted table ids */
+  size_t accepted_size;
+  uint64_t *large_ids;   /* accepted table ids >= RPL_FILTER_MAX_BITMAP_ID */
+  uint32_t large_count;
+} MA_RPL_FILTER;
+
+static void rpl_filter_free(MA_RPL_FILTER *filter)
+{
+  if (!filter)
+    return;
+  while (filter->rules)
+  {
+    MA_RPL_FILTER_RULE *rule= filter->rules;
+    filter->rules= rule->next;
+    free(rule->database);
+    free(rule->table);
+    free(rule->columns);
+    free(rule);
+  }
+  free(filter->accepted);
+  free(filter->large_ids);
+  free(filter);
+}
+
+static int rpl_filter_add(MARIADB_RPL *rpl, enum enum_rpl_filter_rule type,
+                          const char *database, const char *table,
+                          uint32_t column_count, const uint32_t *columns)
+{
+  MA_RPL_FILTER_RULE *rule, **p;
+
+  if (!rpl->filter &&
+      !(rpl->filter= (MA_RPL_FILTER *)calloc(1, sizeof(MA_RPL_FILTER))))
+    return 1;
+  if (!(rule= (MA_RPL_FILTER_RULE *)calloc(1, sizeof(MA_RPL_FILTER_RULE))))
+    return 1;
+  rule->type= type;
+  if ((database && !(rule->database= strdup(database))) ||
+      (table && !(rule->table= strdup(table))) ||
+      (column_count && !(rule->columns= (uint32_t *)malloc(column_count * sizeof(uint32_t)))))
+  {
+    free(rule->database);
+    free(rule->table);
+    free(rule);
+    return 1;
+  }
+  if (column_count)
+    memcpy(rule->columns, columns, column_count * sizeof(uint32_t));
+  rule->column_count= column_count;
+
+  /* rules are evaluated in the order they were added */
+  for (p= &rpl->filter->rules; *p; p= &(*p)->next);
+  *p= rule;
+  if (type == RPL_FILTER_INCLUDE)
+    rpl->filter->include_rules++;
+  return 0;
+}
+
+static my_bool rpl_filter_match(MA_RPL_FILTER_RULE *rule,
+                                const uchar *database, size_t database_len,
+                                const uchar *table, size_t table_len)
+{
+  if (rule->database &&
+      (strlen(rule->database) != database_len ||
+       memcmp(rule->database, database, database_len)))
+    return 0;
+  if (rule->table &&
+      (strlen(rule->table) != table_len ||
+       memcmp(rule->table, table, table_len)))
+    return 0;
+  return 1;
+}
+
+static my_bool rpl_filter_accept(MA_RPL_FILTER *filter,
+                                 const uchar *database, size_t database_len,
+                                 const uchar *table, size_t table_len)
+{
+  MA_RPL_FILTER_RULE *rule;
+  my_bool accept= !filter->include_rules;
+
+  for (rule= filter->rules; rule; rule= rule->next)
+  {
+    if (rule->type == RPL_FILTER_COLUMNS ||
+        !rpl_filter_match(rule, database, database_len, table, table_len))
+      continue;
+    if (rule->type == RPL_FILTER_EXCLUDE)
+      return 0;
+    accept= 1;
+  }
+  return accept;
+}
+
+/* returns 1 if memory allocation failed */
+static my_bool rpl_filter_set(MA_RPL_FILTER *filter, uint64_t table_id,
+                              my_bool accept)
+{
+  uint32_t i;
+
+  if (table_id < RPL_FILTER_MAX_BITMAP_ID)
+  {
+    size_t ofs= (size_t)(table_id / 8);
+    uchar bit= (uchar)(1 << (table_id % 8));
+
+    if (ofs >= filter->accepted_size)
+    {
+      size_t size= MAX(filter->accepted_size * 2, MAX(ofs + 1, 64));
+      uchar *accepted;
+
+      if (!accept)
+        return 0;
+      size= MIN(size, RPL_FILTER_MAX_BITMAP_ID / 8);
+      if (!(accepted= (uchar *)realloc(filter->accepted, size)))
+        return 1;
+      memset(accepted + filter->accepted_size, 0, size - filter->accepted_size);
+      filter->accepted= accepted;
+      filter->accepted_size= size;
+    }
+    if (accept)
+      filter->accepted[ofs]|= bit;
+    else
+      filter->accepted[ofs]&= (uchar)~bit;
+    return 0;
+  }
+
+  for (i= 0; i < filter->large_count; i++)
+    if (filter->large_ids[i] == table_id)
+      break;
+  if (accept && i == filter->large_count)
+  {
+    uint64_t *ids= (uint64_t *)realloc(filter->large_ids,
+                                       (filter->large_count + 1) * sizeof(uint64_t));
+    if (!ids)
+      return 1;
+    filter->large_ids= ids;
+    filter->large_ids[filter->large_count++]= table_id;
+  }
+  else if (!accept && i < filter->large_count)
+    filter->large_ids[i]= filter->large_ids[--filter->large_count];
+  return 0;
+}
+
+static my_bool rpl_filter_get(MA_RPL_FILTER *filter, uint64_t table_id)
+{
+  uint32_t i;
+
+  if (table_id < RPL_FILTER_MAX_BITMAP_ID)
+  {
+    size_t ofs= (size_t)(table_id / 8);
+    return ofs < filter->accepted_size &&
+           ((filter->accepted[ofs] >> (table_id % 8)) & 1);
+  }
+  for (i= 0; i < filter->large_count; i++)
+    if (filter->large_ids[i] == table_id)
+      return 1;
+  return 0;
+}
+
+/*
+  Checks the event at ev, which points to the event header. Returns 1 if
+  the event belongs to a table which is not accepted, -1 if memory
+  allocation failed. Malformed events are not skipped, so the error is
+  reported by rpl_read_event().
+*/
+static int rpl_filter_skip(MARIADB_RPL *rpl, const uchar *ev, size_t len)
+{
+  const uchar *end= ev + len;
+  uint8_t event_type;
+  uint64_t table_id;
+
+  if (len < RPL_EVENT_HEADER_SIZE + 8)
+    return 0;
+  event_type= ev[4];
+  ev+= RPL_EVENT_HEADER_SIZE;
+  table_id= uint6korr(ev);
+
+  if (event_type == TABLE_MAP_EVENT)
+  {
+    const uchar *database, *table;
+    size_t database_len, table_len;
+    my_bool accept;
+
+    ev+= 8;
+    if (ev >= end)
+      return 0;
+    database_len= *ev++;
+    database= ev;
+    ev+= database_len + 1;
+    if (ev >= end)
+      return 0;
+    table_len= *ev++;
+    table= ev;
+    if (table_len > (size_t)(end - table))
+      return 0;
+
+    accept= rpl_filter_accept(rpl->filter, database, database_len, table, table_len);
+    if (rpl_filter_set(rpl->filter, table_id, accept))
+      return -1;
+    return !accept;
+  }
+  if (IS_ROW_EVENT_TYPE(event_type))
+    return !rpl_filter_get(rpl->filter, table_id);
+  return 0;
+}
+
+/* bitmap of the columns which are extracted, NULL if all columns are */
+static uchar *rpl_filter_columns(MARIADB_RPL *rpl, MARIADB_RPL_EVENT *tm_event)
+{
+  struct st_mariadb_rpl_table_map_event *map= &tm_event->event.table_map;
+  MA_RPL_FILTER_RULE *rule;
+  uchar *projection;
+  uint32_t i;
+
+  if (!rpl->filter)
+    return NULL;
+  for (rule= rpl->filter->rules; rule; rule= rule->next)
+    if (rule->type == RPL_FILTER_COLUMNS &&
+        rpl_filter_match(rule, (uchar *)map->database.str, map->database.length,
+                         (uchar *)map->table.str, map->table.length))
+      break;
+  if (!rule ||
+      !(projection= (uchar *)ma_calloc_root(&tm_event->memroot, (map->column_count + 7) / 8)))
+    return NULL;
+  for (i= 0; i < rule->column_count; i++)
+    if (rule->columns[i] < map->column_count)
+      projection[rule->columns[i] / 8]|= (uchar)(1 << (rule->columns[i] % 8));
+  return projection;
+}
+/* }}} */
+
+/*
+  Verifies the CRC32 of an event, start points to the event header and
+  end to the end of the event including the 4 bytes checksum.
+  Artificial events (fake rotate events) are generated by the server and
+  have no stored checksum. Returns 1 and frees the event on mismatch.
+*/
+static my_bool rpl_verify_checksum(MARIADB_RPL *rpl, MARIADB_RPL_EVENT *event,
+                                   const uchar *start, const uchar *end)
+{
+  uint32_t stored, crc;
+
+  if (event->timestamp == 0 && (event->flags & LOG_EVENT_ARTIFICIAL_F))
+    return 0;
+  if (end - start < RPL_EVENT_HEADER_SIZE + 4)
+    return 0;
+  stored= uint4korr(end - 4);
+  crc= (uint32_t)ma_simd_crc32(0, start, (size_t)(end - start - 4));
+  if (stored == crc)
+    return 0;
+  rpl_set_error(rpl, CR_ERR_CHECKSUM_VERIFICATION_ERROR, SQLSTATE_UNKNOWN, 0,
+                RPL_ERR_POS(rpl), stored, crc);
+  mariadb_free_rpl_event(event);
+  return 1;
+}
+
+/*
+  Zero copy: the network buffer holding the current packet becomes the
+  packet buffer of the event. The previous buffer of the event, or a new
+  one, is used by the connection for the next packet.
+*/
+static my_bool rpl_take_packet(MARIADB_RPL *rpl, MARIADB_RPL_EVENT *event)
+{
+  NET *net= &rpl->mysql->net;
+  uchar *buffer= event->packet_buffer;
+  size_t size= event->packet_buffer_size;
+
+  if (!buffer)
+  {
+    size= RPL_PACKET_BUFFER_SIZE;
+    if (!(buffer= (uchar *)malloc(size + NET_HEADER_SIZE + COMP_HEADER_SIZE)))
+      return 1;
+  }
+  event->raw_data= net->read_pos;
+  event->packet_buffer= net->buff;
+  event->packet_buffer_size= net->max_packet;
+  net->buff= net->write_pos= net->read_pos= buffer;
+  net->buff_end= buffer + (net->max_packet= (unsigned long)size);
+  return 0;
+}
+
+/* reads and decodes the next event, row data is not extracted */
+static MARIADB_RPL_EVENT *rpl_read_event(MARIADB_RPL *rpl, MARIADB_RPL_EVENT *event)
 {
   unsigned char *ev= 0;
   unsigned char *checksum_start= 0;
@@ -1003,10 +1446,23 @@ MARIADB_RPL_EVENT * STDCALL mariadb_rpl_fetch(MARIADB_RPL *rpl, MARIADB_RPL_EVEN
   if (event)
   {
     MA_MEM_ROOT memroot= event->memroot;
+    uchar *packet_buffer= event->packet_buffer;
+    size_t packet_buffer_size= event->packet_buffer_size;
+
     rpl_event= event;
-    ma_free_root(&memroot, MYF(MY_KEEP_PREALLOC));
+    /* keep the memory of the event unless it was large */
+    ma_free_root(&memroot, MYF(event->raw_data_size > RPL_RECYCLE_SIZE ?
+                               MY_KEEP_PREALLOC : MY_MARK_BLOCKS_FREE));
+    if (packet_buffer_size > RPL_PACKET_BUFFER_MAX)
+    {
+      free(packet_buffer);
+      packet_buffer= NULL;
+      packet_buffer_size= 0;
+    }
     memset(rpl_event, 0, sizeof(MARIADB_RPL_EVENT));
     rpl_event->memroot= memroot;
+    rpl_event->packet_buffer= packet_buffer;
+    rpl_event->packet_buffer_size= packet_buffer_size;
   } else {
     if (!(rpl_event = (MARIADB_RPL_EVENT *)malloc(sizeof(MARIADB_RPL_EVENT))))
       goto mem_error;
@@ -1047,15 +1503,41 @@ MARIADB_RPL_EVENT * STDCALL mariadb_rpl_fetch(MARIADB_RPL *rpl, MARIADB_RPL_EVEN
        https://mariadb.com/kb/en/library/2-binlog-event-header/ */
       if (rpl->flags & MARIADB_RPL_IGNORE_HEARTBEAT)
       {
-        if (rpl->mysql->net.read_pos[1 + 4] == HEARTBEAT_LOG_EVENT)
+        if (rpl->mysql->net.read_pos[1 + 4] == HEARTBEAT_LOG_EVENT)
+          continue;
+      }
+
+      if (rpl->filter && pkt_len > 3)
+      {
+        uchar *hdr= rpl->mysql->net.read_pos + 1;
+        my_bool ack= 0;
+        int skip;
+
+        /* events which have to be acknowledged are never skipped */
+        if (rpl->is_semi_sync && hdr[0] == SEMI_SYNC_INDICATOR)
+        {
+          ack= hdr[1] == SEMI_SYNC_ACK_REQ;
+          hdr+= 2;
+        }
+        if ((skip= rpl_filter_skip(rpl, hdr, pkt_len - (hdr - rpl->mysql->net.read_pos))) < 0)
+          goto mem_error;
+        if (skip && !ack)
           continue;
       }
  
-      if (!(rpl_event->raw_data= ma_alloc_root(&rpl_event->memroot, pkt_len)))
-        goto mem_error;
-
+      /* compressed connections may have the next packet in the buffer */
+      if (rpl->zero_copy && !rpl->mysql->net.compress)
+      {
+        if (rpl_take_packet(rpl, rpl_event))
+          goto mem_error;
+      }
+      else
+      {
+        if (!(rpl_event->raw_data= ma_alloc_root(&rpl_event->memroot, pkt_len)))
+          goto mem_error;
+        memcpy(rpl_event->raw_data, rpl->mysql->net.read_pos, pkt_len);
+      }
       rpl_event->raw_data_size= pkt_len;
-      memcpy(rpl_event->raw_data, rpl->mysql->net.read_pos, pkt_len);
       ev= rpl_event->raw_data;
     } else if (rpl->fp) {
       char buf[EVENT_HEADER_OFS]; /* header */
@@ -1077,12 +1559,22 @@ MARIADB_RPL_EVENT * STDCALL mariadb_rpl_fetch(MARIADB_RPL *rpl, MARIADB_RPL_EVEN
       }
       len= uint4korr(p + 9);
 
-      if (!(rpl_event->raw_data= ma_alloc_root(&rpl_event->memroot, len)))
+      /* the packet buffer of the event is reused for the next event */
+      if (len > rpl_event->packet_buffer_size)
       {
-        rpl_set_error(rpl, CR_OUT_OF_MEMORY, 0);
-        mariadb_free_rpl_event(rpl_event);
-        return NULL;
+        size_t size= MAX(len, RPL_PACKET_BUFFER_SIZE);
+
+        free(rpl_event->packet_buffer);
+        rpl_event->packet_buffer_size= 0;
+        if (!(rpl_event->packet_buffer= (uchar *)malloc(size)))
+        {
+          rpl_set_error(rpl, CR_OUT_OF_MEMORY, 0);
+          mariadb_free_rpl_event(rpl_event);
+          return NULL;
+        }
+        rpl_event->packet_buffer_size= size;
       }
+      rpl_event->raw_data= rpl_event->packet_buffer;
 
       rpl_event->raw_data_size= len;
       memcpy(rpl_event->raw_data, buf, EVENT_HEADER_OFS - 1);
@@ -1100,6 +1592,15 @@ MARIADB_RPL_EVENT * STDCALL mariadb_rpl_fetch(MARIADB_RPL *rpl, MARIADB_RPL_EVEN
       if (rpl->encrypted) {
         return rpl_event;
       }
+
+      if (rpl->filter)
+      {
+        int skip= rpl_filter_skip(rpl, rpl_event->raw_data, rpl_event->raw_data_size);
+        if (skip < 0)
+          goto mem_error;
+        if (skip)
+          continue;
+      }
     }
 
     ev_end= rpl_event->raw_data + rpl_event->raw_data_size;
@@ -1160,6 +1661,15 @@ MARIADB_RPL_EVENT * STDCALL mariadb_rpl_fetch(MARIADB_RPL *rpl, MARIADB_RPL_EVEN
     /* start of post_header */
     ev_start= ev;
 
+    /*
+      The checksum flag of a format description event is part of its
+      post header, it is verified after the flag was read.
+    */
+    if (rpl->verify_checksum && rpl->use_checksum &&
+        rpl_event->event_type != FORMAT_DESCRIPTION_EVENT &&
+        rpl_verify_checksum(rpl, rpl_event, checksum_start, ev_end))
+      return 0;
+
     DBUG_ASSERT(rpl_event->event_type < ENUM_END_EVENT);
 
     switch(rpl_event->event_type) {
@@ -1310,6 +1820,9 @@ MARIADB_RPL_EVENT * STDCALL mariadb_rpl_fetch(MARIADB_RPL *rpl, MARIADB_RPL_EVEN
       {
         rpl_event->checksum= uint4korr(ev);
         ev+= 4;
+        if (rpl->verify_checksum &&
+            rpl_verify_checksum(rpl, rpl_event, checksum_start, ev_end))
+          return 0;
       }
       break;
 
@@ -1875,11 +2388,9 @@ MARIADB_RPL_EVENT * STDCALL mariadb_rpl_fetch(MARIADB_RPL *rpl, MARIADB_RPL_EVEN
         RPL_CHECK_POS(ev, ev_end, header_size + len);
         ev+= header_size + len;
       } else {
+        /* row data and values point into raw_data */
         rpl_event->event.rows.row_data_size= ev_end - ev - (rpl->use_checksum ? 4 : 0);
-        if (!(rpl_event->event.rows.row_data =
-            (char *)ma_calloc_root(&rpl_event->memroot, rpl_event->event.rows.row_data_size)))
-          goto mem_error;
-        memcpy(rpl_event->event.rows.row_data, ev, rpl_event->event.rows.row_data_size);
+        rpl_event->event.rows.row_data= ev;
       }
       break;
     }
@@ -1908,24 +2419,9 @@ MARIADB_RPL_EVENT * STDCALL mariadb_rpl_fetch(MARIADB_RPL *rpl, MARIADB_RPL_EVEN
       }
     }
 
+    /* checksum was already verified after the event header was read */
     if (rpl->use_checksum && !rpl_event->checksum)
-    {
       rpl_event->checksum= uint4korr(ev_end - 4);
-
-      if (rpl_event->checksum && rpl->verify_checksum)
-      {
-        unsigned long crc= crc32(0L, Z_NULL, 0);
-        crc= crc32(crc, checksum_start, (uint32_t)(ev_end - checksum_start - 4));
-        if (rpl_event->checksum != (uint32_t)crc)
-        {
-          rpl_set_error(rpl, CR_ERR_CHECKSUM_VERIFICATION_ERROR, SQLSTATE_UNKNOWN, 0, 
-                       RPL_ERR_POS(rpl),
-                       rpl_event->checksum, (uint32_t)crc);
-          mariadb_free_rpl_event(rpl_event);
-          return 0;
-        }
-      }
-    }
     return rpl_event;
   }
 mem_error:
@@ -1939,10 +2435,588 @@ malformed_packet:
   return 0;
 }
 
+/* {{{ row decoding */
+
+/*
+  Rows of a row event can only be decoded with the TABLE_MAP_EVENT of the
+  table, which the application may free at any time. The decoder keeps
+  copies of the table maps of the current statement, row events waiting
+  for a decode thread hold a reference. Released copies are cached, since
+  the primary sends the same table maps for every statement.
+
+  With MARIADB_RPL_DECODE_THREADS a reader thread reads events into a ring
+  buffer in binlog order. Row events are decoded by a pool of threads,
+  mariadb_rpl_fetch() returns the events in the order they were read, so
+  transaction boundaries are preserved.
+*/
+typedef struct st_ma_rpl_table {
+  MARIADB_RPL_EVENT *event;
+  uchar *projection;           /* columns which are extracted, NULL = all */
+  my_bool lazy;                /* values are decoded on access */
+  uint32_t refs;
+  struct st_ma_rpl_table *next;
+} MA_RPL_TABLE;
+
+enum enum_rpl_job_state {
+  RPL_JOB_PENDING,  /* row event waiting for a decode thread */
+  RPL_JOB_BUSY,     /* row event being decoded */
+  RPL_JOB_READY     /* event can be returned */
+};
+
+typedef struct {
+  MARIADB_RPL_EVENT *event;
+  MA_RPL_TABLE *table;
+  enum enum_rpl_job_state state;
+  my_bool failed;
+} MA_RPL_JOB;
+
+#ifdef _WIN32
+typedef HANDLE rpl_thread_t;
+#define rpl_thread_create(T, F, A) (!(*(T)= CreateThread(NULL, 0, (F), (A), 0, NULL)))
+#define rpl_thread_join(T) (WaitForSingleObject((T), INFINITE), CloseHandle((T)))
+#else
+typedef pthread_t rpl_thread_t;
+#define rpl_thread_create(T, F, A) (pthread_create((T), NULL, (F), (A)) != 0)
+#define rpl_thread_join(T) pthread_join((T), NULL)
+#endif
+
+typedef struct st_ma_rpl_decoder {
+  pthread_mutex_t lock;
+  pthread_cond_t reader_cond;  /* reader waits for a free slot */
+  pthread_cond_t worker_cond;  /* decode threads wait for row events */
+  pthread_cond_t result_cond;  /* mariadb_rpl_fetch waits for the next event */
+  MA_RPL_TABLE *tables;        /* table maps of the current statement */
+  /* ring buffer, head <= dispatch <= tail */
+  MA_RPL_JOB *jobs;
+  uint32_t size;
+  uint64_t head;               /* next event returned by mariadb_rpl_fetch */
+  uint64_t dispatch;           /* next event checked by the decode threads */
+  uint64_t tail;               /* next free slot */
+  uint32_t pending;            /* number of jobs in state RPL_JOB_PENDING */
+  uint32_t decode_queue_size;
+  rpl_thread_t reader;
+  rpl_thread_t *threads;
+  uint32_t thread_count;
+  my_bool reader_started;
+  my_bool running;
+  my_bool eof;
+  my_bool shutdown;
+  MA_RPL_TABLE *table_cache;   /* released table maps, refs is 0 */
+  uint32_t cached_tables;
+  /* events returned by mariadb_rpl_fetch, reused by the reader */
+  MARIADB_RPL_EVENT **free_events;
+  uint32_t free_count;
+} MA_RPL_DECODER;
+
+static MA_RPL_DECODER *rpl_get_decoder(MARIADB_RPL *rpl)
+{
+  MA_RPL_DECODER *d;
+
+  if (rpl->decoder)
+    return rpl->decoder;
+  if (!(d= (MA_RPL_DECODER *)calloc(1, sizeof(MA_RPL_DECODER))))
+    return NULL;
+  pthread_mutex_init(&d->lock, NULL);
+  pthread_cond_init(&d->reader_cond, NULL);
+  pthread_cond_init(&d->worker_cond, NULL);
+  pthread_cond_init(&d->result_cond, NULL);
+  return rpl->decoder= d;
+}
+
+/* takes an event from the pool, NULL if it is empty */
+static MARIADB_RPL_EVENT *rpl_event_get(MA_RPL_DECODER *d)
+{
+  MARIADB_RPL_EVENT *event= NULL;
+
+  pthread_mutex_lock(&d->lock);
+  if (d->free_count)
+    event= d->free_events[--d->free_count];
+  pthread_mutex_unlock(&d->lock);
+  return event;
+}
+
+static void rpl_event_put(MA_RPL_DECODER *d, MARIADB_RPL_EVENT *event)
+{
+  if (!event)
+    return;
+  pthread_mutex_lock(&d->lock);
+  /* events in use: the queue, the reader and the application */
+  if (d->free_events && d->free_count < d->size + 2)
+  {
+    d->free_events[d->free_count++]= event;
+    event= NULL;
+  }
+  pthread_mutex_unlock(&d->lock);
+  mariadb_free_rpl_event(event);
+}
+
+#define RPL_SAME_STRING(a, b)\
+((a).length == (b).length && !memcmp((a).str, (b).str, (a).length))
+
+/* returns a cached copy of the table map, NULL if there is none */
+static MA_RPL_TABLE *rpl_table_cached(MARIADB_RPL *rpl, MARIADB_RPL_EVENT *tm_event)
+{
+  struct st_mariadb_rpl_table_map_event *src= &tm_event->event.table_map, *map;
+  MA_RPL_DECODER *d= rpl->decoder;
+  MA_RPL_TABLE **p, *table= NULL;
+
+  pthread_mutex_lock(&d->lock);
+  for (p= &d->table_cache; *p; p= &(*p)->next)
+  {
+    map= &(*p)->event->event.table_map;
+    if (map->table_id == src->table_id &&
+        map->column_count == src->column_count &&
+        (*p)->lazy == rpl->lazy_values &&
+        RPL_SAME_STRING(map->column_types, src->column_types) &&
+        RPL_SAME_STRING(map->metadata, src->metadata) &&
+        RPL_SAME_STRING(map->table, src->table) &&
+        RPL_SAME_STRING(map->database, src->database))
+    {
+      table= *p;
+      *p= table->next;
+      table->next= NULL;
+      table->refs= 1;
+      d->cached_tables--;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&d->lock);
+  return table;
+}
+
+/* copies the parts of a table map needed to decode rows */
+static MA_RPL_TABLE *rpl_table_create(MARIADB_RPL *rpl, MARIADB_RPL_EVENT *tm_event)
+{
+  struct st_mariadb_rpl_table_map_event *src= &tm_event->event.table_map, *map;
+  MA_RPL_TABLE *table;
+  MARIADB_RPL_EVENT *event;
+
+  if ((table= rpl_table_cached(rpl, tm_event)))
+    return table;
+  if (!(table= (MA_RPL_TABLE *)calloc(1, sizeof(MA_RPL_TABLE))))
+    return NULL;
+  if (!(event= table->event= (MARIADB_RPL_EVENT *)calloc(1, sizeof(MARIADB_RPL_EVENT))))
+  {
+    free(table);
+    return NULL;
+  }
+  ma_init_alloc_root(&event->memroot, 1024, 0);
+  event->event_type= TABLE_MAP_EVENT;
+  map= &event->event.table_map;
+  map->table_id= src->table_id;
+  map->column_count= src->column_count;
+  if (rpl_alloc_set_string_and_len(event, &map->database, src->database.str, src->database.length) ||
+      rpl_alloc_set_string_and_len(event, &map->table, src->table.str, src->table.length) ||
+      rpl_alloc_set_string_and_len(event, &map->column_types, src->column_types.str, src->column_types.length) ||
+      rpl_alloc_set_string_and_len(event, &map->metadata, src->metadata.str, src->metadata.length))
+  {
+    mariadb_free_rpl_event(event);
+    free(table);
+    return NULL;
+  }
+  table->projection= rpl_filter_columns(rpl, event);
+  table->lazy= rpl->lazy_values;
+  table->refs= 1;
+  return table;
+}
+
+static void rpl_table_free(MA_RPL_TABLE *table)
+{
+  mariadb_free_rpl_event(table->event);
+  free(table);
+}
+
+/* decoder lock must be held */
+static void rpl_table_release(MA_RPL_DECODER *d, MA_RPL_TABLE *table)
+{
+  if (table && !--table->refs)
+  {
+    if (d->cached_tables < RPL_TABLE_CACHE_SIZE)
+    {
+      table->next= d->table_cache;
+      d->table_cache= table;
+      d->cached_tables++;
+    }
+    else
+      rpl_table_free(table);
+  }
+}
+
+static void rpl_tables_clear(MA_RPL_DECODER *d)
+{
+  while (d->tables)
+  {
+    MA_RPL_TABLE *table= d->tables;
+    d->tables= table->next;
+    rpl_table_release(d, table);
+  }
+}
+
+/*
+  Keeps track of the table maps of the current statement: table is the
+  copy of event if it is a TABLE_MAP_EVENT. For row events the table map
+  is returned with an additional reference, NULL if the rows can't be
+  decoded. Decoder lock must be held.
+*/
+static MA_RPL_TABLE *rpl_track_event(MA_RPL_DECODER *d, MARIADB_RPL_EVENT *event,
+                                     MA_RPL_TABLE *table)
+{
+  MA_RPL_TABLE **p;
+
+  if (table)
+  {
+    /* a new map replaces the map with the same table_id */
+    for (p= &d->tables; *p; p= &(*p)->next)
+    {
+      if ((*p)->event->event.table_map.table_id == table->event->event.table_map.table_id)
+      {
+        MA_RPL_TABLE *old= *p;
+        *p= old->next;
+        rpl_table_release(d, old);
+        break;
+      }
+    }
+    table->next= d->tables;
+    d->tables= table;
+    return NULL;
+  }
+
+  if (!IS_ROW_EVENT(event) || !event->event.rows.row_data ||
+      !event->event.rows.row_data_size)
+    return NULL;
+
+  for (table= d->tables; table; table= table->next)
+    if (table->event->event.table_map.table_id == event->event.rows.table_id)
+    {
+      table->refs++;
+      break;
+    }
+  /* table maps are valid until the end of the statement */
+  if (event->event.rows.flags & FL_STMT_END)
+    rpl_tables_clear(d);
+  return table;
+}
+
+/* returns 1 if the rows couldn't be decoded */
+static my_bool rpl_decode_rows(MARIADB_RPL *rpl, MARIADB_RPL_EVENT *event,
+                               MA_RPL_TABLE *table)
+{
+  MARIADB_RPL_ROW *row;
+
+  if (!(event->rows= rpl_extract_rows(rpl, table->event, event,
+                                      table->projection, table->lazy)))
+    return 1;
+  for (row= event->rows; row; row= row->next)
+    event->event.rows.row_count++;
+  return 0;
+}
+
+#ifndef _WIN32
+static void *rpl_reader_thread(void *arg)
+#else
+static DWORD WINAPI rpl_reader_thread(void *arg)
+#endif
+{
+  MARIADB_RPL *rpl= (MARIADB_RPL *)arg;
+  MA_RPL_DECODER *d= rpl->decoder;
+
+  for (;;)
+  {
+    MARIADB_RPL_EVENT *event= rpl_read_event(rpl, rpl_event_get(d));
+    MA_RPL_TABLE *table= NULL;
+    MA_RPL_JOB *job;
+    my_bool failed= 0;
+
+    if (event && event->event_type == TABLE_MAP_EVENT &&
+        !(table= rpl_table_create(rpl, event)))
+      failed= 1;
+
+    pthread_mutex_lock(&d->lock);
+    if (!event)
+    {
+      /* end of binlog or error, rpl->error_no was set by rpl_read_event */
+      d->eof= 1;
+      pthread_cond_broadcast(&d->result_cond);
+      pthread_mutex_unlock(&d->lock);
+      break;
+    }
+    table= rpl_track_event(d, event, table);
+    while (!d->shutdown &&
+           (d->tail - d->head == d->size ||
+            (table && d->pending >= d->decode_queue_size)))
+      pthread_cond_wait(&d->reader_cond, &d->lock);
+    if (d->shutdown)
+    {
+      rpl_table_release(d, table);
+      pthread_mutex_unlock(&d->lock);
+      mariadb_free_rpl_event(event);
+      break;
+    }
+    job= &d->jobs[d->tail++ % d->size];
+    job->event= event;
+    job->table= table;
+    job->failed= failed;
+    if (table)
+    {
+      job->state= RPL_JOB_PENDING;
+      d->pending++;
+      pthread_cond_signal(&d->worker_cond);
+    }
+    else
+    {
+      job->state= RPL_JOB_READY;
+      pthread_cond_signal(&d->result_cond);
+    }
+    pthread_mutex_unlock(&d->lock);
+  }
+  return 0;
+}
+
+#ifndef _WIN32
+static void *rpl_decode_thread(void *arg)
+#else
+static DWORD WINAPI rpl_decode_thread(void *arg)
+#endif
+{
+  MA_RPL_DECODER *d= (MA_RPL_DECODER *)arg;
+  /* decoding errors are reported per event, not via the handle */
+  MARIADB_RPL scratch;
+
+  memset(&scratch, 0, sizeof(scratch));
+  pthread_mutex_lock(&d->lock);
+  for (;;)
+  {
+    MA_RPL_JOB *job;
+
+    /* events before head were already returned */
+    if (d->dispatch < d->head)
+      d->dispatch= d->head;
+    while (d->dispatch < d->tail &&
+           d->jobs[d->dispatch % d->size].state != RPL_JOB_PENDING)
+      d->dispatch++;
+    if (d->shutdown)
+      break;
+    if (d->dispatch == d->tail)
+    {
+      pthread_cond_wait(&d->worker_cond, &d->lock);
+      continue;
+    }
+    job= &d->jobs[d->dispatch++ % d->size];
+    job->state= RPL_JOB_BUSY;
+    d->pending--;
+    pthread_cond_signal(&d->reader_cond);
+    pthread_mutex_unlock(&d->lock);
+
+    job->failed= rpl_decode_rows(&scratch, job->event, job->table);
+
+    pthread_mutex_lock(&d->lock);
+    rpl_table_release(d, job->table);
+    job->table= NULL;
+    job->state= RPL_JOB_READY;
+    if (job == &d->jobs[d->head % d->size])
+      pthread_cond_signal(&d->result_cond);
+  }
+  pthread_mutex_unlock(&d->lock);
+  return 0;
+}
+
+static void rpl_decoder_stop(MARIADB_RPL *rpl)
+{
+  MA_RPL_DECODER *d= rpl->decoder;
+  my_bool eof;
+  uint32_t i;
+
+  pthread_mutex_lock(&d->lock);
+  d->shutdown= 1;
+  eof= d->eof;
+  pthread_cond_broadcast(&d->reader_cond);
+  pthread_cond_broadcast(&d->worker_cond);
+  pthread_mutex_unlock(&d->lock);
+
+  if (d->reader_started)
+  {
+    MARIADB_PVIO *pvio= rpl->mysql ? rpl->mysql->net.pvio : NULL;
+
+    /* wake up the reader if it waits for the next event from the primary */
+    if (!eof && pvio && pvio->methods->shutdown)
+      pvio->methods->shutdown(pvio);
+    rpl_thread_join(d->reader);
+  }
+  for (i= 0; i < d->thread_count; i++)
+    rpl_thread_join(d->threads[i]);
+
+  /* events which were not fetched */
+  for (; d->head < d->tail; d->head++)
+  {
+    MA_RPL_JOB *job= &d->jobs[d->head % d->size];
+    rpl_table_release(d, job->table);
+    mariadb_free_rpl_event(job->event);
+  }
+  rpl_tables_clear(d);
+  while (d->free_count)
+    mariadb_free_rpl_event(d->free_events[--d->free_count]);
+  free(d->free_events);
+  free(d->jobs);
+  free(d->threads);
+  d->free_events= NULL;
+  d->jobs= NULL;
+  d->threads= NULL;
+  d->thread_count= 0;
+  d->reader_started= d->running= 0;
+}
+
+static my_bool rpl_decoder_start(MARIADB_RPL *rpl)
+{
+  MA_RPL_DECODER *d= rpl->decoder;
+  uint32_t i;
+
+  d->decode_queue_size= MAX(rpl->decode_queue_size, 1);
+  d->size= d->decode_queue_size + MAX(rpl->result_queue_size, 1);
+  d->head= d->dispatch= d->tail= 0;
+  d->pending= 0;
+  d->eof= d->shutdown= 0;
+  d->running= 1;
+
+  if (!(d->jobs= (MA_RPL_JOB *)calloc(d->size, sizeof(MA_RPL_JOB))) ||
+      !(d->free_events= (MARIADB_RPL_EVENT **)calloc(d->size + 2, sizeof(MARIADB_RPL_EVENT *))) ||
+      !(d->threads= (rpl_thread_t *)calloc(rpl->decode_threads, sizeof(rpl_thread_t))))
+    goto error;
+  for (i= 0; i < rpl->decode_threads; i++)
+  {
+    if (rpl_thread_create(&d->threads[i], rpl_decode_thread, d))
+      break;
+    d->thread_count++;
+  }
+  if (!d->thread_count || rpl_thread_create(&d->reader, rpl_reader_thread, rpl))
+    goto error;
+  d->reader_started= 1;
+  return 0;
+error:
+  rpl_decoder_stop(rpl);
+  return 1;
+}
+
+static MARIADB_RPL_EVENT *rpl_decoder_fetch(MARIADB_RPL *rpl)
+{
+  MA_RPL_DECODER *d= rpl->decoder;
+  MARIADB_RPL_EVENT *event;
+  MA_RPL_JOB *job;
+  my_bool failed;
+
+  pthread_mutex_lock(&d->lock);
+  while (!(d->head < d->tail && d->jobs[d->head % d->size].state == RPL_JOB_READY) &&
+         !(d->eof && d->head == d->tail))
+    pthread_cond_wait(&d->result_cond, &d->lock);
+  if (d->head == d->tail)
+  {
+    pthread_mutex_unlock(&d->lock);
+    rpl_decoder_stop(rpl);
+    return NULL;
+  }
+  job= &d->jobs[d->head++ % d->size];
+  event= job->event;
+  failed= job->failed;
+  job->event= NULL;
+  pthread_cond_signal(&d->reader_cond);
+  pthread_mutex_unlock(&d->lock);
+
+  if (failed)
+  {
+    /* rpl->filename may be changed by the reader thread */
+    rpl_set_error(rpl, CR_BINLOG_ERROR, 0, 0, "", (unsigned long)event->next_event_pos,
+                  "Can't decode row event");
+    mariadb_free_rpl_event(event);
+    return NULL;
+  }
+  return event;
+}
+
+MARIADB_RPL_EVENT * STDCALL mariadb_rpl_fetch(MARIADB_RPL *rpl, MARIADB_RPL_EVENT *event)
+{
+  MA_RPL_DECODER *d;
+  MA_RPL_TABLE *table= NULL;
+  my_bool failed;
+
+  if (!rpl || (!rpl->mysql && !rpl->fp))
+    return 0;
+
+  if (!rpl->decode_threads && !rpl->extract_values && !rpl->lazy_values &&
+      !(rpl->decoder && rpl->decoder->running))
+    return rpl_read_event(rpl, event);
+
+  if (!(d= rpl_get_decoder(rpl)))
+  {
+    mariadb_free_rpl_event(event);
+    rpl_set_error(rpl, CR_OUT_OF_MEMORY, 0);
+    return 0;
+  }
+
+  if (rpl->decode_threads || d->running)
+  {
+    /* events are taken from the queue, the passed event goes to the pool */
+    rpl_event_put(d, event);
+    if (!d->running && rpl_decoder_start(rpl))
+    {
+      rpl_set_error(rpl, CR_OUT_OF_MEMORY, 0);
+      return 0;
+    }
+    return rpl_decoder_fetch(rpl);
+  }
+
+  if (!(event= rpl_read_event(rpl, event)))
+    return 0;
+  if (event->event_type == TABLE_MAP_EVENT && !(table= rpl_table_create(rpl, event)))
+  {
+    mariadb_free_rpl_event(event);
+    rpl_set_error(rpl, CR_OUT_OF_MEMORY, 0);
+    return 0;
+  }
+  pthread_mutex_lock(&d->lock);
+  if (!(table= rpl_track_event(d, event, table)))
+  {
+    pthread_mutex_unlock(&d->lock);
+    return event;
+  }
+  pthread_mutex_unlock(&d->lock);
+
+  failed= rpl_decode_rows(rpl, event, table);
+
+  pthread_mutex_lock(&d->lock);
+  rpl_table_release(d, table);
+  pthread_mutex_unlock(&d->lock);
+  if (failed)
+  {
+    mariadb_free_rpl_event(event);
+    return 0;
+  }
+  return event;
+}
+/* }}} */
+
 void STDCALL mariadb_rpl_close(MARIADB_RPL *rpl)
 {
   if (!rpl)
     return;
+  if (rpl->decoder)
+  {
+    MA_RPL_DECODER *d= rpl->decoder;
+
+    if (d->running)
+      rpl_decoder_stop(rpl);
+    rpl_tables_clear(d);
+    while (d->table_cache)
+    {
+      MA_RPL_TABLE *table= d->table_cache;
+      d->table_cache= table->next;
+      rpl_table_free(table);
+    }
+    pthread_mutex_destroy(&d->lock);
+    pthread_cond_destroy(&d->reader_cond);
+    pthread_cond_destroy(&d->worker_cond);
+    pthread_cond_destroy(&d->result_cond);
+    free(d);
+  }
+  rpl_filter_free(rpl->filter);
   free((void *)rpl->filename);
   if (rpl->fp)
   {
@@ -2029,6 +3103,53 @@ int STDCALL mariadb_rpl_optionsv(MARIADB_RPL *rpl,
     rpl->is_semi_sync = (uint8_t)va_arg(ap, uint32_t);
     break;
   }
+  case MARIADB_RPL_DECODE_THREADS:
+  {
+    rpl->decode_threads= va_arg(ap, uint32_t);
+    break;
+  }
+  case MARIADB_RPL_DECODE_QUEUE_SIZE:
+  {
+    rpl->decode_queue_size= va_arg(ap, uint32_t);
+    break;
+  }
+  case MARIADB_RPL_RESULT_QUEUE_SIZE:
+  {
+    rpl->result_queue_size= va_arg(ap, uint32_t);
+    break;
+  }
+  case MARIADB_RPL_INCLUDE_TABLE:
+  case MARIADB_RPL_EXCLUDE_TABLE:
+  {
+    const char *database= va_arg(ap, const char *);
+    const char *table= va_arg(ap, const char *);
+    if ((rc= rpl_filter_add(rpl, option == MARIADB_RPL_INCLUDE_TABLE ?
+                            RPL_FILTER_INCLUDE : RPL_FILTER_EXCLUDE,
+                            database, table, 0, NULL)))
+      rpl_set_error(rpl, CR_OUT_OF_MEMORY, 0);
+    break;
+  }
+  case MARIADB_RPL_TABLE_COLUMNS:
+  {
+    const char *database= va_arg(ap, const char *);
+    const char *table= va_arg(ap, const char *);
+    uint32_t column_count= va_arg(ap, uint32_t);
+    const uint32_t *columns= va_arg(ap, const uint32_t *);
+    if ((rc= rpl_filter_add(rpl, RPL_FILTER_COLUMNS, database, table,
+                            column_count, columns)))
+      rpl_set_error(rpl, CR_OUT_OF_MEMORY, 0);
+    break;
+  }
+  case MARIADB_RPL_ZERO_COPY:
+  {
+    rpl->zero_copy= (uint8_t)va_arg(ap, uint32_t);
+    break;
+  }
+  case MARIADB_RPL_LAZY_VALUES:
+  {
+    rpl->lazy_values= (uint8_t)va_arg(ap, uint32_t);
+    break;
+  }
   default:
     rc= -1;
     goto end;
@@ -2077,12 +3198,48 @@ int STDCALL mariadb_rpl_get_optionsv(MARIADB_RPL *rpl,
     *start= rpl->start_position;
     break;
   }
+  case MARIADB_RPL_VERIFY_CHECKSUM:
+  {
+    uint32_t *verify= va_arg(ap, uint32_t *);
+    *verify= rpl->verify_checksum;
+    break;
+  }
   case MARIADB_RPL_SEMI_SYNC:
   {
     unsigned int* semi_sync = va_arg(ap, unsigned int*);
     *semi_sync = rpl->is_semi_sync;
     break;
   }
+  case MARIADB_RPL_DECODE_THREADS:
+  {
+    uint32_t *threads= va_arg(ap, uint32_t *);
+    *threads= rpl->decode_threads;
+    break;
+  }
+  case MARIADB_RPL_DECODE_QUEUE_SIZE:
+  {
+    uint32_t *size= va_arg(ap, uint32_t *);
+    *size= rpl->decode_queue_size;
+    break;
+  }
+  case MARIADB_RPL_RESULT_QUEUE_SIZE:
+  {
+    uint32_t *size= va_arg(ap, uint32_t *);
+    *size= rpl->result_queue_size;
+    break;
+  }
+  case MARIADB_RPL_LAZY_VALUES:
+  {
+    uint32_t *lazy= va_arg(ap, uint32_t *);
+    *lazy= rpl->lazy_values;
+    break;
+  }
+  case MARIADB_RPL_ZERO_COPY:
+  {
+    uint32_t *zero_copy= va_arg(ap, uint32_t *);
+    *zero_copy= rpl->zero_copy;
+    break;
+  }
 
   default:
     va_end(ap);
@@ -77,8 +77,28 @@ stmt_set_error((stmt), (stmt)->mysql->net.last_errno, (stmt)->mysql->net.sqlstat
 typedef struct
 {
   MA_MEM_ROOT fields_ma_alloc_root;
+  unsigned int fetch_array_size;
+  size_t fetch_row_size;
+  unsigned int rows_fetched;
+  char *query;                 /* SQL text, if statement cache is enabled */
+  unsigned long query_length;
 } MADB_STMT_EXTENSION;
 
+/* server side statement in the client side statement cache */
+typedef struct
+{
+  LIST list;
+  char *query;
+  unsigned long query_length;
+  char *db;                    /* default schema when it was prepared */
+  unsigned long stmt_id;
+  unsigned int field_count;
+  unsigned int param_count;
+  MYSQL_FIELD *fields;
+  MYSQL_BIND *bind;
+  MA_MEM_ROOT fields_ma_alloc_root;
+} MA_STMT_CACHE_ENTRY;
+
 static my_bool net_stmt_close(MYSQL_STMT *stmt, my_bool remove);
 
 static my_bool is_not_null= 0;
@@ -1210,6 +1230,15 @@ my_bool STDCALL mysql_stmt_attr_get(MYSQL_STMT *stmt, enum enum_stmt_attr_type a
     case STMT_ATTR_CB_USER_DATA:
       *((void **)value) = stmt->user_data;
       break;
+    case STMT_ATTR_FETCH_ARRAY_SIZE:
+      *(unsigned int *)value= ((MADB_STMT_EXTENSION *)stmt->extension)->fetch_array_size;
+      break;
+    case STMT_ATTR_FETCH_ROW_SIZE:
+      *(size_t *)value= ((MADB_STMT_EXTENSION *)stmt->extension)->fetch_row_size;
+      break;
+    case STMT_ATTR_ROWS_FETCHED:
+      *(unsigned int *)value= ((MADB_STMT_EXTENSION *)stmt->extension)->rows_fetched;
+      break;
     default:
       return(1);
   }
@@ -1261,6 +1290,12 @@ my_bool STDCALL mysql_stmt_attr_set(MYSQL_STMT *stmt, enum enum_stmt_attr_type a
   case STMT_ATTR_CB_USER_DATA:
     stmt->user_data= (void *)value;
     break;
+  case STMT_ATTR_FETCH_ARRAY_SIZE:
+    ((MADB_STMT_EXTENSION *)stmt->extension)->fetch_array_size= *(unsigned int *)value;
+    break;
+  case STMT_ATTR_FETCH_ROW_SIZE:
+    ((MADB_STMT_EXTENSION *)stmt->extension)->fetch_row_size= *(size_t *)value;
+    break;
   default:
     stmt_set_error(stmt, CR_NOT_IMPLEMENTED, SQLSTATE_UNKNOWN, 0);
     return(1);
@@ -1505,6 +1540,221 @@ static my_bool net_stmt_close(MYSQL_STMT *stmt, my_bool remove)
   return 0;
 }
 
+/*
+  Client side statement cache (MARIADB_OPT_STMT_CACHE_SIZE)
+
+  Instead of closing a prepared statement on the server, mysql_stmt_close()
+  and mysql_stmt_prepare() move the server side statement together with
+  its metadata into a per connection cache, keyed by the SQL text and
+  the default schema (unqualified table names were resolved against it).
+  A later mysql_stmt_prepare() of the same SQL in the same schema takes
+  it from the cache without a round trip. mysql->db follows
+  mysql_select_db() and, with session tracking, USE statements. If the
+  cache is full, the least recently cached
+  statement will be closed. All cached statements are dropped when the
+  connection is closed, reset or reconnected (ma_invalidate_stmts).
+*/
+static uchar *ma_stmt_cache_key(const uchar *record, uint *length,
+                                my_bool not_used __attribute__((unused)))
+{
+  MA_STMT_CACHE_ENTRY *entry= (MA_STMT_CACHE_ENTRY *)record;
+  *length= (uint)entry->query_length;
+  return (uchar *)entry->query;
+}
+
+static void ma_stmt_cache_free_entry(MA_STMT_CACHE_ENTRY *entry)
+{
+  ma_free_root(&entry->fields_ma_alloc_root, MYF(0));
+  free(entry->query);
+  free(entry->db);
+  free(entry);
+}
+
+static void ma_stmt_cache_remove(MYSQL *mysql, MA_STMT_CACHE_ENTRY *entry)
+{
+  struct st_mariadb_extension *ext= mysql->extension;
+
+  ma_hashtbl_delete(&ext->stmt_cache, (uchar *)entry);
+  if (ext->stmt_cache_lru_tail == &entry->list)
+    ext->stmt_cache_lru_tail= entry->list.prev;
+  ext->stmt_cache_lru= list_delete(ext->stmt_cache_lru, &entry->list);
+  ext->stmt_cache_count--;
+}
+
+/* drops all cached statements without closing them on the server */
+void ma_stmt_cache_free(MYSQL *mysql)
+{
+  struct st_mariadb_extension *ext= mysql->extension;
+
+  if (!ext || !ma_hashtbl_inited(&ext->stmt_cache))
+    return;
+  while (ext->stmt_cache_lru)
+  {
+    MA_STMT_CACHE_ENTRY *entry= (MA_STMT_CACHE_ENTRY *)ext->stmt_cache_lru->data;
+    ext->stmt_cache_lru= list_delete(ext->stmt_cache_lru, &entry->list);
+    ma_stmt_cache_free_entry(entry);
+  }
+  ma_hashtbl_free(&ext->stmt_cache);
+  ext->stmt_cache_lru_tail= NULL;
+  ext->stmt_cache_count= 0;
+}
+
+static my_bool ma_stmt_cacheable(MYSQL_STMT *stmt)
+{
+  unsigned int i;
+
+  if (!stmt->mysql || !OPT_EXT_VAL(stmt->mysql, stmt_cache_size) ||
+      !((MADB_STMT_EXTENSION *)stmt->extension)->query ||
+      stmt->state < MYSQL_STMT_PREPARED ||
+      stmt->stmt_id == 0 || stmt->stmt_id == (unsigned long)-1 ||
+      stmt->flags & CURSOR_TYPE_READ_ONLY)
+    return 0;
+
+  /* pending long data would be used by the next execute */
+  if (stmt->params)
+    for (i= 0; i < stmt->param_count; i++)
+      if (stmt->params[i].long_data_used)
+        return 0;
+  return 1;
+}
+
+/*
+  Moves the server side statement into the cache. The statement handle
+  will be in MYSQL_STMT_INITTED state afterwards.
+  Returns 1 if the statement wasn't cached and needs to be closed.
+*/
+static my_bool ma_stmt_cache_put(MYSQL_STMT *stmt)
+{
+  MYSQL *mysql= stmt->mysql;
+  MADB_STMT_EXTENSION *stmt_ext= (MADB_STMT_EXTENSION *)stmt->extension;
+  struct st_mariadb_extension *ext= mysql->extension;
+  unsigned int size= OPT_EXT_VAL(mysql, stmt_cache_size);
+  MA_STMT_CACHE_ENTRY *entry;
+
+  if (mysql->status != MYSQL_STATUS_READY)
+    return 1;
+
+  if (!ma_hashtbl_inited(&ext->stmt_cache) &&
+      ma_hashtbl_init(&ext->stmt_cache, MIN(size, 64), 0, 0,
+                      ma_stmt_cache_key, NULL, 0))
+    return 1;
+
+  if (!(entry= (MA_STMT_CACHE_ENTRY *)calloc(1, sizeof(MA_STMT_CACHE_ENTRY))))
+    return 1;
+  if (mysql->db && !(entry->db= strdup(mysql->db)))
+  {
+    free(entry);
+    return 1;
+  }
+  entry->query= stmt_ext->query;
+  entry->query_length= stmt_ext->query_length;
+  if (ma_hashtbl_insert(&ext->stmt_cache, (uchar *)entry))
+  {
+    free(entry->db);
+    free(entry);
+    return 1;
+  }
+  stmt_ext->query= NULL;
+
+  entry->stmt_id= stmt->stmt_id;
+  entry->field_count= stmt->field_count;
+  entry->param_count= stmt->param_count;
+  entry->fields= stmt->fields;
+  entry->bind= stmt->bind;
+  entry->fields_ma_alloc_root= stmt_ext->fields_ma_alloc_root;
+  ma_init_alloc_root(&stmt_ext->fields_ma_alloc_root, 2048, 2048);
+  entry->list.data= entry;
+  ext->stmt_cache_lru= list_add(ext->stmt_cache_lru, &entry->list);
+  if (!ext->stmt_cache_lru_tail)
+    ext->stmt_cache_lru_tail= &entry->list;
+
+  stmt->fields= NULL;
+  stmt->bind= NULL;
+  stmt->state= MYSQL_STMT_INITTED;
+
+  /* evict least recently cached statement */
+  if (++ext->stmt_cache_count > size)
+  {
+    char stmt_id[STMT_ID_LENGTH];
+
+    entry= (MA_STMT_CACHE_ENTRY *)ext->stmt_cache_lru_tail->data;
+    ma_stmt_cache_remove(mysql, entry);
+    int4store(stmt_id, entry->stmt_id);
+    ma_stmt_cache_free_entry(entry);
+    if (mysql->methods->db_command(mysql, COM_STMT_CLOSE, stmt_id,
+                                   sizeof(stmt_id), 1, stmt))
+      UPDATE_STMT_ERROR(stmt);
+  }
+  return 0;
+}
+
+/*
+  Takes a prepared statement for query from the cache.
+  Returns 1 if the statement was found.
+*/
+static my_bool ma_stmt_cache_get(MYSQL_STMT *stmt, const char *query,
+                                 unsigned long length)
+{
+  MYSQL *mysql= stmt->mysql;
+  MADB_STMT_EXTENSION *stmt_ext= (MADB_STMT_EXTENSION *)stmt->extension;
+  MA_STMT_CACHE_ENTRY *entry;
+  MYSQL_BIND *params= NULL;
+
+  if (!mysql->extension || !ma_hashtbl_inited(&mysql->extension->stmt_cache))
+    return 0;
+
+  /* the same SQL may be cached for several schemas */
+  for (entry= (MA_STMT_CACHE_ENTRY *)ma_hashtbl_search(&mysql->extension->stmt_cache,
+                                                      (const uchar *)query,
+                                                      (uint)length);
+       entry;
+       entry= (MA_STMT_CACHE_ENTRY *)ma_hashtbl_next(&mysql->extension->stmt_cache,
+                                                    (const uchar *)query,
+                                                    (uint)length))
+  {
+    if (entry->db ? mysql->db && !strcmp(entry->db, mysql->db) : !mysql->db)
+      break;
+  }
+  if (!entry)
+    return 0;
+
+  if (entry->param_count)
+  {
+    /* let the server report the wrong number of parameters */
+    if (stmt->prebind_params)
+    {
+      if (stmt->prebind_params != entry->param_count)
+        return 0;
+    }
+    else if (!(params= (MYSQL_BIND *)ma_alloc_root(&stmt->mem_root,
+                                  entry->param_count * sizeof(MYSQL_BIND))))
+      return 0;
+    else
+      memset(params, 0, entry->param_count * sizeof(MYSQL_BIND));
+  }
+
+  ma_stmt_cache_remove(mysql, entry);
+
+  ma_free_root(&stmt_ext->fields_ma_alloc_root, MYF(0));
+  stmt_ext->fields_ma_alloc_root= entry->fields_ma_alloc_root;
+  free(stmt_ext->query);
+  stmt_ext->query= entry->query;
+  stmt_ext->query_length= entry->query_length;
+
+  stmt->stmt_id= entry->stmt_id;
+  stmt->field_count= entry->field_count;
+  stmt->param_count= entry->param_count;
+  stmt->fields= entry->fields;
+  if ((stmt->bind= entry->bind))
+    memset(stmt->bind, 0, sizeof(MYSQL_BIND) * stmt->field_count);
+  if (params)
+    stmt->params= params;
+  stmt->mysql->warning_count= stmt->upsert_status.warning_count= 0;
+  stmt->state= MYSQL_STMT_PREPARED;
+  free(entry);
+  return 1;
+}
+
 my_bool STDCALL mysql_stmt_close(MYSQL_STMT *stmt)
 {
   my_bool rc= 1;
@@ -1518,10 +1768,16 @@ my_bool STDCALL mysql_stmt_close(MYSQL_STMT *stmt)
   if (stmt)
   {
     if (stmt->mysql && stmt->mysql->net.pvio)
-      mysql_stmt_internal_reset(stmt, 1);
+    {
+      my_bool cacheable= ma_stmt_cacheable(stmt);
+
+      if (!mysql_stmt_internal_reset(stmt, 1) && cacheable)
+        ma_stmt_cache_put(stmt);
+    }
 
     rc= net_stmt_close(stmt, 1);
 
+    free(((MADB_STMT_EXTENSION *)stmt->extension)->query);
     free(stmt->extension);
     free(stmt);
   }
@@ -1557,8 +1813,96 @@ int mthd_stmt_fetch_row(MYSQL_STMT *stmt, unsigned char **row)
   return stmt->fetch_row_func(stmt, row);
 }
 
+/* size of one array element for column-wise bound result buffers */
+static size_t ma_get_fetch_element_size(MYSQL_BIND *bind)
+{
+  switch (bind->buffer_type) {
+  case MYSQL_TYPE_TIME:
+  case MYSQL_TYPE_DATE:
+  case MYSQL_TYPE_DATETIME:
+  case MYSQL_TYPE_TIMESTAMP:
+    return sizeof(MYSQL_TIME);
+  default:
+    if (mysql_ps_fetch_functions[bind->buffer_type].pack_len > 0)
+      return mysql_ps_fetch_functions[bind->buffer_type].pack_len;
+    return bind->buffer_length;
+  }
+}
+
+/*
+  Moves the bound result buffers by the given number of rows. Pointers
+  which were not provided by the application (and point to the internal
+  *_value members) stay in place.
+*/
+static void ma_stmt_shift_bind(MYSQL_STMT *stmt, long rows)
+{
+  size_t row_size= ((MADB_STMT_EXTENSION *)stmt->extension)->fetch_row_size;
+  uint i;
+
+  for (i=0; i < stmt->field_count; i++)
+  {
+    MYSQL_BIND *bind= &stmt->bind[i];
+
+    if (bind->buffer)
+      bind->buffer= (char *)bind->buffer +
+        rows * (long)(row_size ? row_size : ma_get_fetch_element_size(bind));
+    if (bind->length != &bind->length_value)
+      bind->length= (unsigned long *)((char *)bind->length +
+        rows * (long)(row_size ? row_size : sizeof(unsigned long)));
+    if (bind->is_null != &bind->is_null_value)
+      bind->is_null= (my_bool *)((char *)bind->is_null +
+        rows * (long)(row_size ? row_size : sizeof(my_bool)));
+    if (bind->error != &bind->error_value)
+      bind->error= (my_bool *)((char *)bind->error +
+        rows * (long)(row_size ? row_size : sizeof(my_bool)));
+  }
+}
+
+/*
+  Array fetch: decodes up to STMT_ATTR_FETCH_ARRAY_SIZE rows into the
+  bound buffers. If STMT_ATTR_FETCH_ROW_SIZE is set, buffers are bound
+  row-wise (one structure per row), otherwise column-wise (one array per
+  column). The number of fetched rows is available via
+  STMT_ATTR_ROWS_FETCHED.
+*/
+static int ma_stmt_fetch_array(MYSQL_STMT *stmt)
+{
+  MADB_STMT_EXTENSION *ext= (MADB_STMT_EXTENSION *)stmt->extension;
+  unsigned char *row;
+  unsigned int row_nr, shifted;
+  int rc= 0, truncated= 0;
+
+  for (row_nr= 0; row_nr < ext->fetch_array_size; row_nr++)
+  {
+    if (row_nr)
+      ma_stmt_shift_bind(stmt, 1);
+    if ((rc= stmt->mysql->methods->db_stmt_fetch(stmt, &row)))
+    {
+      stmt->state= MYSQL_STMT_FETCH_DONE;
+      stmt->mysql->status= MYSQL_STATUS_READY;
+      break;
+    }
+    if (stmt->mysql->methods->db_stmt_fetch_to_bind(stmt, row))
+      truncated= 1;
+  }
+  /* restore the application's buffer addresses */
+  if ((shifted= rc ? row_nr : row_nr - 1))
+    ma_stmt_shift_bind(stmt, -(long)shifted);
+
+  ext->rows_fetched= row_nr;
+  if (!row_nr || rc == 1)
+    return(rc);
+
+  if (!rc)
+    stmt->state= MYSQL_STMT_USER_FETCHING;
+  CLEAR_CLIENT_ERROR(stmt->mysql);
+  CLEAR_CLIENT_STMT_ERROR(stmt);
+  return(truncated ? MYSQL_DATA_TRUNCATED : 0);
+}
+
 int STDCALL mysql_stmt_fetch(MYSQL_STMT *stmt)
 {
+  MADB_STMT_EXTENSION *ext= (MADB_STMT_EXTENSION *)stmt->extension;
   unsigned char *row;
   int rc;
 
@@ -1577,9 +1921,14 @@ int STDCALL mysql_stmt_fetch(MYSQL_STMT *stmt)
     stmt->default_rset_handler(stmt);
   }
 
+  ext->rows_fetched= 0;
   if (stmt->state == MYSQL_STMT_FETCH_DONE)
     return(MYSQL_NO_DATA);
 
+  if (ext->fetch_array_size > 1 && stmt->bind_result_done &&
+      !stmt->result_callback)
+    return ma_stmt_fetch_array(stmt);
+
   if ((rc= stmt->mysql->methods->db_stmt_fetch(stmt, &row)))
   {
     stmt->state= MYSQL_STMT_FETCH_DONE;
@@ -1589,6 +1938,7 @@ int STDCALL mysql_stmt_fetch(MYSQL_STMT *stmt)
   }
 
   rc= stmt->mysql->methods->db_stmt_fetch_to_bind(stmt, row);
+  ext->rows_fetched= 1;
 
   stmt->state= MYSQL_STMT_USER_FETCHING;
   CLEAR_CLIENT_ERROR(stmt->mysql);
@@ -1797,7 +2147,7 @@ int STDCALL mysql_stmt_prepare(MYSQL_STMT *stmt, const char *query, unsigned lon
 {
   MYSQL *mysql= stmt->mysql;
   int rc= 1;
-  my_bool is_multi= 0;
+  my_bool is_multi= 0, use_cache;
 
   if (!stmt->mysql)
   {
@@ -1813,10 +2163,16 @@ int STDCALL mysql_stmt_prepare(MYSQL_STMT *stmt, const char *query, unsigned lon
   CLEAR_CLIENT_ERROR(stmt->mysql);
   stmt->upsert_status.affected_rows= mysql->affected_rows= (unsigned long long) ~0;
 
+  /* statement cache can't be used if the caller reads the response */
+  use_cache= OPT_EXT_VAL(mysql, stmt_cache_size) &&
+             mysql->net.extension->multi_status == COM_MULTI_OFF &&
+             !mysql->options.extension->skip_read_response;
+
   /* check if we have to clear results */
   if (stmt->state > MYSQL_STMT_INITTED)
   {
     char stmt_id[STMT_ID_LENGTH];
+    my_bool cacheable= ma_stmt_cacheable(stmt);
     is_multi= (mysql->net.extension->multi_status > COM_MULTI_OFF);
     /* We need to semi-close the prepared statement:
        reset stmt and free all buffers and close the statement
@@ -1829,18 +2185,43 @@ int STDCALL mysql_stmt_prepare(MYSQL_STMT *stmt, const char *query, unsigned lon
       goto fail;
 
     ma_free_root(&stmt->mem_root, MYF(MY_KEEP_PREALLOC));
-    ma_free_root(&((MADB_STMT_EXTENSION *)stmt->extension)->fields_ma_alloc_root, MYF(0));
+
+    if (!cacheable || ma_stmt_cache_put(stmt))
+    {
+      ma_free_root(&((MADB_STMT_EXTENSION *)stmt->extension)->fields_ma_alloc_root, MYF(0));
+      int4store(stmt_id, stmt->stmt_id);
+      if (mysql->methods->db_command(mysql, COM_STMT_CLOSE, stmt_id,
+                                           sizeof(stmt_id), 1, stmt))
+        goto fail;
+    }
 
     stmt->param_count= 0;
     stmt->field_count= 0;
     stmt->fields= NULL;
     stmt->params= NULL;
+  }
 
-    int4store(stmt_id, stmt->stmt_id);
-    if (mysql->methods->db_command(mysql, COM_STMT_CLOSE, stmt_id,
-                                         sizeof(stmt_id), 1, stmt))
-      goto fail;
+  if (use_cache)
+  {
+    MADB_STMT_EXTENSION *stmt_ext= (MADB_STMT_EXTENSION *)stmt->extension;
+
+    if (ma_stmt_cache_get(stmt, query, length))
+    {
+      /* send pending COM_STMT_CLOSE */
+      if (!is_multi && mysql->net.extension->multi_status == COM_MULTI_ENABLED &&
+          ma_multi_command(mysql, mysql->net.write_pos != mysql->net.buff ?
+                                  COM_MULTI_END : COM_MULTI_OFF))
+        goto fail;
+      return 0;
+    }
+    free(stmt_ext->query);
+    if ((stmt_ext->query= (char *)malloc(length ? length : 1)))
+    {
+      memcpy(stmt_ext->query, query, length);
+      stmt_ext->query_length= length;
+    }
   }
+
   if (mysql->methods->db_command(mysql, COM_STMT_PREPARE, query, length, 1, stmt))
     goto fail;
 
@@ -2621,6 +3002,9 @@ int STDCALL mariadb_stmt_execute_direct(MYSQL_STMT *stmt,
                                          sizeof(stmt_id), 1, stmt))
       goto fail;
   }
+  /* statement can't be cached, we don't know its id */
+  free(((MADB_STMT_EXTENSION *)stmt->extension)->query);
+  ((MADB_STMT_EXTENSION *)stmt->extension)->query= NULL;
   stmt->stmt_id= -1;
   if (mysql->methods->db_command(mysql, COM_STMT_PREPARE, stmt_str, length, 1, stmt))
     goto fail;
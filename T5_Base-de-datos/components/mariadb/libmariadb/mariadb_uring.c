@@ -0,0 +1,1348 @@
+/************************************************************************************
+   Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not see <http://www.gnu.org/licenses>
+   or write to the Free Software Foundation, Inc.,
+   51 Franklin St., Fifth Floor, Boston, MA 02110, USA
+*************************************************************************************/
+
+/*
+  io_uring rings for socket I/O
+
+  The ring is set up with the raw system calls and a single mmap() of the
+  submission and completion queues, no liburing is needed. A request is
+  identified by its connection and a tag in the low bits of user_data.
+
+  Receiving: a receive selects its buffer from a ring of provided buffers
+  (IORING_REGISTER_PBUF_RING) shared by all connections of the ring.
+  Buffers are queued per connection in the order they were filled and
+  returned to the kernel as soon as they were copied out. If all buffers
+  are in use the receive stops with ENOBUFS; until buffers were returned a
+  readiness poll is armed instead and the data is read with a plain recv().
+  With the non-blocking API on a shared ring the receive is multishot
+  where the kernel supports it, so it stays armed and produces a
+  completion for every chunk of data which arrives. The blocking API only
+  arms a single receive while it waits for data: nothing is left armed
+  when it returns, so the application may poll the socket itself.
+
+  Sending: writes are copied into a staging buffer of the connection. With
+  the blocking API a write returns when the data was sent, like a write on
+  the socket (e.g. mysql_send_query() followed by polling the socket).
+  With the non-blocking API on a shared ring the send is queued and
+  submitted with the next io_uring_enter() of the ring, together with the
+  sends of all other connections. At most one send per connection is in
+  flight, a write timeout is a linked timeout of the send.
+*/
+
+#include <ma_global.h>
+#include <ma_sys.h>
+#include <mysql.h>
+#include <ma_common.h>
+#include <ma_context.h>
+#include <ma_pvio.h>
+#include <mariadb_uring.h>
+#include <ma_uring.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+/* provided buffer rings came with the headers of Linux 5.19 */
+#ifdef IORING_ASYNC_CANCEL_FD
+#define MA_URING_ENABLED 1
+#endif
+#endif
+
+#ifdef MA_URING_ENABLED
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define MA_URING_DEFAULT_ENTRIES   256
+#define MA_URING_MAX_ENTRIES       32768
+#define MA_URING_PRIVATE_ENTRIES   16
+#define MA_URING_PRIVATE_BUFFERS   8
+#define MA_URING_MAX_BUFFERS       32768
+#define MA_URING_BUFFER_SIZE       8192
+#define MA_URING_BUFFER_GROUP      0
+#define MA_URING_STAGE_MIN         16384
+#define MA_URING_SEND_FLUSH        (256 * 1024)   /* send when more is staged */
+
+enum enum_ma_uring_tag {
+  MA_URING_RECV= 1,
+  MA_URING_SEND,
+  MA_URING_LINK_TIMEOUT,
+  MA_URING_POLL,
+  MA_URING_CANCEL
+};
+#define MA_URING_TAG_MASK 7
+
+/* operation a non-blocking connection is suspended in */
+#define MA_URING_WAIT_READ  1
+#define MA_URING_WAIT_WRITE 2
+
+struct st_ma_uring_conn {
+  MARIADB_URING *ring;
+  MARIADB_PVIO *pvio;
+  my_socket fd;
+  unsigned int inflight;         /* requests without final completion */
+  my_bool recv_armed;
+  my_bool poll_armed;
+  my_bool poll_ready;            /* socket is readable, use recv() */
+  my_bool eof;
+  int error;                     /* receive error (errno) */
+  int send_error;
+  /* received data: list of buffers */
+  int rx_first, rx_last;
+  size_t rx_pos;                 /* offset in the first buffer */
+  size_t rx_bytes;
+  /* staged data and the data of the send in flight */
+  uchar *stage;
+  size_t stage_len, stage_size;
+  uchar *sending;
+  size_t send_pos, send_len, sending_size;
+  my_bool send_inflight;
+  int write_timeout;             /* milliseconds, <= 0 = none */
+  struct __kernel_timespec send_ts;
+  unsigned int waiting;          /* MA_URING_WAIT_xxx */
+  my_bool ready;                 /* in the ready list of the ring */
+  struct st_ma_uring_conn *ready_next;
+  my_bool deferred;              /* in the deferred list of the ring */
+  struct st_ma_uring_conn *deferred_next;
+};
+
+struct st_mariadb_uring {
+  int fd;
+  unsigned int refs;
+  my_bool shared;
+  /* submission queue */
+  unsigned int *sq_head, *sq_tail, *sq_flags;
+  unsigned int sq_mask, sq_entries;
+  unsigned int sqe_tail;         /* local tail, published by ma_uring_enter() */
+  struct io_uring_sqe *sqes;
+  /* completion queue */
+  unsigned int *cq_head, *cq_tail;
+  unsigned int cq_mask;
+  struct io_uring_cqe *cqes;
+  void *ring_map;
+  size_t ring_map_size;
+  size_t sqes_size;
+  my_bool multishot;             /* multishot receive supported */
+  my_bool recv_ok;               /* a receive completed with data */
+  /* provided receive buffers */
+  struct io_uring_buf_ring *br;
+  size_t br_size;
+  uchar *buf_base;
+  unsigned int buf_count, buf_size;
+  unsigned int buf_avail;        /* buffers the kernel may fill */
+  unsigned short br_tail;
+  int *buf_len;
+  int *buf_next;
+  my_bool buf_registered;
+  my_bool buf_failed;            /* no provided buffers, only polls */
+  /* connections which can continue, see mariadb_uring_wait() */
+  MA_URING_CONN *ready_first, *ready_last;
+  /* connections whose send didn't fit into the submission queue */
+  MA_URING_CONN *deferred_first;
+  MARIADB_URING_STATS stats;
+};
+
+static unsigned long long ma_uring_time(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* {{{ ring setup */
+static void ma_uring_free(MARIADB_URING *ring)
+{
+  if (ring->br)
+    munmap(ring->br, ring->br_size);
+  free(ring->buf_base);
+  free(ring->buf_len);
+  free(ring->buf_next);
+  if (ring->sqes)
+    munmap(ring->sqes, ring->sqes_size);
+  if (ring->ring_map)
+    munmap(ring->ring_map, ring->ring_map_size);
+  if (ring->fd >= 0)
+    close(ring->fd);
+  free(ring);
+}
+
+static MARIADB_URING *ma_uring_create(unsigned int entries, unsigned int buffers)
+{
+  MARIADB_URING *ring;
+  struct io_uring_params p;
+  unsigned int features= IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP |
+                         IORING_FEAT_EXT_ARG;
+  unsigned int flags= IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+  uchar *map;
+  unsigned int i;
+
+
+  if (!(ring= (MARIADB_URING *)calloc(1, sizeof(MARIADB_URING))))
+    return NULL;
+  ring->refs= 1;
+  ring->buf_count= buffers;
+  ring->buf_size= MA_URING_BUFFER_SIZE;
+
+  memset(&p, 0, sizeof(p));
+  p.flags= flags;
+  /* older kernels reject setup flags they don't know */
+  if ((ring->fd= (int)syscall(__NR_io_uring_setup, entries, &p)) < 0 &&
+      errno == EINVAL && flags)
+  {
+    memset(&p, 0, sizeof(p));
+    ring->fd= (int)syscall(__NR_io_uring_setup, entries, &p);
+  }
+  if (ring->fd < 0 || (p.features & features) != features)
+    goto error;
+
+  ring->ring_map_size= MAX(p.sq_off.array + p.sq_entries * sizeof(unsigned int),
+                           p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe));
+  ring->sqes_size= p.sq_entries * sizeof(struct io_uring_sqe);
+  if ((map= mmap(NULL, ring->ring_map_size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, ring->fd,
+                 IORING_OFF_SQ_RING)) == MAP_FAILED)
+    goto error;
+  ring->ring_map= map;
+  if ((ring->sqes= mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd,
+                        IORING_OFF_SQES)) == MAP_FAILED)
+  {
+    ring->sqes= NULL;
+    goto error;
+  }
+
+  ring->sq_head= (unsigned int *)(map + p.sq_off.head);
+  ring->sq_tail= (unsigned int *)(map + p.sq_off.tail);
+  ring->sq_flags= (unsigned int *)(map + p.sq_off.flags);
+  ring->sq_mask= *(unsigned int *)(map + p.sq_off.ring_mask);
+  ring->sq_entries= p.sq_entries;
+  ring->cq_head= (unsigned int *)(map + p.cq_off.head);
+  ring->cq_tail= (unsigned int *)(map + p.cq_off.tail);
+  ring->cq_mask= *(unsigned int *)(map + p.cq_off.ring_mask);
+  ring->cqes= (struct io_uring_cqe *)(map + p.cq_off.cqes);
+  ring->sqe_tail= *ring->sq_tail;
+
+  /* submission queue entries are always used in order */
+  for (i= 0; i < p.sq_entries; i++)
+    ((unsigned int *)(map + p.sq_off.array))[i]= i;
+
+#ifdef IORING_RECV_MULTISHOT
+  ring->multishot= 1;
+#endif
+  return ring;
+error:
+  ma_uring_free(ring);
+  return NULL;
+}
+
+/* returns a buffer to the kernel */
+static void ma_uring_buf_recycle(MARIADB_URING *ring, int bid)
+{
+  struct io_uring_buf *buf= &ring->br->bufs[ring->br_tail & (ring->buf_count - 1)];
+
+  buf->addr= (unsigned long long)(size_t)(ring->buf_base + (size_t)bid * ring->buf_size);
+  buf->len= ring->buf_size;
+  buf->bid= (unsigned short)bid;
+  ring->br_tail++;
+  __atomic_store_n(&ring->br->tail, ring->br_tail, __ATOMIC_RELEASE);
+  ring->buf_avail++;
+}
+
+/*
+  Registers the receive buffers when the first connection is attached,
+  so the buffer options can be set after mariadb_uring_init(). If the
+  kernel doesn't support provided buffer rings, receives use polls.
+*/
+static void ma_uring_setup_buffers(MARIADB_URING *ring)
+{
+  struct io_uring_buf_reg reg;
+  long page= sysconf(_SC_PAGESIZE);
+  unsigned int i;
+
+  ring->br_size= (ring->buf_count * sizeof(struct io_uring_buf) + page - 1) & ~(page - 1);
+  if ((ring->br= mmap(NULL, ring->br_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+  {
+    ring->br= NULL;
+    goto error;
+  }
+  if (!(ring->buf_base= (uchar *)malloc((size_t)ring->buf_count * ring->buf_size)) ||
+      !(ring->buf_len= (int *)calloc(ring->buf_count, sizeof(int))) ||
+      !(ring->buf_next= (int *)calloc(ring->buf_count, sizeof(int))))
+    goto error;
+
+  memset(&reg, 0, sizeof(reg));
+  reg.ring_addr= (unsigned long long)(size_t)ring->br;
+  reg.ring_entries= ring->buf_count;
+  reg.bgid= MA_URING_BUFFER_GROUP;
+  if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    goto error;
+
+  for (i= 0; i < ring->buf_count; i++)
+    ma_uring_buf_recycle(ring, i);
+  ring->buf_registered= 1;
+  return;
+error:
+  if (ring->br)
+    munmap(ring->br, ring->br_size);
+  ring->br= NULL;
+  free(ring->buf_base);
+  free(ring->buf_len);
+  free(ring->buf_next);
+  ring->buf_base= NULL;
+  ring->buf_len= ring->buf_next= NULL;
+  ring->buf_failed= 1;
+}
+/* }}} */
+
+/* {{{ submission and completion */
+/*
+  Publishes the queued submissions and enters the kernel. If wait_nr is
+  set, blocks until that many completions are available or timeout
+  (milliseconds, < 0 = none) has expired. Returns the number of
+  submissions or -errno.
+*/
+static int ma_uring_enter(MARIADB_URING *ring, unsigned int wait_nr, int timeout)
+{
+  struct io_uring_getevents_arg arg;
+  struct __kernel_timespec ts;
+  unsigned int flags= wait_nr ? IORING_ENTER_GETEVENTS : 0;
+  unsigned int to_submit;
+  void *argp= NULL;
+  size_t argsz= 0;
+  int rc;
+
+  __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+  to_submit= ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  if (!to_submit && !wait_nr)
+    return 0;
+  if (wait_nr && timeout >= 0)
+  {
+    ts.tv_sec= timeout / 1000;
+    ts.tv_nsec= (timeout % 1000) * 1000000LL;
+    memset(&arg, 0, sizeof(arg));
+    arg.ts= (unsigned long long)(size_t)&ts;
+    argp= &arg;
+    argsz= sizeof(arg);
+    flags|= IORING_ENTER_EXT_ARG;
+  }
+  ring->stats.enters++;
+  rc= (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, wait_nr,
+                   flags, argp, argsz);
+  if (rc < 0)
+    return -errno;
+  ring->stats.submitted+= rc;
+  return rc;
+}
+
+static struct io_uring_sqe *ma_uring_get_sqe(MARIADB_URING *ring)
+{
+  struct io_uring_sqe *sqe;
+
+  if (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries)
+  {
+    /* submission queue is full */
+    ma_uring_enter(ring, 0, 0);
+    if (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries)
+      return NULL;
+  }
+  sqe= &ring->sqes[ring->sqe_tail & ring->sq_mask];
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  ring->sqe_tail++;
+  return sqe;
+}
+
+static unsigned int ma_uring_sq_space(MARIADB_URING *ring)
+{
+  return ring->sq_entries -
+         (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE));
+}
+
+static unsigned long long ma_uring_user_data(MA_URING_CONN *conn, enum enum_ma_uring_tag tag)
+{
+  return (unsigned long long)(size_t)conn | tag;
+}
+
+static my_bool ma_uring_readable(MA_URING_CONN *conn)
+{
+  return conn->rx_bytes || conn->eof || conn->error || conn->poll_ready ||
+         conn->send_error;
+}
+
+/* queues a connection for mariadb_uring_wait() if it waits for this */
+static void ma_uring_notify(MA_URING_CONN *conn)
+{
+  MARIADB_URING *ring= conn->ring;
+
+  if (conn->ready || !conn->waiting)
+    return;
+  if (!(((conn->waiting & MA_URING_WAIT_READ) && ma_uring_readable(conn)) ||
+        ((conn->waiting & MA_URING_WAIT_WRITE) &&
+         (conn->stage_len < MA_URING_SEND_FLUSH || conn->send_error))))
+    return;
+  conn->ready= 1;
+  conn->ready_next= NULL;
+  if (ring->ready_last)
+    ring->ready_last->ready_next= conn;
+  else
+    ring->ready_first= conn;
+  ring->ready_last= conn;
+}
+
+/*
+  Arms a receive, or a poll if there are no free buffers. A multishot
+  receive stays armed after data arrived, it is only used for connections
+  which wait in mariadb_uring_wait().
+*/
+static void ma_uring_arm(MA_URING_CONN *conn, my_bool multishot)
+{
+  MARIADB_URING *ring= conn->ring;
+  struct io_uring_sqe *sqe;
+
+  if (conn->recv_armed || conn->poll_armed || ma_uring_readable(conn))
+    return;
+  if (!(sqe= ma_uring_get_sqe(ring)))
+    return;
+  sqe->fd= conn->fd;
+  if (ring->buf_registered && ring->buf_avail)
+  {
+    sqe->opcode= IORING_OP_RECV;
+    sqe->flags= IOSQE_BUFFER_SELECT;
+    sqe->buf_group= MA_URING_BUFFER_GROUP;
+#ifdef IORING_RECV_MULTISHOT
+    if (multishot && ring->multishot)
+      sqe->ioprio= IORING_RECV_MULTISHOT;
+#endif
+    sqe->user_data= ma_uring_user_data(conn, MA_URING_RECV);
+    conn->recv_armed= 1;
+    ring->stats.recv_armed++;
+  }
+  else
+  {
+    unsigned int events= POLLIN;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    events= (events << 16) | (events >> 16);
+#endif
+    sqe->opcode= IORING_OP_POLL_ADD;
+    sqe->poll32_events= events;
+    sqe->user_data= ma_uring_user_data(conn, MA_URING_POLL);
+    conn->poll_armed= 1;
+    ring->stats.polls++;
+  }
+  conn->inflight++;
+}
+
+/* data which was not sent yet */
+static my_bool ma_uring_unsent(MA_URING_CONN *conn)
+{
+  return conn->send_inflight || conn->stage_len || conn->send_pos != conn->send_len;
+}
+
+/*
+  Queues a send of the staged data, if no send is in flight. If the
+  submission queue is full, e.g. because the kernel doesn't take
+  submissions while completions are pending, the data stays staged and
+  ma_uring_reap() queues the send after it processed the completions.
+*/
+static void ma_uring_flush(MA_URING_CONN *conn)
+{
+  MARIADB_URING *ring= conn->ring;
+  struct io_uring_sqe *sqe;
+  uchar *buffer;
+  size_t size;
+
+  if (conn->send_inflight || conn->send_error ||
+      (!conn->stage_len && conn->send_pos == conn->send_len))
+    return;
+  /* a send with linked timeout needs two entries */
+  if (ma_uring_sq_space(ring) < 2)
+    ma_uring_enter(ring, 0, 0);
+  if (ma_uring_sq_space(ring) < 2)
+  {
+    if (!conn->deferred)
+    {
+      conn->deferred= 1;
+      conn->deferred_next= ring->deferred_first;
+      ring->deferred_first= conn;
+    }
+    return;
+  }
+  if (conn->send_pos == conn->send_len)
+  {
+    /* swap the buffers, staging continues behind the send */
+    buffer= conn->sending;
+    size= conn->sending_size;
+    conn->sending= conn->stage;
+    conn->sending_size= conn->stage_size;
+    conn->send_pos= 0;
+    conn->send_len= conn->stage_len;
+    conn->stage= buffer;
+    conn->stage_size= size;
+    conn->stage_len= 0;
+  }
+  sqe= ma_uring_get_sqe(ring);
+  sqe->opcode= IORING_OP_SEND;
+  sqe->fd= conn->fd;
+  sqe->addr= (unsigned long long)(size_t)(conn->sending + conn->send_pos);
+  sqe->len= (unsigned int)MIN(conn->send_len - conn->send_pos, 0x7ffff000);
+  sqe->msg_flags= MSG_NOSIGNAL;
+  sqe->user_data= ma_uring_user_data(conn, MA_URING_SEND);
+  conn->send_inflight= 1;
+  conn->inflight++;
+  if (conn->write_timeout > 0)
+  {
+    sqe->flags= IOSQE_IO_LINK;
+    conn->send_ts.tv_sec= conn->write_timeout / 1000;
+    conn->send_ts.tv_nsec= (conn->write_timeout % 1000) * 1000000LL;
+    sqe= ma_uring_get_sqe(ring);
+    sqe->opcode= IORING_OP_LINK_TIMEOUT;
+    sqe->fd= -1;
+    sqe->addr= (unsigned long long)(size_t)&conn->send_ts;
+    sqe->len= 1;
+    sqe->user_data= ma_uring_user_data(conn, MA_URING_LINK_TIMEOUT);
+    conn->inflight++;
+  }
+}
+
+static void ma_uring_complete(MARIADB_URING *ring, unsigned long long user_data,
+                              int res, unsigned int flags)
+{
+  MA_URING_CONN *conn= (MA_URING_CONN *)(size_t)(user_data & ~(unsigned long long)MA_URING_TAG_MASK);
+
+  switch (user_data & MA_URING_TAG_MASK) {
+  case MA_URING_RECV:
+    if (!(flags & IORING_CQE_F_MORE))
+    {
+      conn->recv_armed= 0;
+      conn->inflight--;
+    }
+    if (flags & IORING_CQE_F_BUFFER)
+    {
+      int bid= (int)(flags >> IORING_CQE_BUFFER_SHIFT);
+
+      ring->buf_avail--;
+      if (res <= 0)
+        ma_uring_buf_recycle(ring, bid);
+      else
+      {
+        ring->buf_len[bid]= res;
+        ring->buf_next[bid]= -1;
+        if (conn->rx_last >= 0)
+          ring->buf_next[conn->rx_last]= bid;
+        else
+          conn->rx_first= bid;
+        conn->rx_last= bid;
+        conn->rx_bytes+= res;
+        ring->recv_ok= 1;
+        ring->stats.receives++;
+        ring->stats.bytes_received+= res;
+      }
+    }
+    if (res == 0)
+      conn->eof= 1;
+    else if (res == -ENOBUFS)
+      ring->stats.no_buffers++;
+    else if (res == -EINVAL && ring->multishot && !ring->recv_ok)
+      ring->multishot= 0;                  /* kernel without multishot receive */
+    else if (res < 0 && res != -ECANCELED && res != -EINTR)
+      conn->error= -res;
+    /* a suspended connection must not lose its receive, unless it was
+       cancelled on purpose */
+    if (!conn->recv_armed && (conn->waiting & MA_URING_WAIT_READ) &&
+        res != -ECANCELED)
+      ma_uring_arm(conn, 1);
+    break;
+  case MA_URING_POLL:
+    conn->poll_armed= 0;
+    conn->inflight--;
+    if (res != -ECANCELED)
+      conn->poll_ready= 1;
+    break;
+  case MA_URING_SEND:
+    conn->send_inflight= 0;
+    conn->inflight--;
+    if (res >= 0)
+    {
+      ring->stats.sends++;
+      ring->stats.bytes_sent+= res;
+      conn->send_pos+= res;
+    }
+    else if (res == -ECANCELED)
+      conn->send_error= ETIMEDOUT;         /* by the linked timeout */
+    else if (res != -EINTR && res != -EAGAIN)
+      conn->send_error= -res;
+    /* send the remainder of a short send, and what was staged meanwhile */
+    ma_uring_flush(conn);
+    break;
+  case MA_URING_LINK_TIMEOUT:
+    conn->inflight--;
+    if (res == -ETIME)
+      ring->stats.timeouts++;
+    break;
+  case MA_URING_CANCEL:
+    conn->inflight--;
+    break;
+  }
+  ma_uring_notify(conn);
+}
+
+/* retries the sends which didn't fit into the submission queue */
+static void ma_uring_flush_deferred(MARIADB_URING *ring)
+{
+  MA_URING_CONN *conn= ring->deferred_first;
+
+  /* a send which still doesn't fit is deferred again */
+  ring->deferred_first= NULL;
+  while (conn)
+  {
+    MA_URING_CONN *next= conn->deferred_next;
+
+    conn->deferred= 0;
+    ma_uring_flush(conn);
+    ma_uring_notify(conn);
+    conn= next;
+  }
+}
+
+static void ma_uring_reap(MARIADB_URING *ring)
+{
+  unsigned int head= *ring->cq_head;
+
+  for (;;)
+  {
+    while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+    {
+      struct io_uring_cqe *cqe= &ring->cqes[head & ring->cq_mask];
+      unsigned long long user_data= cqe->user_data;
+      int res= cqe->res;
+      unsigned int flags= cqe->flags;
+
+      /* release the entry first, completing may enter the kernel */
+      __atomic_store_n(ring->cq_head, ++head, __ATOMIC_RELEASE);
+      ring->stats.completed++;
+      ma_uring_complete(ring, user_data, res, flags);
+    }
+    /* completions which didn't fit into the queue are kept by the kernel */
+    if (!(__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW))
+      break;
+    ring->stats.enters++;
+    syscall(__NR_io_uring_enter, ring->fd, 0, 0, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+      break;
+  }
+  if (ring->deferred_first)
+    ma_uring_flush_deferred(ring);
+}
+
+/* waits for completions, returns 0, -1 with errno = ETIMEDOUT or -1 on error */
+static int ma_uring_wait_for(MARIADB_URING *ring, unsigned int wait_nr,
+                             unsigned long long deadline, int timeout)
+{
+  int rc;
+
+  if (timeout > 0)
+  {
+    unsigned long long now= ma_uring_time();
+    if (now >= deadline)
+    {
+      errno= ETIMEDOUT;
+      return -1;
+    }
+    timeout= (int)(deadline - now);
+  }
+  /* ma_uring_reap() queues deferred sends, they may be waited for */
+  if (ring->deferred_first)
+    wait_nr= 0;
+  if ((rc= ma_uring_enter(ring, wait_nr, timeout)) < 0 &&
+      rc != -ETIME && rc != -EINTR && rc != -EBUSY)
+  {
+    errno= -rc;
+    return -1;
+  }
+  ma_uring_reap(ring);
+  return 0;
+}
+
+/* cancels the request of a connection which is identified by tag */
+static void ma_uring_cancel(MA_URING_CONN *conn, enum enum_ma_uring_tag tag)
+{
+  struct io_uring_sqe *sqe;
+
+  if (!(sqe= ma_uring_get_sqe(conn->ring)))
+    return;
+  sqe->opcode= IORING_OP_ASYNC_CANCEL;
+  sqe->fd= -1;
+  sqe->addr= ma_uring_user_data(conn, tag);
+  sqe->user_data= ma_uring_user_data(conn, MA_URING_CANCEL);
+  conn->inflight++;
+}
+
+/*
+  Cancels the receive or poll which a blocking read left armed when it
+  gave up, so that it doesn't take data from the socket behind the
+  application's back.
+*/
+static void ma_uring_disarm(MA_URING_CONN *conn)
+{
+  int save_errno= errno;
+
+  if (conn->recv_armed)
+    ma_uring_cancel(conn, MA_URING_RECV);
+  if (conn->poll_armed)
+    ma_uring_cancel(conn, MA_URING_POLL);
+  ma_uring_enter(conn->ring, 0, 0);
+  errno= save_errno;
+}
+
+/*
+  Waits until the connection has no requests in the kernel. Staged data
+  is sent first, unless discard is set: then only what can be sent
+  without waiting goes out (e.g. COM_QUIT before closing).
+*/
+static int ma_uring_quiesce(MA_URING_CONN *conn, my_bool discard)
+{
+  MARIADB_URING *ring= conn->ring;
+
+  ma_uring_flush(conn);
+  ma_uring_enter(ring, 0, 0);
+  ma_uring_reap(ring);
+  while (!discard && !conn->send_error && ma_uring_unsent(conn))
+  {
+    ma_uring_flush(conn);
+    if (ma_uring_wait_for(ring, 1, 0, -1))
+      return 1;
+  }
+  if (conn->recv_armed)
+    ma_uring_cancel(conn, MA_URING_RECV);
+  if (conn->poll_armed)
+    ma_uring_cancel(conn, MA_URING_POLL);
+  if (conn->send_inflight)
+    ma_uring_cancel(conn, MA_URING_SEND);
+  while (conn->inflight)
+    if (ma_uring_wait_for(ring, 1, 0, -1))
+      return 1;
+  return 0;
+}
+
+/* copies received data, returns the number of bytes */
+static size_t ma_uring_copy(MA_URING_CONN *conn, uchar *buffer, size_t length)
+{
+  MARIADB_URING *ring= conn->ring;
+  size_t copied= 0;
+
+  while (copied < length && conn->rx_first >= 0)
+  {
+    int bid= conn->rx_first;
+    size_t n= MIN((size_t)ring->buf_len[bid] - conn->rx_pos, length - copied);
+
+    memcpy(buffer + copied,
+           ring->buf_base + (size_t)bid * ring->buf_size + conn->rx_pos, n);
+    copied+= n;
+    conn->rx_pos+= n;
+    if (conn->rx_pos == (size_t)ring->buf_len[bid])
+    {
+      if ((conn->rx_first= ring->buf_next[bid]) < 0)
+        conn->rx_last= -1;
+      conn->rx_pos= 0;
+      ma_uring_buf_recycle(ring, bid);
+    }
+  }
+  conn->rx_bytes-= copied;
+  return copied;
+}
+
+/*
+  Returns what is available for reading: data, end of file or an error.
+  Returns MA_URING_NO_DATA if the connection has to wait.
+*/
+static ssize_t ma_uring_take(MA_URING_CONN *conn, uchar *buffer, size_t length)
+{
+  ssize_t r;
+
+  ma_uring_reap(conn->ring);
+  if (conn->rx_bytes)
+    return (ssize_t)ma_uring_copy(conn, buffer, length);
+  if (conn->error || conn->send_error)
+  {
+    errno= conn->error ? conn->error : conn->send_error;
+    return -1;
+  }
+  if (conn->eof)
+    return 0;
+  if (conn->poll_ready)
+  {
+    if ((r= recv(conn->fd, buffer, length, MSG_DONTWAIT)) >= 0)
+    {
+      /* a short read emptied the socket */
+      if ((size_t)r < length)
+        conn->poll_ready= 0;
+      return r;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      return -1;
+    conn->poll_ready= 0;
+  }
+  return MA_URING_NO_DATA;
+}
+
+static int ma_uring_stage(MA_URING_CONN *conn, const uchar *buffer, size_t length)
+{
+  if (conn->stage_len + length > conn->stage_size)
+  {
+    size_t size= MAX(conn->stage_size * 2, MA_URING_STAGE_MIN);
+    uchar *stage;
+
+    while (size < conn->stage_len + length)
+      size*= 2;
+    if (!(stage= (uchar *)realloc(conn->stage, size)))
+      return 1;
+    conn->stage= stage;
+    conn->stage_size= size;
+  }
+  memcpy(conn->stage + conn->stage_len, buffer, length);
+  conn->stage_len+= length;
+  return 0;
+}
+/* }}} */
+
+/* {{{ connection I/O, used by pvio_uring */
+MARIADB_URING *ma_uring_private(void)
+{
+  return ma_uring_create(MA_URING_PRIVATE_ENTRIES, MA_URING_PRIVATE_BUFFERS);
+}
+
+void ma_uring_ref(MARIADB_URING *ring)
+{
+  ring->refs++;
+}
+
+void ma_uring_unref(MARIADB_URING *ring)
+{
+  if (ring && !--ring->refs)
+    ma_uring_free(ring);
+}
+
+MA_URING_CONN *ma_uring_attach(MARIADB_URING *ring, MARIADB_PVIO *pvio, my_socket fd)
+{
+  MA_URING_CONN *conn;
+
+  if (!(conn= (MA_URING_CONN *)calloc(1, sizeof(MA_URING_CONN))))
+    return NULL;
+  if (!ring->buf_registered && !ring->buf_failed)
+    ma_uring_setup_buffers(ring);
+  conn->ring= ring;
+  conn->pvio= pvio;
+  conn->fd= fd;
+  conn->rx_first= conn->rx_last= -1;
+  ma_uring_ref(ring);
+  ring->stats.connections++;
+  return conn;
+}
+
+void ma_uring_detach(MA_URING_CONN *conn)
+{
+  MARIADB_URING *ring= conn->ring;
+  MA_URING_CONN *c, *prev= NULL;
+
+  /* the kernel may still complete requests of the connection */
+  if (ma_uring_quiesce(conn, 1))
+    return;
+  while (conn->rx_first >= 0)
+  {
+    int bid= conn->rx_first;
+    conn->rx_first= ring->buf_next[bid];
+    ma_uring_buf_recycle(ring, bid);
+  }
+  if (conn->ready)
+  {
+    for (c= ring->ready_first; c != conn; c= c->ready_next)
+      prev= c;
+    if (prev)
+      prev->ready_next= conn->ready_next;
+    else
+      ring->ready_first= conn->ready_next;
+    if (ring->ready_last == conn)
+      ring->ready_last= prev;
+  }
+  if (conn->deferred)
+  {
+    MA_URING_CONN **next= &ring->deferred_first;
+
+    while (*next != conn)
+      next= &(*next)->deferred_next;
+    *next= conn->deferred_next;
+  }
+  free(conn->stage);
+  free(conn->sending);
+  ring->stats.connections--;
+  free(conn);
+  ma_uring_unref(ring);
+}
+
+my_bool ma_uring_is_shared(MA_URING_CONN *conn)
+{
+  return conn->ring->shared;
+}
+
+size_t ma_uring_pending(MA_URING_CONN *conn)
+{
+  ma_uring_reap(conn->ring);
+  return conn->rx_bytes;
+}
+
+/*
+  Stops the ring I/O of the connection, so that the socket can be used
+  directly, and returns data which was already received.
+*/
+ssize_t ma_uring_release(MA_URING_CONN *conn, uchar *buffer, size_t length)
+{
+  if (!conn->recv_armed && !conn->poll_armed && !conn->inflight &&
+      !ma_uring_unsent(conn) && !conn->rx_bytes && !conn->poll_ready)
+    return MA_URING_NO_DATA;
+  if (ma_uring_quiesce(conn, 0))
+    return -1;
+  conn->poll_ready= 0;
+  if (conn->send_error)
+  {
+    errno= conn->send_error;
+    return -1;
+  }
+  if (conn->rx_bytes && length)
+    return (ssize_t)ma_uring_copy(conn, buffer, length);
+  return MA_URING_NO_DATA;
+}
+
+ssize_t ma_uring_read(MA_URING_CONN *conn, uchar *buffer, size_t length, int timeout)
+{
+  unsigned long long deadline= timeout > 0 ? ma_uring_time() + timeout : 0;
+  ssize_t r;
+
+  for (;;)
+  {
+    if ((r= ma_uring_take(conn, buffer, length)) != MA_URING_NO_DATA)
+      return r;
+    if (!timeout)
+    {
+      /* don't leave a receive armed, read what the socket has */
+      if (!conn->recv_armed && !conn->poll_armed)
+        return recv(conn->fd, buffer, length, MSG_DONTWAIT);
+      errno= EAGAIN;
+      return -1;
+    }
+    ma_uring_arm(conn, 0);
+    /*
+      Requests of the connection other than the receive (e.g. a linked
+      timeout) complete without waiting for the server, so wait for them
+      and the response at once instead of waking up for each.
+    */
+    if (ma_uring_wait_for(conn->ring, MAX(conn->inflight, 1), deadline, timeout))
+    {
+      if (errno == ETIMEDOUT)
+        conn->ring->stats.timeouts++;
+      ma_uring_disarm(conn);
+      return -1;
+    }
+  }
+}
+
+ssize_t ma_uring_write(MA_URING_CONN *conn, const MA_PVIO_IOVEC *iov, int iovcnt, int timeout)
+{
+  size_t total= 0;
+  int i;
+
+  ma_uring_reap(conn->ring);
+  if (conn->send_error)
+  {
+    errno= conn->send_error;
+    return -1;
+  }
+  conn->write_timeout= timeout;
+  for (i= 0; i < iovcnt; i++)
+  {
+    if (ma_uring_stage(conn, iov[i].base, iov[i].length))
+    {
+      errno= ENOMEM;
+      return total ? (ssize_t)total : -1;
+    }
+    total+= iov[i].length;
+  }
+  /*
+    The blocking API returns when the data is on the wire, the application
+    may wait for the response on the socket. A write timeout cancels the
+    send by its linked timeout.
+  */
+  ma_uring_flush(conn);
+  while (ma_uring_unsent(conn) && !conn->send_error)
+  {
+    if (ma_uring_wait_for(conn->ring, 1, 0, -1))
+      return -1;
+    ma_uring_flush(conn);
+  }
+  if (conn->send_error)
+  {
+    errno= conn->send_error;
+    return -1;
+  }
+  return (ssize_t)total;
+}
+
+ssize_t ma_uring_async_read(MA_URING_CONN *conn, uchar *buffer, size_t length)
+{
+  ssize_t r;
+
+  conn->waiting&= ~MA_URING_WAIT_READ;
+  if ((r= ma_uring_take(conn, buffer, length)) != MA_URING_NO_DATA)
+    return r;
+  /* submitted by the next mariadb_uring_wait() or mariadb_uring_submit() */
+  ma_uring_flush(conn);
+  ma_uring_arm(conn, 1);
+  conn->waiting|= MA_URING_WAIT_READ;
+  errno= EAGAIN;
+  return -1;
+}
+
+ssize_t ma_uring_async_write(MA_URING_CONN *conn, const uchar *buffer, size_t length,
+                             int timeout)
+{
+  conn->waiting&= ~MA_URING_WAIT_WRITE;
+  ma_uring_reap(conn->ring);
+  if (conn->send_error)
+  {
+    errno= conn->send_error;
+    return -1;
+  }
+  conn->write_timeout= timeout;
+  if (conn->stage_len >= MA_URING_SEND_FLUSH)
+  {
+    conn->waiting|= MA_URING_WAIT_WRITE;
+    errno= EAGAIN;
+    return -1;
+  }
+  if (ma_uring_stage(conn, buffer, length))
+  {
+    errno= ENOMEM;
+    return -1;
+  }
+  ma_uring_flush(conn);
+  return (ssize_t)length;
+}
+
+int ma_uring_wait_io(MA_URING_CONN *conn, my_bool is_read, int timeout)
+{
+  unsigned long long deadline= timeout > 0 ? ma_uring_time() + timeout : 0;
+
+  ma_uring_flush(conn);
+  if (!is_read)
+  {
+    ma_uring_enter(conn->ring, 0, 0);
+    return 1;
+  }
+  for (;;)
+  {
+    ma_uring_reap(conn->ring);
+    if (ma_uring_readable(conn))
+      return 1;
+    if (!timeout)
+    {
+      struct pollfd pfd;
+
+      if (conn->recv_armed || conn->poll_armed)
+        return 0;
+      pfd.fd= conn->fd;
+      pfd.events= POLLIN;
+      return poll(&pfd, 1, 0);
+    }
+    ma_uring_arm(conn, 0);
+    if (ma_uring_wait_for(conn->ring, 1, deadline, timeout))
+    {
+      ma_uring_disarm(conn);
+      if (errno != ETIMEDOUT)
+        return -1;
+      conn->ring->stats.timeouts++;
+      return 0;
+    }
+  }
+}
+/* }}} */
+
+/* {{{ API */
+MARIADB_URING * STDCALL mariadb_uring_init(unsigned int entries)
+{
+  MARIADB_URING *ring;
+  unsigned int buffers= 1;
+
+  if (!entries)
+    entries= MA_URING_DEFAULT_ENTRIES;
+  entries= MIN(entries, MA_URING_MAX_ENTRIES);
+  /* one receive buffer per entry */
+  while (buffers < entries && buffers < MA_URING_MAX_BUFFERS)
+    buffers*= 2;
+  if ((ring= ma_uring_create(entries, buffers)))
+    ring->shared= 1;
+  return ring;
+}
+
+int STDCALL mariadb_uring_optionsv(MARIADB_URING *ring,
+                                   enum mariadb_uring_option option,
+                                   ...)
+{
+  va_list ap;
+  unsigned int value;
+  int rc= 0;
+
+  /* buffers can't be changed after a connection was attached */
+  if (!ring || ring->buf_registered || ring->buf_failed)
+    return 1;
+
+  va_start(ap, option);
+  value= va_arg(ap, unsigned int);
+  switch (option) {
+  case MARIADB_URING_BUFFERS:
+    if (!value || value > MA_URING_MAX_BUFFERS || (value & (value - 1)))
+      rc= 1;
+    else
+      ring->buf_count= value;
+    break;
+  case MARIADB_URING_BUFFER_SIZE:
+    if (value < 512 || value > 1024 * 1024)
+      rc= 1;
+    else
+      ring->buf_size= value;
+    break;
+  default:
+    rc= 1;
+    break;
+  }
+  va_end(ap);
+  return rc;
+}
+
+int STDCALL mariadb_uring_get_fd(MARIADB_URING *ring)
+{
+  return ring ? ring->fd : -1;
+}
+
+int STDCALL mariadb_uring_submit(MARIADB_URING *ring)
+{
+  int rc;
+
+  if (!ring)
+    return -1;
+  if (ring->deferred_first)
+    ma_uring_flush_deferred(ring);
+  if ((rc= ma_uring_enter(ring, 0, 0)) < 0)
+  {
+    errno= -rc;
+    return -1;
+  }
+  return rc;
+}
+
+int STDCALL mariadb_uring_wait(MARIADB_URING *ring, MYSQL **ready,
+                               unsigned int max_ready, int timeout_ms)
+{
+  unsigned long long deadline;
+  unsigned int count= 0;
+
+  if (!ring || !ready || !max_ready)
+    return -1;
+  deadline= timeout_ms > 0 ? ma_uring_time() + timeout_ms : 0;
+
+  for (;;)
+  {
+    ma_uring_reap(ring);
+    if (ring->ready_first)
+    {
+      /* still submit what the ready connections queued */
+      ma_uring_enter(ring, 0, 0);
+      break;
+    }
+    if (!timeout_ms)
+    {
+      ma_uring_enter(ring, 0, 0);
+      ma_uring_reap(ring);
+      break;
+    }
+    if (ma_uring_wait_for(ring, 1, deadline, timeout_ms))
+      return errno == ETIMEDOUT ? 0 : -1;
+  }
+
+  while (ring->ready_first && count < max_ready)
+  {
+    MA_URING_CONN *conn= ring->ready_first;
+    MYSQL *mysql= conn->pvio->mysql;
+
+    if (!(ring->ready_first= conn->ready_next))
+      ring->ready_last= NULL;
+    conn->ready= 0;
+    if (conn->waiting && mysql->options.extension &&
+        mysql->options.extension->async_context &&
+        mysql->options.extension->async_context->suspended)
+    {
+      conn->waiting= 0;
+      ready[count++]= mysql;
+    }
+  }
+  return (int)count;
+}
+
+void STDCALL mariadb_uring_get_stats(MARIADB_URING *ring, MARIADB_URING_STATS *stats)
+{
+  if (!ring || !stats)
+    return;
+  *stats= ring->stats;
+  stats->buffers= ring->buf_registered ? ring->buf_count : 0;
+  stats->buffers_free= ring->buf_registered ? ring->buf_avail : 0;
+}
+
+void STDCALL mariadb_uring_close(MARIADB_URING *ring)
+{
+  ma_uring_unref(ring);
+}
+/* }}} */
+
+#else /* MA_URING_ENABLED */
+
+/* {{{ stubs: io_uring is not available */
+MARIADB_URING *ma_uring_private(void)
+{
+  return NULL;
+}
+
+void ma_uring_ref(MARIADB_URING *ring __attribute__((unused)))
+{
+}
+
+void ma_uring_unref(MARIADB_URING *ring __attribute__((unused)))
+{
+}
+
+MA_URING_CONN *ma_uring_attach(MARIADB_URING *ring __attribute__((unused)),
+                               MARIADB_PVIO *pvio __attribute__((unused)),
+                               my_socket fd __attribute__((unused)))
+{
+  return NULL;
+}
+
+void ma_uring_detach(MA_URING_CONN *conn __attribute__((unused)))
+{
+}
+
+my_bool ma_uring_is_shared(MA_URING_CONN *conn __attribute__((unused)))
+{
+  return 0;
+}
+
+size_t ma_uring_pending(MA_URING_CONN *conn __attribute__((unused)))
+{
+  return 0;
+}
+
+ssize_t ma_uring_release(MA_URING_CONN *conn __attribute__((unused)),
+                         uchar *buffer __attribute__((unused)),
+                         size_t length __attribute__((unused)))
+{
+  return MA_URING_NO_DATA;
+}
+
+ssize_t ma_uring_read(MA_URING_CONN *conn __attribute__((unused)),
+                      uchar *buffer __attribute__((unused)),
+                      size_t length __attribute__((unused)),
+                      int timeout __attribute__((unused)))
+{
+  return -1;
+}
+
+ssize_t ma_uring_write(MA_URING_CONN *conn __attribute__((unused)),
+                       const MA_PVIO_IOVEC *iov __attribute__((unused)),
+                       int iovcnt __attribute__((unused)),
+                       int timeout __attribute__((unused)))
+{
+  return -1;
+}
+
+ssize_t ma_uring_async_read(MA_URING_CONN *conn __attribute__((unused)),
+                            uchar *buffer __attribute__((unused)),
+                            size_t length __attribute__((unused)))
+{
+  return -1;
+}
+
+ssize_t ma_uring_async_write(MA_URING_CONN *conn __attribute__((unused)),
+                             const uchar *buffer __attribute__((unused)),
+                             size_t length __attribute__((unused)),
+                             int timeout __attribute__((unused)))
+{
+  return -1;
+}
+
+int ma_uring_wait_io(MA_URING_CONN *conn __attribute__((unused)),
+                     my_bool is_read __attribute__((unused)),
+                     int timeout __attribute__((unused)))
+{
+  return -1;
+}
+
+MARIADB_URING * STDCALL mariadb_uring_init(unsigned int entries __attribute__((unused)))
+{
+  return NULL;
+}
+
+int STDCALL mariadb_uring_optionsv(MARIADB_URING *ring __attribute__((unused)),
+                                   enum mariadb_uring_option option __attribute__((unused)),
+                                   ...)
+{
+  return 1;
+}
+
+int STDCALL mariadb_uring_get_fd(MARIADB_URING *ring __attribute__((unused)))
+{
+  return -1;
+}
+
+int STDCALL mariadb_uring_submit(MARIADB_URING *ring __attribute__((unused)))
+{
+  return -1;
+}
+
+int STDCALL mariadb_uring_wait(MARIADB_URING *ring __attribute__((unused)),
+                               MYSQL **ready __attribute__((unused)),
+                               unsigned int max_ready __attribute__((unused)),
+                               int timeout_ms __attribute__((unused)))
+{
+  return -1;
+}
+
+void STDCALL mariadb_uring_get_stats(MARIADB_URING *ring __attribute__((unused)),
+                                     MARIADB_URING_STATS *stats)
+{
+  if (stats)
+    memset(stats, 0, sizeof(MARIADB_URING_STATS));
+}
+
+void STDCALL mariadb_uring_close(MARIADB_URING *ring __attribute__((unused)))
+{
+}
+/* }}} */
+
+#endif /* MA_URING_ENABLED */
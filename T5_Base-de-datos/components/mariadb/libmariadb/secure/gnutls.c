@@ -1580,6 +1580,14 @@ int ma_tls_get_protocol_version(MARIADB_TLS *ctls)
   return gnutls_protocol_get_version(ctls->ssl) - 1;
 }
 
+my_bool ma_tls_session_reused(MARIADB_TLS *ctls)
+{
+  if (!ctls || !ctls->ssl)
+    return 0;
+
+  return gnutls_session_is_resumed(ctls->ssl) ? 1 : 0;
+}
+
 void ma_tls_set_connection(MYSQL *mysql)
 {
   (void)gnutls_session_set_ptr(mysql->net.pvio->ctls->ssl, (void *)mysql);
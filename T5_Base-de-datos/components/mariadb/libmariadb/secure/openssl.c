@@ -30,6 +30,7 @@
 #include <openssl/conf.h>
 #include <openssl/md4.h>
 #include <ma_tls.h>
+#include <sys/stat.h>
 #if OPENSSL_VERSION_NUMBER < 0x10100000L
 #include <time.h>
 #endif
@@ -90,6 +91,8 @@ static BIO_METHOD ma_BIO_method;
 
 static int ma_verification_callback(int preverify_ok, X509_STORE_CTX *ctx);
 
+static void ma_tls_ctx_cache_free(void);
+
 static long ma_tls_version_options(const char *version)
 {
   long protocol_options,
@@ -280,6 +283,7 @@ void ma_tls_end()
   if (ma_tls_initialized)
   {
     pthread_mutex_lock(&LOCK_openssl_config);
+    ma_tls_ctx_cache_free();
 #ifndef HAVE_OPENSSL_1_1_API
     if (LOCK_crypto)
     {
@@ -418,32 +422,359 @@ error:
   return 1;
 }
 
-void *ma_tls_init(MYSQL *mysql)
+/*
+  TLS context cache
+
+  Parsing the CA certificates, certificate chain and private key is the
+  most expensive part of a TLS connect besides the handshake itself, so
+  connections with the same TLS options share one SSL_CTX. A cache entry
+  holds a reference to its context and every SSL object holds another
+  one, so an entry can be dropped while its context is still in use. An
+  entry is rebuilt when one of its files was modified, and the least
+  recently used entry is dropped when the cache is full.
+
+  Every entry also keeps the last session per server (host and port, or
+  unix socket), so that reconnects and pooled connections resume the
+  session with an abbreviated handshake. Sessions are only kept if the
+  server certificate was verified without any error, the server name is
+  still verified for a resumed session.
+
+  The cache is protected by LOCK_openssl_config.
+*/
+#define MA_TLS_CTX_CACHE_SIZE 8
+#define MA_TLS_SESSION_CACHE_SIZE 32
+
+/* options which make up the key of a context, files come first */
+enum ma_tls_ctx_option {
+  MA_TLS_CA, MA_TLS_CAPATH, MA_TLS_CERT, MA_TLS_KEY, MA_TLS_CRL,
+  MA_TLS_CRLPATH, MA_TLS_FILES= MA_TLS_CRLPATH + 1,
+  MA_TLS_CIPHER= MA_TLS_FILES, MA_TLS_VERSION, MA_TLS_PASSPHRASE,
+  MA_TLS_OPTIONS
+};
+
+typedef struct st_ma_tls_session {
+  struct st_ma_tls_session *next;
+  SSL_SESSION *session;
+  unsigned int port;
+  char host[1];
+} MA_TLS_SESSION;
+
+typedef struct st_ma_tls_ctx {
+  struct st_ma_tls_ctx *next;
+  SSL_CTX *ctx;
+  time_t mtime[MA_TLS_FILES];
+  MA_TLS_SESSION *sessions;
+  unsigned int session_count;
+  size_t key_length;
+  char *key;
+} MA_TLS_CTX;
+
+static MA_TLS_CTX *ma_tls_ctx_cache= NULL;
+static unsigned int ma_tls_ctx_count= 0;
+
+static void ma_tls_ctx_options(MYSQL *mysql, const char **option)
 {
-  SSL *ssl= NULL;
-  SSL_CTX *ctx= NULL;
+  struct st_mysql_options_extension *ext= mysql->options.extension;
+
+  option[MA_TLS_CA]= mysql->options.ssl_ca;
+  option[MA_TLS_CAPATH]= mysql->options.ssl_capath;
+  option[MA_TLS_CERT]= mysql->options.ssl_cert;
+  option[MA_TLS_KEY]= mysql->options.ssl_key;
+  option[MA_TLS_CRL]= ext ? ext->ssl_crl : NULL;
+  option[MA_TLS_CRLPATH]= ext ? ext->ssl_crlpath : NULL;
+  option[MA_TLS_CIPHER]= mysql->options.ssl_cipher;
+  option[MA_TLS_VERSION]= ext ? ext->tls_version : NULL;
+  option[MA_TLS_PASSPHRASE]= ext ? ext->tls_pw : NULL;
+}
+
+/* every option is stored as a flag byte (set or not) and a terminated
+   string, returns the length of the key */
+static size_t ma_tls_ctx_key(const char **option, char *key)
+{
+  size_t length= 0, len;
+  int i;
+
+  for (i= 0; i < MA_TLS_OPTIONS; i++)
+  {
+    len= option[i] ? strlen(option[i]) : 0;
+    if (key)
+    {
+      key[length]= option[i] ? 1 : 0;
+      memcpy(key + length + 1, option[i] ? option[i] : "", len + 1);
+    }
+    length+= len + 2;
+  }
+  return length;
+}
+
+static time_t ma_tls_file_mtime(const char *file)
+{
+  struct stat st;
+
+  if (!file || !file[0] || stat(file, &st))
+    return 0;
+  return st.st_mtime;
+}
+
+/* returns the host (or unix socket) sessions of the connection are
+   stored for, or NULL */
+static const char *ma_tls_session_peer(MYSQL *mysql, unsigned int *port)
+{
+  const char *host= mysql->host;
+
+  *port= mysql->port;
+  if (mysql->net.pvio && mysql->net.pvio->type == PVIO_TYPE_UNIXSOCKET)
+  {
+    host= mysql->unix_socket;
+    *port= 0;
+  }
+  return (host && host[0]) ? host : NULL;
+}
+
+static void ma_tls_session_free(MA_TLS_SESSION *session)
+{
+  SSL_SESSION_free(session->session);
+  ma_free(session);
+}
+
+/* removes the session of host and port from the cache entry */
+static MA_TLS_SESSION *ma_tls_session_take(MA_TLS_CTX *entry, const char *host,
+                                           unsigned int port)
+{
+  MA_TLS_SESSION *session, **prev;
+
+  for (prev= &entry->sessions; (session= *prev); prev= &session->next)
+  {
+    if (session->port == port && !strcmp(session->host, host))
+    {
+      *prev= session->next;
+      entry->session_count--;
+      return session;
+    }
+  }
+  return NULL;
+}
+
+static void ma_tls_ctx_free(MA_TLS_CTX *entry)
+{
+  MA_TLS_SESSION *session;
+
+  SSL_CTX_set_app_data(entry->ctx, NULL);
+  SSL_CTX_free(entry->ctx);
+  while ((session= entry->sessions))
+  {
+    entry->sessions= session->next;
+    ma_tls_session_free(session);
+  }
+  /* the key contains the passphrase */
+  memset(entry->key, 0, entry->key_length);
+  ma_free(entry->key);
+  ma_free(entry);
+}
+
+static void ma_tls_ctx_cache_free(void)
+{
+  MA_TLS_CTX *entry;
+
+  while ((entry= ma_tls_ctx_cache))
+  {
+    ma_tls_ctx_cache= entry->next;
+    ma_tls_ctx_free(entry);
+  }
+  ma_tls_ctx_count= 0;
+}
+
+/* called by OpenSSL when the server sent a session (ticket) */
+static int ma_tls_new_session(SSL *ssl, SSL_SESSION *ssl_session)
+{
+  MYSQL *mysql= (MYSQL *)SSL_get_app_data(ssl);
+  MA_TLS_CTX *entry;
+  MA_TLS_SESSION *session, **prev;
+  const char *host;
+  unsigned int port;
+  int rc= 0;
+
+  if (!mysql || SSL_get_verify_result(ssl) != X509_V_OK ||
+      mysql->net.tls_verify_status != MARIADB_TLS_VERIFY_OK ||
+      !(host= ma_tls_session_peer(mysql, &port)))
+    return 0;
+
+  pthread_mutex_lock(&LOCK_openssl_config);
+  if ((entry= (MA_TLS_CTX *)SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl))))
+  {
+    if ((session= ma_tls_session_take(entry, host, port)))
+      SSL_SESSION_free(session->session);
+    else if ((session= (MA_TLS_SESSION *)ma_malloc(sizeof(MA_TLS_SESSION) + strlen(host), MYF(0))))
+    {
+      session->port= port;
+      strcpy(session->host, host);
+    }
+    if (session)
+    {
+      session->session= ssl_session;
+      session->next= entry->sessions;
+      entry->sessions= session;
+      if (++entry->session_count > MA_TLS_SESSION_CACHE_SIZE)
+      {
+        for (prev= &entry->sessions; (*prev)->next; prev= &(*prev)->next);
+        ma_tls_session_free(*prev);
+        *prev= NULL;
+        entry->session_count--;
+      }
+      rc= 1;
+    }
+  }
+  pthread_mutex_unlock(&LOCK_openssl_config);
+  return rc;
+}
+
+/* sets the cached session of the server, if any */
+static void ma_tls_resume_session(SSL *ssl, MYSQL *mysql)
+{
+  MA_TLS_CTX *entry;
+  MA_TLS_SESSION *session;
+  const char *host;
+  unsigned int port;
+
+  if (!(host= ma_tls_session_peer(mysql, &port)))
+    return;
+
+  pthread_mutex_lock(&LOCK_openssl_config);
+  if ((entry= (MA_TLS_CTX *)SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl))) &&
+      (session= ma_tls_session_take(entry, host, port)))
+  {
+#if defined(HAVE_OPENSSL_1_1_API) && defined(TLS1_3_VERSION)
+    if (SSL_SESSION_is_resumable(session->session))
+      SSL_set_session(ssl, session->session);
+    /* TLS 1.3 tickets are meant to be used once, the server sends new
+       ones after the handshake */
+    if (!SSL_SESSION_is_resumable(session->session) ||
+        SSL_SESSION_get_protocol_version(session->session) == TLS1_3_VERSION)
+      ma_tls_session_free(session);
+    else
+#else
+    SSL_set_session(ssl, session->session);
+#endif
+    {
+      session->next= entry->sessions;
+      entry->sessions= session;
+      entry->session_count++;
+    }
+  }
+  pthread_mutex_unlock(&LOCK_openssl_config);
+}
+
+static SSL_CTX *ma_tls_ctx_new(MYSQL *mysql)
+{
+  SSL_CTX *ctx;
   long default_options= SSL_OP_ALL |
                         SSL_OP_NO_SSLv2 |
                         SSL_OP_NO_SSLv3 |
                         SSL_OP_NO_TLSv1;
   long options= 0;
-  pthread_mutex_lock(&LOCK_openssl_config);
 
-  #if OPENSSL_VERSION_NUMBER >= 0x10100000L
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
   if (!(ctx= SSL_CTX_new(TLS_client_method())))
 #else
   if (!(ctx= SSL_CTX_new(SSLv23_client_method())))
 #endif
-    goto error;
+    return NULL;
   if (mysql->options.extension) 
     options= ma_tls_version_options(mysql->options.extension->tls_version);
   SSL_CTX_set_options(ctx, options ? options : default_options);
 
   if (ma_tls_set_certs(mysql, ctx))
   {
-    goto error;
+    SSL_CTX_free(ctx);
+    return NULL;
+  }
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT |
+                                      SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ctx, ma_tls_new_session);
+  return ctx;
+}
+
+/* returns the cached context for the TLS options of the connection */
+static SSL_CTX *ma_tls_get_ctx(MYSQL *mysql)
+{
+  const char *option[MA_TLS_OPTIONS];
+  time_t mtime[MA_TLS_FILES];
+  MA_TLS_CTX *entry, **prev;
+  size_t length;
+  char *key;
+  int i;
+
+  ma_tls_ctx_options(mysql, option);
+  length= ma_tls_ctx_key(option, NULL);
+  if (!(key= (char *)ma_malloc(length, MYF(0))))
+    return NULL;
+  ma_tls_ctx_key(option, key);
+  for (i= 0; i < MA_TLS_FILES; i++)
+    mtime[i]= ma_tls_file_mtime(option[i]);
+
+  for (prev= &ma_tls_ctx_cache; (entry= *prev); prev= &entry->next)
+  {
+    if (entry->key_length == length && !memcmp(entry->key, key, length))
+    {
+      *prev= entry->next;
+      /* certificates, keys or revocation lists were replaced */
+      if (memcmp(entry->mtime, mtime, sizeof(mtime)))
+      {
+        ma_tls_ctx_free(entry);
+        ma_tls_ctx_count--;
+        entry= NULL;
+      }
+      break;
+    }
+  }
+
+  if (entry)
+  {
+    memset(key, 0, length);
+    ma_free(key);
+  }
+  else
+  {
+    if (!(entry= (MA_TLS_CTX *)ma_malloc(sizeof(MA_TLS_CTX), MYF(0))))
+    {
+      ma_free(key);
+      return NULL;
+    }
+    memset(entry, 0, sizeof(MA_TLS_CTX));
+    entry->key= key;
+    entry->key_length= length;
+    memcpy(entry->mtime, mtime, sizeof(mtime));
+    if (!(entry->ctx= ma_tls_ctx_new(mysql)))
+    {
+      memset(key, 0, length);
+      ma_free(key);
+      ma_free(entry);
+      return NULL;
+    }
+    SSL_CTX_set_app_data(entry->ctx, entry);
+    if (++ma_tls_ctx_count > MA_TLS_CTX_CACHE_SIZE)
+    {
+      for (prev= &ma_tls_ctx_cache; (*prev)->next; prev= &(*prev)->next);
+      ma_tls_ctx_free(*prev);
+      *prev= NULL;
+      ma_tls_ctx_count--;
+    }
   }
+  entry->next= ma_tls_ctx_cache;
+  ma_tls_ctx_cache= entry;
+  return entry->ctx;
+}
+
+void *ma_tls_init(MYSQL *mysql)
+{
+  SSL *ssl= NULL;
+  SSL_CTX *ctx;
+  pthread_mutex_lock(&LOCK_openssl_config);
+
+  if (!(ctx= ma_tls_get_ctx(mysql)))
+    goto error;
 
+  /* the SSL object holds its own reference to the context */
   if (!(ssl= SSL_new(ctx)))
     goto error;
 
@@ -454,8 +785,6 @@ void *ma_tls_init(MYSQL *mysql)
   return (void *)ssl;
 error:
   pthread_mutex_unlock(&LOCK_openssl_config);
-  if (ctx)
-    SSL_CTX_free(ctx);
   if (ssl)
     SSL_free(ssl);
   return NULL;
@@ -560,6 +889,7 @@ my_bool ma_tls_connect(MARIADB_TLS *ctls)
 #else
   SSL_set_fd(ssl, (int)mysql_get_socket(mysql));
 #endif
+  ma_tls_resume_session(ssl, mysql);
   if (!mysql->options.extension->tls_allow_invalid_server_cert)
     SSL_set_verify(ssl, SSL_VERIFY_PEER, ma_verification_callback);
 
@@ -691,14 +1021,10 @@ my_bool ma_tls_close(MARIADB_TLS *ctls)
 {
   int i, rc;
   SSL *ssl;
-  SSL_CTX *ctx= NULL;
 
   if (!ctls || !ctls->ssl)
     return 1;
   ssl= (SSL *)ctls->ssl;
-  ctx= SSL_get_SSL_CTX(ssl);
-  if (ctx)
-    SSL_CTX_free(ctx);
 
   SSL_set_quiet_shutdown(ssl, 1); 
   /* 2 x pending + 2 * data = 4 */ 
@@ -953,6 +1279,14 @@ int ma_tls_get_protocol_version(MARIADB_TLS *ctls)
   return SSL_version(ctls->ssl) & 0xFF;
 }
 
+my_bool ma_tls_session_reused(MARIADB_TLS *ctls)
+{
+  if (!ctls || !ctls->ssl)
+    return 0;
+
+  return SSL_session_reused((SSL *)ctls->ssl) ? 1 : 0;
+}
+
 void ma_tls_set_connection(MYSQL *mysql)
 {
   (void)SSL_set_app_data(mysql->net.pvio->ctls->ssl, mysql);
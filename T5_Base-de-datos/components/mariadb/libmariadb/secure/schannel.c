@@ -707,6 +707,12 @@ unsigned int ma_tls_get_finger_print(MARIADB_TLS *ctls, uint hash_type, char *fp
   return (uint)ma_hash_digest_size(hash_type);
 }
 
+/* session reuse is handled by Schannel internally and not reported */
+my_bool ma_tls_session_reused(MARIADB_TLS *ctls __attribute__((unused)))
+{
+  return 0;
+}
+
 void ma_tls_set_connection(MYSQL *mysql __attribute__((unused)))
 {
   return;
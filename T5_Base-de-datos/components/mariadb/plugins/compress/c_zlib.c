@@ -36,8 +36,12 @@ static ma_compress_ctx *ma_zlib_ctx_init(int compression_level)
   if (!(ctx = (ma_compress_ctx *)calloc(1, sizeof(ma_compress_ctx))))
     return NULL;
 
+  /* Z_DEFAULT_COMPRESSION is level 6, use the number so that adaptive
+     compression can step from it */
   ctx->compression_level= (compression_level == COMPRESSION_LEVEL_DEFAULT) ?
-                          Z_DEFAULT_COMPRESSION : compression_level;
+                          6 : compression_level;
+  ctx->min_level= Z_BEST_SPEED;
+  ctx->max_level= Z_BEST_COMPRESSION;
   return ctx;
 }
 
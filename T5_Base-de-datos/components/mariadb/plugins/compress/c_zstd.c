@@ -55,6 +55,9 @@ static ma_compress_ctx *ma_zstd_ctx_init(int compression_level)
 
   ctx->compression_level= (compression_level == COMPRESSION_LEVEL_DEFAULT) ?
                           ZSTD_CLEVEL_DEFAULT : compression_level;
+  /* higher levels need too much memory and time for a network protocol */
+  ctx->min_level= 1;
+  ctx->max_level= MIN(ZSTD_maxCLevel(), 19);
 
   if (!(ctx->compress_ctx= (void *)ZSTD_createCCtx()) ||
       !(ctx->decompress_ctx= (void *)ZSTD_createDCtx()))
@@ -97,6 +97,9 @@ ssize_t pvio_socket_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length);
 ssize_t pvio_socket_async_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length);
 ssize_t pvio_socket_async_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length);
 ssize_t pvio_socket_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length);
+#ifndef _WIN32
+ssize_t pvio_socket_writev(MARIADB_PVIO *pvio, const MA_PVIO_IOVEC *iov, int iovcnt);
+#endif
 int pvio_socket_wait_io_or_timeout(MARIADB_PVIO *pvio, my_bool is_read, int timeout);
 int pvio_socket_blocking(MARIADB_PVIO *pvio, my_bool value, my_bool *old_value);
 my_bool pvio_socket_connect(MARIADB_PVIO *pvio, MA_PVIO_CINFO *cinfo);
@@ -134,7 +137,12 @@ struct st_ma_pvio_methods pvio_socket_methods= {
   pvio_socket_is_blocking,
   pvio_socket_is_alive,
   pvio_socket_has_data,
-  pvio_socket_shutdown
+  pvio_socket_shutdown,
+#ifndef _WIN32
+  pvio_socket_writev
+#else
+  NULL
+#endif
 };
 
 #ifndef PLUGIN_DYNAMIC
@@ -495,6 +503,72 @@ ssize_t pvio_socket_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length
 }
 /* }}} */
 
+#ifndef _WIN32
+/* {{{ pvio_socket_writev */
+/*
+   gather write to socket
+
+   SYNOPSIS
+   pvio_socket_writev()
+     pvio             PVIO
+     iov              array of buffers
+     iovcnt           number of buffers (<= PVIO_IOV_MAX)
+
+   DESCRIPTION
+     writes up to the total length of all buffers to socket with a
+     single sendmsg() call. In the event of an error errno is set to
+     indicate it.
+
+   RETURNS
+      1..n           number of bytes written
+      0              peer has performed shutdown
+     -1              on error
+*/
+ssize_t pvio_socket_writev(MARIADB_PVIO *pvio, const MA_PVIO_IOVEC *iov, int iovcnt)
+{
+  ssize_t r;
+  struct st_pvio_socket *csock;
+  struct iovec vec[PVIO_IOV_MAX];
+  struct msghdr msg;
+  int timeout, i;
+  int send_flags= MSG_DONTWAIT;
+#ifdef MSG_NOSIGNAL
+  send_flags|= MSG_NOSIGNAL;
+#endif
+  if (!pvio || !pvio->data || iovcnt > PVIO_IOV_MAX)
+    return -1;
+
+  csock= (struct st_pvio_socket *)pvio->data;
+  timeout = pvio->timeout[PVIO_WRITE_TIMEOUT];
+
+  for (i= 0; i < iovcnt; i++)
+  {
+    vec[i].iov_base= (void *)iov[i].base;
+    vec[i].iov_len= iov[i].length;
+  }
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov= vec;
+  msg.msg_iovlen= iovcnt;
+
+  while ((r = sendmsg(csock->socket, &msg, send_flags)) == -1)
+  {
+    int err = socket_errno;
+    if (IS_SOCKET_EINTR(err))
+      continue;
+    if ((err != SOCKET_EAGAIN
+#ifdef HAVE_SOCKET_EWOULDBLOCK
+      && err != SOCKET_EWOULDBLOCK
+#endif
+       )|| timeout == 0)
+      return r;
+    if (pvio_socket_wait_io_or_timeout(pvio, FALSE, timeout) < 1)
+      return -1;
+  }
+  return r;
+}
+/* }}} */
+#endif
+
 int pvio_socket_wait_io_or_timeout(MARIADB_PVIO *pvio, my_bool is_read, int timeout)
 {
   int rc;
@@ -0,0 +1,255 @@
+/************************************************************************************
+   Copyright (C) 2025 MariaDB Corporation AB
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public
+   License along with this library; if not see <http://www.gnu.org/licenses>
+   or write to the Free Software Foundation, Inc.,
+   51 Franklin St., Fifth Floor, Boston, MA 02110, USA
+*************************************************************************************/
+
+/*
+   MariaDB virtual IO plugin for socket communication with io_uring:
+
+   The plugin is used for sockets if MARIADB_OPT_IO_URING was set. It
+   connects with pvio_socket and uses its methods until the handshake has
+   completed, then the socket is attached to an io_uring (see
+   mariadb_uring.c). Connections with TLS, and connections for which no
+   ring can be set up, stay with the pvio_socket methods. The plugin is
+   always compiled into Connector/C, like pvio_socket.
+*/
+
+#include <ma_global.h>
+#include <ma_sys.h>
+#include <errmsg.h>
+#include <mysql.h>
+#include <mysql/client_plugin.h>
+#include <ma_common.h>
+#include <ma_pvio.h>
+#include <mariadb_uring.h>
+#include <ma_uring.h>
+#include <string.h>
+
+/* methods of pvio_socket */
+extern struct st_ma_pvio_methods pvio_socket_methods;
+my_bool pvio_socket_set_timeout(MARIADB_PVIO *pvio, enum enum_pvio_timeout type, int timeout);
+int pvio_socket_get_timeout(MARIADB_PVIO *pvio, enum enum_pvio_timeout type);
+ssize_t pvio_socket_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length);
+ssize_t pvio_socket_async_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length);
+ssize_t pvio_socket_async_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length);
+ssize_t pvio_socket_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length);
+ssize_t pvio_socket_writev(MARIADB_PVIO *pvio, const MA_PVIO_IOVEC *iov, int iovcnt);
+int pvio_socket_wait_io_or_timeout(MARIADB_PVIO *pvio, my_bool is_read, int timeout);
+int pvio_socket_blocking(MARIADB_PVIO *pvio, my_bool value, my_bool *old_value);
+my_bool pvio_socket_connect(MARIADB_PVIO *pvio, MA_PVIO_CINFO *cinfo);
+my_bool pvio_socket_close(MARIADB_PVIO *pvio);
+int pvio_socket_fast_send(MARIADB_PVIO *pvio);
+int pvio_socket_keepalive(MARIADB_PVIO *pvio);
+my_bool pvio_socket_get_handle(MARIADB_PVIO *pvio, void *handle);
+my_bool pvio_socket_is_blocking(MARIADB_PVIO *pvio);
+my_bool pvio_socket_is_alive(MARIADB_PVIO *pvio);
+my_bool pvio_socket_has_data(MARIADB_PVIO *pvio, ssize_t *data_len);
+int pvio_socket_shutdown(MARIADB_PVIO *pvio);
+
+/* Function prototypes */
+ssize_t pvio_uring_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length);
+ssize_t pvio_uring_async_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length);
+ssize_t pvio_uring_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length);
+ssize_t pvio_uring_async_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length);
+ssize_t pvio_uring_writev(MARIADB_PVIO *pvio, const MA_PVIO_IOVEC *iov, int iovcnt);
+int pvio_uring_wait_io_or_timeout(MARIADB_PVIO *pvio, my_bool is_read, int timeout);
+my_bool pvio_uring_close(MARIADB_PVIO *pvio);
+my_bool pvio_uring_is_alive(MARIADB_PVIO *pvio);
+my_bool pvio_uring_has_data(MARIADB_PVIO *pvio, ssize_t *data_len);
+void pvio_uring_established(MARIADB_PVIO *pvio);
+
+struct st_ma_pvio_methods pvio_uring_methods= {
+  pvio_socket_set_timeout,
+  pvio_socket_get_timeout,
+  pvio_uring_read,
+  pvio_uring_async_read,
+  pvio_uring_write,
+  pvio_uring_async_write,
+  pvio_uring_wait_io_or_timeout,
+  pvio_socket_blocking,
+  pvio_socket_connect,
+  pvio_uring_close,
+  pvio_socket_fast_send,
+  pvio_socket_keepalive,
+  pvio_socket_get_handle,
+  pvio_socket_is_blocking,
+  pvio_uring_is_alive,
+  pvio_uring_has_data,
+  pvio_socket_shutdown,
+  pvio_uring_writev,
+  pvio_uring_established
+};
+
+MARIADB_PVIO_PLUGIN pvio_uring_client_plugin=
+{
+  MARIADB_CLIENT_PVIO_PLUGIN,
+  MARIADB_CLIENT_PVIO_PLUGIN_INTERFACE_VERSION,
+  "pvio_uring",
+  "MariaDB Corporation AB",
+  "MariaDB virtual IO plugin for socket communication with io_uring",
+  {1, 0, 0},
+  "LGPL",
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  &pvio_uring_methods
+};
+
+#define URING_CONN(pvio) ((pvio)->mysql->extension->uring_conn)
+
+/* {{{ pvio_uring_established */
+/*
+  Attaches the socket to the ring of MARIADB_OPT_IO_URING, or to a new
+  private ring, once the handshake has completed. Otherwise the connection
+  continues as a pvio_socket connection.
+*/
+void pvio_uring_established(MARIADB_PVIO *pvio)
+{
+  MYSQL *mysql= pvio->mysql;
+  MARIADB_URING *ring= mysql->options.extension ? mysql->options.extension->uring : NULL;
+  my_socket fd;
+
+  if (!pvio->ctls && !URING_CONN(pvio) &&
+      !pvio_socket_get_handle(pvio, &fd))
+  {
+    if (ring)
+      ma_uring_ref(ring);
+    else
+      ring= ma_uring_private();
+    if (ring)
+    {
+      URING_CONN(pvio)= ma_uring_attach(ring, pvio, fd);
+      ma_uring_unref(ring);
+    }
+  }
+  if (!URING_CONN(pvio))
+    pvio->methods= &pvio_socket_methods;
+}
+/* }}} */
+
+/* {{{ pvio_uring_read */
+ssize_t pvio_uring_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length)
+{
+  if (!URING_CONN(pvio))
+    return pvio_socket_read(pvio, buffer, length);
+  return ma_uring_read(URING_CONN(pvio), buffer, length,
+                       pvio->timeout[PVIO_READ_TIMEOUT]);
+}
+/* }}} */
+
+/* {{{ pvio_uring_async_read */
+/*
+  With a shared ring the connection waits in mariadb_uring_wait(), a
+  connection with a private ring is driven through its socket and leaves
+  the ring while it is used with the non-blocking API.
+*/
+ssize_t pvio_uring_async_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length)
+{
+  MA_URING_CONN *conn= URING_CONN(pvio);
+  ssize_t r;
+
+  if (conn && ma_uring_is_shared(conn))
+    return ma_uring_async_read(conn, buffer, length);
+  if (conn && (r= ma_uring_release(conn, buffer, length)) != MA_URING_NO_DATA)
+    return r;
+  return pvio_socket_async_read(pvio, buffer, length);
+}
+/* }}} */
+
+/* {{{ pvio_uring_write */
+ssize_t pvio_uring_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length)
+{
+  MA_PVIO_IOVEC iov;
+
+  if (!URING_CONN(pvio))
+    return pvio_socket_write(pvio, buffer, length);
+  iov.base= buffer;
+  iov.length= length;
+  return ma_uring_write(URING_CONN(pvio), &iov, 1,
+                        pvio->timeout[PVIO_WRITE_TIMEOUT]);
+}
+/* }}} */
+
+/* {{{ pvio_uring_writev */
+ssize_t pvio_uring_writev(MARIADB_PVIO *pvio, const MA_PVIO_IOVEC *iov, int iovcnt)
+{
+  if (!URING_CONN(pvio))
+    return pvio_socket_writev(pvio, iov, iovcnt);
+  return ma_uring_write(URING_CONN(pvio), iov, iovcnt,
+                        pvio->timeout[PVIO_WRITE_TIMEOUT]);
+}
+/* }}} */
+
+/* {{{ pvio_uring_async_write */
+ssize_t pvio_uring_async_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length)
+{
+  MA_URING_CONN *conn= URING_CONN(pvio);
+
+  if (conn && ma_uring_is_shared(conn))
+    return ma_uring_async_write(conn, buffer, length,
+                                pvio->timeout[PVIO_WRITE_TIMEOUT]);
+  if (conn && ma_uring_release(conn, NULL, 0) == -1)
+    return -1;
+  return pvio_socket_async_write(pvio, buffer, length);
+}
+/* }}} */
+
+/* {{{ pvio_uring_wait_io_or_timeout */
+int pvio_uring_wait_io_or_timeout(MARIADB_PVIO *pvio, my_bool is_read, int timeout)
+{
+  if (!URING_CONN(pvio))
+    return pvio_socket_wait_io_or_timeout(pvio, is_read, timeout);
+  return ma_uring_wait_io(URING_CONN(pvio), is_read, timeout);
+}
+/* }}} */
+
+/* {{{ pvio_uring_is_alive */
+my_bool pvio_uring_is_alive(MARIADB_PVIO *pvio)
+{
+  if (URING_CONN(pvio) && ma_uring_pending(URING_CONN(pvio)))
+    return TRUE;
+  return pvio_socket_is_alive(pvio);
+}
+/* }}} */
+
+/* {{{ pvio_uring_has_data */
+my_bool pvio_uring_has_data(MARIADB_PVIO *pvio, ssize_t *data_len)
+{
+  size_t pending;
+
+  if (URING_CONN(pvio) && (pending= ma_uring_pending(URING_CONN(pvio))))
+  {
+    *data_len= (ssize_t)pending;
+    return 0;
+  }
+  return pvio_socket_has_data(pvio, data_len);
+}
+/* }}} */
+
+/* {{{ pvio_uring_close */
+my_bool pvio_uring_close(MARIADB_PVIO *pvio)
+{
+  /* data which was written is sent before the socket is closed */
+  if (pvio->mysql && URING_CONN(pvio))
+  {
+    ma_uring_detach(URING_CONN(pvio));
+    URING_CONN(pvio)= NULL;
+  }
+  return pvio_socket_close(pvio);
+}
+/* }}} */
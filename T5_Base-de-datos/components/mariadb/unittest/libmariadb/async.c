@@ -16,6 +16,7 @@
 */
 #include "my_test.h"
 #include "ma_common.h"
+#include <ma_context.h>
 
 
 #ifndef _WIN32
@@ -27,6 +28,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <mysql.h>
+#include <mariadb_loop.h>
+#include <mariadb_stack.h>
+#include <mariadb_uring.h>
 
 my_bool skip_async= 0;
 
@@ -299,12 +303,295 @@ static int test_conc622(MYSQL *my __attribute__((unused)))
 }
 
 
+#define LOOP_CONNECTIONS 20
+
+struct loop_test_st {
+  MARIADB_LOOP *loop;
+  unsigned int connected;
+  unsigned int queries;
+  unsigned int errors;
+};
+
+static void loop_query_done(MARIADB_LOOP_OP *op, void *data)
+{
+  struct loop_test_st *t= (struct loop_test_st *)data;
+  MYSQL_RES *res= mariadb_loop_op_result(op);
+  MYSQL_ROW row;
+
+  if (mariadb_loop_op_status(op) || !res || !(row= mysql_fetch_row(res)) ||
+      strcmp(row[0], "1"))
+    t->errors++;
+  t->queries++;
+  if (res)
+    mysql_free_result(res);
+}
+
+static void loop_connected(MARIADB_LOOP_OP *op, void *data)
+{
+  struct loop_test_st *t= (struct loop_test_st *)data;
+
+  if (mariadb_loop_op_status(op))
+  {
+    diag("Error: %s", mysql_error(mariadb_loop_op_mysql(op)));
+    t->errors++;
+    return;
+  }
+  t->connected++;
+  if (!mariadb_loop_query(t->loop, mariadb_loop_op_mysql(op), SL("SELECT 1"),
+                          loop_query_done, t))
+    t->errors++;
+}
+
+static int test_loop(MYSQL *unused __attribute__((unused)))
+{
+  MYSQL *mysql[LOOP_CONNECTIONS];
+  MARIADB_LOOP_STATS stats;
+  MARIADB_LOOP_OP *op;
+  MYSQL_RES *res;
+  struct loop_test_st t;
+  int i, rc;
+
+  if (skip_async)
+    return SKIP;
+
+  memset(&t, 0, sizeof(t));
+  t.loop= mariadb_loop_init();
+  FAIL_IF(!t.loop, "mariadb_loop_init() failed");
+
+  for (i= 0; i < LOOP_CONNECTIONS; i++)
+  {
+    mysql[i]= mysql_init(NULL);
+    mysql_options(mysql[i], MARIADB_OPT_SSL_FP, fingerprint);
+    if (force_tls)
+      mysql_ssl_set(mysql[i], NULL, NULL, NULL, NULL, NULL);
+    op= mariadb_loop_connect(t.loop, mysql[i], hostname, username, password,
+                             schema, port, socketname, 0, loop_connected, &t);
+    FAIL_IF(!op, "mariadb_loop_connect() failed");
+  }
+  /* callbacks are only called from the loop */
+  FAIL_IF(t.connected, "callback called before mariadb_loop_run()");
+
+  while (t.queries + t.errors < LOOP_CONNECTIONS)
+  {
+    rc= mariadb_loop_run(t.loop, 10000);
+    FAIL_IF(rc <= 0, "mariadb_loop_run() failed or timed out");
+  }
+  FAIL_IF(t.errors, "connect or query failed");
+  FAIL_IF(t.connected != LOOP_CONNECTIONS, "not all connections connected");
+
+  /* future: multi statement, only the first result is returned */
+  op= mariadb_loop_query(t.loop, mysql[0], SL("SELECT 2; SELECT 3"), NULL, NULL);
+  FAIL_IF(!op, "mariadb_loop_query() failed");
+  FAIL_IF(mariadb_loop_wait(t.loop, op, 10000), "mariadb_loop_wait() failed");
+  FAIL_IF(mariadb_loop_op_status(op), mysql_error(mysql[0]));
+  res= mariadb_loop_op_result(op);
+  FAIL_IF(!res || strcmp(mysql_fetch_row(res)[0], "2"), "wrong result");
+  mysql_free_result(res);
+  mariadb_loop_op_free(op);
+
+  /* operations on the same connection run in order */
+  op= mariadb_loop_query(t.loop, mysql[1], SL("SELECT SLEEP(0.1)"), NULL, NULL);
+  mariadb_loop_op_free(op);
+  op= mariadb_loop_ping(t.loop, mysql[1], NULL, NULL);
+  mariadb_loop_get_stats(t.loop, &stats);
+  FAIL_IF(stats.queued != 1, "expected one queued operation");
+  FAIL_IF(mariadb_loop_wait(t.loop, op, 10000), "mariadb_loop_wait() failed");
+  FAIL_IF(mariadb_loop_op_status(op), mysql_error(mysql[1]));
+  FAIL_IF(mariadb_loop_op_latency(op) < 100000, "ping didn't wait for the query");
+  mariadb_loop_op_free(op);
+
+  /* deadline */
+  FAIL_IF(mariadb_loop_optionsv(t.loop, MARIADB_LOOP_OP_TIMEOUT, 100),
+          "mariadb_loop_optionsv() failed");
+  op= mariadb_loop_query(t.loop, mysql[2], SL("SELECT SLEEP(5)"), NULL, NULL);
+  FAIL_IF(mariadb_loop_wait(t.loop, op, 10000), "mariadb_loop_wait() failed");
+  FAIL_IF(mariadb_loop_op_status(op) != CR_LOOP_TIMEOUT, "expected CR_LOOP_TIMEOUT");
+  mariadb_loop_op_free(op);
+
+  mariadb_loop_get_stats(t.loop, &stats);
+  diag("completed: %llu  max in flight: %u  wakeups: %llu  p99: %llu us",
+       stats.completed, stats.max_in_flight, stats.wakeups,
+       mariadb_loop_stats_percentile(&stats, 99));
+  FAIL_IF(stats.connections != LOOP_CONNECTIONS, "wrong number of connections");
+  FAIL_IF(stats.in_flight || stats.queued, "operations left");
+  FAIL_IF(stats.completed != stats.submitted, "completed != submitted");
+  FAIL_IF(stats.timeouts != 1, "expected one timeout");
+
+  for (i= 0; i < LOOP_CONNECTIONS; i++)
+  {
+    FAIL_IF(mariadb_loop_remove(t.loop, mysql[i]), "mariadb_loop_remove() failed");
+    mysql_close(mysql[i]);
+  }
+  mariadb_loop_close(t.loop);
+  return OK;
+}
+
+#define STACK_POOL_CONNECTIONS 10
+
+static int test_stack_pool(MYSQL *unused __attribute__((unused)))
+{
+  MYSQL *mysql[STACK_POOL_CONNECTIONS], *ret;
+  MARIADB_STACK_POOL *pool;
+  MARIADB_STACK_POOL_STATS stats;
+  int i, rc, err, status;
+
+  if (skip_async)
+    return SKIP;
+#ifndef MY_CONTEXT_USE_STACK
+  /* Win32 fibers allocate their own stacks */
+  diag("async contexts don't use a pooled stack");
+  return SKIP;
+#endif
+
+  pool= mariadb_stack_pool_init(0);
+  FAIL_IF(!pool, "mariadb_stack_pool_init() failed");
+  rc= mariadb_stack_pool_optionsv(pool, MARIADB_STACK_POOL_MEASURE, 1);
+  FAIL_IF(rc, "mariadb_stack_pool_optionsv() failed");
+
+  for (i= 0; i < STACK_POOL_CONNECTIONS; i++)
+  {
+    mysql[i]= mysql_init(NULL);
+    rc= mysql_optionsv(mysql[i], MARIADB_OPT_ASYNC_STACK_POOL, pool);
+    check_mysql_rc(rc, mysql[i]);
+    mysql_options(mysql[i], MARIADB_OPT_SSL_FP, fingerprint);
+    if (force_tls)
+      mysql_ssl_set(mysql[i], NULL, NULL, NULL, NULL, NULL);
+  }
+  /* connections only borrow a stack while a call is suspended */
+  mariadb_stack_pool_get_stats(pool, &stats);
+  FAIL_IF(stats.created, "stacks were created before the first call");
+
+  for (i= 0; i < STACK_POOL_CONNECTIONS; i++)
+  {
+    status= mysql_real_connect_start(&ret, mysql[i], hostname, username,
+                                     password, schema, port, socketname, 0);
+    while (status)
+    {
+      status= wait_for_mysql(mysql[i], status);
+      status= mysql_real_connect_cont(&ret, mysql[i], status);
+    }
+    FAIL_IF(!ret, mysql_error(mysql[i]));
+
+    status= mysql_real_query_start(&err, mysql[i], SL("SELECT 1"));
+    while (status)
+    {
+      status= wait_for_mysql(mysql[i], status);
+      status= mysql_real_query_cont(&err, mysql[i], status);
+    }
+    FAIL_IF(err, mysql_error(mysql[i]));
+    mysql_free_result(mysql_store_result(mysql[i]));
+  }
+
+  mariadb_stack_pool_get_stats(pool, &stats);
+  diag("stack size: %zu  high water: %zu  created: %llu",
+       stats.stack_size, stats.high_water, stats.created);
+  FAIL_IF(stats.in_use, "stacks are still in use");
+  /* the calls ran one after another and shared a single stack */
+  FAIL_IF(stats.created != 1, "expected one stack");
+  FAIL_IF(!stats.high_water || stats.high_water > stats.stack_size,
+          "wrong high water mark");
+
+  /* the connections keep the pool alive */
+  mariadb_stack_pool_close(pool);
+  for (i= 0; i < STACK_POOL_CONNECTIONS; i++)
+    mysql_close(mysql[i]);
+  return OK;
+}
+
+#define URING_CONNECTIONS 10
+
+static int test_uring(MYSQL *unused __attribute__((unused)))
+{
+  MYSQL *mysql[URING_CONNECTIONS], *ready[URING_CONNECTIONS], *ret;
+  MARIADB_URING *ring;
+  MARIADB_URING_STATS stats;
+  int i, j, rc, count, pending, status[URING_CONNECTIONS], err[URING_CONNECTIONS];
+  MYSQL_RES *res;
+  MYSQL_ROW row;
+
+  if (skip_async)
+    return SKIP;
+  /* TLS connections don't use the ring */
+  if (force_tls)
+    return SKIP;
+  if (!(ring= mariadb_uring_init(64)))
+  {
+    diag("io_uring is not available");
+    return SKIP;
+  }
+
+  for (i= 0; i < URING_CONNECTIONS; i++)
+  {
+    mysql[i]= mysql_init(NULL);
+    rc= mysql_optionsv(mysql[i], MARIADB_OPT_IO_URING, ring);
+    check_mysql_rc(rc, mysql[i]);
+    mysql_options(mysql[i], MYSQL_OPT_NONBLOCK, 0);
+    /* the handshake uses the socket */
+    status[i]= mysql_real_connect_start(&ret, mysql[i], hostname, username,
+                                        password, schema, port, socketname, 0);
+    while (status[i])
+    {
+      status[i]= wait_for_mysql(mysql[i], status[i]);
+      status[i]= mysql_real_connect_cont(&ret, mysql[i], status[i]);
+    }
+    FAIL_IF(!ret, mysql_error(mysql[i]));
+  }
+  mariadb_uring_get_stats(ring, &stats);
+  FAIL_IF(stats.connections != URING_CONNECTIONS, "connections weren't attached");
+
+  /* the queries of all connections are submitted together */
+  pending= 0;
+  for (i= 0; i < URING_CONNECTIONS; i++)
+  {
+    char query[64];
+    snprintf(query, sizeof(query), "SELECT %d", i);
+    if ((status[i]= mysql_real_query_start(&err[i], mysql[i], query, strlen(query))))
+      pending++;
+  }
+  while (pending)
+  {
+    count= mariadb_uring_wait(ring, ready, URING_CONNECTIONS, 5000);
+    FAIL_IF(count <= 0, "mariadb_uring_wait() failed");
+    for (j= 0; j < count; j++)
+    {
+      for (i= 0; mysql[i] != ready[j]; i++)
+        ;
+      if (!(status[i]= mysql_real_query_cont(&err[i], mysql[i], MYSQL_WAIT_READ)))
+        pending--;
+    }
+  }
+  for (i= 0; i < URING_CONNECTIONS; i++)
+  {
+    FAIL_IF(err[i], mysql_error(mysql[i]));
+    res= mysql_store_result(mysql[i]);
+    FAIL_IF(!res, mysql_error(mysql[i]));
+    row= mysql_fetch_row(res);
+    FAIL_IF(!row || atoi(row[0]) != i, "wrong result");
+    mysql_free_result(res);
+  }
+
+  mariadb_uring_get_stats(ring, &stats);
+  diag("enters: %llu  sends: %llu  receives: %llu  buffers: %u",
+       stats.enters, stats.sends, stats.receives, stats.buffers);
+  FAIL_IF(stats.sends < URING_CONNECTIONS || !stats.receives,
+          "ring wasn't used");
+
+  /* the connections keep the ring alive */
+  mariadb_uring_close(ring);
+  for (i= 0; i < URING_CONNECTIONS; i++)
+    mysql_close(mysql[i]);
+  return OK;
+}
+
 struct my_tests_st my_tests[] = {
   {"test_async", test_async, TEST_CONNECTION_DEFAULT, 0,  NULL,  NULL},
   {"async1", async1, TEST_CONNECTION_DEFAULT, 0,  NULL,  NULL},
   {"test_conc131", test_conc131, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
   {"test_conc129", test_conc129, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
   {"test_conc622", test_conc622, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
+  {"test_loop", test_loop, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
+  {"test_stack_pool", test_stack_pool, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
+  {"test_uring", test_uring, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
   {NULL, NULL, 0, 0, NULL, NULL}
 };
 
@@ -29,6 +29,14 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "my_test.h"
 #include "ma_common.h"
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
 
 static int test_conc75(MYSQL *my)
 {
@@ -806,6 +814,393 @@ static int test_compressed(MYSQL *unused __attribute__((unused)))
   return OK;
 }
 
+static int test_compression_stats(MYSQL *unused __attribute__((unused)))
+{
+  int rc, i;
+  MYSQL *mysql= mysql_init(NULL);
+  MYSQL_RES *res;
+  MYSQL_ROW row;
+  MARIADB_COMPRESSION_STATS stats;
+  char query[1024];
+
+  mysql_options(mysql, MYSQL_OPT_COMPRESS, (void *)1);
+  FAIL_IF(!my_test_connect(mysql, hostname, username, password, schema,
+                           port, socketname, 0, 1), mysql_error(mysql));
+
+  /* compressible query and result, the scratch buffer will be reused */
+  for (i= 0; i < 10; i++)
+  {
+    snprintf(query, sizeof(query), "SELECT REPEAT('A', %d), '%0*d'",
+             10000 * (i + 1), 500, i);
+    rc= mysql_query(mysql, query);
+    check_mysql_rc(rc, mysql);
+    res= mysql_store_result(mysql);
+    FAIL_IF(!res, mysql_error(mysql));
+    row= mysql_fetch_row(res);
+    FAIL_IF(mysql_fetch_lengths(res)[0] != (unsigned long)(10000 * (i + 1)) ||
+            row[0][0] != 'A', "Wrong result");
+    mysql_free_result(res);
+  }
+
+  rc= mariadb_get_infov(mysql, MARIADB_CONNECTION_COMPRESSION_STATS, &stats);
+  FAIL_IF(rc, "mariadb_get_infov failed");
+  diag("sent: %llu/%llu bytes, read: %llu/%llu bytes",
+       stats.compressed_bytes_sent, stats.raw_bytes_sent,
+       stats.compressed_bytes_read, stats.raw_bytes_read);
+  FAIL_IF(stats.packets_sent < 10 || stats.packets_read < 10,
+          "Expected compressed packets");
+  FAIL_IF(stats.compressed_bytes_sent >= stats.raw_bytes_sent ||
+          stats.compressed_bytes_read >= stats.raw_bytes_read,
+          "Expected compression");
+
+  mysql_close(mysql);
+  return OK;
+}
+
+static int test_compression_adaptive(MYSQL *unused __attribute__((unused)))
+{
+  int rc, i;
+  MYSQL *mysql= mysql_init(NULL);
+  MYSQL_RES *res;
+  MARIADB_COMPRESSION_STATS stats;
+  my_bool adaptive= 1;
+  unsigned char random[4000];
+  char *query;
+
+  rc= mysql_optionsv(mysql, MARIADB_OPT_COMPRESSION_ADAPTIVE, &adaptive);
+  check_mysql_rc(rc, mysql);
+  adaptive= 0;
+  rc= mysql_get_optionv(mysql, MARIADB_OPT_COMPRESSION_ADAPTIVE, &adaptive);
+  check_mysql_rc(rc, mysql);
+  FAIL_IF(!adaptive, "Expected adaptive compression");
+
+  mysql_options(mysql, MYSQL_OPT_COMPRESS, (void *)1);
+  FAIL_IF(!my_test_connect(mysql, hostname, username, password, schema,
+                           port, socketname, 0, 1), mysql_error(mysql));
+
+  /* incompressible payload: compression should be skipped */
+  srand(4711);
+  for (i= 0; i < (int)sizeof(random); i++)
+    random[i]= (unsigned char)(rand() >> 3);
+  query= (char *)malloc(sizeof(random) * 2 + 64);
+  FAIL_IF(!query, "Not enough memory");
+  strcpy(query, "SELECT LENGTH(_binary'");
+  i= (int)strlen(query);
+  i+= (int)mysql_real_escape_string(mysql, query + i, (char *)random, sizeof(random));
+  strcpy(query + i, "')");
+
+  for (i= 0; i < 20; i++)
+  {
+    rc= mysql_query(mysql, query);
+    check_mysql_rc(rc, mysql);
+    res= mysql_store_result(mysql);
+    FAIL_IF(!res, mysql_error(mysql));
+    FAIL_IF(strcmp(mysql_fetch_row(res)[0], "4000"), "Wrong result");
+    mysql_free_result(res);
+  }
+  free(query);
+
+  rc= mariadb_get_infov(mysql, MARIADB_CONNECTION_COMPRESSION_STATS, &stats);
+  FAIL_IF(rc, "mariadb_get_infov failed");
+  diag("skipped: %llu, level: %d (+%llu/-%llu)", stats.packets_skipped,
+       stats.compression_level, stats.level_raised, stats.level_lowered);
+  FAIL_IF(!stats.packets_skipped, "Expected skipped packets");
+  FAIL_IF(stats.compression_level <= 0, "Expected compression level");
+
+  mysql_close(mysql);
+  return OK;
+}
+
+#ifndef _WIN32
+/*
+  Relays one connection between the client and the server and forwards
+  the client's data at about 2MB/s, so the link and not the socket
+  buffer limits the write throughput.
+*/
+struct slow_proxy {
+  int listen_fd;
+  int port;
+};
+
+static void *slow_proxy_run(void *arg)
+{
+  struct slow_proxy *proxy= (struct slow_proxy *)arg;
+  struct addrinfo hints, *ai;
+  struct pollfd pfd[2];
+  char buf[4096], portstr[12];
+  int client, server, rcvbuf= 4096;
+
+  if ((client= accept(proxy->listen_fd, NULL, NULL)) < 0)
+    return NULL;
+  setsockopt(client, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_socktype= SOCK_STREAM;
+  snprintf(portstr, sizeof(portstr), "%u", port ? port : 3306);
+  if (getaddrinfo(!hostname || !strcmp(hostname, "localhost") ?
+                  "127.0.0.1" : hostname, portstr, &hints, &ai))
+  {
+    close(client);
+    return NULL;
+  }
+  server= socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if (server < 0 || connect(server, ai->ai_addr, ai->ai_addrlen))
+  {
+    freeaddrinfo(ai);
+    close(client);
+    if (server >= 0)
+      close(server);
+    return NULL;
+  }
+  freeaddrinfo(ai);
+
+  pfd[0].fd= client;
+  pfd[1].fd= server;
+  pfd[0].events= pfd[1].events= POLLIN;
+  while (poll(pfd, 2, -1) > 0)
+  {
+    ssize_t len;
+    if (pfd[0].revents)
+    {
+      if ((len= read(client, buf, sizeof(buf))) <= 0 ||
+          write(server, buf, len) != len)
+        break;
+      usleep(2000);
+    }
+    if (pfd[1].revents)
+    {
+      if ((len= read(server, buf, sizeof(buf))) <= 0 ||
+          write(client, buf, len) != len)
+        break;
+    }
+  }
+  close(client);
+  close(server);
+  return NULL;
+}
+
+static int slow_proxy_start(struct slow_proxy *proxy, pthread_t *thread)
+{
+  struct sockaddr_in addr;
+  socklen_t len= sizeof(addr);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family= AF_INET;
+  addr.sin_addr.s_addr= htonl(INADDR_LOOPBACK);
+  if ((proxy->listen_fd= socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    return 1;
+  if (bind(proxy->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+      listen(proxy->listen_fd, 1) ||
+      getsockname(proxy->listen_fd, (struct sockaddr *)&addr, &len) ||
+      pthread_create(thread, NULL, slow_proxy_run, proxy))
+  {
+    close(proxy->listen_fd);
+    return 1;
+  }
+  proxy->port= ntohs(addr.sin_port);
+  return 0;
+}
+
+/*
+  Over a slow link writing a compressed packet is fast (it only fills the
+  socket buffer), but sending it is not: compression has to stay on.
+*/
+static int test_compression_adaptive_slow_link(MYSQL *unused __attribute__((unused)))
+{
+  int rc, i, sndbuf= 16384;
+  MYSQL *mysql;
+  MYSQL_RES *res;
+  MARIADB_COMPRESSION_STATS stats;
+  my_bool adaptive= 1;
+  struct slow_proxy proxy;
+  pthread_t thread;
+  size_t len= 128 * 1024;
+  char *query;
+  unsigned int seed= 4711;
+
+  SKIP_SKYSQL;
+  if (slow_proxy_start(&proxy, &thread))
+  {
+    diag("Can't start proxy");
+    return SKIP;
+  }
+
+  mysql= mysql_init(NULL);
+  mysql_optionsv(mysql, MARIADB_OPT_COMPRESSION_ADAPTIVE, &adaptive);
+  mysql_options(mysql, MYSQL_OPT_COMPRESS, (void *)1);
+  if (!my_test_connect(mysql, "127.0.0.1", username, password, schema,
+                       proxy.port, NULL, 0, 1))
+  {
+    diag("Can't connect through proxy: %s", mysql_error(mysql));
+    mysql_close(mysql);
+    close(proxy.listen_fd);
+    pthread_join(thread, NULL);
+    return SKIP;
+  }
+  close(proxy.listen_fd);
+  setsockopt(mysql_get_socket(mysql), SOL_SOCKET, SO_SNDBUF, &sndbuf,
+             sizeof(sndbuf));
+
+  /* hex digits compress to about half: the packets still fill the buffer */
+  query= (char *)malloc(len + 64);
+  FAIL_IF(!query, "Not enough memory");
+  strcpy(query, "SELECT LENGTH('");
+  i= (int)strlen(query);
+  for (; i < (int)len; i++)
+  {
+    seed= seed * 1103515245 + 12345;
+    query[i]= "0123456789abcdef"[(seed >> 16) & 15];
+  }
+  strcpy(query + len, "')");
+
+  for (i= 0; i < 40; i++)
+  {
+    rc= mysql_query(mysql, query);
+    check_mysql_rc(rc, mysql);
+    res= mysql_store_result(mysql);
+    FAIL_IF(!res, mysql_error(mysql));
+    mysql_free_result(res);
+  }
+  free(query);
+
+  rc= mariadb_get_infov(mysql, MARIADB_CONNECTION_COMPRESSION_STATS, &stats);
+  FAIL_IF(rc, "mariadb_get_infov failed");
+  diag("sent: %llu/%llu, skipped: %llu, level: %d (+%llu/-%llu)",
+       stats.compressed_bytes_sent, stats.raw_bytes_sent,
+       stats.packets_skipped, stats.compression_level,
+       stats.level_raised, stats.level_lowered);
+  FAIL_IF(stats.packets_skipped, "Compression must not be skipped on a slow link");
+  FAIL_IF(stats.compression_level <= 0, "Expected compression level");
+
+  mysql_close(mysql);
+  pthread_join(thread, NULL);
+  return OK;
+}
+#endif
+
+static int test_gather_write(MYSQL *mysql)
+{
+  int rc;
+  size_t i, len= 1024 * 1024;
+  char *query;
+  MYSQL_RES *res;
+  MYSQL_STMT *stmt;
+  MYSQL_BIND bind;
+  long long count= 0, total= 0;
+
+  /* packet larger than the net buffer, sent without copying */
+  query= (char *)malloc(len + 64);
+  FAIL_IF(!query, "Not enough memory");
+  strcpy(query, "SELECT LENGTH('");
+  i= strlen(query);
+  memset(query + i, 'a', len);
+  strcpy(query + i + len, "')");
+  rc= mysql_real_query(mysql, query, (unsigned long)strlen(query));
+  check_mysql_rc(rc, mysql);
+  res= mysql_store_result(mysql);
+  FAIL_IF(!res, mysql_error(mysql));
+  FAIL_IF(strtoul(mysql_fetch_row(res)[0], NULL, 10) != len, "Wrong length");
+  mysql_free_result(res);
+
+  /* long data chunks of different size */
+  stmt= mysql_stmt_init(mysql);
+  rc= mysql_stmt_prepare(stmt, SL("SELECT LENGTH(?)"));
+  check_stmt_rc(rc, stmt);
+  memset(&bind, 0, sizeof(MYSQL_BIND));
+  bind.buffer_type= MYSQL_TYPE_LONG_BLOB;
+  rc= mysql_stmt_bind_param(stmt, &bind);
+  check_stmt_rc(rc, stmt);
+  for (i= 1; i <= len; i*= 4)
+  {
+    rc= mysql_stmt_send_long_data(stmt, 0, query, (unsigned long)i);
+    check_stmt_rc(rc, stmt);
+    total+= i;
+  }
+  free(query);
+  rc= mysql_stmt_execute(stmt);
+  check_stmt_rc(rc, stmt);
+  memset(&bind, 0, sizeof(MYSQL_BIND));
+  bind.buffer_type= MYSQL_TYPE_LONGLONG;
+  bind.buffer= &count;
+  rc= mysql_stmt_bind_result(stmt, &bind);
+  check_stmt_rc(rc, stmt);
+  rc= mysql_stmt_fetch(stmt);
+  check_stmt_rc(rc, stmt);
+  FAIL_IF(count != total, "Wrong length");
+  mysql_stmt_close(stmt);
+
+  return OK;
+}
+
+static int test_pipeline(MYSQL *mysql)
+{
+  int rc, i, val;
+  char query[64];
+  MYSQL_STMT *stmt, *res_stmt;
+  MYSQL_BIND bind;
+  MYSQL_RES *res;
+
+  rc= mysql_query(mysql, "CREATE OR REPLACE TEMPORARY TABLE t_pipeline (a int primary key)");
+  check_mysql_rc(rc, mysql);
+
+  stmt= mysql_stmt_init(mysql);
+  rc= mysql_stmt_prepare(stmt, SL("INSERT INTO t_pipeline VALUES (?)"));
+  check_stmt_rc(rc, stmt);
+  memset(&bind, 0, sizeof(MYSQL_BIND));
+  bind.buffer_type= MYSQL_TYPE_LONG;
+  bind.buffer= &val;
+  rc= mysql_stmt_bind_param(stmt, &bind);
+  check_stmt_rc(rc, stmt);
+
+  /* results can't be read before the pipeline was flushed */
+  rc= mariadb_pipeline_begin(mysql);
+  check_mysql_rc(rc, mysql);
+  FAIL_IF(mariadb_pipeline_next_result(mysql, NULL) != 1, "Error expected");
+
+  for (i= 1; i <= 50; i++)
+  {
+    snprintf(query, sizeof(query), "INSERT INTO t_pipeline VALUES (%d)", i);
+    rc= mariadb_pipeline_query(mysql, query, -1);
+    check_mysql_rc(rc, mysql);
+  }
+  /* duplicate key */
+  rc= mariadb_pipeline_query(mysql, SL("INSERT INTO t_pipeline VALUES (1)"));
+  check_mysql_rc(rc, mysql);
+  val= 51;
+  rc= mariadb_pipeline_stmt_execute(stmt);
+  check_stmt_rc(rc, stmt);
+  rc= mariadb_pipeline_query(mysql, SL("SELECT COUNT(*) FROM t_pipeline"));
+  check_mysql_rc(rc, mysql);
+  rc= mariadb_pipeline_flush(mysql);
+  check_mysql_rc(rc, mysql);
+
+  for (i= 1; i <= 50; i++)
+  {
+    rc= mariadb_pipeline_next_result(mysql, &res_stmt);
+    check_mysql_rc(rc, mysql);
+    FAIL_IF(res_stmt, "Query expected");
+    FAIL_IF(mysql_affected_rows(mysql) != 1, "Expected 1 affected row");
+  }
+  rc= mariadb_pipeline_next_result(mysql, &res_stmt);
+  FAIL_IF(rc != 1 || mysql_errno(mysql) != 1062, "Expected duplicate key error");
+
+  rc= mariadb_pipeline_next_result(mysql, &res_stmt);
+  check_stmt_rc(rc, stmt);
+  FAIL_IF(res_stmt != stmt, "Statement expected");
+  FAIL_IF(mysql_stmt_affected_rows(stmt) != 1, "Expected 1 affected row");
+
+  rc= mariadb_pipeline_next_result(mysql, &res_stmt);
+  check_mysql_rc(rc, mysql);
+  res= mysql_store_result(mysql);
+  FAIL_IF(!res, mysql_error(mysql));
+  FAIL_IF(strcmp(mysql_fetch_row(res)[0], "51"), "Expected 51 rows");
+  mysql_free_result(res);
+
+  FAIL_IF(mariadb_pipeline_next_result(mysql, NULL) != -1, "No more results expected");
+
+  mysql_stmt_close(stmt);
+  return OK;
+}
+
 static int test_conc624(MYSQL *mysql)
 {
   MYSQL_STMT *stmt= mysql_stmt_init(mysql);
@@ -854,6 +1249,13 @@ struct my_tests_st my_tests[] = {
   {"test_conc70", test_conc70, TEST_CONNECTION_DEFAULT, 0,  NULL,  NULL},
   {"test_conc68", test_conc68, TEST_CONNECTION_DEFAULT, 0,  NULL,  NULL},
   {"test_compressed", test_compressed, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
+  {"test_compression_stats", test_compression_stats, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
+  {"test_compression_adaptive", test_compression_adaptive, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
+#ifndef _WIN32
+  {"test_compression_adaptive_slow_link", test_compression_adaptive_slow_link, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
+#endif
+  {"test_gather_write", test_gather_write, TEST_CONNECTION_DEFAULT, 0,  NULL,  NULL},
+  {"test_pipeline", test_pipeline, TEST_CONNECTION_DEFAULT, 0,  NULL,  NULL},
   {"test_reconnect_maxpackage", test_reconnect_maxpackage, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
   {"basic_connect", basic_connect, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
   {"use_utf8", use_utf8, TEST_CONNECTION_NEW, 0,  opt_utf8,  NULL},
@@ -23,6 +23,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include "my_test.h"
+#include <ma_simd.h>
 
 /*
  test gbk charset escaping
@@ -860,6 +861,218 @@ static int test_conc223(MYSQL *mysql)
   return OK;
 }
 
+/* compares the vectorized escape and hex functions with the byte by
+   byte versions for all compiled character sets */
+static int test_escape_simd(MYSQL *unused __attribute__((unused)))
+{
+  static const struct {
+    const char *str;
+    size_t len;
+  } tokens[]= {
+    {"a", 1}, {"Hello world ", 12}, {"abcdefghijklmnopqrstuvwxyz0123456789", 36},
+    {"'", 1}, {"\"", 1}, {"\\", 1}, {"\n", 1}, {"\r", 1}, {"\032", 1},
+    {"\0", 1}, {"\xc3\xa9", 2}, {"\xe2\x82\xac", 3}, {"\xf0\x9f\x98\x80", 4},
+    {"\x80", 1}, {"\xbf\x27", 2}, {"\x81\x5c", 2}, {"\xff", 1}
+  };
+  const MARIADB_CHARSET_INFO *cs;
+  enum enum_ma_simd_level level, best= ma_simd_detect();
+  char in[2100], expected[4200], out[4200];
+  int i, checked= 0;
+
+  srand(42);
+  for (i= 0; i < 200; i++)
+  {
+    size_t len= 0, max= (i % 20 == 19) ? 2000 : (size_t)(rand() % 100);
+    /* misalign the input */
+    char *str= in + (i % 8);
+
+    while (len < max)
+    {
+      int t= rand() % (int)(sizeof(tokens) / sizeof(tokens[0]));
+      /* clean runs are more likely than special characters */
+      if (rand() % 3)
+        t= rand() % 3;
+      if (len + tokens[t].len > max)
+        break;
+      memcpy(str + len, tokens[t].str, tokens[t].len);
+      len+= tokens[t].len;
+    }
+
+    for (cs= mariadb_compiled_charsets; cs->nr; cs++)
+    {
+      int slashes;
+
+      /* internal character sets like filename can't be escaped */
+      if (cs->char_maxlen > 1 && !cs->mb_valid)
+        continue;
+      for (slashes= 0; slashes < 2; slashes++)
+      {
+        size_t rc, expected_rc;
+
+        ma_simd_set_level(MA_SIMD_SCALAR);
+        expected_rc= slashes ? mysql_cset_escape_slashes(cs, expected, str, len) :
+                               mysql_cset_escape_quotes(cs, expected, str, len);
+        for (level= MA_SIMD_WORD; level <= MA_SIMD_NEON; level++)
+        {
+          if (ma_simd_set_level(level))
+            continue;
+          rc= slashes ? mysql_cset_escape_slashes(cs, out, str, len) :
+                        mysql_cset_escape_quotes(cs, out, str, len);
+          if (rc != expected_rc || memcmp(out, expected, rc + 1))
+          {
+            diag("%s escaping differs: charset %s, level %d, length %zu",
+                 slashes ? "slashes" : "quotes", cs->name, level, len);
+            ma_simd_set_level(best);
+            return FAIL;
+          }
+          checked++;
+        }
+      }
+    }
+
+    ma_simd_set_level(MA_SIMD_SCALAR);
+    mysql_hex_string(expected, str, (unsigned long)len);
+    for (level= MA_SIMD_WORD; level <= MA_SIMD_NEON; level++)
+    {
+      if (ma_simd_set_level(level))
+        continue;
+      FAIL_IF(mysql_hex_string(out, str, (unsigned long)len) != 2 * len ||
+              strcmp(out, expected), "mysql_hex_string differs");
+    }
+  }
+  ma_simd_set_level(best);
+  diag("%d comparisons, simd level %d", checked, best);
+  return OK;
+}
+
+/* length of the valid prefix computed with mb_valid of the character set */
+static size_t utf8_valid_ref(const MARIADB_CHARSET_INFO *cs, const uchar *str,
+                             size_t len, my_bool strict, size_t *chars)
+{
+  const uchar *p= str, *end= str + len;
+
+  *chars= 0;
+  while (p < end)
+  {
+    unsigned int l= *p < 0x80 ? 1 : cs->mb_valid((const char *)p, (const char *)end);
+
+    if (strict && l == 3 && p[0] == 0xED && p[1] >= 0xA0)
+      l= 0;
+    if (!l)
+      break;
+    p+= l;
+    (*chars)++;
+  }
+  return p - str;
+}
+
+static int test_utf8_valid(MYSQL *unused __attribute__((unused)))
+{
+  static const struct {
+    const char *charset;
+    int flags;
+    const char *prefix;
+  } configs[]= {
+    {"utf8mb3", 0, "a\xc3\xa9\xe2\x82\xac"},
+    {"utf8mb4", MA_UTF8_MB4, "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80"},
+    {"utf8mb4", MA_UTF8_MB4 | MA_UTF8_STRICT, "a\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80"}
+  };
+  static const char *chars_utf8[]= {"\xc3\xa9", "\xe2\x82\xac", "\xef\xbf\xbd",
+                                     "\xf0\x9f\x98\x80"};
+  /* interesting values for the 3rd and 4th byte */
+  static const uchar tails[]= {0x41, 0x80, 0x8f, 0x90, 0x9f, 0xa0, 0xbf, 0xc0,
+                               0xf0};
+  enum enum_ma_simd_level level, best= ma_simd_detect();
+  uchar buf[64 + 2000];
+  unsigned int c;
+  int checked= 0;
+
+  for (c= 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+  {
+    const MARIADB_CHARSET_INFO *cs= mariadb_get_charset_by_name(configs[c].charset);
+    size_t plen= strlen(configs[c].prefix);
+    my_bool strict= (configs[c].flags & MA_UTF8_STRICT) != 0;
+    unsigned int b0, b1, t2, t3;
+
+    FAIL_IF(!cs, "character set not found");
+    /* all 1 and 2 byte sequences, 3 and 4 byte sequences with sampled tails */
+    for (b0= 0x80; b0 < 0x100; b0++)
+    for (b1= 0; b1 < 0x100; b1++)
+    for (t2= 0; t2 < sizeof(tails); t2++)
+    for (t3= 0; t3 < (b0 >= 0xF0 ? sizeof(tails) : 1); t3++)
+    {
+      /* the sequence crosses 16 and 32 byte block boundaries */
+      size_t offset= 29 + b1 % 4, i, lengths[2], chars, expected, expected_chars;
+      int l;
+
+      for (i= 0; i + plen <= offset; i+= plen)
+        memcpy(buf + i, configs[c].prefix, plen);
+      memset(buf + i, 'x', 64 - i);
+      buf[offset]= (uchar)b0;
+      buf[offset + 1]= (uchar)b1;
+      buf[offset + 2]= tails[t2];
+      buf[offset + 3]= tails[t3];
+      lengths[0]= 64;
+      lengths[1]= offset + 1 + (b1 + t2) % 3;
+      for (l= 0; l < 2; l++)
+      {
+        expected= utf8_valid_ref(cs, buf, lengths[l], strict, &expected_chars);
+        for (level= MA_SIMD_SCALAR; level <= MA_SIMD_NEON; level++)
+        {
+          if (ma_simd_set_level(level))
+            continue;
+          if (ma_simd_utf8_valid(buf, lengths[l], configs[c].flags, &chars) != expected ||
+              chars != expected_chars)
+          {
+            diag("%s: %02X %02X %02X %02X at %zu, length %zu, level %d",
+                 configs[c].charset, b0, b1, tails[t2], tails[t3], offset,
+                 lengths[l], level);
+            ma_simd_set_level(best);
+            return FAIL;
+          }
+          checked++;
+        }
+      }
+    }
+
+    /* long valid strings with an error somewhere */
+    srand(42);
+    for (b0= 0; b0 < 200; b0++)
+    {
+      size_t len= 0, max= (size_t)(rand() % 2000), chars, expected, expected_chars;
+      uchar *str= buf + b0 % 8;
+
+      while (len + 4 <= max)
+      {
+        /* ASCII runs and characters of every length */
+        int t= rand() % (configs[c].flags & MA_UTF8_MB4 ? 8 : 6);
+
+        if (t < 4)
+          str[len++]= 'a' + t;
+        else
+        {
+          memcpy(str + len, chars_utf8[t - 4], strlen(chars_utf8[t - 4]));
+          len+= strlen(chars_utf8[t - 4]);
+        }
+      }
+      if (len && rand() % 2)
+        str[rand() % len]= (uchar)(0x80 + rand() % 0x80);
+      expected= utf8_valid_ref(cs, str, len, strict, &expected_chars);
+      for (level= MA_SIMD_SCALAR; level <= MA_SIMD_NEON; level++)
+      {
+        if (ma_simd_set_level(level))
+          continue;
+        FAIL_IF(ma_simd_utf8_valid(str, len, configs[c].flags, &chars) != expected ||
+                chars != expected_chars, "utf8 validation differs");
+        checked++;
+      }
+    }
+  }
+  ma_simd_set_level(best);
+  diag("%d comparisons, simd level %d", checked, best);
+  return OK;
+}
+
 struct my_tests_st my_tests[] = {
   {"test_conc223", test_conc223, TEST_CONNECTION_DEFAULT, 0,  NULL, NULL},
   {"charset_auto", charset_auto, TEST_CONNECTION_DEFAULT, 0,  NULL, NULL},
@@ -874,6 +1087,8 @@ struct my_tests_st my_tests[] = {
   {"test_ps_i18n", test_ps_i18n, TEST_CONNECTION_DEFAULT, 0,  NULL, NULL},
   {"test_bug_54100", test_bug_54100, TEST_CONNECTION_NEW, 0, NULL, NULL}, 
   {"test_utf16_utf32_noboms", test_utf16_utf32_noboms, TEST_CONNECTION_DEFAULT, 0,  NULL, NULL},
+  {"test_escape_simd", test_escape_simd, TEST_CONNECTION_NONE, 0,  NULL, NULL},
+  {"test_utf8_valid", test_utf8_valid, TEST_CONNECTION_NONE, 0,  NULL, NULL},
   {NULL, NULL, 0, 0, NULL, 0}
 };
 
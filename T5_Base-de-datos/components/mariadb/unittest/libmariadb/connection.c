@@ -26,6 +26,9 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 */
 
 #include "my_test.h"
+#ifndef _WIN32
+#include <poll.h>
+#endif
 
 static int test_conc66(MYSQL *my)
 {
@@ -2336,7 +2339,113 @@ static int test_conc505(MYSQL *my __attribute__((unused)))
   return OK;
 }
 
+static int test_io_uring(MYSQL *unused __attribute__((unused)))
+{
+  MYSQL *mysql= mysql_init(NULL);
+  MYSQL_RES *res;
+  MYSQL_ROW row;
+  unsigned long *lengths;
+  void *ring= (void *)1;
+  int rc, i;
+
+  /* passes with pvio_socket too, if io_uring isn't available */
+  rc= mysql_optionsv(mysql, MARIADB_OPT_IO_URING, NULL);
+  check_mysql_rc(rc, mysql);
+  rc= mysql_get_optionv(mysql, MARIADB_OPT_IO_URING, &ring);
+  check_mysql_rc(rc, mysql);
+  FAIL_IF(ring != NULL, "Expected private ring");
+
+  if (!my_test_connect(mysql, hostname, username, password, schema, port, socketname, CLIENT_MULTI_STATEMENTS, 1))
+  {
+    diag("Error: %s", mysql_error(mysql));
+    mysql_close(mysql);
+    return FAIL;
+  }
+
+  for (i= 0; i < 100; i++)
+  {
+    rc= mysql_query(mysql, "SELECT REPEAT('a', 100000), 1");
+    check_mysql_rc(rc, mysql);
+    res= mysql_store_result(mysql);
+    FAIL_IF(!res, "Expected result set");
+    row= mysql_fetch_row(res);
+    lengths= mysql_fetch_lengths(res);
+    FAIL_IF(!row || lengths[0] != 100000 || strcmp(row[1], "1"), "Wrong result");
+    mysql_free_result(res);
+  }
+
+  rc= mysql_ping(mysql);
+  check_mysql_rc(rc, mysql);
+
+  /* a multi statement leaves the next result on the ring */
+  rc= mysql_query(mysql, "SELECT 1; SELECT 2");
+  check_mysql_rc(rc, mysql);
+  do {
+    res= mysql_store_result(mysql);
+    mysql_free_result(res);
+  } while (!(rc= mysql_next_result(mysql)));
+  FAIL_IF(rc > 0, "Error reading results");
+
+  mysql_close(mysql);
+  return OK;
+}
+
+#ifndef _WIN32
+/*
+  With the blocking API mysql_send_query() must have sent the query when
+  it returns, and the response must arrive on the socket, not on the ring.
+*/
+static int test_io_uring_send_query_poll(MYSQL *unused __attribute__((unused)))
+{
+  MYSQL *mysql= mysql_init(NULL);
+  MYSQL_RES *res;
+  MYSQL_ROW row;
+  struct pollfd pfd;
+  int rc, i;
+
+  rc= mysql_optionsv(mysql, MARIADB_OPT_IO_URING, NULL);
+  check_mysql_rc(rc, mysql);
+  if (!my_test_connect(mysql, hostname, username, password, schema, port, socketname, 0, 1))
+  {
+    diag("Error: %s", mysql_error(mysql));
+    mysql_close(mysql);
+    return FAIL;
+  }
+
+  for (i= 0; i < 10; i++)
+  {
+    /* a previous round trip must not leave a receive armed */
+    rc= mysql_query(mysql, "SELECT 1");
+    check_mysql_rc(rc, mysql);
+    res= mysql_store_result(mysql);
+    mysql_free_result(res);
+
+    rc= mysql_send_query(mysql, SL("SELECT SLEEP(0.01), 2"));
+    check_mysql_rc(rc, mysql);
+    pfd.fd= mysql_get_socket(mysql);
+    pfd.events= POLLIN;
+    pfd.revents= 0;
+    rc= poll(&pfd, 1, 5000);
+    FAIL_IF(rc != 1 || !(pfd.revents & POLLIN), "Socket didn't become readable");
+    rc= mysql_read_query_result(mysql);
+    check_mysql_rc(rc, mysql);
+    res= mysql_store_result(mysql);
+    FAIL_IF(!res, "Expected result set");
+    row= mysql_fetch_row(res);
+    FAIL_IF(!row || strcmp(row[1], "2"), "Wrong result");
+    mysql_free_result(res);
+  }
+
+  mysql_close(mysql);
+  return OK;
+}
+#endif
+
 struct my_tests_st my_tests[] = {
+  {"test_io_uring", test_io_uring, TEST_CONNECTION_NONE, 0, NULL, NULL},
+#ifndef _WIN32
+  {"test_io_uring_send_query_poll", test_io_uring_send_query_poll, TEST_CONNECTION_NONE, 0, NULL, NULL},
+#endif
   {"test_conc505", test_conc505, TEST_CONNECTION_NONE, 0, NULL, NULL},
   {"test_conc632", test_conc632, TEST_CONNECTION_NONE, 0, NULL, NULL},
   {"test_status_callback", test_status_callback, TEST_CONNECTION_NONE, 0, NULL, NULL},
@@ -0,0 +1,1373 @@
+/*
+Copyright (c) 2025 MariaDB Corporation AB
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published
+by the Free Software Foundation; version 2 of the License.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+for more details.
+
+You should have received a copy of the GNU General Public License along
+with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
+*/
+
+/**
+  Microbenchmarks for the client side decoding paths.
+
+  No server is needed: packets are generated once with ma_net_write()
+  into an in-memory pvio and replayed for every pass, so the numbers
+  only contain the client's own work (packet framing, decompression,
+  row and field decoding, binary protocol conversion, double to string
+  formatting, binlog event checksums, dynamic columns to JSON and
+  dynamic column updates).
+
+  usage: decode_bench [--filter substring] [--time seconds]
+                      [--json file] [--baseline file] [--tolerance percent]
+
+  --json writes the results, a file written by --json can be passed
+  later with --baseline. Benchmarks which are more than --tolerance
+  percent (default 10) slower than the baseline are reported and the
+  program exits with a non zero status. The numbers depend on the
+  machine and the build, so a baseline is meant to be written and
+  compared on the same machine, e.g. before and after a change.
+*/
+
+#include <ma_global.h>
+#include <ma_common.h>
+#include <ma_pvio.h>
+#include <ma_compress.h>
+#include "ma_priv.h"
+#include <ma_simd.h>
+#include <ma_string.h>
+#include <mysql.h>
+#include <mariadb_dyncol.h>
+#include <errmsg.h>
+#include <mysql/client_plugin.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+extern MYSQL_DATA *mthd_my_read_rows(MYSQL *mysql, MYSQL_FIELD *mysql_fields,
+                                     uint fields);
+extern int mthd_my_read_one_row(MYSQL *mysql, uint fields, MYSQL_ROW row,
+                                ulong *lengths);
+extern int mthd_stmt_fetch_to_bind(MYSQL_STMT *stmt, unsigned char *row);
+extern unsigned char *mysql_net_store_length(unsigned char *packet,
+                                             ulonglong length);
+extern void ma_init_alloc_root(MA_MEM_ROOT *mem_root, size_t block_size,
+                               size_t pre_alloc_size);
+extern void ma_free_root(MA_MEM_ROOT *root, myf MyFlags);
+
+#define ROWS 1000
+#define COLUMNS 10
+#define FIELD_DEFS 50
+#define BIN_COLUMNS 6
+#define VALUES 1024
+#define BINLOG_EVENTS 1000
+#define DYNCOL_ATTRS 20
+#define DYNCOL_SMALL 200       /* columns of the records for updates */
+#define DYNCOL_LARGE 5000
+#define DYNCOL_UPDATES 1000    /* updates of the record per pass */
+#define DYNCOL_APPENDS 100     /* columns appended per pass */
+#define DYNCOL_ROW_UPDATES 10  /* columns updated in every row */
+
+/* {{{ in-memory pvio */
+typedef struct st_mem_stream {
+  uchar *buf;
+  size_t length;
+  size_t alloced;
+  size_t pos;
+  my_bool capture;      /* append writes to buf, otherwise discard them */
+} MEM_STREAM;
+
+static ssize_t mem_read(MARIADB_PVIO *pvio, uchar *buffer, size_t length)
+{
+  MEM_STREAM *s= (MEM_STREAM *)pvio->data;
+  size_t remain= s->length - s->pos;
+
+  if (!remain)
+    return 0;
+  if (length > remain)
+    length= remain;
+  memcpy(buffer, s->buf + s->pos, length);
+  s->pos+= length;
+  return (ssize_t)length;
+}
+
+static ssize_t mem_write(MARIADB_PVIO *pvio, const uchar *buffer, size_t length)
+{
+  MEM_STREAM *s= (MEM_STREAM *)pvio->data;
+
+  if (!s->capture)
+    return (ssize_t)length;
+  if (s->length + length > s->alloced)
+  {
+    size_t alloced= MAX(s->alloced * 2, s->length + length);
+    uchar *buf= (uchar *)realloc(s->buf, alloced);
+    if (!buf)
+      return -1;
+    s->buf= buf;
+    s->alloced= alloced;
+  }
+  memcpy(s->buf + s->length, buffer, length);
+  s->length+= length;
+  return (ssize_t)length;
+}
+
+static int mem_blocking(MARIADB_PVIO *pvio __attribute__((unused)),
+                        my_bool value __attribute__((unused)),
+                        my_bool *old_value)
+{
+  if (old_value)
+    *old_value= 1;
+  return 0;
+}
+
+static PVIO_METHODS mem_methods= {
+  NULL,
+  NULL,
+  mem_read,
+  NULL,
+  mem_write,
+  NULL,
+  NULL,
+  mem_blocking,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL,
+  NULL
+};
+/* }}} */
+
+typedef struct st_decode_bench {
+  MYSQL *mysql;
+  MEM_STREAM stream;
+  unsigned long long packets;  /* packets in stream */
+  /* binary protocol rows and codec input */
+  uchar *data;
+  size_t data_length;
+  size_t offsets[ROWS];
+  MYSQL_FIELD fields[BIN_COLUMNS];
+  MYSQL_BIND bind[BIN_COLUMNS];
+  MYSQL_STMT *stmt;
+  /* ps_fetch_* */
+  MYSQL_FIELD field;
+  MYSQL_BIND value_bind;
+  char value_buffer[64];
+  MYSQL_TIME value_time;
+  /* binlog_crc32*: events with checksum and the end offset of each event */
+  enum enum_ma_simd_level simd_level;
+  size_t event_ends[BINLOG_EVENTS];
+  /* dyncol_json*: ROWS records starting at offsets[] */
+  DYNAMIC_COLUMN_JSON_SINK json_sink;
+  /* dyncol_update*: the record (or ROWS records) and the changed columns */
+  DYNAMIC_COLUMN dyncol;
+  DYNAMIC_COLUMN *dyncol_rows;
+  DYNAMIC_COLUMN_UPDATE dyncol_update;
+  DYNAMIC_COLUMN_VALUE *dyncol_values;
+  uint dyncol_keys[100];
+  uint dyncol_key_count;
+  uint dyncol_columns;
+  /* results of the current pass */
+  unsigned long long ops;
+  unsigned long long bytes;
+} DECODE_BENCH;
+
+static unsigned long long bench_time(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER count, freq;
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&freq);
+  return (unsigned long long)(count.QuadPart * 1000000000.0 / freq.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+static void bench_set_error(MYSQL *mysql, unsigned int error_nr,
+                            const char *sqlstate __attribute__((unused)),
+                            const char *format __attribute__((unused)), ...)
+{
+  if (mysql)
+    mysql->net.last_errno= error_nr;
+}
+
+/* creates a connection handle which reads from and writes to b->stream */
+static my_bool bench_connect(DECODE_BENCH *b, my_bool compress)
+{
+  MARIADB_PVIO *pvio;
+
+  memset(&b->stream, 0, sizeof(MEM_STREAM));
+  if (!(b->mysql= mysql_init(NULL)))
+    return 1;
+  /* installs the default status callback used by EOF packets */
+  mysql_optionsv(b->mysql, MARIADB_OPT_STATUS_CALLBACK, NULL, NULL);
+
+  if (!(pvio= (MARIADB_PVIO *)calloc(1, sizeof(MARIADB_PVIO))) ||
+      !(pvio->cache= (uchar *)malloc(PVIO_READ_AHEAD_CACHE_SIZE)))
+  {
+    free(pvio);
+    return 1;
+  }
+  pvio->cache_pos= pvio->cache;
+  pvio->data= &b->stream;
+  pvio->methods= &mem_methods;
+  pvio->set_error= bench_set_error;
+  pvio->type= PVIO_TYPE_SOCKET;
+  if (ma_net_init(&b->mysql->net, pvio))
+  {
+    ma_pvio_close(pvio);
+    return 1;
+  }
+  pvio->mysql= b->mysql;
+  b->mysql->server_capabilities= CLIENT_PROTOCOL_41;
+
+  if (compress)
+  {
+    NET *net= &b->mysql->net;
+    MARIADB_COMPRESSION_PLUGIN *plugin= (MARIADB_COMPRESSION_PLUGIN *)
+      mysql_client_find_plugin(b->mysql, "zlib", MARIADB_CLIENT_COMPRESSION_PLUGIN);
+
+    if (!plugin ||
+        !(compression_ctx(net)= plugin->init_ctx(COMPRESSION_LEVEL_DEFAULT)))
+      return 1;
+    compression_plugin(net)= plugin;
+    net->compress= 1;
+  }
+  return 0;
+}
+
+static void bench_disconnect(DECODE_BENCH *b)
+{
+  if (b->stmt)
+  {
+    /* the statement was never prepared on a server */
+    b->stmt->state= MYSQL_STMT_INITTED;
+    mysql_stmt_close(b->stmt);
+    b->stmt= NULL;
+  }
+  if (b->mysql)
+  {
+    b->stream.capture= 0;
+    mysql_close(b->mysql);
+    b->mysql= NULL;
+  }
+  free(b->stream.buf);
+  memset(&b->stream, 0, sizeof(MEM_STREAM));
+  free(b->data);
+  b->data= NULL;
+  b->data_length= 0;
+  free(b->json_sink.str);
+  memset(&b->json_sink, 0, sizeof(b->json_sink));
+  mariadb_dyncol_free(&b->dyncol);
+  mariadb_dyncol_init(&b->dyncol);
+  if (b->dyncol_rows)
+  {
+    size_t i;
+    for (i= 0; i < ROWS; i++)
+      mariadb_dyncol_free(b->dyncol_rows + i);
+    free(b->dyncol_rows);
+    b->dyncol_rows= NULL;
+  }
+  mariadb_dyncol_update_free(&b->dyncol_update);
+  free(b->dyncol_values);
+  b->dyncol_values= NULL;
+}
+
+/* rewinds the stream and resets the reader state of the connection */
+static void bench_rewind(DECODE_BENCH *b)
+{
+  NET *net= &b->mysql->net;
+
+  b->stream.pos= 0;
+  net->pvio->cache_pos= net->pvio->cache;
+  net->pvio->cache_size= 0;
+  net->pkt_nr= net->compress_pkt_nr= 0;
+  net->where_b= net->remain_in_buf= net->buf_length= 0;
+  net->read_pos= net->buff;
+  net->error= 0;
+}
+
+static my_bool bench_write(DECODE_BENCH *b, const uchar *packet, size_t length)
+{
+  b->packets++;
+  return ma_net_write(&b->mysql->net, packet, length) != 0;
+}
+
+static my_bool bench_flush(DECODE_BENCH *b)
+{
+  my_bool rc= ma_net_flush(&b->mysql->net) != 0;
+  b->stream.capture= 0;
+  bench_rewind(b);
+  return rc;
+}
+
+static uchar *store_string(uchar *p, const char *str, size_t length)
+{
+  p= mysql_net_store_length(p, length);
+  memcpy(p, str, length);
+  return p + length;
+}
+
+static my_bool write_eof(DECODE_BENCH *b)
+{
+  uchar eof[5]= {254, 0, 0, 0, 0};
+  int2store(eof + 3, SERVER_STATUS_AUTOCOMMIT);
+  return bench_write(b, eof, sizeof(eof));
+}
+
+/* {{{ text protocol rows: int, bigint, double, 2 x varchar, datetime,
+       decimal, tinyint, NULL and a longer text column */
+static my_bool write_text_rows(DECODE_BENCH *b)
+{
+  uchar packet[1024];
+  unsigned int i;
+
+  b->stream.capture= 1;
+  for (i= 0; i < ROWS; i++)
+  {
+    char val[512];
+    uchar *p= packet;
+    int len;
+
+    len= snprintf(val, sizeof(val), "%u", i * 7919);
+    p= store_string(p, val, len);
+    len= snprintf(val, sizeof(val), "%llu", 1000000000000ULL + i * 104729ULL);
+    p= store_string(p, val, len);
+    len= snprintf(val, sizeof(val), "%.6f", i * 3.14159);
+    p= store_string(p, val, len);
+    len= snprintf(val, sizeof(val), "name_%u", i);
+    p= store_string(p, val, len);
+    len= snprintf(val, sizeof(val), "user%u@example.com", i);
+    p= store_string(p, val, len);
+    len= snprintf(val, sizeof(val), "2024-%02u-%02u %02u:%02u:%02u",
+                  i % 12 + 1, i % 28 + 1, i % 24, i % 60, (i * 7) % 60);
+    p= store_string(p, val, len);
+    len= snprintf(val, sizeof(val), "%u.%02u", i * 13, i % 100);
+    p= store_string(p, val, len);
+    p= store_string(p, (i & 1) ? "1" : "0", 1);
+    *p++= 251;  /* NULL */
+    memset(val, 'a' + i % 26, 200);
+    p= store_string(p, val, 200);
+    if (bench_write(b, packet, p - packet))
+      return 1;
+  }
+  if (write_eof(b))
+    return 1;
+  return bench_flush(b);
+}
+/* }}} */
+
+static int prepare_net_read(DECODE_BENCH *b, my_bool compress)
+{
+  if (bench_connect(b, compress))
+    return 1;
+  return write_text_rows(b);
+}
+
+static int prepare_net_read_raw(DECODE_BENCH *b)
+{
+  return prepare_net_read(b, 0);
+}
+
+static int prepare_net_read_zlib(DECODE_BENCH *b)
+{
+  return prepare_net_read(b, 1);
+}
+
+static int run_net_read(DECODE_BENCH *b)
+{
+  unsigned long long i;
+
+  bench_rewind(b);
+  for (i= 0; i < b->packets; i++)
+  {
+    ulong len= ma_net_read(&b->mysql->net);
+    if (len == packet_error)
+      return 1;
+    b->bytes+= len;
+  }
+  b->ops+= b->packets;
+  return 0;
+}
+
+static int prepare_rows(DECODE_BENCH *b)
+{
+  if (bench_connect(b, 0))
+    return 1;
+  return write_text_rows(b);
+}
+
+static int run_read_rows(DECODE_BENCH *b)
+{
+  MYSQL_DATA *data;
+
+  bench_rewind(b);
+  if (!(data= mthd_my_read_rows(b->mysql, NULL, COLUMNS)))
+    return 1;
+  b->ops+= data->rows;
+  b->bytes+= b->stream.length;
+  free_rows(data);
+  return 0;
+}
+
+static int run_read_one_row(DECODE_BENCH *b)
+{
+  char *row[COLUMNS + 1];
+  ulong lengths[COLUMNS];
+  int rc;
+
+  bench_rewind(b);
+  while (!(rc= mthd_my_read_one_row(b->mysql, COLUMNS, row, lengths)))
+    b->ops++;
+  if (rc < 0)
+    return 1;
+  b->bytes+= b->stream.length;
+  return 0;
+}
+
+/* {{{ column definitions */
+static int prepare_fields(DECODE_BENCH *b)
+{
+  static const enum enum_field_types types[]= {
+    MYSQL_TYPE_LONG, MYSQL_TYPE_LONGLONG, MYSQL_TYPE_DOUBLE,
+    MYSQL_TYPE_VAR_STRING, MYSQL_TYPE_DATETIME, MYSQL_TYPE_NEWDECIMAL};
+  uchar packet[512];
+  unsigned int i;
+
+  if (bench_connect(b, 0))
+    return 1;
+  b->stream.capture= 1;
+  for (i= 0; i < FIELD_DEFS; i++)
+  {
+    char name[32];
+    uchar *p= packet;
+    int len= snprintf(name, sizeof(name), "column_%u", i);
+    enum enum_field_types type= types[i % (sizeof(types) / sizeof(types[0]))];
+
+    p= store_string(p, "def", 3);
+    p= store_string(p, "benchmark", 9);
+    p= store_string(p, "t", 1);
+    p= store_string(p, "decode_table", 12);
+    p= store_string(p, name, len);
+    p= store_string(p, name, len);
+    *p++= 0x0c;
+    int2store(p, type == MYSQL_TYPE_VAR_STRING ? 45 : 63);
+    int4store(p + 2, type == MYSQL_TYPE_VAR_STRING ? 1020 : 20);
+    p[6]= (uchar)type;
+    int2store(p + 7, NOT_NULL_FLAG);
+    p[9]= type == MYSQL_TYPE_NEWDECIMAL ? 2 : 0;
+    p[10]= p[11]= 0;
+    p+= 12;
+    if (bench_write(b, packet, p - packet))
+      return 1;
+  }
+  if (write_eof(b))
+    return 1;
+  return bench_flush(b);
+}
+
+static int run_unpack_fields(DECODE_BENCH *b)
+{
+  MYSQL_DATA *data;
+  MA_MEM_ROOT alloc;
+  int rc= 0;
+
+  bench_rewind(b);
+  if (!(data= mthd_my_read_rows(b->mysql, NULL, ma_result_set_rows(b->mysql))))
+    return 1;
+  ma_init_alloc_root(&alloc, 8192, 0);
+  if (!unpack_fields(b->mysql, data, &alloc, FIELD_DEFS, 0))
+    rc= 1;
+  ma_free_root(&alloc, MYF(0));
+  b->ops+= FIELD_DEFS;
+  b->bytes+= b->stream.length;
+  return rc;
+}
+/* }}} */
+
+/* {{{ binary protocol rows: int, bigint, double, varchar, datetime,
+       decimal. Every 10th varchar is NULL */
+static int prepare_fetch_to_bind(DECODE_BENCH *b)
+{
+  static const enum enum_field_types types[BIN_COLUMNS]= {
+    MYSQL_TYPE_LONG, MYSQL_TYPE_LONGLONG, MYSQL_TYPE_DOUBLE,
+    MYSQL_TYPE_VAR_STRING, MYSQL_TYPE_DATETIME, MYSQL_TYPE_NEWDECIMAL};
+  static int32 v_int;
+  static longlong v_bigint;
+  static double v_double;
+  static char v_string[64], v_decimal[32];
+  static MYSQL_TIME v_time;
+  unsigned int i;
+  uchar *p;
+
+  if (bench_connect(b, 0))
+    return 1;
+
+  if (!(b->data= (uchar *)malloc(ROWS * 128)))
+    return 1;
+  p= b->data;
+  for (i= 0; i < ROWS; i++)
+  {
+    char val[64];
+    int len;
+
+    b->offsets[i]= p - b->data;
+    *p++= 0;  /* status */
+    memset(p, 0, (BIN_COLUMNS + 9) / 8);
+    if (i % 10 == 0)
+      p[(3 + 2) / 8]|= 1 << ((3 + 2) % 8);
+    p+= (BIN_COLUMNS + 9) / 8;
+    int4store(p, i * 7919);
+    p+= 4;
+    int8store(p, 1000000000000ULL + i * 104729ULL);
+    p+= 8;
+    v_double= i * 3.14159;
+    float8store(p, v_double);
+    p+= 8;
+    if (i % 10)
+    {
+      len= snprintf(val, sizeof(val), "user%u@example.com", i);
+      p= store_string(p, val, len);
+    }
+    *p++= 7;
+    int2store(p, 2024);
+    p[2]= i % 12 + 1;
+    p[3]= i % 28 + 1;
+    p[4]= i % 24;
+    p[5]= i % 60;
+    p[6]= (i * 7) % 60;
+    p+= 7;
+    len= snprintf(val, sizeof(val), "%u.%02u", i * 13, i % 100);
+    p= store_string(p, val, len);
+  }
+  b->data_length= p - b->data;
+
+  memset(b->fields, 0, sizeof(b->fields));
+  memset(b->bind, 0, sizeof(b->bind));
+  for (i= 0; i < BIN_COLUMNS; i++)
+  {
+    b->fields[i].type= types[i];
+    b->fields[i].charsetnr= 63;
+    b->fields[i].decimals= types[i] == MYSQL_TYPE_NEWDECIMAL ? 2 : 0;
+    b->bind[i].buffer_type= types[i];
+  }
+  b->fields[3].charsetnr= 45;
+  b->bind[0].buffer= &v_int;
+  b->bind[1].buffer= &v_bigint;
+  b->bind[2].buffer= &v_double;
+  b->bind[3].buffer= v_string;
+  b->bind[3].buffer_length= sizeof(v_string);
+  b->bind[4].buffer= &v_time;
+  b->bind[5].buffer_type= MYSQL_TYPE_STRING;
+  b->bind[5].buffer= v_decimal;
+  b->bind[5].buffer_length= sizeof(v_decimal);
+
+  if (!(b->stmt= mysql_stmt_init(b->mysql)))
+    return 1;
+  b->stmt->state= MYSQL_STMT_PREPARED;
+  b->stmt->field_count= BIN_COLUMNS;
+  b->stmt->fields= b->fields;
+  return mysql_stmt_bind_result(b->stmt, b->bind);
+}
+
+static int run_fetch_to_bind(DECODE_BENCH *b)
+{
+  unsigned int i;
+
+  for (i= 0; i < ROWS; i++)
+    if (mthd_stmt_fetch_to_bind(b->stmt, b->data + b->offsets[i]))
+      return 1;
+  b->ops+= ROWS;
+  b->bytes+= b->data_length;
+  return 0;
+}
+/* }}} */
+
+/* {{{ ps_fetch_* converters, VALUES values of one field type converted
+       to one buffer type */
+static int prepare_codec(DECODE_BENCH *b, enum enum_field_types field_type,
+                         enum enum_field_types buffer_type)
+{
+  unsigned int i;
+  uchar *p;
+
+  memset(&b->field, 0, sizeof(MYSQL_FIELD));
+  memset(&b->value_bind, 0, sizeof(MYSQL_BIND));
+  b->field.type= field_type;
+  b->field.charsetnr= 63;
+  b->field.length= 20;
+  b->field.decimals= field_type == MYSQL_TYPE_DOUBLE ? NOT_FIXED_DEC : 0;
+  b->value_bind.buffer_type= buffer_type;
+  b->value_bind.length= &b->value_bind.length_value;
+  b->value_bind.is_null= &b->value_bind.is_null_value;
+  b->value_bind.error= &b->value_bind.error_value;
+  if (buffer_type == MYSQL_TYPE_DATETIME)
+    b->value_bind.buffer= &b->value_time;
+  else
+    b->value_bind.buffer= b->value_buffer;
+  b->value_bind.buffer_length= sizeof(b->value_buffer);
+
+  if (!(b->data= (uchar *)malloc(VALUES * 32)))
+    return 1;
+  p= b->data;
+  for (i= 0; i < VALUES; i++)
+  {
+    char val[32];
+    int len;
+
+    switch (field_type) {
+    case MYSQL_TYPE_LONG:
+      int4store(p, i * 7919);
+      p+= 4;
+      break;
+    case MYSQL_TYPE_LONGLONG:
+      int8store(p, 1000000000000ULL + i * 104729ULL);
+      p+= 8;
+      break;
+    case MYSQL_TYPE_DOUBLE:
+    {
+      double d= i * 3.14159;
+      float8store(p, d);
+      p+= 8;
+      break;
+    }
+    case MYSQL_TYPE_DATETIME:
+      *p++= 7;
+      int2store(p, 2024);
+      p[2]= i % 12 + 1;
+      p[3]= i % 28 + 1;
+      p[4]= i % 24;
+      p[5]= i % 60;
+      p[6]= (i * 7) % 60;
+      p+= 7;
+      break;
+    case MYSQL_TYPE_NEWDECIMAL:
+      len= snprintf(val, sizeof(val), "%u.%02u", i * 13, i % 100);
+      p= store_string(p, val, len);
+      break;
+    default:
+      len= snprintf(val, sizeof(val), "%u", i * 7919);
+      p= store_string(p, val, len);
+      break;
+    }
+  }
+  b->data_length= p - b->data;
+  return 0;
+}
+
+static int run_codec(DECODE_BENCH *b)
+{
+  ps_field_fetch_func fetch= mysql_ps_fetch_functions[b->field.type].func;
+  uchar *row= b->data;
+  unsigned int i;
+
+  for (i= 0; i < VALUES; i++)
+    fetch(&b->value_bind, &b->field, &row);
+  if (row != b->data + b->data_length)
+    return 1;
+  b->ops+= VALUES;
+  b->bytes+= b->data_length;
+  return 0;
+}
+
+#define CODEC_PREPARE(name, field_type, buffer_type) \
+static int prepare_##name(DECODE_BENCH *b) \
+{ \
+  return prepare_codec(b, field_type, buffer_type); \
+}
+
+CODEC_PREPARE(int32, MYSQL_TYPE_LONG, MYSQL_TYPE_LONG)
+CODEC_PREPARE(int64, MYSQL_TYPE_LONGLONG, MYSQL_TYPE_LONGLONG)
+CODEC_PREPARE(double, MYSQL_TYPE_DOUBLE, MYSQL_TYPE_DOUBLE)
+CODEC_PREPARE(int32_to_string, MYSQL_TYPE_LONG, MYSQL_TYPE_STRING)
+CODEC_PREPARE(double_to_string, MYSQL_TYPE_DOUBLE, MYSQL_TYPE_STRING)
+CODEC_PREPARE(string, MYSQL_TYPE_VAR_STRING, MYSQL_TYPE_STRING)
+CODEC_PREPARE(string_to_long, MYSQL_TYPE_VAR_STRING, MYSQL_TYPE_LONG)
+CODEC_PREPARE(datetime, MYSQL_TYPE_DATETIME, MYSQL_TYPE_DATETIME)
+CODEC_PREPARE(datetime_to_string, MYSQL_TYPE_DATETIME, MYSQL_TYPE_STRING)
+CODEC_PREPARE(decimal_to_double, MYSQL_TYPE_NEWDECIMAL, MYSQL_TYPE_DOUBLE)
+/* }}} */
+
+/* {{{ double to string, VALUES doubles over a wide range of exponents */
+static int prepare_dtoa(DECODE_BENCH *b)
+{
+  double *val;
+  unsigned int i;
+
+  if (!(b->data= (uchar *)malloc(VALUES * sizeof(double))))
+    return 1;
+  val= (double *)b->data;
+  for (i= 0; i < VALUES; i++)
+  {
+    val[i]= (i + 1) * 3.14159e-7 * (double)(1ULL << (i % 48));
+    if (i % 3 == 0)
+      val[i]= -val[i];
+  }
+  b->data_length= VALUES * sizeof(double);
+  return 0;
+}
+
+/* shortest round trip representation: digits are generated by Grisu */
+static int run_dtoa_gcvt(DECODE_BENCH *b)
+{
+  double *val= (double *)b->data;
+  unsigned int i;
+
+  for (i= 0; i < VALUES; i++)
+    b->bytes+= ma_gcvt(val[i], MY_GCVT_ARG_DOUBLE, 39, b->value_buffer, NULL);
+  b->ops+= VALUES;
+  return 0;
+}
+
+/* fixed number of decimals, the shortest representation fits: Grisu */
+static int run_dtoa_fcvt(DECODE_BENCH *b)
+{
+  double *val= (double *)b->data;
+  unsigned int i;
+
+  for (i= 0; i < VALUES; i++)
+    b->bytes+= ma_fcvt(val[i], 30, b->value_buffer, NULL);
+  b->ops+= VALUES;
+  return 0;
+}
+
+/* values have to be rounded, digits are generated by dtoa() */
+static int run_dtoa_fcvt_round(DECODE_BENCH *b)
+{
+  double *val= (double *)b->data;
+  unsigned int i;
+
+  for (i= 0; i < VALUES; i++)
+    b->bytes+= ma_fcvt(val[i], 4, b->value_buffer, NULL);
+  b->ops+= VALUES;
+  return 0;
+}
+
+/* C library as a reference, %.17g round trips like ma_gcvt() */
+static int run_dtoa_snprintf(DECODE_BENCH *b)
+{
+  double *val= (double *)b->data;
+  unsigned int i;
+
+  for (i= 0; i < VALUES; i++)
+    b->bytes+= snprintf(b->value_buffer, sizeof(b->value_buffer), "%.17g",
+                        val[i]);
+  b->ops+= VALUES;
+  return 0;
+}
+/* }}} */
+
+/* {{{ binlog checksums */
+static int prepare_binlog(DECODE_BENCH *b, enum enum_ma_simd_level level)
+{
+  size_t pos= 0, i, j, length;
+
+  if (ma_simd_set_level(level))
+    return 1;
+  b->simd_level= level;
+  /* row events between 64 bytes and 8K */
+  if (!(b->data= (uchar *)malloc(BINLOG_EVENTS * 8192)))
+    return 1;
+  for (i= 0; i < BINLOG_EVENTS; i++)
+  {
+    length= 64 + (i * 7919) % (8192 - 64);
+    for (j= 0; j < length - 4; j++)
+      b->data[pos + j]= (uchar)(i + j * 31);
+    int4store(b->data + pos + length - 4,
+              ma_simd_crc32(0, b->data + pos, length - 4));
+    pos+= length;
+    b->event_ends[i]= pos;
+  }
+  b->data_length= pos;
+  ma_simd_set_level(ma_simd_detect());
+  return 0;
+}
+
+static int prepare_binlog_crc32_scalar(DECODE_BENCH *b)
+{
+  return prepare_binlog(b, MA_SIMD_SCALAR);
+}
+
+static int prepare_binlog_crc32(DECODE_BENCH *b)
+{
+  return prepare_binlog(b, ma_simd_detect());
+}
+
+/* same check as rpl_verify_checksum() for every event */
+static int run_binlog_crc32(DECODE_BENCH *b)
+{
+  size_t start= 0, i;
+  int rc= 0;
+
+  ma_simd_set_level(b->simd_level);
+  for (i= 0; i < BINLOG_EVENTS && !rc; i++)
+  {
+    const uchar *end= b->data + b->event_ends[i];
+
+    if (uint4korr(end - 4) != ma_simd_crc32(0, b->data + start,
+                                            b->event_ends[i] - start - 4))
+      rc= 1;
+    start= b->event_ends[i];
+  }
+  ma_simd_set_level(ma_simd_detect());
+  b->ops+= BINLOG_EVENTS;
+  b->bytes+= b->data_length;
+  return rc;
+}
+/* }}} */
+
+/* {{{ dynamic columns to JSON */
+static int prepare_dyncol(DECODE_BENCH *b, enum enum_ma_simd_level level)
+{
+  DYNAMIC_COLUMN_VALUE vals[DYNCOL_ATTRS];
+  MYSQL_LEX_STRING names[DYNCOL_ATTRS];
+  char name_buf[DYNCOL_ATTRS][8], str_buf[DYNCOL_ATTRS][128];
+  MARIADB_CHARSET_INFO *cs= mariadb_get_charset_by_name("utf8mb4");
+  size_t pos= 0, size= 0;
+  uint i, j;
+
+  if (!cs || ma_simd_set_level(level))
+    return 1;
+  b->simd_level= level;
+  ma_simd_set_level(ma_simd_detect());
+  for (i= 0; i < ROWS; i++)
+  {
+    DYNAMIC_COLUMN col;
+
+    /* attributes of a typical REST object: numbers, short and long text */
+    for (j= 0; j < DYNCOL_ATTRS; j++)
+    {
+      names[j].str= name_buf[j];
+      names[j].length= snprintf(name_buf[j], sizeof(name_buf[j]), "attr%02u", j);
+      switch (j % 4) {
+      case 0:
+        vals[j].type= DYN_COL_INT;
+        vals[j].x.long_value= (longlong)i * 7919 - j * 100003;
+        break;
+      case 1:
+        vals[j].type= DYN_COL_DOUBLE;
+        vals[j].x.double_value= i / 7.0 + j;
+        break;
+      case 2:
+        vals[j].type= DYN_COL_STRING;
+        vals[j].x.string.value.str= str_buf[j];
+        vals[j].x.string.value.length=
+          snprintf(str_buf[j], sizeof(str_buf[j]), "value %u", i + j);
+        vals[j].x.string.charset= cs;
+        break;
+      default:
+        vals[j].type= DYN_COL_STRING;
+        vals[j].x.string.value.str= str_buf[j];
+        vals[j].x.string.value.length=
+          snprintf(str_buf[j], sizeof(str_buf[j]),
+                   "Lorem ipsum dolor sit amet, consectetur adipiscing elit, "
+                   "sed do eiusmod tempor \"incididunt\" %u", i * j);
+        vals[j].x.string.charset= cs;
+        break;
+      }
+    }
+    mariadb_dyncol_init(&col);
+    if (mariadb_dyncol_create_many_named(&col, DYNCOL_ATTRS, names, vals, 0) < 0)
+      return 1;
+    if (pos + col.length > size)
+    {
+      uchar *data;
+      size= (pos + col.length) * 2;
+      if (!(data= (uchar *)realloc(b->data, size)))
+      {
+        mariadb_dyncol_free(&col);
+        return 1;
+      }
+      b->data= data;
+    }
+    memcpy(b->data + pos, col.str, col.length);
+    b->offsets[i]= pos;
+    pos+= col.length;
+    mariadb_dyncol_free(&col);
+  }
+  b->data_length= pos;
+  return 0;
+}
+
+static int prepare_dyncol_json_scalar(DECODE_BENCH *b)
+{
+  return prepare_dyncol(b, MA_SIMD_SCALAR);
+}
+
+static int prepare_dyncol_json(DECODE_BENCH *b)
+{
+  return prepare_dyncol(b, ma_simd_detect());
+}
+
+static void dyncol_record(DECODE_BENCH *b, size_t i, DYNAMIC_COLUMN *col)
+{
+  size_t end= i + 1 < ROWS ? b->offsets[i + 1] : b->data_length;
+
+  mariadb_dyncol_init(col);
+  col->str= (char *)b->data + b->offsets[i];
+  col->length= end - b->offsets[i];
+}
+
+/* mariadb_dyncol_json() with a new string for every record */
+static int run_dyncol_json(DECODE_BENCH *b)
+{
+  DYNAMIC_COLUMN col;
+  DYNAMIC_STRING json;
+  size_t i;
+
+  for (i= 0; i < ROWS; i++)
+  {
+    dyncol_record(b, i, &col);
+    if (mariadb_dyncol_json(&col, &json) < 0)
+      return 1;
+    mariadb_dyncol_free(&json);
+  }
+  b->ops+= ROWS;
+  b->bytes+= b->data_length;
+  return 0;
+}
+
+/* mariadb_dyncol_json_write() into one reused buffer */
+static int run_dyncol_json_write(DECODE_BENCH *b)
+{
+  DYNAMIC_COLUMN col;
+  size_t i;
+  int rc= 0;
+
+  ma_simd_set_level(b->simd_level);
+  for (i= 0; i < ROWS && !rc; i++)
+  {
+    dyncol_record(b, i, &col);
+    b->json_sink.length= 0;
+    if (mariadb_dyncol_json_write(&col, &b->json_sink) < 0)
+      rc= 1;
+  }
+  ma_simd_set_level(ma_simd_detect());
+  b->ops+= ROWS;
+  b->bytes+= b->data_length;
+  return rc;
+}
+/* }}} */
+
+/* {{{ dynamic column updates */
+/* numeric record with integers in the even and text in the odd columns */
+static my_bool dyncol_update_record(DYNAMIC_COLUMN *col, uint columns)
+{
+  DYNAMIC_COLUMN_VALUE *vals;
+  uint *nums, i;
+  MARIADB_CHARSET_INFO *cs= mariadb_get_charset_by_name("utf8mb4");
+  my_bool rc;
+
+  vals= (DYNAMIC_COLUMN_VALUE *)malloc(sizeof(DYNAMIC_COLUMN_VALUE) * columns);
+  nums= (uint *)malloc(sizeof(uint) * columns);
+  if (!cs || !vals || !nums)
+  {
+    free(vals);
+    free(nums);
+    return 1;
+  }
+  for (i= 0; i < columns; i++)
+  {
+    nums[i]= i + 1;
+    if (nums[i] % 2 == 0)
+    {
+      vals[i].type= DYN_COL_INT;
+      vals[i].x.long_value= (longlong)nums[i] * 1000;
+    }
+    else
+    {
+      vals[i].type= DYN_COL_STRING;
+      vals[i].x.string.value.str=
+        (char *)"a text attribute of thirty-two b";
+      vals[i].x.string.value.length= 32;
+      vals[i].x.string.charset= cs;
+    }
+  }
+  mariadb_dyncol_init(col);
+  rc= mariadb_dyncol_create_many_num(col, columns, nums, vals, 0) < 0;
+  free(vals);
+  free(nums);
+  return rc;
+}
+
+/* changes the integer columns to values of the same length */
+static void dyncol_update_values(DYNAMIC_COLUMN_VALUE *vals, uint *keys,
+                                 uint count, uint seq)
+{
+  uint i;
+  for (i= 0; i < count; i++)
+  {
+    vals[i].type= DYN_COL_INT;
+    vals[i].x.long_value= (longlong)keys[i] * 1000 + (seq & 63);
+  }
+}
+
+static int prepare_dyncol_update(DECODE_BENCH *b, uint columns, uint updates)
+{
+  uint i;
+
+  if (dyncol_update_record(&b->dyncol, columns) ||
+      !(b->dyncol_values= (DYNAMIC_COLUMN_VALUE *)
+        malloc(sizeof(DYNAMIC_COLUMN_VALUE) * updates)))
+    return 1;
+  /* integer columns spread over the record */
+  for (i= 0; i < updates; i++)
+    b->dyncol_keys[i]= 2 + 2 * (i * (columns / 2) / updates);
+  b->dyncol_key_count= updates;
+  b->dyncol_columns= columns;
+  return 0;
+}
+
+#define DYNCOL_UPDATE_PREPARE(name, columns, updates) \
+static int prepare_##name(DECODE_BENCH *b) \
+{ \
+  return prepare_dyncol_update(b, columns, updates); \
+}
+DYNCOL_UPDATE_PREPARE(dyncol_update_1_small, DYNCOL_SMALL, 1)
+DYNCOL_UPDATE_PREPARE(dyncol_update_10_small, DYNCOL_SMALL, 10)
+DYNCOL_UPDATE_PREPARE(dyncol_update_100_small, DYNCOL_SMALL, 100)
+DYNCOL_UPDATE_PREPARE(dyncol_update_1_large, DYNCOL_LARGE, 1)
+DYNCOL_UPDATE_PREPARE(dyncol_update_10_large, DYNCOL_LARGE, 10)
+DYNCOL_UPDATE_PREPARE(dyncol_update_100_large, DYNCOL_LARGE, 100)
+
+/* mariadb_dyncol_update_many_num() of the same record */
+static int run_dyncol_update(DECODE_BENCH *b)
+{
+  uint i;
+
+  for (i= 0; i < DYNCOL_UPDATES; i++)
+  {
+    dyncol_update_values(b->dyncol_values, b->dyncol_keys,
+                         b->dyncol_key_count, i);
+    if (mariadb_dyncol_update_many_num(&b->dyncol, b->dyncol_key_count,
+                                       b->dyncol_keys, b->dyncol_values) < 0)
+      return 1;
+  }
+  b->ops+= DYNCOL_UPDATES;
+  b->bytes+= (unsigned long long)DYNCOL_UPDATES * b->dyncol.length;
+  return 0;
+}
+
+static int prepare_dyncol_append(DECODE_BENCH *b)
+{
+  DYNAMIC_COLUMN col;
+
+  if (dyncol_update_record(&col, DYNCOL_SMALL))
+    return 1;
+  /* the record every pass starts with */
+  b->data= (uchar *)col.str;
+  b->data_length= col.length;
+  b->dyncol_columns= DYNCOL_SMALL;
+  return !(b->dyncol_values= (DYNAMIC_COLUMN_VALUE *)
+           malloc(sizeof(DYNAMIC_COLUMN_VALUE)));
+}
+
+/* adds DYNCOL_APPENDS columns one by one after the last column */
+static int run_dyncol_append(DECODE_BENCH *b)
+{
+  uint i, key;
+
+  mariadb_dyncol_free(&b->dyncol);
+  mariadb_dyncol_init(&b->dyncol);
+  if (!(b->dyncol.str= (char *)malloc(b->data_length)))
+    return 1;
+  memcpy(b->dyncol.str, b->data, b->data_length);
+  b->dyncol.length= b->dyncol.max_length= b->data_length;
+  for (i= 0; i < DYNCOL_APPENDS; i++)
+  {
+    key= b->dyncol_columns + 1 + i;
+    dyncol_update_values(b->dyncol_values, &key, 1, i);
+    if (mariadb_dyncol_update_many_num(&b->dyncol, 1, &key,
+                                       b->dyncol_values) < 0)
+      return 1;
+  }
+  b->ops+= DYNCOL_APPENDS;
+  b->bytes+= b->dyncol.length;
+  return 0;
+}
+
+static int prepare_dyncol_update_rows(DECODE_BENCH *b)
+{
+  size_t i;
+
+  if (!(b->dyncol_rows= (DYNAMIC_COLUMN *)
+        calloc(ROWS, sizeof(DYNAMIC_COLUMN))) ||
+      !(b->dyncol_values= (DYNAMIC_COLUMN_VALUE *)
+        malloc(sizeof(DYNAMIC_COLUMN_VALUE) * ROWS * DYNCOL_ROW_UPDATES)))
+    return 1;
+  for (i= 0; i < ROWS; i++)
+  {
+    if (dyncol_update_record(b->dyncol_rows + i, DYNCOL_ATTRS))
+      return 1;
+    b->data_length+= b->dyncol_rows[i].length;
+  }
+  for (i= 0; i < DYNCOL_ROW_UPDATES; i++)
+    b->dyncol_keys[i]= 2 + 2 * (uint)i;
+  b->dyncol_key_count= DYNCOL_ROW_UPDATES;
+  return 0;
+}
+
+/* mariadb_dyncol_update_many_num() for every row */
+static int run_dyncol_update_rows_single(DECODE_BENCH *b)
+{
+  size_t i;
+
+  for (i= 0; i < ROWS; i++)
+  {
+    dyncol_update_values(b->dyncol_values, b->dyncol_keys,
+                         b->dyncol_key_count, (uint)(i + b->ops));
+    if (mariadb_dyncol_update_many_num(b->dyncol_rows + i,
+                                       b->dyncol_key_count,
+                                       b->dyncol_keys, b->dyncol_values) < 0)
+      return 1;
+  }
+  b->ops+= ROWS;
+  b->bytes+= b->data_length;
+  return 0;
+}
+
+/* all rows with one mariadb_dyncol_update_rows_num() */
+static int run_dyncol_update_rows(DECODE_BENCH *b)
+{
+  size_t i;
+
+  for (i= 0; i < ROWS; i++)
+    dyncol_update_values(b->dyncol_values + i * b->dyncol_key_count,
+                         b->dyncol_keys, b->dyncol_key_count,
+                         (uint)(i + b->ops));
+  if (mariadb_dyncol_update_rows_num(&b->dyncol_update, b->dyncol_rows, ROWS,
+                                     b->dyncol_key_count, b->dyncol_keys,
+                                     b->dyncol_values) < 0)
+    return 1;
+  b->ops+= ROWS;
+  b->bytes+= b->data_length;
+  return 0;
+}
+/* }}} */
+
+struct st_decode_test {
+  const char *name;
+  const char *unit;
+  int (*prepare)(DECODE_BENCH *b);
+  int (*run)(DECODE_BENCH *b);
+};
+
+static struct st_decode_test decode_tests[]= {
+  {"net_read", "packet", prepare_net_read_raw, run_net_read},
+  {"net_read_zlib", "packet", prepare_net_read_zlib, run_net_read},
+  {"read_rows", "row", prepare_rows, run_read_rows},
+  {"read_one_row", "row", prepare_rows, run_read_one_row},
+  {"unpack_fields", "field", prepare_fields, run_unpack_fields},
+  {"stmt_fetch_to_bind", "row", prepare_fetch_to_bind, run_fetch_to_bind},
+  {"ps_fetch_int32", "value", prepare_int32, run_codec},
+  {"ps_fetch_int64", "value", prepare_int64, run_codec},
+  {"ps_fetch_double", "value", prepare_double, run_codec},
+  {"ps_fetch_int32_to_string", "value", prepare_int32_to_string, run_codec},
+  {"ps_fetch_double_to_string", "value", prepare_double_to_string, run_codec},
+  {"ps_fetch_string", "value", prepare_string, run_codec},
+  {"ps_fetch_string_to_long", "value", prepare_string_to_long, run_codec},
+  {"ps_fetch_datetime", "value", prepare_datetime, run_codec},
+  {"ps_fetch_datetime_to_string", "value", prepare_datetime_to_string, run_codec},
+  {"ps_fetch_decimal_to_double", "value", prepare_decimal_to_double, run_codec},
+  {"dtoa_gcvt", "value", prepare_dtoa, run_dtoa_gcvt},
+  {"dtoa_fcvt", "value", prepare_dtoa, run_dtoa_fcvt},
+  {"dtoa_fcvt_round", "value", prepare_dtoa, run_dtoa_fcvt_round},
+  {"dtoa_snprintf", "value", prepare_dtoa, run_dtoa_snprintf},
+  {"binlog_crc32_scalar", "event", prepare_binlog_crc32_scalar, run_binlog_crc32},
+  {"binlog_crc32", "event", prepare_binlog_crc32, run_binlog_crc32},
+  {"dyncol_json", "record", prepare_dyncol_json, run_dyncol_json},
+  {"dyncol_json_write_scalar", "record", prepare_dyncol_json_scalar, run_dyncol_json_write},
+  {"dyncol_json_write", "record", prepare_dyncol_json, run_dyncol_json_write},
+  {"dyncol_update_1_small", "update", prepare_dyncol_update_1_small, run_dyncol_update},
+  {"dyncol_update_10_small", "update", prepare_dyncol_update_10_small, run_dyncol_update},
+  {"dyncol_update_100_small", "update", prepare_dyncol_update_100_small, run_dyncol_update},
+  {"dyncol_update_1_large", "update", prepare_dyncol_update_1_large, run_dyncol_update},
+  {"dyncol_update_10_large", "update", prepare_dyncol_update_10_large, run_dyncol_update},
+  {"dyncol_update_100_large", "update", prepare_dyncol_update_100_large, run_dyncol_update},
+  {"dyncol_append", "column", prepare_dyncol_append, run_dyncol_append},
+  {"dyncol_update_rows_single", "row", prepare_dyncol_update_rows, run_dyncol_update_rows_single},
+  {"dyncol_update_rows", "row", prepare_dyncol_update_rows, run_dyncol_update_rows},
+  {NULL, NULL, NULL, NULL}
+};
+
+/* {{{ baseline */
+static char *read_file(const char *path)
+{
+  FILE *fp= fopen(path, "rb");
+  char *buf= NULL;
+  long size;
+
+  if (!fp)
+    return NULL;
+  if (!fseek(fp, 0, SEEK_END) && (size= ftell(fp)) >= 0 &&
+      !fseek(fp, 0, SEEK_SET) && (buf= (char *)malloc(size + 1)))
+  {
+    if (fread(buf, 1, size, fp) != (size_t)size)
+    {
+      free(buf);
+      buf= NULL;
+    }
+    else
+      buf[size]= 0;
+  }
+  fclose(fp);
+  return buf;
+}
+
+/* returns ns_per_op of a benchmark in a file written by --json, or 0 */
+static double baseline_value(const char *baseline, const char *name)
+{
+  char key[128];
+  const char *p, *end;
+
+  snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+  if (!baseline || !(p= strstr(baseline, key)))
+    return 0;
+  end= strchr(p, '}');
+  if (!(p= strstr(p, "\"ns_per_op\":")) || (end && p > end))
+    return 0;
+  return strtod(p + strlen("\"ns_per_op\":"), NULL);
+}
+/* }}} */
+
+static void usage(const char *progname)
+{
+  fprintf(stderr, "usage: %s [--filter substring] [--time seconds] [--json file]\n"
+                  "       [--baseline file] [--tolerance percent]\n", progname);
+}
+
+int main(int argc, char **argv)
+{
+  const char *filter= NULL, *json_file= NULL, *baseline_file= NULL;
+  char *baseline= NULL;
+  double min_time= 0.5, tolerance= 10.0;
+  FILE *json= NULL;
+  int i, regressions= 0, errors= 0, count= 0;
+
+  for (i= 1; i < argc; i++)
+  {
+    if (i + 1 < argc && !strcmp(argv[i], "--filter"))
+      filter= argv[++i];
+    else if (i + 1 < argc && !strcmp(argv[i], "--time"))
+      min_time= atof(argv[++i]);
+    else if (i + 1 < argc && !strcmp(argv[i], "--json"))
+      json_file= argv[++i];
+    else if (i + 1 < argc && !strcmp(argv[i], "--baseline"))
+      baseline_file= argv[++i];
+    else if (i + 1 < argc && !strcmp(argv[i], "--tolerance"))
+      tolerance= atof(argv[++i]);
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (baseline_file && !(baseline= read_file(baseline_file)))
+  {
+    fprintf(stderr, "Can't read baseline %s\n", baseline_file);
+    return 1;
+  }
+  if (json_file)
+  {
+    if (!(json= fopen(json_file, "w")))
+    {
+      fprintf(stderr, "Can't create %s\n", json_file);
+      free(baseline);
+      return 1;
+    }
+    fprintf(json, "{\n  \"benchmarks\": [");
+  }
+
+  mysql_library_init(0, NULL, NULL);
+
+  printf("%-30s %12s %8s %14s %12s\n", "benchmark", "ns/op", "unit",
+         "bytes/s", "baseline");
+  for (i= 0; decode_tests[i].name; i++)
+  {
+    struct st_decode_test *test= &decode_tests[i];
+    DECODE_BENCH b;
+    unsigned long long start, elapsed= 0, passes= 0;
+    double ns_per_op, bytes_per_sec, base;
+    char base_str[32]= "";
+
+    if (filter && !strstr(test->name, filter))
+      continue;
+
+    memset(&b, 0, sizeof(b));
+    if (test->prepare(&b) || test->run(&b))
+    {
+      printf("%-30s failed\n", test->name);
+      bench_disconnect(&b);
+      errors++;
+      continue;
+    }
+
+    /* the first pass above was a warmup */
+    b.ops= b.bytes= 0;
+    start= bench_time();
+    do {
+      if (test->run(&b))
+        break;
+      passes++;
+      elapsed= bench_time() - start;
+    } while (elapsed < min_time * 1e9);
+    bench_disconnect(&b);
+
+    if (!passes || !b.ops)
+    {
+      printf("%-30s failed\n", test->name);
+      errors++;
+      continue;
+    }
+
+    ns_per_op= (double)elapsed / b.ops;
+    bytes_per_sec= b.bytes * 1e9 / elapsed;
+    if ((base= baseline_value(baseline, test->name)) > 0)
+    {
+      double change= (ns_per_op - base) * 100.0 / base;
+      snprintf(base_str, sizeof(base_str), "%+.1f%%%s", change,
+               change > tolerance ? " REGRESSION" : "");
+      if (change > tolerance)
+        regressions++;
+    }
+    printf("%-30s %12.1f %8s %14.0f %12s\n", test->name, ns_per_op,
+           test->unit, bytes_per_sec, base_str);
+
+    if (json)
+      fprintf(json, "%s\n    {\"name\": \"%s\", \"unit\": \"%s\", "
+                    "\"iterations\": %llu, \"ns_per_op\": %.3f, "
+                    "\"bytes_per_sec\": %.0f}",
+              count ? "," : "", test->name, test->unit, b.ops,
+              ns_per_op, bytes_per_sec);
+    count++;
+  }
+
+  if (json)
+  {
+    fprintf(json, "\n  ]\n}\n");
+    fclose(json);
+  }
+  free(baseline);
+  mysql_library_end();
+
+  if (regressions)
+    printf("%d benchmark(s) slower than baseline by more than %.1f%%\n",
+           regressions, tolerance);
+  return (errors || regressions) ? 1 : 0;
+}
@@ -17,6 +17,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "my_test.h"
 #include "mariadb_dyncol.h"
+#include "ma_simd.h"
 
 static int create_dyncol_named(MYSQL *mysql)
 {
@@ -299,6 +300,552 @@ static int dyncol_nested(MYSQL *mysql __attribute__((unused)))
   return OK;
 }
 
+static int dyncol_double_str(MYSQL *unused __attribute__((unused)))
+{
+  double values[1010]= {0.1, 1.0 / 3, 1e23, 5e-324, 2.2250738585072014e-308,
+                        1.7976931348623157e308, 9007199254740993.0, -123.456,
+                        0.3, 100};
+  DYNAMIC_COLUMN dyncol;
+  DYNAMIC_COLUMN_VALUE val;
+  DYNAMIC_STRING s;
+  uint i, nr= 1;
+
+  srand(42);
+  for (i= 10; i < 1010; i++)
+  {
+    ulonglong bits= ((ulonglong)rand() << 40) ^ ((ulonglong)rand() << 20) ^ rand();
+    bits&= 0x7FEFFFFFFFFFFFFFULL;
+    memcpy(&values[i], &bits, sizeof(double));
+  }
+
+  val.type= DYN_COL_DOUBLE;
+  for (i= 0; i < 1010; i++)
+  {
+    char *p;
+
+    mariadb_dyncol_init(&dyncol);
+    val.x.double_value= values[i];
+    FAIL_IF(mariadb_dyncol_create_many_num(&dyncol, 1, &nr, &val, 0) != ER_DYNCOL_OK,
+            "Error while creating dyncol");
+    FAIL_IF(mariadb_dyncol_json(&dyncol, &s) != ER_DYNCOL_OK, "Conversion failed");
+    /* {"1":"<value>"} */
+    p= strchr(s.str, ':');
+    if (!p || strtod(p + 2, NULL) != values[i])
+    {
+      diag("%.17g was converted to %s", values[i], s.str);
+      return FAIL;
+    }
+    ma_dynstr_free(&s);
+    mariadb_dyncol_free(&dyncol);
+  }
+  return OK;
+}
+
+static my_bool dyncol_value_eq(DYNAMIC_COLUMN_VALUE *a, DYNAMIC_COLUMN_VALUE *b)
+{
+  if (a->type != b->type)
+    return 0;
+  switch (a->type) {
+  case DYN_COL_NULL:
+    return 1;
+  case DYN_COL_INT:
+    return a->x.long_value == b->x.long_value;
+  case DYN_COL_DOUBLE:
+    return a->x.double_value == b->x.double_value;
+  case DYN_COL_STRING:
+    return a->x.string.value.length == b->x.string.value.length &&
+           memcmp(a->x.string.value.str, b->x.string.value.str,
+                  a->x.string.value.length) == 0;
+  default:
+    return 0;
+  }
+}
+
+static int dyncol_index(MYSQL *unused __attribute__((unused)))
+{
+  DYNAMIC_COLUMN dense, sparse, named;
+  DYNAMIC_COLUMN_INDEX index;
+  DYNAMIC_COLUMN_VALUE vals[20], val, expected, many[24];
+  MYSQL_LEX_STRING names[20], keys[24];
+  char namebuf[20][8], strbuf[20][8];
+  uint nums[20], sparse_nums[5]= {3, 700, 1500, 40000, 65000};
+  uint lookup[24];
+  uint i, k;
+  MARIADB_CHARSET_INFO *cs= mariadb_get_charset_by_name("utf8mb4");
+
+  FAIL_IF(!cs, "utf8mb4 not found");
+  for (i= 0; i < 20; i++)
+  {
+    nums[i]= i + 1;
+    names[i].str= namebuf[i];
+    names[i].length= snprintf(namebuf[i], sizeof(namebuf[i]), "col%u", i);
+    switch (i % 3) {
+    case 0:
+      vals[i].type= DYN_COL_INT;
+      vals[i].x.long_value= (longlong)i * -1000;
+      break;
+    case 1:
+      vals[i].type= DYN_COL_DOUBLE;
+      vals[i].x.double_value= i / 4.0;
+      break;
+    default:
+      vals[i].type= DYN_COL_STRING;
+      vals[i].x.string.value.str= strbuf[i];
+      vals[i].x.string.value.length= snprintf(strbuf[i], sizeof(strbuf[i]),
+                                              "val%u", i);
+      vals[i].x.string.charset= cs;
+    }
+  }
+  mariadb_dyncol_init(&dense);
+  mariadb_dyncol_init(&sparse);
+  mariadb_dyncol_init(&named);
+  FAIL_IF(mariadb_dyncol_create_many_num(&dense, 20, nums, vals, 0) < 0,
+          "Error while creating dense");
+  FAIL_IF(mariadb_dyncol_create_many_num(&sparse, 5, sparse_nums, vals, 0) < 0,
+          "Error while creating sparse");
+  FAIL_IF(mariadb_dyncol_create_many_named(&named, 20, names, vals, 0) < 0,
+          "Error while creating named");
+
+  /* existing and missing keys, numbers and names for every format */
+  for (i= 0; i < 24; i++)
+  {
+    lookup[i]= i < 5 ? sparse_nums[i] : i - 4;
+    keys[i]= i < 20 ? names[i] : names[0];
+  }
+  keys[20].str= (char *)"1";
+  keys[20].length= 1;
+  keys[21].str= (char *)"700";
+  keys[21].length= 3;
+  keys[22].str= (char *)"col";
+  keys[22].length= 3;
+  keys[23].str= (char *)"col19x";
+  keys[23].length= 6;
+
+  mariadb_dyncol_index_init(&index);
+  for (k= 0; k < 3; k++)
+  {
+    DYNAMIC_COLUMN *col= k == 0 ? &dense : (k == 1 ? &sparse : &named);
+
+    FAIL_IF(mariadb_dyncol_index_parse(&index, col) < 0, "Parse failed");
+    for (i= 0; i < 24; i++)
+    {
+      FAIL_IF(mariadb_dyncol_get_num(col, lookup[i], &expected) < 0 ||
+              mariadb_dyncol_index_get_num(&index, lookup[i], &val) < 0,
+              "Error while getting column by number");
+      FAIL_IF(!dyncol_value_eq(&val, &expected), "Wrong value (number)");
+      FAIL_IF(mariadb_dyncol_get_named(col, keys + i, &expected) < 0 ||
+              mariadb_dyncol_index_get_named(&index, keys + i, &val) < 0,
+              "Error while getting column by name");
+      FAIL_IF(!dyncol_value_eq(&val, &expected), "Wrong value (name)");
+    }
+
+    FAIL_IF(mariadb_dyncol_get_many_num(col, 24, lookup, many) < 0,
+            "Error while getting columns by number");
+    for (i= 0; i < 24; i++)
+    {
+      mariadb_dyncol_get_num(col, lookup[i], &expected);
+      FAIL_IF(!dyncol_value_eq(many + i, &expected), "Wrong value (many num)");
+    }
+    FAIL_IF(mariadb_dyncol_get_many_named(col, 24, keys, many) < 0,
+            "Error while getting columns by name");
+    for (i= 0; i < 24; i++)
+    {
+      mariadb_dyncol_get_named(col, keys + i, &expected);
+      FAIL_IF(!dyncol_value_eq(many + i, &expected), "Wrong value (many named)");
+    }
+  }
+
+  /* an empty record has no columns */
+  mariadb_dyncol_free(&dense);
+  mariadb_dyncol_init(&dense);
+  FAIL_IF(mariadb_dyncol_index_parse(&index, &dense) < 0, "Parse failed");
+  FAIL_IF(mariadb_dyncol_index_get_num(&index, 1, &val) < 0 ||
+          val.type != DYN_COL_NULL, "NULL expected");
+  FAIL_IF(mariadb_dyncol_get_many_num(&dense, 2, nums, many) < 0 ||
+          many[0].type != DYN_COL_NULL || many[1].type != DYN_COL_NULL,
+          "NULL expected");
+
+  mariadb_dyncol_index_free(&index);
+  mariadb_dyncol_free(&sparse);
+  mariadb_dyncol_free(&named);
+  return OK;
+}
+
+typedef struct {
+  char str[2048];
+  size_t length;
+} JSON_BLOCKS;
+
+/* sink which passes the text on in blocks of DYNCOL_JSON_SINK_MIN bytes */
+static my_bool json_block_flush(DYNAMIC_COLUMN_JSON_SINK *sink, size_t need)
+{
+  JSON_BLOCKS *out= (JSON_BLOCKS *)sink->data;
+
+  if (out->length + sink->length > sizeof(out->str))
+    return 1;
+  memcpy(out->str + out->length, sink->str, sink->length);
+  out->length+= sink->length;
+  sink->length= 0;
+  return need > sink->max_length;
+}
+
+static int dyncol_json_write(MYSQL *unused __attribute__((unused)))
+{
+  DYNAMIC_COLUMN inner, outer, wide;
+  DYNAMIC_COLUMN_VALUE vals[7], wide_val;
+  DYNAMIC_COLUMN_JSON_SINK sink, block_sink;
+  DYNAMIC_STRING json;
+  JSON_BLOCKS blocks;
+  MYSQL_LEX_STRING names[7]= {{(char *)"int", 3}, {(char *)"uint", 4},
+                              {(char *)"dbl", 3}, {(char *)"str", 3},
+                              {(char *)"long", 4}, {(char *)"nested", 6},
+                              {(char *)"esc\"", 4}};
+  uint nums[2]= {1, 20000};
+  char long_str[300], wide_str[100], wide_escaped[128];
+  char block_buffer[DYNCOL_JSON_SINK_MIN];
+  enum enum_ma_simd_level level, best= ma_simd_detect();
+  const char *escaped= "{\"1\":\"a\\\"b\\\\c\\nd\\u0001\xc3\xa9\",\"20000\":-42}";
+  MARIADB_CHARSET_INFO *cs= mariadb_get_charset_by_name("utf8mb4");
+  uint i;
+  int wide_len;
+
+  FAIL_IF(!cs, "utf8mb4 not found");
+  memset(vals, 0, sizeof(vals));
+  for (i= 0; i < sizeof(long_str); i++)
+    long_str[i]= 'a' + i % 26;
+  vals[0].type= DYN_COL_INT;
+  vals[0].x.long_value= -9223372036854775807LL - 1;
+  vals[1].type= DYN_COL_UINT;
+  vals[1].x.ulong_value= 18446744073709551615ULL;
+  vals[2].type= DYN_COL_DOUBLE;
+  vals[2].x.double_value= 0.1;
+  vals[3].type= DYN_COL_STRING;
+  vals[3].x.string.value.str= (char *)"J\xc3\xbcrgen";
+  vals[3].x.string.value.length= 7;
+  vals[3].x.string.charset= cs;
+  vals[4].type= DYN_COL_STRING;
+  vals[4].x.string.value.str= long_str;
+  vals[4].x.string.value.length= sizeof(long_str);
+  vals[4].x.string.charset= cs;
+
+  /* without characters to escape the text is the same as the old one */
+  mariadb_dyncol_init(&inner);
+  mariadb_dyncol_init(&outer);
+  FAIL_IF(mariadb_dyncol_create_many_named(&inner, 5, names, vals, 0) < 0,
+          "Error while creating inner");
+  vals[5].type= DYN_COL_DYNCOL;
+  vals[5].x.string.value.str= inner.str;
+  vals[5].x.string.value.length= inner.length;
+  FAIL_IF(mariadb_dyncol_create_many_named(&outer, 6, names, vals, 0) < 0,
+          "Error while creating outer");
+  FAIL_IF(mariadb_dyncol_json(&outer, &json) < 0, "Conversion failed");
+
+  memset(&sink, 0, sizeof(sink));
+  FAIL_IF(mariadb_dyncol_json_write(&outer, &sink) < 0, "Writing failed");
+  FAIL_IF(sink.length != json.length ||
+          memcmp(sink.str, json.str, json.length), "JSON text differs");
+  FAIL_IF(mariadb_dyncol_json_size_hint(&outer) < json.length,
+          "Size hint too small");
+
+  /* the same text through a small flushing buffer */
+  blocks.length= 0;
+  memset(&block_sink, 0, sizeof(block_sink));
+  block_sink.str= block_buffer;
+  block_sink.max_length= sizeof(block_buffer);
+  block_sink.flush= json_block_flush;
+  block_sink.data= &blocks;
+  FAIL_IF(mariadb_dyncol_json_write(&outer, &block_sink) < 0 ||
+          json_block_flush(&block_sink, 0), "Writing failed");
+  FAIL_IF(blocks.length != json.length ||
+          memcmp(blocks.str, json.str, json.length), "Flushed text differs");
+  ma_dynstr_free(&json);
+
+  /* escaping, numeric names and reuse of the sink */
+  vals[6].type= DYN_COL_STRING;
+  vals[6].x.string.value.str= (char *)"a\"b\\c\nd\001\xc3\xa9";
+  vals[6].x.string.value.length= 10;
+  vals[6].x.string.charset= cs;
+  vals[0].x.long_value= -42;
+  mariadb_dyncol_free(&inner);
+  mariadb_dyncol_init(&inner);
+  FAIL_IF(mariadb_dyncol_create_many_num(&inner, 1, nums, vals + 6, 0) < 0 ||
+          mariadb_dyncol_update_many_num(&inner, 1, nums + 1, vals) < 0,
+          "Error while creating record");
+
+  /*
+    A value which is long enough for the vector loops, with characters to
+    escape behind the first 16 and 32 byte blocks and in the tail
+  */
+  for (i= 0; i < sizeof(wide_str); i++)
+    wide_str[i]= 'a' + i % 26;
+  wide_str[40]= '"';
+  wide_str[57]= '\\';
+  wide_str[63]= '"';
+  wide_str[75]= '\001';
+  wide_str[97]= '\n';
+  wide_len= sprintf(wide_escaped,
+                    "{\"1\":\"%.40s\\\"%.16s\\\\%.5s\\\"%.11s\\u0001%.21s\\n%.2s\"}",
+                    wide_str, wide_str + 41, wide_str + 58, wide_str + 64,
+                    wide_str + 76, wide_str + 98);
+  wide_val.type= DYN_COL_STRING;
+  wide_val.x.string.value.str= wide_str;
+  wide_val.x.string.value.length= sizeof(wide_str);
+  wide_val.x.string.charset= cs;
+  mariadb_dyncol_init(&wide);
+  FAIL_IF(mariadb_dyncol_create_many_num(&wide, 1, nums, &wide_val, 0) < 0,
+          "Error while creating record");
+
+  for (level= MA_SIMD_SCALAR; level <= MA_SIMD_NEON; level++)
+  {
+    if (ma_simd_set_level(level))
+      continue;
+    sink.length= 0;
+    FAIL_IF(mariadb_dyncol_json_write(&inner, &sink) < 0, "Writing failed");
+    if (sink.length != strlen(escaped) ||
+        memcmp(sink.str, escaped, sink.length))
+    {
+      diag("level %d: %.*s", level, (int)sink.length, sink.str);
+      ma_simd_set_level(best);
+      return FAIL;
+    }
+    sink.length= 0;
+    FAIL_IF(mariadb_dyncol_json_write(&wide, &sink) < 0, "Writing failed");
+    if (sink.length != (size_t)wide_len ||
+        memcmp(sink.str, wide_escaped, sink.length))
+    {
+      diag("level %d: %.*s", level, (int)sink.length, sink.str);
+      ma_simd_set_level(best);
+      return FAIL;
+    }
+  }
+  ma_simd_set_level(best);
+  mariadb_dyncol_free(&wide);
+
+  /* escaped names */
+  mariadb_dyncol_free(&inner);
+  mariadb_dyncol_init(&inner);
+  FAIL_IF(mariadb_dyncol_create_many_named(&inner, 1, names + 6, vals, 0) < 0,
+          "Error while creating record");
+  sink.length= 0;
+  FAIL_IF(mariadb_dyncol_json_write(&inner, &sink) < 0 ||
+          sink.length != 13 || memcmp(sink.str, "{\"esc\\\"\":-42}", 13),
+          "Wrong escaping of names");
+
+  free(sink.str);
+  mariadb_dyncol_free(&inner);
+  mariadb_dyncol_free(&outer);
+  return OK;
+}
+
+#define UPD_ROWS 3
+#define UPD_COLS 24
+
+static void dyncol_update_value(DYNAMIC_COLUMN_VALUE *val, char *buf,
+                                MARIADB_CHARSET_INFO *cs, uint col, uint seq,
+                                my_bool longer)
+{
+  switch (col % 3) {
+  case 0:
+    val->type= DYN_COL_INT;
+    val->x.long_value= (longlong)col * 1000 + seq;
+    break;
+  case 1:
+    val->type= DYN_COL_DOUBLE;
+    val->x.double_value= col + seq / 8.0;
+    break;
+  default:
+    val->type= DYN_COL_STRING;
+    val->x.string.value.str= buf;
+    val->x.string.value.length=
+      sprintf(buf, longer ? "longer value %02u" : "s%02u%02u", col, seq);
+    val->x.string.charset= cs;
+  }
+}
+
+static int dyncol_update_in_place(MYSQL *unused __attribute__((unused)))
+{
+  /* kind 0: same length values, 1: delete, 2: longer values */
+  static const struct {
+    uint count;
+    uint cols[2];
+    int kind;
+  } steps[]= {
+    {1, {5}, 0},          /* replace in place */
+    {2, {4, 7}, 0},
+    {2, {21, 22}, 0},     /* append */
+    {2, {3, 23}, 0},      /* replace and append */
+    {1, {10}, 1},         /* delete, record is rebuilt */
+    {1, {10}, 0},         /* insert before the last column */
+    {1, {8}, 2}           /* value gets longer */
+  };
+  DYNAMIC_COLUMN rows[UPD_ROWS], single, expected;
+  DYNAMIC_COLUMN_UPDATE update;
+  DYNAMIC_COLUMN_VALUE model[UPD_ROWS][UPD_COLS + 1], row_vals[UPD_ROWS * 2];
+  DYNAMIC_COLUMN_VALUE create_vals[UPD_COLS];
+  MYSQL_LEX_STRING names[UPD_COLS + 1], create_names[UPD_COLS], step_names[2];
+  char namebuf[UPD_COLS + 1][8], bufs[UPD_ROWS][UPD_COLS + 1][24];
+  uint create_nums[UPD_COLS], step_nums[2];
+  uint named, s, r, c, j, n;
+  MARIADB_CHARSET_INFO *cs= mariadb_get_charset_by_name("utf8mb4");
+
+  FAIL_IF(!cs, "utf8mb4 not found");
+  for (c= 0; c <= UPD_COLS; c++)
+  {
+    names[c].str= namebuf[c];
+    names[c].length= snprintf(namebuf[c], sizeof(namebuf[c]), "c%02u", c);
+  }
+
+  mariadb_dyncol_update_init(&update);
+  for (named= 0; named < 2; named++)
+  {
+    /* columns 1..20 */
+    for (r= 0; r < UPD_ROWS; r++)
+    {
+      for (c= 0, n= 0; c <= UPD_COLS; c++)
+      {
+        model[r][c].type= DYN_COL_NULL;
+        if (c < 1 || c > 20)
+          continue;
+        dyncol_update_value(&model[r][c], bufs[r][c], cs, c, r, 0);
+        create_nums[n]= c;
+        create_names[n]= names[c];
+        create_vals[n++]= model[r][c];
+      }
+      mariadb_dyncol_init(rows + r);
+      FAIL_IF((named ?
+               mariadb_dyncol_create_many_named(rows + r, n, create_names,
+                                                create_vals, 0) :
+               mariadb_dyncol_create_many_num(rows + r, n, create_nums,
+                                              create_vals, 0)) < 0,
+              "Error while creating record");
+      if (r == 0)
+      {
+        /* updated one by one with the values of the first row */
+        mariadb_dyncol_init(&single);
+        FAIL_IF((named ?
+                 mariadb_dyncol_create_many_named(&single, n, create_names,
+                                                  create_vals, 0) :
+                 mariadb_dyncol_create_many_num(&single, n, create_nums,
+                                                create_vals, 0)) < 0,
+                "Error while creating record");
+      }
+    }
+
+    for (s= 0; s < sizeof(steps) / sizeof(steps[0]); s++)
+    {
+      for (j= 0; j < steps[s].count; j++)
+      {
+        step_nums[j]= steps[s].cols[j];
+        step_names[j]= names[step_nums[j]];
+        for (r= 0; r < UPD_ROWS; r++)
+        {
+          DYNAMIC_COLUMN_VALUE *val= &model[r][step_nums[j]];
+
+          if (steps[s].kind == 1)
+            val->type= DYN_COL_NULL;
+          else
+            dyncol_update_value(val, bufs[r][step_nums[j]], cs, step_nums[j],
+                                s * UPD_ROWS + r, steps[s].kind == 2);
+          row_vals[r * steps[s].count + j]= *val;
+        }
+      }
+      FAIL_IF((named ?
+               mariadb_dyncol_update_rows_named(&update, rows, UPD_ROWS,
+                                                steps[s].count, step_names,
+                                                row_vals) :
+               mariadb_dyncol_update_rows_num(&update, rows, UPD_ROWS,
+                                              steps[s].count, step_nums,
+                                              row_vals)) < 0,
+              "Error while updating rows");
+      FAIL_IF((named ?
+               mariadb_dyncol_update_many_named(&single, steps[s].count,
+                                                step_names, row_vals) :
+               mariadb_dyncol_update_many_num(&single, steps[s].count,
+                                              step_nums, row_vals)) < 0,
+              "Error while updating record");
+
+      /* the result is the same as a newly created record */
+      for (r= 0; r < UPD_ROWS; r++)
+      {
+        for (c= 0, n= 0; c <= UPD_COLS; c++)
+        {
+          if (model[r][c].type == DYN_COL_NULL)
+            continue;
+          create_nums[n]= c;
+          create_names[n]= names[c];
+          create_vals[n++]= model[r][c];
+        }
+        mariadb_dyncol_init(&expected);
+        FAIL_IF((named ?
+                 mariadb_dyncol_create_many_named(&expected, n, create_names,
+                                                  create_vals, 0) :
+                 mariadb_dyncol_create_many_num(&expected, n, create_nums,
+                                                create_vals, 0)) < 0,
+                "Error while creating record");
+        FAIL_IF(mariadb_dyncol_check(rows + r) < 0, "Broken record");
+        FAIL_IF(rows[r].length != expected.length ||
+                memcmp(rows[r].str, expected.str, expected.length),
+                "Record differs from a new one");
+        FAIL_IF(r == 0 && (single.length != expected.length ||
+                           memcmp(single.str, expected.str, expected.length)),
+                "Single update differs from a new record");
+        mariadb_dyncol_free(&expected);
+      }
+    }
+    for (r= 0; r < UPD_ROWS; r++)
+      mariadb_dyncol_free(rows + r);
+    mariadb_dyncol_free(&single);
+  }
+  mariadb_dyncol_update_free(&update);
+  return OK;
+}
+
+static int dyncol_update_in_place_error(MYSQL *unused __attribute__((unused)))
+{
+  DYNAMIC_COLUMN rec;
+  DYNAMIC_COLUMN_VALUE vals[3];
+  uint nums[3]= {1, 2, 3};
+  char copy[128], text[255];
+  size_t length;
+  MARIADB_CHARSET_INFO *cs= mariadb_get_charset_by_name("utf8mb4");
+  enum enum_dyncol_func_result rc;
+
+  FAIL_IF(!cs, "utf8mb4 not found");
+  memset(text, 'x', sizeof(text));
+  vals[0].type= vals[1].type= DYN_COL_INT;
+  vals[0].x.long_value= 1000;
+  vals[1].x.long_value= 2000;
+  vals[2].type= DYN_COL_STRING;
+  vals[2].x.string.value.str= text;
+  vals[2].x.string.value.length= 40;
+  vals[2].x.string.charset= cs;
+  mariadb_dyncol_init(&rec);
+  FAIL_IF(mariadb_dyncol_create_many_num(&rec, 3, nums, vals, 0) < 0,
+          "Error while creating record");
+  /* 3 byte fixed header, entries of 2 byte column number + 2 byte offset */
+  FAIL_IF((rec.str[0] & 3) != 1 || rec.length > sizeof(copy),
+          "Unexpected record layout");
+
+  /*
+    Move the data of column 3 past the end of the record, column 2 now
+    seems to be 256 bytes long. Values of the same length take the
+    in-place path, which only finds the broken offset after column 1.
+  */
+  int2store(rec.str + 3 + 2 * 4 + 2, (0x102 << 3) | (DYN_COL_STRING - 1));
+  memcpy(copy, rec.str, rec.length);
+  length= rec.length;
+
+  vals[0].x.long_value= 1001;
+  vals[1]= vals[2];
+  vals[1].x.string.value.length= 255;
+  rc= mariadb_dyncol_update_many_num(&rec, 2, nums, vals);
+  FAIL_IF(rc != ER_DYNCOL_FORMAT, "Broken record was updated");
+  FAIL_IF(rec.length != length || memcmp(rec.str, copy, length),
+          "Failed update changed the record");
+  mariadb_dyncol_free(&rec);
+  return OK;
+}
+
 struct my_tests_st my_tests[] = {
   {"mdev_x1", mdev_x1, TEST_CONNECTION_NEW, 0, NULL, NULL}, 
   {"mdev_4994", mdev_4994, TEST_CONNECTION_NEW, 0, NULL, NULL}, 
@@ -306,6 +853,11 @@ struct my_tests_st my_tests[] = {
   {"create_dyncol_num", create_dyncol_num, TEST_CONNECTION_NEW, 0, NULL, NULL}, 
   {"dyncol_column_count", dyncol_column_count, TEST_CONNECTION_NEW, 0, NULL, NULL}, 
   {"dyncol_nested", dyncol_nested, TEST_CONNECTION_NEW, 0, NULL, NULL}, 
+  {"dyncol_double_str", dyncol_double_str, TEST_CONNECTION_NONE, 0, NULL, NULL},
+  {"dyncol_index", dyncol_index, TEST_CONNECTION_NONE, 0, NULL, NULL},
+  {"dyncol_json_write", dyncol_json_write, TEST_CONNECTION_NONE, 0, NULL, NULL},
+  {"dyncol_update_in_place", dyncol_update_in_place, TEST_CONNECTION_NONE, 0, NULL, NULL},
+  {"dyncol_update_in_place_error", dyncol_update_in_place_error, TEST_CONNECTION_NONE, 0, NULL, NULL},
   {NULL, NULL, 0, 0, NULL, 0}
 };
 
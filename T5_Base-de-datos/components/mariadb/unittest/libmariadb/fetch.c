@@ -22,6 +22,7 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 51 Franklin St, Fifth Floor, Boston, MA 02110-1301  USA
 */
 #include "my_test.h"
+#include <mariadb_columnar.h>
 
 /* Generalized fetch conversion routine for all basic types */
 
@@ -972,7 +973,472 @@ static int test_conc281(MYSQL *mysql)
 
 }
 
+static int check_column_batch(MARIADB_COLUMN_BATCH *batch)
+{
+  MARIADB_COLUMN *col;
+
+  FAIL_IF(!batch, "Expected column batch");
+  FAIL_IF(batch->row_count != 3, "Expected 3 rows");
+  FAIL_IF(batch->column_count != 3, "Expected 3 columns");
+
+  col= &batch->columns[0];
+  FAIL_IF(col->format != MARIADB_COLUMN_INT32, "Expected INT32 column");
+  FAIL_IF(col->null_count != 1 || !col->validity, "Expected one NULL value");
+  FAIL_IF(MARIADB_COLUMN_IS_NULL(col, 0) || !MARIADB_COLUMN_IS_NULL(col, 1) ||
+          MARIADB_COLUMN_IS_NULL(col, 2), "Wrong validity bitmap");
+  FAIL_IF(((int *)col->values)[0] != 1 || ((int *)col->values)[1] != 0 ||
+          ((int *)col->values)[2] != -3, "Wrong integer values");
+
+  col= &batch->columns[1];
+  FAIL_IF(col->format != MARIADB_COLUMN_DOUBLE, "Expected DOUBLE column");
+  FAIL_IF(col->validity, "Expected no validity bitmap");
+  FAIL_IF(((double *)col->values)[0] != 1.5 ||
+          ((double *)col->values)[2] != -0.25, "Wrong double values");
+
+  col= &batch->columns[2];
+  FAIL_IF(col->format != MARIADB_COLUMN_BINARY, "Expected BINARY column");
+  FAIL_IF(col->null_count != 1, "Expected one NULL value");
+  FAIL_IF(col->offsets[0] != 0 || col->offsets[1] != 3 ||
+          col->offsets[2] != 3 || col->offsets[3] != 8, "Wrong offsets");
+  FAIL_IF(memcmp(col->values, "fooworld", 8), "Wrong string values");
+  return OK;
+}
+
+static int test_fetch_columns(MYSQL *mysql)
+{
+  int rc;
+  MYSQL_RES *res;
+  MYSQL_STMT *stmt;
+  MARIADB_COLUMN_BATCH *batch;
+  const char *query= "SELECT a, b, c FROM t_columns ORDER BY id";
+
+  rc= mysql_query(mysql, "DROP TABLE IF EXISTS t_columns");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "CREATE TABLE t_columns (id int, a int, b double, c varchar(20))");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "INSERT INTO t_columns VALUES (1, 1, 1.5, 'foo'),"
+                         "(2, NULL, 2, NULL), (3, -3, -0.25, 'world')");
+  check_mysql_rc(rc, mysql);
+
+  /* text protocol, buffered */
+  rc= mysql_query(mysql, query);
+  check_mysql_rc(rc, mysql);
+  res= mysql_store_result(mysql);
+  FAIL_IF(!res, "Invalid result set");
+  batch= mariadb_fetch_columns(res, 0);
+  rc= check_column_batch(batch);
+  mariadb_free_columns(batch);
+  mysql_free_result(res);
+  if (rc)
+    return rc;
+
+  /* text protocol, unbuffered, two batches */
+  rc= mysql_query(mysql, query);
+  check_mysql_rc(rc, mysql);
+  res= mysql_use_result(mysql);
+  FAIL_IF(!res, "Invalid result set");
+  batch= mariadb_fetch_columns(res, 2);
+  FAIL_IF(!batch || batch->row_count != 2, "Expected 2 rows");
+  mariadb_free_columns(batch);
+  batch= mariadb_fetch_columns(res, 2);
+  FAIL_IF(!batch || batch->row_count != 1, "Expected 1 row");
+  FAIL_IF(memcmp(batch->columns[2].values, "world", 5), "Wrong string value");
+  mariadb_free_columns(batch);
+  mysql_free_result(res);
+
+  /* binary protocol */
+  stmt= mysql_stmt_init(mysql);
+  rc= mysql_stmt_prepare(stmt, SL(query));
+  check_stmt_rc(rc, stmt);
+  rc= mysql_stmt_execute(stmt);
+  check_stmt_rc(rc, stmt);
+  batch= mariadb_stmt_fetch_columns(stmt, 0);
+  rc= check_column_batch(batch);
+  mariadb_free_columns(batch);
+  mysql_stmt_close(stmt);
+  if (rc)
+    return rc;
+
+  rc= mysql_query(mysql, "DROP TABLE t_columns");
+  check_mysql_rc(rc, mysql);
+  return OK;
+}
+
+static int test_fetch_array(MYSQL *mysql)
+{
+  int rc, i;
+  MYSQL_STMT *stmt;
+  MYSQL_BIND bind[2];
+  int ids[4];
+  char names[4][10];
+  unsigned long lengths[4];
+  my_bool is_null[4];
+  unsigned int array_size= 4, rows_fetched;
+  size_t row_size;
+  struct st_row {
+    int id;
+    char name[10];
+    unsigned long length;
+    my_bool is_null;
+  } rows[4];
+
+  rc= mysql_query(mysql, "DROP TABLE IF EXISTS t_fetch_array");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "CREATE TABLE t_fetch_array (a int, b varchar(10))");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "INSERT INTO t_fetch_array VALUES (1, 'one'), (2, NULL),"
+                         "(3, 'three'), (4, 'four'), (5, 'five'), (6, 'six')");
+  check_mysql_rc(rc, mysql);
+
+  /* column-wise binding */
+  stmt= mysql_stmt_init(mysql);
+  rc= mysql_stmt_prepare(stmt, SL("SELECT a, b FROM t_fetch_array ORDER BY a"));
+  check_stmt_rc(rc, stmt);
+  rc= mysql_stmt_attr_set(stmt, STMT_ATTR_FETCH_ARRAY_SIZE, &array_size);
+  check_stmt_rc(rc, stmt);
+  rc= mysql_stmt_execute(stmt);
+  check_stmt_rc(rc, stmt);
+
+  memset(bind, 0, sizeof(MYSQL_BIND) * 2);
+  bind[0].buffer_type= MYSQL_TYPE_LONG;
+  bind[0].buffer= ids;
+  bind[1].buffer_type= MYSQL_TYPE_STRING;
+  bind[1].buffer= names;
+  bind[1].buffer_length= sizeof(names[0]);
+  bind[1].length= lengths;
+  bind[1].is_null= is_null;
+  rc= mysql_stmt_bind_result(stmt, bind);
+  check_stmt_rc(rc, stmt);
+
+  rc= mysql_stmt_fetch(stmt);
+  check_stmt_rc(rc, stmt);
+  mysql_stmt_attr_get(stmt, STMT_ATTR_ROWS_FETCHED, &rows_fetched);
+  FAIL_IF(rows_fetched != 4, "Expected 4 rows");
+  for (i=0; i < 4; i++)
+    FAIL_IF(ids[i] != i + 1, "Wrong integer value");
+  FAIL_IF(is_null[0] || !is_null[1] || is_null[2], "Wrong NULL indicator");
+  FAIL_IF(lengths[2] != 5 || strcmp(names[2], "three"), "Wrong string value");
+
+  rc= mysql_stmt_fetch(stmt);
+  check_stmt_rc(rc, stmt);
+  mysql_stmt_attr_get(stmt, STMT_ATTR_ROWS_FETCHED, &rows_fetched);
+  FAIL_IF(rows_fetched != 2, "Expected 2 rows");
+  FAIL_IF(ids[0] != 5 || ids[1] != 6, "Wrong integer value");
+  FAIL_IF(strcmp(names[1], "six"), "Wrong string value");
+
+  rc= mysql_stmt_fetch(stmt);
+  FAIL_IF(rc != MYSQL_NO_DATA, "Expected MYSQL_NO_DATA");
+  mysql_stmt_close(stmt);
+
+  /* row-wise binding, unbuffered */
+  stmt= mysql_stmt_init(mysql);
+  rc= mysql_stmt_prepare(stmt, SL("SELECT a, b FROM t_fetch_array ORDER BY a"));
+  check_stmt_rc(rc, stmt);
+  row_size= sizeof(struct st_row);
+  rc= mysql_stmt_attr_set(stmt, STMT_ATTR_FETCH_ARRAY_SIZE, &array_size);
+  check_stmt_rc(rc, stmt);
+  rc= mysql_stmt_attr_set(stmt, STMT_ATTR_FETCH_ROW_SIZE, &row_size);
+  check_stmt_rc(rc, stmt);
+  rc= mysql_stmt_execute(stmt);
+  check_stmt_rc(rc, stmt);
+
+  memset(bind, 0, sizeof(MYSQL_BIND) * 2);
+  bind[0].buffer_type= MYSQL_TYPE_LONG;
+  bind[0].buffer= &rows[0].id;
+  bind[1].buffer_type= MYSQL_TYPE_STRING;
+  bind[1].buffer= rows[0].name;
+  bind[1].buffer_length= sizeof(rows[0].name);
+  bind[1].length= &rows[0].length;
+  bind[1].is_null= &rows[0].is_null;
+  rc= mysql_stmt_bind_result(stmt, bind);
+  check_stmt_rc(rc, stmt);
+
+  rc= mysql_stmt_fetch(stmt);
+  check_stmt_rc(rc, stmt);
+  mysql_stmt_attr_get(stmt, STMT_ATTR_ROWS_FETCHED, &rows_fetched);
+  FAIL_IF(rows_fetched != 4, "Expected 4 rows");
+  for (i=0; i < 4; i++)
+    FAIL_IF(rows[i].id != i + 1, "Wrong integer value");
+  FAIL_IF(!rows[1].is_null || rows[3].is_null, "Wrong NULL indicator");
+  FAIL_IF(rows[3].length != 4 || strcmp(rows[3].name, "four"), "Wrong string value");
+  mysql_stmt_close(stmt);
+
+  rc= mysql_query(mysql, "DROP TABLE t_fetch_array");
+  check_mysql_rc(rc, mysql);
+  return OK;
+}
+
+/*
+  The conversion of ma_stmt_codec.c before the SWAR/fast path parsers
+  were added, used as reference for test_fetch_numeric_str
+*/
+static unsigned long long ref_strtoull(const char *str, size_t len, const char **end, int *err)
+{
+  unsigned long long val= 0;
+  const char *p= str;
+  const char *end_str= p + len;
+
+  for (; p < end_str; p++)
+  {
+    if (*p < '0' || *p > '9')
+      break;
+    if (val > ULLONG_MAX / 10 || val * 10 > ULLONG_MAX - (*p - '0'))
+    {
+      *err= ERANGE;
+      break;
+    }
+    val= val * 10 + *p - '0';
+  }
+  if (p == str)
+    *err= ERANGE;
+  *end= p;
+  return val;
+}
+
+static long long ref_strtoll(const char *str, size_t len, const char **end, int *err)
+{
+  unsigned long long uval;
+  const char *p= str;
+  const char *end_str= p + len;
+  int neg;
+
+  while (p < end_str && isspace(*p))
+    p++;
+  if (p == end_str)
+  {
+    *end= p;
+    *err= ERANGE;
+    return 0;
+  }
+  if ((neg= (*p == '-')))
+    p++;
+  uval= ref_strtoull(p, end_str - p, &p, err);
+  *end= p;
+  if (*err)
+    return uval;
+  if (!neg)
+  {
+    if (uval > LLONG_MAX)
+    {
+      *end= p - 1;
+      uval= LLONG_MAX;
+      *err= ERANGE;
+    }
+    return uval;
+  }
+  if (uval == (unsigned long long)LLONG_MIN)
+    return LLONG_MIN;
+  if (uval > LLONG_MAX)
+  {
+    *end= p - 1;
+    uval= LLONG_MIN;
+    *err= ERANGE;
+  }
+  return -1LL * uval;
+}
+
+static long long ref_atoll(const char *str, int *error, my_bool is_unsigned)
+{
+  const char *p= str, *end, *end_str= str + strlen(str);
+  long long ret;
+
+  while (p < end_str && isspace(*p))
+    p++;
+  ret= is_unsigned ? (long long)ref_strtoull(p, end_str - p, &end, error)
+                   : ref_strtoll(p, end_str - p, &end, error);
+  while (end < end_str && isspace(*end))
+    end++;
+  if (end != end_str)
+    *error= 1;
+  return ret;
+}
+
+static double ref_atod(const char *str, int *error)
+{
+  double val;
+
+  *error= errno= 0;
+  val= strtod(str, NULL);
+  if (errno)
+    *error= errno;
+  return val;
+}
+
+/* deterministic, so that a failure can be reproduced */
+static unsigned int numeric_str_rand(unsigned int *seed)
+{
+  *seed= *seed * 1103515245 + 12345;
+  return (*seed >> 16) & 0x7FFF;
+}
+
+#define NUMERIC_STR_RANDOM 200
+
+/*
+  Compares the client side conversion of numeric strings to signed and
+  unsigned bigint and to double with the previous conversion
+*/
+static int test_fetch_numeric_str(MYSQL *mysql)
+{
+  static const char *fixed_int[]= {
+    "0", "-0", "7", "-7", "+7", "00000000000000000000000042", "-000123",
+    "1234567890123456789",                /* 19 digits */
+    "12345678901234567890",               /* 20 digits */
+    "99999999999999999999",               /* 20 digits, overflow */
+    "9223372036854775807",                /* LLONG_MAX */
+    "9223372036854775808",                /* LLONG_MAX + 1 */
+    "-9223372036854775808",               /* LLONG_MIN */
+    "-9223372036854775809",               /* LLONG_MIN - 1 */
+    "18446744073709551615",               /* ULLONG_MAX */
+    "18446744073709551616",               /* ULLONG_MAX + 1 */
+    "000000018446744073709551615",
+    "184467440737095516150",
+    "12345678", "123456789", "1234567a", "12 ", " 12", "", "-", "1e3"
+  };
+  static const char *fixed_dbl[]= {
+    "0", "-0", "0.1", "-0.1", "+1.5", "1.", ".5", "1e22", "1e23", "1e-22",
+    "1e-23", "9007199254740992", "9007199254740993", "-9007199254740993",
+    "123456789012345678901234567890", "0.000000000000000000001",
+    "1.7976931348623157e308", "2.2250738585072014e-308", "1e309",
+    "4.9e-324", "0001.2500", "1e", "1.5x", "12345678901234567890"
+  };
+  int rc, i, j, count;
+  unsigned int seed= 1;
+  MYSQL_STMT *stmt;
+  MYSQL_BIND bind[3];
+  char ival[NUMERIC_STR_RANDOM][32], dval_str[NUMERIC_STR_RANDOM][64];
+  char query[256];
+  long long lval;
+  unsigned long long ulval;
+  double dval;
+  my_bool error[3];
+
+  rc= mysql_query(mysql, "DROP TABLE IF EXISTS t_numeric_str");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "CREATE TABLE t_numeric_str (id int, a varchar(64), b varchar(64))");
+  check_mysql_rc(rc, mysql);
+
+  for (i= 0; i < NUMERIC_STR_RANDOM; i++)
+  {
+    int len= 1 + numeric_str_rand(&seed) % 22, k= 0;
+
+    if (i % 3 == 0)
+      ival[i][k++]= '-';
+    for (j= 0; j < len; j++)
+      ival[i][k++]= '0' + numeric_str_rand(&seed) % 10;
+    ival[i][k]= 0;
+    snprintf(dval_str[i], sizeof(dval_str[i]), "%s.%ue%d", ival[i],
+             numeric_str_rand(&seed) % 1000, (int)(numeric_str_rand(&seed) % 60) - 30);
+  }
+
+  count= (int)(sizeof(fixed_int) / sizeof(char *));
+  if (count < (int)(sizeof(fixed_dbl) / sizeof(char *)))
+    count= (int)(sizeof(fixed_dbl) / sizeof(char *));
+  for (i= 0; i < count + NUMERIC_STR_RANDOM; i++)
+  {
+    const char *a, *b;
+
+    if (i < count)
+    {
+      a= i < (int)(sizeof(fixed_int) / sizeof(char *)) ? fixed_int[i] : "0";
+      b= i < (int)(sizeof(fixed_dbl) / sizeof(char *)) ? fixed_dbl[i] : "0";
+    }
+    else
+    {
+      a= ival[i - count];
+      b= dval_str[i - count];
+    }
+    FAIL_IF(snprintf(query, sizeof(query), "INSERT INTO t_numeric_str VALUES (%d, '%s', '%s')",
+                     i, a, b) >= (int)sizeof(query), "Query buffer too small");
+    rc= mysql_query(mysql, query);
+    check_mysql_rc(rc, mysql);
+  }
+
+  stmt= mysql_stmt_init(mysql);
+  rc= mysql_stmt_prepare(stmt, SL("SELECT a, a, b FROM t_numeric_str ORDER BY id"));
+  check_stmt_rc(rc, stmt);
+  rc= mysql_stmt_execute(stmt);
+  check_stmt_rc(rc, stmt);
+
+  memset(bind, 0, sizeof(MYSQL_BIND) * 3);
+  bind[0].buffer_type= MYSQL_TYPE_LONGLONG;
+  bind[0].buffer= &lval;
+  bind[0].error= &error[0];
+  bind[1].buffer_type= MYSQL_TYPE_LONGLONG;
+  bind[1].buffer= &ulval;
+  bind[1].is_unsigned= 1;
+  bind[1].error= &error[1];
+  bind[2].buffer_type= MYSQL_TYPE_DOUBLE;
+  bind[2].buffer= &dval;
+  bind[2].error= &error[2];
+  rc= mysql_stmt_bind_result(stmt, bind);
+  check_stmt_rc(rc, stmt);
+
+  for (i= 0; i < count + NUMERIC_STR_RANDOM; i++)
+  {
+    char a[64], b[64];
+    MYSQL_BIND sbind[2];
+    unsigned long alen, blen;
+    long long expected;
+    double expected_dbl;
+    int err;
+
+    rc= mysql_stmt_fetch(stmt);
+    FAIL_IF(rc == 1 || rc == MYSQL_NO_DATA, "Fetch failed");
+
+    memset(sbind, 0, sizeof(MYSQL_BIND) * 2);
+    sbind[0].buffer_type= sbind[1].buffer_type= MYSQL_TYPE_STRING;
+    sbind[0].buffer= a;
+    sbind[0].buffer_length= sizeof(a);
+    sbind[0].length= &alen;
+    sbind[1].buffer= b;
+    sbind[1].buffer_length= sizeof(b);
+    sbind[1].length= &blen;
+    rc= mysql_stmt_fetch_column(stmt, &sbind[0], 0, 0);
+    check_stmt_rc(rc, stmt);
+    rc= mysql_stmt_fetch_column(stmt, &sbind[1], 2, 0);
+    check_stmt_rc(rc, stmt);
+
+    err= 0;
+    expected= ref_atoll(a, &err, 0);
+    if (lval != expected || error[0] != (err > 0))
+    {
+      diag("'%s': %lld (error %d), expected %lld (error %d)", a, lval, error[0], expected, err > 0);
+      return FAIL;
+    }
+    err= 0;
+    expected= ref_atoll(a, &err, 1);
+    if (ulval != (unsigned long long)expected || error[1] != (err > 0))
+    {
+      diag("'%s': %llu (error %d), expected %llu (error %d) as unsigned", a, ulval, error[1],
+           (unsigned long long)expected, err > 0);
+      return FAIL;
+    }
+    /* the edges must not only match the reference */
+    if (!strcmp(a, "18446744073709551616"))
+      FAIL_IF(!error[0] || !error[1], "ULLONG_MAX + 1 not reported as overflow");
+    if (!strcmp(a, "18446744073709551615"))
+      FAIL_IF(error[1] || ulval != ULLONG_MAX || !error[0], "Wrong conversion of ULLONG_MAX");
+    if (!strcmp(a, "-9223372036854775808"))
+      FAIL_IF(error[0] || lval != LLONG_MIN, "Wrong conversion of LLONG_MIN");
+
+    expected_dbl= ref_atod(b, &err);
+    if (memcmp(&dval, &expected_dbl, sizeof(double)) || error[2] != (err > 0))
+    {
+      diag("'%s': %.17g (error %d), expected %.17g (error %d)", b, dval, error[2], expected_dbl, err > 0);
+      return FAIL;
+    }
+  }
+  mysql_stmt_close(stmt);
+
+  rc= mysql_query(mysql, "DROP TABLE t_numeric_str");
+  check_mysql_rc(rc, mysql);
+  return OK;
+}
+
 struct my_tests_st my_tests[] = {
+  {"test_fetch_numeric_str", test_fetch_numeric_str, TEST_CONNECTION_DEFAULT, 0, NULL, NULL},
+  {"test_fetch_array", test_fetch_array, TEST_CONNECTION_DEFAULT, 0, NULL, NULL},
+  {"test_fetch_columns", test_fetch_columns, TEST_CONNECTION_DEFAULT, 0, NULL, NULL},
   {"test_conc281", test_conc281, 1, 0, NULL, NULL},
   {"test_fetch_seek", test_fetch_seek, 1, 0, NULL , NULL},
   {"test_fetch_offset", test_fetch_offset, 1, 0, NULL , NULL},
@@ -5224,7 +5224,187 @@ end:
   return error ? FAIL : OK;
 }
 
+static int test_stmt_cache(MYSQL *unused __attribute__((unused)))
+{
+  MYSQL *mysql= mysql_init(NULL);
+  MYSQL_STMT *stmt;
+  MYSQL_BIND bind[2];
+  unsigned int cache_size= 2;
+  unsigned long stmt_id= 0;
+  int rc, i, val, res;
+  char query[64];
+
+  rc= mysql_optionsv(mysql, MARIADB_OPT_STMT_CACHE_SIZE, &cache_size);
+  check_mysql_rc(rc, mysql);
+  cache_size= 0;
+  rc= mysql_get_optionv(mysql, MARIADB_OPT_STMT_CACHE_SIZE, &cache_size);
+  check_mysql_rc(rc, mysql);
+  FAIL_IF(cache_size != 2, "Expected cache size 2");
+  FAIL_IF(!my_test_connect(mysql, hostname, username, password, schema,
+                           port, socketname, 0, 0), mysql_error(mysql));
+
+  /* prepare/execute/close loop: the server side statement must be reused */
+  for (i= 0; i < 5; i++)
+  {
+    stmt= mysql_stmt_init(mysql);
+    rc= mysql_stmt_prepare(stmt, SL("SELECT ? + 1"));
+    check_stmt_rc(rc, stmt);
+    FAIL_IF(mysql_stmt_param_count(stmt) != 1, "Expected 1 parameter");
+    FAIL_IF(mysql_stmt_field_count(stmt) != 1, "Expected 1 column");
+    if (i)
+      FAIL_IF(stmt->stmt_id != stmt_id, "Statement was not reused");
+    stmt_id= stmt->stmt_id;
+
+    memset(bind, 0, sizeof(bind));
+    val= i;
+    bind[0].buffer_type= MYSQL_TYPE_LONG;
+    bind[0].buffer= &val;
+    bind[1].buffer_type= MYSQL_TYPE_LONG;
+    bind[1].buffer= &res;
+    rc= mysql_stmt_bind_param(stmt, &bind[0]);
+    check_stmt_rc(rc, stmt);
+    rc= mysql_stmt_execute(stmt);
+    check_stmt_rc(rc, stmt);
+    rc= mysql_stmt_bind_result(stmt, &bind[1]);
+    check_stmt_rc(rc, stmt);
+    rc= mysql_stmt_fetch(stmt);
+    check_stmt_rc(rc, stmt);
+    FAIL_IF(res != i + 1, "Wrong result");
+    mysql_stmt_close(stmt);
+  }
+
+  /* re-prepare with other statements on the same handle: evicts the
+     least recently cached statement */
+  stmt= mysql_stmt_init(mysql);
+  for (i= 0; i < 4; i++)
+  {
+    snprintf(query, sizeof(query), "SELECT %d", i);
+    rc= mysql_stmt_prepare(stmt, SL(query));
+    check_stmt_rc(rc, stmt);
+    FAIL_IF(stmt->stmt_id == stmt_id, "Cached statement used for other SQL");
+    rc= mysql_stmt_execute(stmt);
+    check_stmt_rc(rc, stmt);
+    rc= mysql_stmt_store_result(stmt);
+    check_stmt_rc(rc, stmt);
+  }
+  rc= mysql_stmt_prepare(stmt, SL("SELECT ? + 1"));
+  check_stmt_rc(rc, stmt);
+  FAIL_IF(stmt->stmt_id == stmt_id, "Evicted statement was reused");
+  mysql_stmt_close(stmt);
+
+  /* statements are invalid after a reset */
+  rc= mysql_reset_connection(mysql);
+  check_mysql_rc(rc, mysql);
+  stmt= mysql_stmt_init(mysql);
+  rc= mysql_stmt_prepare(stmt, SL("SELECT ? + 1"));
+  check_stmt_rc(rc, stmt);
+  val= 41;
+  memset(bind, 0, sizeof(bind));
+  bind[0].buffer_type= MYSQL_TYPE_LONG;
+  bind[0].buffer= &val;
+  rc= mysql_stmt_bind_param(stmt, bind);
+  check_stmt_rc(rc, stmt);
+  rc= mysql_stmt_execute(stmt);
+  check_stmt_rc(rc, stmt);
+  mysql_stmt_close(stmt);
+
+  mysql_close(mysql);
+  return OK;
+}
+
+/* fetches the single integer column of the cached statement for query */
+static int stmt_cache_fetch_int(MYSQL *mysql, const char *query,
+                                unsigned long *stmt_id, int *val)
+{
+  MYSQL_STMT *stmt= mysql_stmt_init(mysql);
+  MYSQL_BIND bind;
+  int rc;
+
+  rc= mysql_stmt_prepare(stmt, query, (unsigned long)strlen(query));
+  check_stmt_rc(rc, stmt);
+  *stmt_id= stmt->stmt_id;
+  rc= mysql_stmt_execute(stmt);
+  check_stmt_rc(rc, stmt);
+  memset(&bind, 0, sizeof(bind));
+  bind.buffer_type= MYSQL_TYPE_LONG;
+  bind.buffer= val;
+  rc= mysql_stmt_bind_result(stmt, &bind);
+  check_stmt_rc(rc, stmt);
+  rc= mysql_stmt_fetch(stmt);
+  check_stmt_rc(rc, stmt);
+  mysql_stmt_close(stmt);
+  return OK;
+}
+
+static int test_stmt_cache_schema(MYSQL *unused __attribute__((unused)))
+{
+  MYSQL *mysql= mysql_init(NULL);
+  unsigned int cache_size= 4;
+  unsigned long stmt_id, first_id;
+  int rc, val;
+  const char *select= "SELECT a FROM t_stmt_cache";
+
+  rc= mysql_optionsv(mysql, MARIADB_OPT_STMT_CACHE_SIZE, &cache_size);
+  check_mysql_rc(rc, mysql);
+  FAIL_IF(!my_test_connect(mysql, hostname, username, password, schema,
+                           port, socketname, 0, 0), mysql_error(mysql));
+
+  rc= mysql_query(mysql, "CREATE DATABASE IF NOT EXISTS test_stmt_cache_db");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "CREATE OR REPLACE TABLE test_stmt_cache_db.t_stmt_cache (a int)");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "INSERT INTO test_stmt_cache_db.t_stmt_cache VALUES (2)");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "CREATE OR REPLACE TABLE t_stmt_cache (a int)");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "INSERT INTO t_stmt_cache VALUES (1)");
+  check_mysql_rc(rc, mysql);
+
+  /* prepare, close, switch schema, prepare again */
+  rc= stmt_cache_fetch_int(mysql, select, &first_id, &val);
+  FAIL_IF(rc, "Prepare in default schema failed");
+  FAIL_IF(val != 1, "Expected value from default schema");
+
+  rc= mysql_select_db(mysql, "test_stmt_cache_db");
+  check_mysql_rc(rc, mysql);
+  rc= stmt_cache_fetch_int(mysql, select, &stmt_id, &val);
+  FAIL_IF(rc, "Prepare in second schema failed");
+  FAIL_IF(stmt_id == first_id, "Statement of other schema was reused");
+  FAIL_IF(val != 2, "Expected value from second schema");
+
+  /* back to the first schema: its statement is still cached */
+  rc= mysql_select_db(mysql, schema);
+  check_mysql_rc(rc, mysql);
+  rc= stmt_cache_fetch_int(mysql, select, &stmt_id, &val);
+  FAIL_IF(rc, "Prepare in default schema failed");
+  FAIL_IF(stmt_id != first_id, "Cached statement was not reused");
+  FAIL_IF(val != 1, "Expected value from default schema");
+
+  /* USE updates mysql->db via session tracking */
+  rc= mysql_query(mysql, "USE test_stmt_cache_db");
+  check_mysql_rc(rc, mysql);
+  if (mysql->db && !strcmp(mysql->db, "test_stmt_cache_db"))
+  {
+    rc= stmt_cache_fetch_int(mysql, select, &stmt_id, &val);
+    FAIL_IF(rc, "Prepare after USE failed");
+    FAIL_IF(val != 2, "Expected value from second schema after USE");
+  }
+  else
+    diag("server doesn't track the schema, USE not tested");
+
+  rc= mysql_query(mysql, "DROP DATABASE test_stmt_cache_db");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_select_db(mysql, schema);
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "DROP TABLE t_stmt_cache");
+  check_mysql_rc(rc, mysql);
+  mysql_close(mysql);
+  return OK;
+}
+
 struct my_tests_st my_tests[] = {
+  {"test_stmt_cache", test_stmt_cache, TEST_CONNECTION_NONE, 0, NULL, NULL},
+  {"test_stmt_cache_schema", test_stmt_cache_schema, TEST_CONNECTION_NONE, 0, NULL, NULL},
   {"test_conc565", test_conc565, TEST_CONNECTION_DEFAULT, 0, NULL, NULL},
   {"test_conc349", test_conc349, TEST_CONNECTION_DEFAULT, 0, NULL, NULL},
   {"test_prepare_error", test_prepare_error, TEST_CONNECTION_NEW, 0, NULL, NULL},
@@ -27,6 +27,46 @@ with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "my_test.h"
 #include "mariadb_rpl.h"
+#include <ma_simd.h>
+
+extern void ma_init_alloc_root(MA_MEM_ROOT *mem_root, size_t block_size,
+                               size_t pre_alloc_size);
+extern void *ma_alloc_root(MA_MEM_ROOT *mem_root, size_t size);
+extern void ma_free_root(MA_MEM_ROOT *root, myf MyFlags);
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+/*
+  Counts the allocations of the process while malloc_counting is set,
+  glibc lets the executable replace malloc().
+*/
+#define HAVE_MALLOC_COUNT
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+static volatile int malloc_counting= 0;
+static volatile unsigned long malloc_count= 0;
+
+void *malloc(size_t size)
+{
+  if (malloc_counting)
+    malloc_count++;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+  if (malloc_counting)
+    malloc_count++;
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  if (malloc_counting)
+    malloc_count++;
+  return __libc_realloc(ptr, size);
+}
+#endif
 
 static int test_rpl_async(MYSQL *my __attribute__((unused)))
 {
@@ -410,12 +450,758 @@ static int test_conc689(MYSQL *my __attribute__((unused)))
 }
 
 
+static MARIADB_RPL *open_rpl_stream(const char *file, uint32_t server_id,
+                                    uint32_t threads, uint32_t zero_copy)
+{
+  MYSQL *mysql= mysql_init(NULL);
+  MARIADB_RPL *rpl;
+
+  if (!my_test_connect(mysql, hostname, username,
+                             password, schema, port, socketname, 0, 1))
+  {
+    diag("Error: %s", mysql_error(mysql));
+    mysql_close(mysql);
+    return NULL;
+  }
+  rpl= mariadb_rpl_init(mysql);
+  mysql_query(mysql, "SET @mariadb_slave_capability=4");
+  mysql_query(mysql, "SET @master_binlog_checksum= @@global.binlog_checksum");
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_FILENAME, file, strlen(file));
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_SERVER_ID, server_id);
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_START, 4UL);
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_FLAGS, MARIADB_RPL_BINLOG_DUMP_NON_BLOCK);
+  if (threads)
+  {
+    /* small queues, so the reader has to wait */
+    mariadb_rpl_optionsv(rpl, MARIADB_RPL_DECODE_THREADS, threads);
+    mariadb_rpl_optionsv(rpl, MARIADB_RPL_DECODE_QUEUE_SIZE, 3);
+    mariadb_rpl_optionsv(rpl, MARIADB_RPL_RESULT_QUEUE_SIZE, 2);
+  }
+  else
+    mariadb_rpl_optionsv(rpl, MARIADB_RPL_EXTRACT_VALUES, 1);
+  /* events must not differ from the ones copied from the packet */
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_ZERO_COPY, zero_copy);
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_VERIFY_CHECKSUM, 1);
+  if (mariadb_rpl_open(rpl))
+  {
+    diag("Error: %s", mysql_error(mysql));
+    mariadb_rpl_close(rpl);
+    mysql_close(mysql);
+    return NULL;
+  }
+  return rpl;
+}
+
+static void close_rpl_stream(MARIADB_RPL *rpl)
+{
+  MYSQL *mysql;
+
+  if (!rpl)
+    return;
+  mysql= rpl->mysql;
+  mariadb_rpl_close(rpl);
+  mysql_close(mysql);
+}
+
+static int compare_rows(MARIADB_RPL_ROW *row1, MARIADB_RPL_ROW *row2)
+{
+  for (; row1 && row2; row1= row1->next, row2= row2->next)
+  {
+    uint32_t i;
+
+    if (row1->column_count != row2->column_count)
+      return 1;
+    for (i= 0; i < row1->column_count; i++)
+    {
+      MARIADB_RPL_VALUE *v1= &row1->columns[i], *v2= &row2->columns[i];
+
+      if (v1->field_type != v2->field_type || v1->is_null != v2->is_null)
+        return 1;
+      if (v1->is_null)
+        continue;
+      if (v1->field_type == MYSQL_TYPE_LONG || v1->field_type == MYSQL_TYPE_LONGLONG)
+      {
+        if (v1->val.ll != v2->val.ll)
+          return 1;
+      }
+      else if (v1->field_type == MYSQL_TYPE_VARCHAR || v1->field_type == MYSQL_TYPE_BLOB)
+      {
+        if (v1->val.str.length != v2->val.str.length ||
+            memcmp(v1->val.str.str, v2->val.str.str, v1->val.str.length))
+          return 1;
+      }
+    }
+  }
+  return row1 != row2;
+}
+
+static int test_rpl_decode_threads(MYSQL *mysql)
+{
+  MARIADB_RPL *rpl1= NULL, *rpl2= NULL;
+  MARIADB_RPL_EVENT *event1= NULL, *event2= NULL;
+  MYSQL_RES *result;
+  MYSQL_ROW row;
+  char file[256], query[256];
+  int rc, i, events= 0, row_events= 0;
+
+  SKIP_SKYSQL;
+  SKIP_MAXSCALE;
+
+  if (!is_mariadb)
+    return SKIP;
+
+  rc= mysql_query(mysql, "SELECT @@log_bin");
+  check_mysql_rc(rc, mysql);
+  result= mysql_store_result(mysql);
+  row= mysql_fetch_row(result);
+  rc= atoi(row[0]) ? OK : SKIP;
+  mysql_free_result(result);
+  if (rc == SKIP)
+  {
+    diag("binary log disabled -> skip");
+    return SKIP;
+  }
+
+  rc= mysql_query(mysql, "FLUSH logs");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "SHOW MASTER STATUS");
+  check_mysql_rc(rc, mysql);
+  result= mysql_store_result(mysql);
+  row= mysql_fetch_row(result);
+  snprintf(file, sizeof(file), "%s", row[0]);
+  mysql_free_result(result);
+
+  rc= mysql_query(mysql, "SET binlog_format=ROW");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "CREATE OR REPLACE TABLE t_rpl_decode (a int, b bigint, c varchar(100), d blob)");
+  check_mysql_rc(rc, mysql);
+  for (i= 0; i < 200; i++)
+  {
+    snprintf(query, sizeof(query),
+             "INSERT INTO t_rpl_decode VALUES (%d, %d * 1000000000, REPEAT('x', %d), %s)",
+             i, i, i % 100, i % 3 ? "'blob'" : "NULL");
+    rc= mysql_query(mysql, query);
+    check_mysql_rc(rc, mysql);
+  }
+  rc= mysql_query(mysql, "UPDATE t_rpl_decode SET c='updated' WHERE a % 2");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "DELETE FROM t_rpl_decode WHERE a > 100");
+  check_mysql_rc(rc, mysql);
+
+  /* decoded in mariadb_rpl_fetch and by decode threads */
+  rpl1= open_rpl_stream(file, 12, 0, 0);
+  rpl2= open_rpl_stream(file, 13, 4, 1);
+  rc= (rpl1 && rpl2) ? OK : FAIL;
+
+  while (rc == OK)
+  {
+    event1= mariadb_rpl_fetch(rpl1, event1);
+    event2= mariadb_rpl_fetch(rpl2, event2);
+    if (!event1 || !event2)
+    {
+      if (event1 || event2)
+      {
+        diag("event streams have different length (%d events)", events);
+        rc= FAIL;
+      }
+      break;
+    }
+    events++;
+    if (event1->event_type != event2->event_type ||
+        event1->next_event_pos != event2->next_event_pos)
+    {
+      diag("event %d differs: type %d/%d", events, event1->event_type, event2->event_type);
+      rc= FAIL;
+    }
+    else if (IS_ROW_EVENT(event1))
+    {
+      row_events++;
+      if (!event1->rows || event1->event.rows.row_count != event2->event.rows.row_count ||
+          compare_rows(event1->rows, event2->rows))
+      {
+        diag("rows of event %d differ", events);
+        rc= FAIL;
+      }
+    }
+  }
+  mariadb_free_rpl_event(event1);
+  mariadb_free_rpl_event(event2);
+  close_rpl_stream(rpl1);
+  close_rpl_stream(rpl2);
+  diag("%d events, %d row events", events, row_events);
+  FAIL_IF(rc != OK, "decoded events differ");
+  FAIL_IF(row_events < 202, "row events missing");
+
+  rc= mysql_query(mysql, "DROP TABLE t_rpl_decode");
+  check_mysql_rc(rc, mysql);
+  return OK;
+}
+
+static int test_rpl_zero_copy(MYSQL *mysql)
+{
+  MARIADB_RPL *rpl1= NULL, *rpl2= NULL;
+  MARIADB_RPL_EVENT *event1= NULL, *event2= NULL;
+  MYSQL_RES *result;
+  MYSQL_ROW row;
+  char file[256], query[256];
+  int rc, i, events= 0, swapped= 0;
+
+  SKIP_SKYSQL;
+  SKIP_MAXSCALE;
+
+  if (!is_mariadb)
+    return SKIP;
+
+  rc= mysql_query(mysql, "SELECT @@log_bin");
+  check_mysql_rc(rc, mysql);
+  result= mysql_store_result(mysql);
+  row= mysql_fetch_row(result);
+  rc= atoi(row[0]) ? OK : SKIP;
+  mysql_free_result(result);
+  if (rc == SKIP)
+  {
+    diag("binary log disabled -> skip");
+    return SKIP;
+  }
+
+  rc= mysql_query(mysql, "FLUSH logs");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "SHOW MASTER STATUS");
+  check_mysql_rc(rc, mysql);
+  result= mysql_store_result(mysql);
+  row= mysql_fetch_row(result);
+  snprintf(file, sizeof(file), "%s", row[0]);
+  mysql_free_result(result);
+
+  rc= mysql_query(mysql, "SET binlog_format=ROW");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "CREATE OR REPLACE TABLE t_rpl_zero_copy (a int, c varchar(100), d blob)");
+  check_mysql_rc(rc, mysql);
+  for (i= 0; i < 100; i++)
+  {
+    snprintf(query, sizeof(query),
+             "INSERT INTO t_rpl_zero_copy VALUES (%d, REPEAT('x', %d), %s)",
+             i, i, i % 3 ? "'blob'" : "NULL");
+    rc= mysql_query(mysql, query);
+    check_mysql_rc(rc, mysql);
+  }
+
+  /* copied and zero copy events, both decoded in mariadb_rpl_fetch */
+  rpl1= open_rpl_stream(file, 15, 0, 0);
+  rpl2= open_rpl_stream(file, 16, 0, 1);
+  rc= (rpl1 && rpl2) ? OK : FAIL;
+
+  while (rc == OK)
+  {
+    NET *net= &rpl2->mysql->net;
+    uchar *event_buffer= event2 ? event2->packet_buffer : NULL;
+    uchar *net_buffer= net->buff;
+
+    event1= mariadb_rpl_fetch(rpl1, event1);
+    event2= mariadb_rpl_fetch(rpl2, event2);
+    if (!event1 || !event2)
+    {
+      if (event1 || event2)
+      {
+        diag("event streams have different length (%d events)", events);
+        rc= FAIL;
+      }
+      break;
+    }
+    events++;
+    /* the event took the network buffer and gave its own buffer back */
+    if (event2->packet_buffer != net_buffer ||
+        (event_buffer && net->buff != event_buffer) ||
+        event2->raw_data < event2->packet_buffer ||
+        event2->raw_data + event2->raw_data_size >
+          event2->packet_buffer + event2->packet_buffer_size)
+    {
+      diag("event %d: packet buffer wasn't swapped", events);
+      rc= FAIL;
+    }
+    else if (event_buffer)
+      swapped++;
+    if (event1->event_type != event2->event_type ||
+        event1->raw_data_size != event2->raw_data_size ||
+        memcmp(event1->raw_data, event2->raw_data, event1->raw_data_size))
+    {
+      diag("event %d differs: type %d/%d", events, event1->event_type, event2->event_type);
+      rc= FAIL;
+    }
+    else if (IS_ROW_EVENT(event1) &&
+             (!event1->rows || compare_rows(event1->rows, event2->rows)))
+    {
+      diag("rows of event %d differ", events);
+      rc= FAIL;
+    }
+  }
+  mariadb_free_rpl_event(event1);
+  mariadb_free_rpl_event(event2);
+  close_rpl_stream(rpl1);
+  close_rpl_stream(rpl2);
+  diag("%d events, %d buffers swapped", events, swapped);
+  FAIL_IF(rc != OK, "zero copy events differ");
+  FAIL_IF(swapped < 100, "packet buffers weren't swapped");
+
+  rc= mysql_query(mysql, "DROP TABLE t_rpl_zero_copy");
+  check_mysql_rc(rc, mysql);
+  return OK;
+}
+
+static int test_rpl_table_filter(MYSQL *mysql)
+{
+  MARIADB_RPL *rpl;
+  MARIADB_RPL_EVENT *event= NULL;
+  MYSQL_RES *result;
+  MYSQL_ROW row;
+  char file[256], query[256];
+  uint32_t columns[]= {0, 2};
+  int rc, i, rows= 0, sum= 0;
+
+  SKIP_SKYSQL;
+  SKIP_MAXSCALE;
+
+  if (!is_mariadb)
+    return SKIP;
+
+  rc= mysql_query(mysql, "SELECT @@log_bin");
+  check_mysql_rc(rc, mysql);
+  result= mysql_store_result(mysql);
+  row= mysql_fetch_row(result);
+  rc= atoi(row[0]) ? OK : SKIP;
+  mysql_free_result(result);
+  if (rc == SKIP)
+  {
+    diag("binary log disabled -> skip");
+    return SKIP;
+  }
+
+  rc= mysql_query(mysql, "FLUSH logs");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "SHOW MASTER STATUS");
+  check_mysql_rc(rc, mysql);
+  result= mysql_store_result(mysql);
+  row= mysql_fetch_row(result);
+  snprintf(file, sizeof(file), "%s", row[0]);
+  mysql_free_result(result);
+
+  rc= mysql_query(mysql, "SET binlog_format=ROW");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "CREATE OR REPLACE TABLE t_rpl_filter1 (a int, b varchar(100), c bigint)");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "CREATE OR REPLACE TABLE t_rpl_filter2 (a int, b varchar(100), c bigint)");
+  check_mysql_rc(rc, mysql);
+  for (i= 0; i < 50; i++)
+  {
+    snprintf(query, sizeof(query),
+             "INSERT INTO t_rpl_filter%d VALUES (%d, REPEAT('x', %d), %d)",
+             1 + i % 2, i, i, i * 2);
+    rc= mysql_query(mysql, query);
+    check_mysql_rc(rc, mysql);
+  }
+
+  rpl= open_rpl_stream(file, 14, 0, 0);
+  FAIL_IF(!rpl, "Can't open replication stream");
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_INCLUDE_TABLE, schema, NULL);
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_EXCLUDE_TABLE, NULL, "t_rpl_filter2");
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_TABLE_COLUMNS, schema, "t_rpl_filter1", 2, columns);
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_LAZY_VALUES, 1);
+
+  rc= OK;
+  while (rc == OK && (event= mariadb_rpl_fetch(rpl, event)))
+  {
+    MARIADB_RPL_ROW *r;
+
+    if (event->event_type == TABLE_MAP_EVENT &&
+        strncmp(event->event.table_map.table.str, "t_rpl_filter1",
+                event->event.table_map.table.length))
+    {
+      diag("unexpected table map for %.*s", (int)event->event.table_map.table.length,
+           event->event.table_map.table.str);
+      rc= FAIL;
+    }
+    if (!IS_ROW_EVENT(event))
+      continue;
+    for (r= event->rows; r; r= r->next)
+    {
+      MARIADB_RPL_VALUE *a= mariadb_rpl_row_value(event, r, 0),
+                        *b= mariadb_rpl_row_value(event, r, 1),
+                        *c= mariadb_rpl_row_value(event, r, 2);
+
+      if (!a || !b || !c || b->field_type != MYSQL_TYPE_NULL ||
+          a->val.ll % 2 || c->val.ll != a->val.ll * 2)
+      {
+        diag("wrong values in row %d", rows);
+        rc= FAIL;
+        break;
+      }
+      rows++;
+      sum+= (int)a->val.ll;
+    }
+  }
+  mariadb_free_rpl_event(event);
+  close_rpl_stream(rpl);
+  FAIL_IF(rc != OK, "filtered events differ");
+  FAIL_IF(rows != 25 || sum != 600, "rows of t_rpl_filter1 missing");
+
+  rc= mysql_query(mysql, "DROP TABLE t_rpl_filter1, t_rpl_filter2");
+  check_mysql_rc(rc, mysql);
+  return OK;
+}
+
+static uint32 crc32_ref(uint32 crc, const uchar *buf, size_t length)
+{
+  size_t i;
+  int b;
+
+  crc= ~crc;
+  for (i= 0; i < length; i++)
+  {
+    crc^= buf[i];
+    for (b= 0; b < 8; b++)
+      crc= (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+/* appends an event with checksum to buf, returns the new length */
+static size_t write_crc_event(uchar *buf, size_t pos, uchar type,
+                              const uchar *body, size_t length)
+{
+  uchar *ev= buf + pos;
+  uint32 event_length= (uint32)(19 + length + 4);
+
+  int4store(ev, 1000);
+  ev[4]= type;
+  int4store(ev + 5, 1);
+  int4store(ev + 9, event_length);
+  int4store(ev + 13, (uint32)(pos + event_length));
+  int2store(ev + 17, 0);
+  memcpy(ev + 19, body, length);
+  int4store(ev + 19 + length, crc32_ref(0, ev, 19 + length));
+  return pos + event_length;
+}
+
+static int read_crc_binlog(const char *file, int *events)
+{
+  MARIADB_RPL *rpl= mariadb_rpl_init_ex(NULL, MARIADB_RPL_VERSION);
+  MARIADB_RPL_EVENT *event= NULL;
+  uint32_t verify= 0;
+
+  *events= 0;
+  FAIL_IF(!rpl, "mariadb_rpl_init_ex failed");
+  /* length 0: file name is copied with terminating zero */
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_FILENAME, file, (size_t)0);
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_VERIFY_CHECKSUM, 1);
+  mariadb_rpl_get_optionsv(rpl, MARIADB_RPL_VERIFY_CHECKSUM, &verify);
+  FAIL_IF(verify != 1, "checksum verification not enabled");
+  if (mariadb_rpl_open(rpl))
+  {
+    mariadb_rpl_close(rpl);
+    diag("can't open %s", file);
+    return FAIL;
+  }
+  while ((event= mariadb_rpl_fetch(rpl, event)))
+  {
+    if (event->event_type == XID_EVENT && event->event.xid.transaction_nr != 4711)
+    {
+      mariadb_free_rpl_event(event);
+      mariadb_rpl_close(rpl);
+      diag("wrong xid");
+      return FAIL;
+    }
+    (*events)++;
+  }
+  mariadb_rpl_close(rpl);
+  return OK;
+}
+
+static int test_rpl_checksum(MYSQL *unused __attribute__((unused)))
+{
+  const char *file= "./rpl_checksum.bin";
+  enum enum_ma_simd_level level, best= ma_simd_detect();
+  uchar buf[2048], body[128];
+  size_t len, ofs, pos;
+  uint32 crc, seed;
+  int checked= 0, events;
+  FILE *fp;
+
+  /* the CRC kernels against a bitwise reference */
+  for (pos= 0; pos < sizeof(buf); pos++)
+    buf[pos]= (uchar)(pos * 131 + (pos >> 7));
+  for (len= 0; len < 600; len++)
+  for (ofs= 0; ofs < 8; ofs+= 3)
+  {
+    seed= len % 3 ? 0 : crc32_ref(0, buf + 1000, len % 64);
+    crc= crc32_ref(seed, buf + ofs, len);
+    for (level= MA_SIMD_SCALAR; level <= MA_SIMD_NEON; level++)
+    {
+      if (ma_simd_set_level(level))
+        continue;
+      if (ma_simd_crc32(seed, buf + ofs, len) != crc)
+      {
+        diag("crc32 differs: length %zu, offset %zu, level %d", len, ofs, level);
+        ma_simd_set_level(best);
+        return FAIL;
+      }
+      checked++;
+    }
+  }
+  ma_simd_set_level(best);
+  diag("%d comparisons, simd level %d", checked, best);
+
+  /* binlog file: format description and xid events with checksums */
+  memcpy(buf, "\xfe" "bin", 4);
+  memset(body, 0, sizeof(body));
+  int2store(body, 4);
+  strcpy((char *)body + 2, "10.6.0-test");
+  body[56]= 19;
+  body[57 + 40]= 1;  /* BINLOG_CHECKSUM_ALG_CRC32 */
+  pos= write_crc_event(buf, 4, FORMAT_DESCRIPTION_EVENT, body, 57 + 41);
+  int8store(body, (ulonglong)4711);
+  pos= write_crc_event(buf, pos, XID_EVENT, body, 8);
+  pos= write_crc_event(buf, pos, XID_EVENT, body, 8);
+
+  for (ofs= 0; ofs < 2; ofs++)
+  {
+    /* second run: flip a bit of the second xid */
+    if (ofs)
+      buf[pos - 4 - 3]^= 0x10;
+    FAIL_IF(!(fp= fopen(file, "wb")), "can't create binlog file");
+    FAIL_IF(fwrite(buf, 1, pos, fp) != pos, "can't write binlog file");
+    fclose(fp);
+    if (read_crc_binlog(file, &events))
+    {
+      remove(file);
+      return FAIL;
+    }
+    diag("%d events", events);
+    FAIL_IF(events != (ofs ? 2 : 3), "checksum verification failed");
+  }
+  remove(file);
+  return OK;
+}
+
+/*
+  Writes a binlog file with checksums: per statement a table map, one to
+  three rows events and a xid event. Returns the number of rows.
+*/
+static int write_rows_binlog(const char *file, int statements)
+{
+  uchar *buf, body[2048];
+  size_t pos, len;
+  int stmt, part, r, rows= 0;
+  FILE *fp;
+
+  if (!(buf= (uchar *)malloc((size_t)statements * 8192 + 1024)))
+    return -1;
+  memcpy(buf, "\xfe" "bin", 4);
+  memset(body, 0, sizeof(body));
+  int2store(body, 4);
+  strcpy((char *)body + 2, "10.6.0-test");
+  body[56]= 19;
+  body[57 + 40]= 1;  /* BINLOG_CHECKSUM_ALG_CRC32 */
+  pos= write_crc_event(buf, 4, FORMAT_DESCRIPTION_EVENT, body, 57 + 41);
+
+  for (stmt= 0; stmt < statements; stmt++)
+  {
+    ulonglong table_id= 100 + stmt % 3;
+    int parts= 1 + stmt % 3;
+
+    /* table test.tN (a int, b varchar(100)) */
+    int6store(body, table_id);
+    int2store(body + 6, 0);
+    len= 8;
+    body[len++]= 4;
+    memcpy(body + len, "test", 5);
+    len+= 5;
+    body[len++]= 2;
+    body[len++]= 't';
+    body[len++]= (uchar)('0' + stmt % 3);
+    body[len++]= 0;
+    body[len++]= 2;
+    body[len++]= MYSQL_TYPE_LONG;
+    body[len++]= MYSQL_TYPE_VARCHAR;
+    body[len++]= 2;
+    int2store(body + len, 100);
+    len+= 2;
+    body[len++]= 0;
+    pos= write_crc_event(buf, pos, TABLE_MAP_EVENT, body, len);
+
+    for (part= 0; part < parts; part++)
+    {
+      int6store(body, table_id);
+      int2store(body + 6, part == parts - 1 ? 1 : 0);  /* statement end */
+      body[8]= 2;
+      body[9]= 3;
+      len= 10;
+      for (r= 0; r < 1 + (stmt * 7 + part) % 20; r++)
+      {
+        int v= stmt * 1000 + part * 100 + r;
+        my_bool is_null= v % 11 == 0;
+
+        body[len++]= is_null ? 2 : 0;
+        int4store(body + len, v);
+        len+= 4;
+        if (!is_null)
+        {
+          body[len++]= (uchar)(v % 50);
+          memset(body + len, 'x', v % 50);
+          len+= v % 50;
+        }
+        rows++;
+      }
+      pos= write_crc_event(buf, pos,
+                           stmt % 2 ? WRITE_ROWS_EVENT_V1 : DELETE_ROWS_EVENT_V1,
+                           body, len);
+    }
+    int8store(body, (ulonglong)stmt);
+    pos= write_crc_event(buf, pos, XID_EVENT, body, 8);
+  }
+
+  if (!(fp= fopen(file, "wb")) || fwrite(buf, 1, pos, fp) != pos)
+    rows= -1;
+  if (fp)
+    fclose(fp);
+  free(buf);
+  return rows;
+}
+
+/*
+  Events read from a binlog file are read into the packet buffer of the
+  event, which is reused for the next event, and once all kinds of events
+  were seen a stream doesn't allocate memory anymore.
+*/
+static int test_rpl_file_buffers(MYSQL *unused __attribute__((unused)))
+{
+  const char *file= "./rpl_file_buffers.bin";
+  MARIADB_RPL *rpl;
+  MARIADB_RPL_EVENT *event= NULL;
+  MARIADB_RPL_ROW *row;
+  uchar *buffer= NULL;
+  int rows, events= 0, extracted= 0, rc= OK;
+  unsigned long mallocs= 0;
+
+  FAIL_IF((rows= write_rows_binlog(file, 300)) < 0, "can't write binlog file");
+
+  rpl= mariadb_rpl_init_ex(NULL, MARIADB_RPL_VERSION);
+  FAIL_IF(!rpl, "mariadb_rpl_init_ex failed");
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_FILENAME, file, (size_t)0);
+  mariadb_rpl_optionsv(rpl, MARIADB_RPL_EXTRACT_VALUES, 1);
+  if (mariadb_rpl_open(rpl))
+  {
+    mariadb_rpl_close(rpl);
+    remove(file);
+    diag("can't open %s", file);
+    return FAIL;
+  }
+
+  while (rc == OK)
+  {
+#ifdef HAVE_MALLOC_COUNT
+    /* all kinds of events and rows were seen after 60 statements */
+    malloc_counting= events >= 400;
+#endif
+    event= mariadb_rpl_fetch(rpl, event);
+#ifdef HAVE_MALLOC_COUNT
+    malloc_counting= 0;
+#endif
+    if (!event)
+      break;
+    events++;
+    if (event->raw_data != event->packet_buffer)
+    {
+      diag("event %d wasn't read into the packet buffer", events);
+      rc= FAIL;
+    }
+    else if (buffer && event->packet_buffer != buffer)
+    {
+      diag("event %d: packet buffer wasn't reused", events);
+      rc= FAIL;
+    }
+    buffer= event->packet_buffer;
+    if (IS_ROW_EVENT(event))
+      for (row= event->rows; row; row= row->next)
+        extracted++;
+  }
+#ifdef HAVE_MALLOC_COUNT
+  mallocs= malloc_count;
+#endif
+  mariadb_free_rpl_event(event);
+  mariadb_rpl_close(rpl);
+  remove(file);
+  diag("%d events, %d rows, %lu allocations in steady state", events, extracted, mallocs);
+  FAIL_IF(rc != OK, "packet buffer not reused");
+  FAIL_IF(extracted != rows, "rows missing");
+  FAIL_IF(mallocs, "memory allocated in steady state");
+  return OK;
+}
+
+/* ma_free_root(MY_MARK_BLOCKS_FREE) keeps all blocks for the next use */
+static int test_rpl_memroot_recycle(MYSQL *unused __attribute__((unused)))
+{
+  MA_MEM_ROOT root;
+  MA_USED_MEM *block;
+  uchar *blocks[64];
+  uint count= 0, free_count= 0, i, k, round;
+  unsigned long mallocs= 0;
+
+  ma_init_alloc_root(&root, 1024, 0);
+  for (round= 0; round < 3; round++)
+  {
+#ifdef HAVE_MALLOC_COUNT
+    malloc_counting= round > 0;
+#endif
+    for (i= 0; i < 40; i++)
+    {
+      uchar *p= (uchar *)ma_alloc_root(&root, 50 + i * 20);
+
+      FAIL_IF(!p, "ma_alloc_root failed");
+      memset(p, (int)i, 50 + i * 20);
+      if (!round)
+        continue;
+      /* later rounds allocate from the blocks of the first round */
+      for (k= 0; k < count; k++)
+        if (p > blocks[k] && p < blocks[k] + ((MA_USED_MEM *)blocks[k])->size)
+          break;
+      FAIL_IF(k == count, "memory not taken from a recycled block");
+    }
+#ifdef HAVE_MALLOC_COUNT
+    malloc_counting= 0;
+    mallocs+= malloc_count;
+    malloc_count= 0;
+#endif
+    if (!round)
+    {
+      for (block= root.used; block && count < 64; block= block->next)
+        blocks[count++]= (uchar *)block;
+      for (block= root.free; block && count < 64; block= block->next)
+        blocks[count++]= (uchar *)block;
+    }
+    ma_free_root(&root, MYF(MY_MARK_BLOCKS_FREE));
+    FAIL_IF(root.used, "blocks still in use");
+    for (free_count= 0, block= root.free; block; block= block->next)
+      free_count++;
+    FAIL_IF(free_count != count, "blocks were released");
+  }
+  ma_free_root(&root, MYF(0));
+  diag("%u blocks, %lu allocations after the first round", count, mallocs);
+  FAIL_IF(mallocs, "memory allocated for recycled blocks");
+  return OK;
+}
+
 struct my_tests_st my_tests[] = {
+  {"test_rpl_checksum", test_rpl_checksum, TEST_CONNECTION_NONE, 0, NULL, NULL},
+  {"test_rpl_file_buffers", test_rpl_file_buffers, TEST_CONNECTION_NONE, 0, NULL, NULL},
+  {"test_rpl_memroot_recycle", test_rpl_memroot_recycle, TEST_CONNECTION_NONE, 0, NULL, NULL},
   {"test_conc689", test_conc689, TEST_CONNECTION_NEW, 0, NULL, NULL},
   {"test_conc592", test_conc592, TEST_CONNECTION_NEW, 0, NULL, NULL},
   {"test_rpl_async", test_rpl_async, TEST_CONNECTION_NEW, 0, NULL, NULL},
   {"test_rpl_semisync", test_rpl_semisync, TEST_CONNECTION_NEW, 0, NULL, NULL},
   {"test_conc467", test_conc467, TEST_CONNECTION_NEW, 0, NULL, NULL},
+  {"test_rpl_decode_threads", test_rpl_decode_threads, TEST_CONNECTION_NEW, 0, NULL, NULL},
+  {"test_rpl_zero_copy", test_rpl_zero_copy, TEST_CONNECTION_NEW, 0, NULL, NULL},
+  {"test_rpl_table_filter", test_rpl_table_filter, TEST_CONNECTION_NEW, 0, NULL, NULL},
   {NULL, NULL, 0, 0, NULL, NULL}
 };
 
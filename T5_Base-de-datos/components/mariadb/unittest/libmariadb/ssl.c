@@ -27,6 +27,13 @@
 #ifdef HAVE_OPENSSL
 #include <openssl/opensslv.h>
 #include <openssl/ssl.h>
+#include <ma_pvio.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
 #endif
 
 #define FNLEN 4096
@@ -1352,8 +1359,161 @@ static int test_ssl_verify(MYSQL *my __attribute__((unused)))
 }
 #endif
 
+#ifdef HAVE_OPENSSL
+static SSL_CTX *get_ssl_ctx(MYSQL *mysql)
+{
+  return SSL_get_SSL_CTX((SSL *)mysql->net.pvio->ctls->ssl);
+}
+
+static my_bool has_session_ticket(MYSQL *mysql)
+{
+#if OPENSSL_VERSION_NUMBER >= 0x10101000L && !defined(LIBRESSL_VERSION_NUMBER)
+  SSL_SESSION *session= SSL_get_session((SSL *)mysql->net.pvio->ctls->ssl);
+  return session && SSL_SESSION_has_ticket(session);
+#else
+  return 1;
+#endif
+}
+#endif
+
+static int test_tls_session_reuse(MYSQL *unused __attribute__((unused)))
+{
+  MYSQL *mysql;
+  my_bool verify= 1, reused;
+  int i, rc, count= 0;
+#ifdef HAVE_OPENSSL
+  int tickets= 0;
+#endif
+  const char *version[]= {NULL, "TLSv1.2"};
+
+  if (check_skip_ssl())
+    return SKIP;
+
+  for (i= 0; i < 10; i++)
+  {
+    mysql= mysql_init(NULL);
+    mysql_ssl_set(mysql, 0, 0, sslca, 0, 0);
+    mysql_options(mysql, MYSQL_OPT_SSL_VERIFY_SERVER_CERT, &verify);
+    /* every second connection uses a different TLS context */
+    if (have_openssl)
+      mysql_options(mysql, MARIADB_OPT_TLS_VERSION, version[i % 2]);
+    FAIL_IF(!mysql_real_connect(mysql, hostname, username, password, schema,
+                           ssl_port, socketname, 0), mysql_error(mysql));
+    FAIL_IF(check_cipher(mysql) != 0, "Invalid cipher");
+    rc= mysql_query(mysql, "SELECT 1");
+    check_mysql_rc(rc, mysql);
+    mysql_free_result(mysql_store_result(mysql));
+
+    rc= mariadb_get_infov(mysql, MARIADB_CONNECTION_TLS_SESSION_REUSED, &reused);
+    FAIL_IF(rc, "mariadb_get_infov failed");
+    count+= reused;
+#ifdef HAVE_OPENSSL
+    /* TLS 1.3 tickets arrive after the handshake, the query above read them */
+    tickets+= has_session_ticket(mysql);
+#endif
+    mysql_close(mysql);
+  }
+  diag("resumed sessions: %d of %d", count, i);
+#ifdef HAVE_OPENSSL
+  if (!count && !tickets)
+  {
+    diag("server doesn't issue session tickets");
+    return SKIP;
+  }
+  FAIL_IF(!count, "No session was resumed");
+#endif
+  return OK;
+}
+
+#ifdef HAVE_OPENSSL
+static int set_file_mtime(const char *file, time_t mtime)
+{
+  struct utimbuf times;
+
+  times.actime= times.modtime= mtime;
+  return utime(file, &times);
+}
+
+static int test_tls_ctx_cache(MYSQL *unused __attribute__((unused)))
+{
+  MYSQL *my[3];
+  const char *ca_copy= "tls_ctx_cache_ca.pem";
+  char buffer[4096];
+  size_t len;
+  FILE *in, *out;
+  time_t now= time(NULL);
+  int i, rc= FAIL;
+
+  if (check_skip_ssl())
+    return SKIP;
+
+  /* a private copy of the CA, so the test can change its mtime */
+  FAIL_IF(!(in= fopen(sslca, "rb")), "Can't open CA file");
+  if (!(out= fopen(ca_copy, "wb")))
+  {
+    fclose(in);
+    diag("Can't create %s", ca_copy);
+    return FAIL;
+  }
+  while ((len= fread(buffer, 1, sizeof(buffer), in)))
+    fwrite(buffer, 1, len, out);
+  fclose(in);
+  fclose(out);
+
+  memset(my, 0, sizeof(my));
+  if (set_file_mtime(ca_copy, now - 100))
+  {
+    diag("Can't set mtime of %s", ca_copy);
+    goto end;
+  }
+
+  for (i= 0; i < 3; i++)
+  {
+    /* the file changes before the third connection */
+    if (i == 2 && set_file_mtime(ca_copy, now - 50))
+    {
+      diag("Can't set mtime of %s", ca_copy);
+      goto end;
+    }
+    my[i]= mysql_init(NULL);
+    mysql_ssl_set(my[i], 0, 0, ca_copy, 0, 0);
+    if (!mysql_real_connect(my[i], hostname, username, password, schema,
+                            ssl_port, socketname, 0))
+    {
+      diag("Error: %s", mysql_error(my[i]));
+      goto end;
+    }
+  }
+
+  /* all connections are still open, so no context can have been freed and
+     reallocated at the same address */
+  if (get_ssl_ctx(my[0]) != get_ssl_ctx(my[1]))
+  {
+    diag("Connections with identical options use different contexts");
+    goto end;
+  }
+  if (get_ssl_ctx(my[0]) == get_ssl_ctx(my[2]))
+  {
+    diag("Context wasn't rebuilt after the CA file changed");
+    goto end;
+  }
+  rc= OK;
+
+end:
+  for (i= 0; i < 3; i++)
+    if (my[i])
+      mysql_close(my[i]);
+  remove(ca_copy);
+  return rc;
+}
+#endif
+
 struct my_tests_st my_tests[] = {
   {"test_ssl", test_ssl, TEST_CONNECTION_NEW, 0,  NULL,  NULL},
+  {"test_tls_session_reuse", test_tls_session_reuse, TEST_CONNECTION_NEW, 0,  NULL,  NULL},
+#ifdef HAVE_OPENSSL
+  {"test_tls_ctx_cache", test_tls_ctx_cache, TEST_CONNECTION_NEW, 0,  NULL,  NULL},
+#endif
 #ifndef HAVE_SCHANNEL
   {"test_ssl_verify", test_ssl_verify, TEST_CONNECTION_NEW, 0,  NULL,  NULL},
 #endif
@@ -3,6 +3,7 @@
 
 #include "my_test.h"
 #include <ma_pthread.h>
+#include <mariadb_pool.h>
 
 static int basic_connect(MYSQL *unused __attribute__((unused)))
 {
@@ -156,9 +157,250 @@ end:
   return 0;
 }
 
+static int test_pool(MYSQL *unused __attribute__((unused)))
+{
+  MARIADB_POOL *pool;
+  MARIADB_POOL_STATS stats;
+  MYSQL *m1, *m2, *m3;
+  MYSQL_RES *res;
+  MYSQL_ROW row;
+  int rc;
+
+  pool= mariadb_pool_init();
+  FAIL_IF(!pool, "mariadb_pool_init failed");
+  mariadb_pool_optionsv(pool, MARIADB_POOL_MIN_SIZE, 1);
+  mariadb_pool_optionsv(pool, MARIADB_POOL_MAX_SIZE, 2);
+  mariadb_pool_optionsv(pool, MARIADB_POOL_WAIT_TIMEOUT, 100);
+  rc= mariadb_pool_open(pool, hostname, username, password, schema,
+                        port, socketname, 0);
+  FAIL_IF(rc, mariadb_pool_error(pool));
+
+  mariadb_pool_get_stats(pool, &stats);
+  FAIL_IF(stats.size != 1 || stats.idle != 1, "Expected one idle connection");
+
+  m1= mariadb_pool_acquire(pool);
+  FAIL_IF(!m1, mariadb_pool_error(pool));
+  rc= mysql_query(m1, "SET @a=1");
+  check_mysql_rc(rc, m1);
+  mariadb_pool_release(pool, m1);
+
+  /* same connection, but session state was reset */
+  m2= mariadb_pool_acquire(pool);
+  FAIL_IF(m2 != m1, "Expected the released connection");
+  rc= mysql_query(m2, "SELECT @a IS NULL");
+  check_mysql_rc(rc, m2);
+  res= mysql_store_result(m2);
+  FAIL_IF(!res, mysql_error(m2));
+  row= mysql_fetch_row(res);
+  FAIL_IF(!row || strcmp(row[0], "1"), "Session variable wasn't reset");
+  mysql_free_result(res);
+
+  m3= mariadb_pool_acquire(pool);
+  FAIL_IF(!m3 || m3 == m2, "Expected a new connection");
+
+  /* pool is exhausted */
+  FAIL_IF(mariadb_pool_acquire(pool), "Expected timeout");
+  FAIL_IF(mariadb_pool_errno(pool) != CR_POOL_TIMEOUT, "Expected CR_POOL_TIMEOUT");
+
+  mariadb_pool_get_stats(pool, &stats);
+  FAIL_IF(stats.size != 2 || stats.in_use != 2, "Expected two connections in use");
+  FAIL_IF(stats.acquired != 3 || stats.created != 2, "Wrong acquire/create count");
+  FAIL_IF(stats.waits != 1 || stats.timeouts != 1, "Wrong wait count");
+  FAIL_IF(stats.wait_time < 100000, "Wait time too short");
+
+  mariadb_pool_release(pool, m2);
+  mariadb_pool_release(pool, m3);
+
+  mariadb_pool_get_stats(pool, &stats);
+  FAIL_IF(stats.idle != 2 || stats.in_use != 0, "Expected two idle connections");
+  FAIL_IF(!stats.busy_time || stats.busy_time > stats.lifetime * 2, "Wrong busy time");
+
+  mariadb_pool_close(pool);
+  return OK;
+}
+
+/* fails once *data connections were set up */
+static int pool_fail_connect(MYSQL *mysql, void *data)
+{
+  int *left= (int *)data;
+
+  return (*left)-- <= 0;
+}
+
+static int test_pool_open_error(MYSQL *unused __attribute__((unused)))
+{
+  MARIADB_POOL *pool;
+  MARIADB_POOL_STATS stats;
+  int rc, left= 2;
+
+  pool= mariadb_pool_init();
+  FAIL_IF(!pool, "mariadb_pool_init failed");
+  mariadb_pool_optionsv(pool, MARIADB_POOL_MIN_SIZE, 4);
+  mariadb_pool_optionsv(pool, MARIADB_POOL_MAX_SIZE, 4);
+  mariadb_pool_optionsv(pool, MARIADB_POOL_INIT_CALLBACK, pool_fail_connect, &left);
+  rc= mariadb_pool_open(pool, hostname, username, password, schema,
+                        port, socketname, 0);
+  FAIL_IF(!rc, "Expected the third connection to fail");
+
+  /* the connections of the warm-up are closed and the pool stays closed */
+  mariadb_pool_get_stats(pool, &stats);
+  FAIL_IF(stats.size || stats.idle, "Connections left in the pool");
+  FAIL_IF(stats.created != 2 || stats.closed != 2, "Wrong create/close count");
+  FAIL_IF(mariadb_pool_acquire(pool), "Pool is open");
+
+  left= 4;
+  rc= mariadb_pool_open(pool, hostname, username, password, schema,
+                        port, socketname, 0);
+  FAIL_IF(rc, mariadb_pool_error(pool));
+  mariadb_pool_get_stats(pool, &stats);
+  FAIL_IF(stats.size != 4 || stats.idle != 4, "Expected four idle connections");
+
+  mariadb_pool_close(pool);
+  return OK;
+}
+
+static int test_pool_dead_connection(MYSQL *mysql)
+{
+  MARIADB_POOL *pool;
+  MARIADB_POOL_STATS stats;
+  MYSQL *m1, *m2;
+  unsigned long thread_id;
+  char query[64];
+  int rc;
+
+  pool= mariadb_pool_init();
+  FAIL_IF(!pool, "mariadb_pool_init failed");
+  mariadb_pool_optionsv(pool, MARIADB_POOL_MIN_SIZE, 1);
+  mariadb_pool_optionsv(pool, MARIADB_POOL_MAX_SIZE, 2);
+  rc= mariadb_pool_open(pool, hostname, username, password, schema,
+                        port, socketname, 0);
+  FAIL_IF(rc, mariadb_pool_error(pool));
+
+  m1= mariadb_pool_acquire(pool);
+  FAIL_IF(!m1, mariadb_pool_error(pool));
+  thread_id= mysql_thread_id(m1);
+  mariadb_pool_release(pool, m1);
+
+  sprintf(query, "KILL %lu", thread_id);
+  rc= mysql_query(mysql, query);
+  check_mysql_rc(rc, mysql);
+  sleep(1);
+
+  /* the killed connection fails the probe and is replaced */
+  m2= mariadb_pool_acquire(pool);
+  FAIL_IF(!m2, mariadb_pool_error(pool));
+  FAIL_IF(mysql_thread_id(m2) == thread_id, "Got the killed connection");
+
+  mariadb_pool_get_stats(pool, &stats);
+  FAIL_IF(stats.broken != 1, "Expected one broken connection");
+  FAIL_IF(stats.acquired != 2, "Broken connection was counted as acquired");
+
+  mariadb_pool_release(pool, m2);
+  mariadb_pool_close(pool);
+  return OK;
+}
+
+#define POOL_THREADS 8
+#define POOL_LOOPS 100
+
+#ifndef _WIN32
+static void *pool_thread(void *arg)
+#else
+static DWORD WINAPI pool_thread(void *arg)
+#endif
+{
+  MARIADB_POOL *pool= (MARIADB_POOL *)arg;
+  int i;
+
+  mysql_thread_init();
+  for (i= 0; i < POOL_LOOPS; i++)
+  {
+    MYSQL *mysql;
+
+    if (!(mysql= mariadb_pool_acquire(pool)))
+    {
+      diag("acquire failed: %s", mariadb_pool_error(pool));
+      break;
+    }
+    if (mysql_query(mysql, "UPDATE t_pool SET a=a+1"))
+      diag("Error: %s", mysql_error(mysql));
+    mariadb_pool_release(pool, mysql);
+  }
+  mysql_thread_end();
+  return 0;
+}
+
+static int test_pool_threads(MYSQL *mysql)
+{
+  MARIADB_POOL *pool;
+  MARIADB_POOL_STATS stats;
+  MYSQL_RES *res;
+  MYSQL_ROW row;
+  int rc, i;
+#ifndef _WIN32
+  pthread_t threads[POOL_THREADS];
+#else
+  HANDLE threads[POOL_THREADS];
+#endif
+
+  rc= mysql_query(mysql, "CREATE OR REPLACE TABLE t_pool (a int)");
+  check_mysql_rc(rc, mysql);
+  rc= mysql_query(mysql, "INSERT INTO t_pool VALUES (0)");
+  check_mysql_rc(rc, mysql);
+
+  pool= mariadb_pool_init();
+  FAIL_IF(!pool, "mariadb_pool_init failed");
+  mariadb_pool_optionsv(pool, MARIADB_POOL_MAX_SIZE, 4);
+  rc= mariadb_pool_open(pool, hostname, username, password, schema,
+                        port, socketname, 0);
+  FAIL_IF(rc, mariadb_pool_error(pool));
+
+  for (i= 0; i < POOL_THREADS; i++)
+  {
+#ifndef _WIN32
+    pthread_create(&threads[i], NULL, pool_thread, pool);
+#else
+    threads[i]= CreateThread(NULL, 0, pool_thread, pool, 0, NULL);
+#endif
+  }
+  for (i= 0; i < POOL_THREADS; i++)
+  {
+#ifndef _WIN32
+    pthread_join(threads[i], NULL);
+#else
+    WaitForSingleObject(threads[i], INFINITE);
+    CloseHandle(threads[i]);
+#endif
+  }
+
+  mariadb_pool_get_stats(pool, &stats);
+  diag("acquired: %llu created: %llu waits: %llu wait_time: %llu us",
+       stats.acquired, stats.created, stats.waits, stats.wait_time);
+  FAIL_IF(stats.acquired != POOL_THREADS * POOL_LOOPS, "Wrong acquire count");
+  FAIL_IF(stats.created > 4 || stats.size > 4, "Pool exceeded max size");
+  FAIL_IF(stats.in_use, "Connections weren't released");
+  mariadb_pool_close(pool);
+
+  rc= mysql_query(mysql, "SELECT a FROM t_pool");
+  check_mysql_rc(rc, mysql);
+  res= mysql_store_result(mysql);
+  FAIL_IF(!res, mysql_error(mysql));
+  row= mysql_fetch_row(res);
+  FAIL_IF(!row || atoi(row[0]) != POOL_THREADS * POOL_LOOPS, "Wrong number of updates");
+  mysql_free_result(res);
+
+  rc= mysql_query(mysql, "DROP TABLE t_pool");
+  check_mysql_rc(rc, mysql);
+  return OK;
+}
+
 struct my_tests_st my_tests[] = {
   {"basic_connect", basic_connect, TEST_CONNECTION_NONE, 0,  NULL,  NULL},
   {"test_conc_27", test_conc_27, TEST_CONNECTION_NEW, 0, NULL, NULL},
+  {"test_pool", test_pool, TEST_CONNECTION_NONE, 0, NULL, NULL},
+  {"test_pool_open_error", test_pool_open_error, TEST_CONNECTION_NONE, 0, NULL, NULL},
+  {"test_pool_dead_connection", test_pool_dead_connection, TEST_CONNECTION_DEFAULT, 0, NULL, NULL},
+  {"test_pool_threads", test_pool_threads, TEST_CONNECTION_DEFAULT, 0, NULL, NULL},
   {NULL, NULL, 0, 0, NULL, NULL}
 };
 